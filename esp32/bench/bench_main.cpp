@@ -0,0 +1,256 @@
+/**
+ * PlanetPlant Firmware Core Benchmarks
+ * Host-side cost of the hot paths the network and sensing tasks run:
+ * payload serialization, MQTT framing, command and settings parsing, the
+ * scheduler under a sensing-like task set, and memory per queued message.
+ *
+ *   pio run -e native && .pio/build/native/program
+ *
+ * Host timings are for comparing changes, not absolute ESP32 figures;
+ * the device-side numbers come from evt/metrics.
+ */
+
+#include <chrono>
+#include <functional>
+#include "hal.h"
+#include "config.h"
+#include "messages.h"
+#include "scheduler.h"
+#include "report_filter.h"
+#include "runtime_settings.h"
+#include "telemetry_codec.h"
+#include "payloads.h"
+#include "mqtt_codec.h"
+#include "topics.h"
+
+#define BENCH_ITERATIONS 100000
+#define BENCH_DEVICE_ID  "plantplant_esp32_bench"
+#define BENCH_EPOCH_MS   1760000000000ULL  // Synced clock, so timestamps have wire size
+
+static StaticJsonDocument<JSON_TX_DOC_SIZE> txDoc;
+static StaticJsonDocument<JSON_RX_DOC_SIZE> rxDoc;
+static char txBuffer[MQTT_MAX_PACKET_SIZE];
+
+// Keeps results observable so the optimizer cannot drop the work
+static volatile size_t sink;
+
+static double nsPerOp(uint32_t iterations, const std::function<void()>& body) {
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) {
+    body();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+}
+
+static void report(const char* name, double ns, size_t bytes) {
+  printf("  %-28s %10.0f ns/op %8u bytes\n", name, ns, (unsigned)bytes);
+}
+
+static TelemetrySample liveSample(uint32_t i) {
+  TelemetrySample sample = {};
+  sample.timestamp = BENCH_EPOCH_MS + 60000ULL * i;
+  sample.epoch = true;
+  sample.temperature = 21.5f + (i % 7) * 0.1f;
+  sample.humidity = 55.25f;
+  sample.moisture = 42;
+  sample.light = 73;
+  sample.wifiRssi = -61;
+  sample.freeHeap = 182344;
+  sample.uptime = 60000 * i;
+  sample.bootId = 17;
+  return sample;
+}
+
+static SensorAggregates aggregatesFixture() {
+  SensorAggregates aggregates = {};
+  aggregates.windowMs = AGGREGATE_WINDOW;
+  aggregates.count = 60;
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    aggregates.channels[i] = { 20.0f + i, 24.5f + i, 22.1f + i, -0.35f };
+  }
+  return aggregates;
+}
+
+static void benchSerialization() {
+  printf("Serialization\n");
+
+  uint32_t i = 0;
+  double ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    buildSamplePayload(txDoc, BENCH_DEVICE_ID, liveSample(i++));
+    sink = serializeJson(txDoc, txBuffer, sizeof(txBuffer));
+  });
+  report("sample (json)", ns, sink);
+
+  uint8_t frame[TELEMETRY_SAMPLE_FRAME_SIZE];
+  ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    TelemetrySample sample = liveSample(i++);
+    sink = encodeSampleFrame(sample, frame, sizeof(frame));
+  });
+  report("sample (packed)", ns, sink);
+
+  TelemetryBatchSample batch[BATCH_MAX_SAMPLES];
+  for (int n = 0; n < BATCH_MAX_SAMPLES; n++) {
+    batch[n] = { (uint32_t)n * BATCH_SAMPLE_INTERVAL, (int16_t)(2150 + n), 5525, 42, 73, 0 };
+  }
+  TelemetryHeartbeat heartbeat = { -61, 182344, 3600000 };
+  uint8_t batchFrame[TELEMETRY_BATCH_FRAME_SIZE(BATCH_MAX_SAMPLES)];
+  ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    sink = encodeBatchFrame(batch, BATCH_MAX_SAMPLES, 3600000, 17, BENCH_EPOCH_MS, &heartbeat,
+                            batchFrame, sizeof(batchFrame));
+  });
+  report("batch (packed)", ns, sink);
+
+  SensorAggregates aggregates = aggregatesFixture();
+  ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    buildAggregatePayload(txDoc, BENCH_DEVICE_ID, aggregates, BENCH_EPOCH_MS);
+    sink = serializeJson(txDoc, txBuffer, sizeof(txBuffer));
+  });
+  report("aggregates (json)", ns, sink);
+
+  WateringResult result = { 6000, 46000, 3, 28, 47, WATERING_TARGET_REACHED };
+  ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    buildWateringPayload(txDoc, BENCH_DEVICE_ID, 0, result, BENCH_EPOCH_MS);
+    sink = serializeJson(txDoc, txBuffer, sizeof(txBuffer));
+  });
+  report("watering result (json)", ns, sink);
+
+  // What MqttLink adds on top of the payload, per publish and delivery
+  buildSamplePayload(txDoc, BENCH_DEVICE_ID, liveSample(1));
+  size_t length = serializeJson(txDoc, txBuffer, sizeof(txBuffer));
+  static uint8_t packet[MQTT_MAX_PACKET_SIZE];
+  static const char topic[] =
+      TOPIC_ROOT "/" TOPIC_VERSION "/" MQTT_SITE "/00/" BENCH_DEVICE_ID "/" TOPIC_EVENTS "/" TOPIC_DATA;
+  ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    sink = mqttEncodePublish(topic, (const uint8_t*)txBuffer, length, 1, (uint16_t)i++, packet, sizeof(packet));
+  });
+  report("mqtt publish framing", ns, sink);
+
+  static uint8_t received[MQTT_MAX_PACKET_SIZE];
+  size_t packetLength = mqttEncodePublish(topic, (const uint8_t*)txBuffer, length, 1, 7, packet, sizeof(packet));
+  ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    // Parsing moves the topic in place, so every run gets a fresh copy
+    memcpy(received, packet, packetLength);
+    uint8_t type;
+    uint8_t flags;
+    uint32_t remaining;
+    int header = mqttDecodeHeader(received, packetLength, &type, &flags, &remaining);
+    MqttPublish publish;
+    sink = mqttParsePublish(flags, received + header, remaining, publish) ? publish.length : 0;
+  });
+  report("mqtt publish parsing", ns, packetLength);
+}
+
+static void benchParsing() {
+  printf("Callback parsing\n");
+
+  // parseWaterCommand() works in place, so every run gets a fresh copy
+  static const char water[] = "{\"action\":\"start\",\"duration\":5000,\"id\":\"cmd-1842\"}";
+  char payload[sizeof(water)];
+  Command command;
+  const char* error = nullptr;
+  double ns = nsPerOp(BENCH_ITERATIONS, [&]() {
+    memcpy(payload, water, sizeof(water));
+    sink = parseWaterCommand(rxDoc, payload, sizeof(water) - 1, command, &error);
+  });
+  report("water command", ns, sizeof(water) - 1);
+
+  Serial.quiet(true);
+  settingsBegin();
+  Serial.quiet(false);
+
+  // Alternate between two values so every update is applied and stored
+  static const char* const updates[] = {
+    "{\"settings\":{\"sensor_interval\":30000,\"deadband_moisture\":2.5,\"moisture_min\":25}}",
+    "{\"settings\":{\"sensor_interval\":60000,\"deadband_moisture\":2.0,\"moisture_min\":30}}"
+  };
+  char config[128];
+  uint32_t i = 0;
+  ns = nsPerOp(BENCH_ITERATIONS / 10, [&]() {
+    const char* update = updates[i++ % 2];
+    size_t length = strlen(update);
+    memcpy(config, update, length + 1);
+    deserializeJson(rxDoc, config, length);
+    sink = settingsApply(rxDoc["settings"].as<JsonObject>(), &error);
+  });
+  report("config update (3 keys)", ns, strlen(updates[0]));
+}
+
+// Sensing task set from main.cpp on a virtual clock. Each callback moves
+// the clock forward by its typical on-device cost, so the scheduler sees
+// the same collisions it does on core 1.
+static uint32_t virtualNow = 0;
+static Scheduler benchScheduler;
+static int dhtServiceId = SCHEDULER_INVALID_TASK;
+static uint32_t callbackRuns = 0;
+
+static void simulateCost(uint32_t ms) {
+  virtualNow += ms;
+  callbackRuns++;
+}
+
+static void sensorCallback() { simulateCost(3); }        // ADC averages, filter, post
+static void adcCallback() { simulateCost(1); }           // DMA ring drain
+static void dhtServiceCallback() { simulateCost(5); }    // RMT capture decode
+
+static void dhtCallback() {
+  simulateCost(0);
+  benchScheduler.runIn(dhtServiceId, DHT_START_PULSE_MS, virtualNow);
+}
+
+static void benchScheduler24h() {
+  printf("Scheduler (24 h virtual, sensing task set)\n");
+
+  RuntimeSettings settings = settingsSnapshot();
+  benchScheduler.add(sensorCallback, settings.sensorInterval, settings.sensorInterval, virtualNow);
+  benchScheduler.add(adcCallback, ADC_POLL_INTERVAL, 0, virtualNow);
+  benchScheduler.add(dhtCallback, DHT_READ_INTERVAL, DHT_RETRY_DELAY, virtualNow);
+  dhtServiceId = benchScheduler.add(dhtServiceCallback, 0, 0, virtualNow);
+
+  const uint32_t end = 24UL * 60 * 60 * 1000;
+  uint32_t wakes = 0;
+  auto started = std::chrono::steady_clock::now();
+  while (virtualNow < end) {
+    benchScheduler.run(virtualNow);
+    virtualNow += benchScheduler.timeUntilNext(virtualNow, 1000);
+    wakes++;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / wakes;
+
+  printf("  %-28s %10.0f ns/op\n", "run() + timeUntilNext()", ns);
+  printf("  %-28s %10lu\n", "wake-ups", (unsigned long)wakes);
+  printf("  %-28s %10lu\n", "callbacks", (unsigned long)callbackRuns);
+  printf("  %-28s %10lu ms\n", "max jitter", (unsigned long)benchScheduler.maxJitter());
+}
+
+static void benchMemory() {
+  printf("Memory per message\n");
+  printf("  %-28s %10u bytes\n", "NetEvent", (unsigned)sizeof(NetEvent));
+  printf("  %-28s %10u bytes\n", "Command", (unsigned)sizeof(Command));
+  printf("  %-28s %10u bytes\n", "eventQueue", (unsigned)sizeof(eventQueue));
+  printf("  %-28s %10u bytes\n", "commandQueue", (unsigned)sizeof(commandQueue));
+  printf("  %-28s %10u bytes\n", "ReportFilter (RTC)", (unsigned)sizeof(ReportFilter));
+  printf("  %-28s %10u bytes\n", "RuntimeSettings", (unsigned)sizeof(RuntimeSettings));
+
+  // Pool use of the static documents next to their capacity
+  printf("  %-28s %10u bytes\n", "txDoc capacity", (unsigned)txDoc.capacity());
+  buildSamplePayload(txDoc, BENCH_DEVICE_ID, liveSample(1));
+  printf("  %-28s %10u bytes pool, %u on the wire\n", "sample (json)",
+         (unsigned)txDoc.memoryUsage(), (unsigned)measureJson(txDoc));
+  buildAggregatePayload(txDoc, BENCH_DEVICE_ID, aggregatesFixture(), BENCH_EPOCH_MS);
+  printf("  %-28s %10u bytes pool, %u on the wire\n", "aggregates (json)",
+         (unsigned)txDoc.memoryUsage(), (unsigned)measureJson(txDoc));
+  settingsToJson(settingsSnapshot(), txDoc.to<JsonObject>());
+  printf("  %-28s %10u bytes pool, %u on the wire\n", "settings (json)",
+         (unsigned)txDoc.memoryUsage(), (unsigned)measureJson(txDoc));
+}
+
+int main() {
+  printf("PlanetPlant firmware core benchmarks (%d iterations)\n\n", BENCH_ITERATIONS);
+  benchSerialization();
+  benchParsing();
+  benchScheduler24h();
+  benchMemory();
+  return 0;
+}
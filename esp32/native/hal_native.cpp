@@ -0,0 +1,84 @@
+/**
+ * PlanetPlant Native HAL
+ */
+
+#include <stdarg.h>
+#include <chrono>
+#include "hal_native.h"
+
+static const auto processStart = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  auto elapsed = std::chrono::steady_clock::now() - processStart;
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+uint32_t micros() {
+  auto elapsed = std::chrono::steady_clock::now() - processStart;
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char* destination, const char* source, size_t size) {
+  size_t length = strlen(source);
+  if (size > 0) {
+    size_t copied = length < size - 1 ? length : size - 1;
+    memcpy(destination, source, copied);
+    destination[copied] = 0;
+  }
+  return length;
+}
+#endif
+
+HostSerial Serial;
+
+int HostSerial::printf(const char* format, ...) {
+  if (silent) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vprintf(format, args);
+  va_end(args);
+  return written;
+}
+
+void HostSerial::println(const char* text) {
+  if (!silent) {
+    puts(text);
+  }
+}
+
+static std::map<std::string, std::vector<uint8_t>> storage;
+
+bool Preferences::begin(const char* name, bool readOnlyMode) {
+  space = name;
+  readOnly = readOnlyMode;
+  return true;
+}
+
+void Preferences::end() {
+  space.clear();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  if (readOnly || space.empty()) {
+    return 0;
+  }
+  const uint8_t* bytes = (const uint8_t*)value;
+  storage[space + "/" + key].assign(bytes, bytes + length);
+  return length;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t capacity) {
+  auto entry = storage.find(space + "/" + key);
+  if (entry == storage.end() || entry->second.size() > capacity) {
+    return 0;
+  }
+  memcpy(buffer, entry->second.data(), entry->second.size());
+  return entry->second.size();
+}
+
+bool Preferences::remove(const char* key) {
+  return !readOnly && storage.erase(space + "/" + key) > 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * PlanetPlant Native HAL
+ * Host stand-ins for the Arduino/FreeRTOS surface listed in src/hal.h, so
+ * the firmware core builds and runs under the PlatformIO native env
+ */
+
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// newlib has it on the device; glibc only from 2.38
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char* destination, const char* source, size_t size);
+#endif
+
+// Time since process start
+uint32_t millis();
+uint32_t micros();
+
+// RTC memory is ordinary memory on the host
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+// Task notifications have no consumer task to wake
+typedef void* TaskHandle_t;
+inline void xTaskNotifyGive(TaskHandle_t) {}
+
+// Critical sections
+struct portMUX_TYPE {
+  std::mutex mutex;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->mutex.lock()
+#define portEXIT_CRITICAL(mux) (mux)->mutex.unlock()
+
+// Serial logging goes to stdout; quiet() silences it for benchmarks
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  void println(const char* text);
+  void quiet(bool enabled) { silent = enabled; }
+
+private:
+  bool silent = false;
+};
+
+extern HostSerial Serial;
+
+// NVS namespaces kept in process memory
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  size_t putBytes(const char* key, const void* value, size_t length);
+  size_t getBytes(const char* key, void* buffer, size_t capacity);
+  bool remove(const char* key);
+
+private:
+  std::string space;
+  bool readOnly = false;
+};
+
+#endif // HAL_NATIVE_H
@@ -0,0 +1,187 @@
+/**
+ * PlanetPlant ESP32 ADC Sampler
+ * IDF 4.4 continuous ADC driver (I2S0 DMA on the ESP32), 12-bit, 11 dB
+ */
+
+#include <Arduino.h>
+#include <algorithm>
+#include <driver/adc.h>
+#include "adc_sampler.h"
+
+#define ADC_DEFAULT_VREF      1100    // mV, used when the eFuse has no calibration
+#define ADC_DMA_FRAME_BYTES   256     // Conversions per DMA interrupt * result size
+#define ADC_DMA_BUFFER_BYTES  4096    // Driver ring: ~100 ms at ADC_SAMPLE_RATE (~50 ms on the C3)
+
+// The ESP32 DMA writes 2-byte TYPE1 results; the C3 only has 4-byte TYPE2
+// ones, which also carry the unit
+#if CONFIG_IDF_TARGET_ESP32C3
+#define ADC_OUTPUT_FORMAT     ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_CONV_LIMIT        false
+#else
+#define ADC_OUTPUT_FORMAT     ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_CONV_LIMIT        true    // Required on the ESP32
+#endif
+
+AdcSampler adcSampler;
+
+static bool decodeResult(const adc_digi_output_data_t& result, uint8_t& channel, uint16_t& data) {
+#if CONFIG_IDF_TARGET_ESP32C3
+  if (result.type2.unit != 0) {
+    return false;  // ADC1 only
+  }
+  channel = result.type2.channel;
+  data = result.type2.data;
+#else
+  channel = result.type1.channel;
+  data = result.type1.data;
+#endif
+  return true;
+}
+
+bool AdcSampler::begin(const uint8_t* pins, uint8_t count) {
+  calSource = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                       ADC_DEFAULT_VREF, &characteristics);
+
+  channelCount = 0;
+  uint32_t channelMask = 0;
+  adc_digi_pattern_config_t pattern[ADC_MAX_CHANNELS] = {};
+
+  for (uint8_t i = 0; i < count && i < ADC_MAX_CHANNELS; i++) {
+    // ADC2 is unusable while WiFi runs and has no DMA path
+    int8_t adcChannel = digitalPinToAnalogChannel(pins[i]);
+    if (adcChannel < 0 || adcChannel >= 8) {
+      Serial.printf("⚠️  Pin %u is not an ADC1 input, using single reads\n", pins[i]);
+      return false;
+    }
+
+    Channel& channel = channels[channelCount++];
+    channel.pin = pins[i];
+    channel.adcChannel = adcChannel;
+    channel.head = 0;
+    channel.count = 0;
+    channelMask |= 1UL << adcChannel;
+
+    pattern[i].atten = ADC_ATTEN_DB_11;
+    pattern[i].channel = adcChannel;
+    pattern[i].unit = 0;  // ADC1
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_digi_init_config_t initConfig = {};
+  initConfig.max_store_buf_size = ADC_DMA_BUFFER_BYTES;
+  initConfig.conv_num_each_intr = ADC_DMA_FRAME_BYTES;
+  initConfig.adc1_chan_mask = channelMask;
+
+  adc_digi_configuration_t digiConfig = {};
+  digiConfig.conv_limit_en = ADC_CONV_LIMIT;
+  digiConfig.conv_limit_num = 250;
+  digiConfig.pattern_num = channelCount;
+  digiConfig.adc_pattern = pattern;
+  digiConfig.sample_freq_hz = ADC_SAMPLE_RATE;
+  digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digiConfig.format = ADC_OUTPUT_FORMAT;
+
+  if (adc_digi_initialize(&initConfig) != ESP_OK ||
+      adc_digi_controller_configure(&digiConfig) != ESP_OK ||
+      adc_digi_start() != ESP_OK) {
+    Serial.println("⚠️  ADC DMA unavailable, using single reads");
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  running = true;
+  Serial.printf("📈 ADC DMA running at %d Hz on %u channels (%s calibration)\n", ADC_SAMPLE_RATE,
+                channelCount, calSource == ESP_ADC_CAL_VAL_DEFAULT_VREF ? "default" : "eFuse");
+  return true;
+}
+
+bool AdcSampler::restart() {
+  uint8_t pins[ADC_MAX_CHANNELS];
+  uint8_t count = channelCount;
+  for (uint8_t i = 0; i < count; i++) {
+    pins[i] = channels[i].pin;
+  }
+
+  if (running) {
+    adc_digi_stop();
+    adc_digi_deinitialize();
+    running = false;
+  }
+  return begin(pins, count);
+}
+
+void AdcSampler::poll() {
+  if (!running) {
+    return;
+  }
+
+  uint8_t buffer[ADC_DMA_FRAME_BYTES];
+  for (;;) {
+    uint32_t length = 0;
+    esp_err_t result = adc_digi_read_bytes(buffer, sizeof(buffer), &length, 0);
+    if (result == ESP_ERR_INVALID_STATE) {
+      // Driver ring overflowed; the newest data is still valid
+      overrunCount++;
+    } else if (result != ESP_OK) {
+      break;  // ESP_ERR_TIMEOUT: drained
+    }
+
+    for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= length; i += sizeof(adc_digi_output_data_t)) {
+      uint8_t adcChannel;
+      uint16_t data;
+      if (!decodeResult(*(const adc_digi_output_data_t*)&buffer[i], adcChannel, data)) {
+        continue;
+      }
+      for (uint8_t c = 0; c < channelCount; c++) {
+        Channel& channel = channels[c];
+        if (channel.adcChannel == adcChannel) {
+          channel.ring[channel.head] = data;
+          channel.head = (channel.head + 1) % ADC_WINDOW_SAMPLES;
+          if (channel.count < ADC_WINDOW_SAMPLES) {
+            channel.count++;
+          }
+          break;
+        }
+      }
+    }
+
+    if (length < sizeof(buffer)) {
+      break;
+    }
+  }
+}
+
+int AdcSampler::readMillivolts(uint8_t pin) {
+  if (!running) {
+    return analogReadMilliVolts(pin);
+  }
+
+  Channel* channel = find(pin);
+  if (channel == nullptr || channel->count == 0) {
+    return -1;
+  }
+
+  // Sorting 256 values is cheaper than the 100 ms the old burst blocked
+  uint16_t window[ADC_WINDOW_SAMPLES];
+  uint16_t count = channel->count;
+  memcpy(window, channel->ring, count * sizeof(uint16_t));
+  std::sort(window, window + count);
+
+  uint16_t trim = count * ADC_TRIM_PERCENT / 100;
+  uint32_t sum = 0;
+  for (uint16_t i = trim; i < count - trim; i++) {
+    sum += window[i];
+  }
+  uint32_t raw = sum / (count - 2 * trim);
+
+  return esp_adc_cal_raw_to_voltage(raw, &characteristics);
+}
+
+AdcSampler::Channel* AdcSampler::find(uint8_t pin) {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (channels[i].pin == pin) {
+      return &channels[i];
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,67 @@
+/**
+ * PlanetPlant ESP32 ADC Sampler
+ * Continuous-mode ADC1 acquisition over DMA: the hardware scans the
+ * analog channels at ADC_SAMPLE_RATE, poll() moves the conversions into
+ * per-channel rings and readMillivolts() reduces the newest window with a
+ * trimmed mean and the eFuse calibration. Falls back to calibrated
+ * single reads if the DMA driver cannot be started.
+ *
+ * Owned by the sensing task; not thread-safe.
+ */
+
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <stdint.h>
+#include <esp_adc_cal.h>
+#include "config.h"
+
+#define ADC_MAX_CHANNELS      8       // Every ADC1 input: up to ZONE_MAX probes plus light
+#define ADC_SAMPLE_RATE       20000   // Conversions/s across all channels (ESP32 DMA minimum)
+#define ADC_WINDOW_SAMPLES    256     // Newest conversions kept per channel
+#define ADC_TRIM_PERCENT      25      // Dropped from each end of the sorted window
+#define ADC_SETTLE_TIME       50      // Time for a fresh window after begin() (ms)
+
+class AdcSampler {
+public:
+  // Register ADC1 pins and start the DMA scan. Returns false (and uses
+  // the single-read fallback) if a pin is not on ADC1 or the driver fails.
+  bool begin(const uint8_t* pins, uint8_t count);
+
+  // Stop the DMA scan and start it again on the same pins; the windows
+  // refill within ADC_SETTLE_TIME.
+  bool restart();
+
+  // Drain pending DMA conversions without blocking.
+  void poll();
+
+  // Trimmed mean of the newest window in calibrated millivolts, or -1 if
+  // the pin is unknown or has no samples yet.
+  int readMillivolts(uint8_t pin);
+
+  bool usingDma() const { return running; }
+  uint32_t overruns() const { return overrunCount; }
+  esp_adc_cal_value_t calibration() const { return calSource; }
+
+private:
+  struct Channel {
+    uint8_t pin;
+    uint8_t adcChannel;
+    uint16_t head;
+    uint16_t count;
+    uint16_t ring[ADC_WINDOW_SAMPLES];
+  };
+
+  Channel channels[ADC_MAX_CHANNELS];
+  uint8_t channelCount = 0;
+  bool running = false;
+  uint32_t overrunCount = 0;
+  esp_adc_cal_characteristics_t characteristics;
+  esp_adc_cal_value_t calSource = ESP_ADC_CAL_VAL_DEFAULT_VREF;
+
+  Channel* find(uint8_t pin);
+};
+
+extern AdcSampler adcSampler;
+
+#endif // ADC_SAMPLER_H
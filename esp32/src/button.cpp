@@ -0,0 +1,113 @@
+/**
+ * PlanetPlant ESP32 Button Input
+ */
+
+#include "button.h"
+
+void ButtonInput::begin(uint8_t buttonPin, TaskHandle_t* notifyTask) {
+  pin = buttonPin;
+  notify = notifyTask;
+  pinMode(pin, INPUT_PULLUP);
+
+  // A press that woke the board from deep sleep is not a new gesture
+  down = digitalRead(pin) == LOW;
+  phase = down ? PHASE_HELD : PHASE_IDLE;
+
+  attachInterruptArg(digitalPinToInterrupt(pin), onEdge, this, CHANGE);
+}
+
+void IRAM_ATTR ButtonInput::onEdge(void* arg) {
+  ButtonInput* button = (ButtonInput*)arg;
+
+  // A full queue only loses bounces; the newest edge is what counts
+  button->edges.push(millis());
+  TaskHandle_t task = *button->notify;
+  if (task != nullptr) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+ButtonGesture ButtonInput::service(uint32_t now, uint32_t* waitMs) {
+  uint32_t edge;
+  while (edges.pop(edge)) {
+    lastEdge = edge;
+    settling = true;
+  }
+
+  ButtonGesture gesture = BUTTON_NONE;
+  if (settling && now - lastEdge < BUTTON_DEBOUNCE_TIME) {
+    *waitMs = lastEdge + BUTTON_DEBOUNCE_TIME - now;
+    return BUTTON_NONE;
+  }
+  if (settling) {
+    settling = false;
+    bool level = digitalRead(pin) == LOW;
+    if (level != down) {
+      down = level;
+      gesture = onLevel(level, lastEdge);
+    }
+  }
+  if (gesture == BUTTON_NONE) {
+    gesture = onDeadline(now);
+  }
+
+  *waitMs = nextDeadline(now);
+  return gesture;
+}
+
+ButtonGesture ButtonInput::onLevel(bool pressedNow, uint32_t at) {
+  Phase previous = phase;
+  phaseSince = at;
+
+  if (pressedNow) {
+    phase = previous == PHASE_GAP ? PHASE_SECOND_PRESS : previous == PHASE_IDLE ? PHASE_FIRST_PRESS : previous;
+    return BUTTON_NONE;
+  }
+
+  switch (previous) {
+    case PHASE_FIRST_PRESS:
+      phase = PHASE_GAP;
+      return BUTTON_NONE;
+    case PHASE_SECOND_PRESS:
+      phase = PHASE_IDLE;
+      return BUTTON_DOUBLE_PRESS;
+    default:
+      // Release after a long press (or of the press that woke the board)
+      phase = PHASE_IDLE;
+      return BUTTON_NONE;
+  }
+}
+
+ButtonGesture ButtonInput::onDeadline(uint32_t now) {
+  bool holding = phase == PHASE_FIRST_PRESS || phase == PHASE_SECOND_PRESS;
+  if (holding && now - phaseSince >= BUTTON_LONG_PRESS_TIME) {
+    bool second = phase == PHASE_SECOND_PRESS;
+    phase = PHASE_HELD;
+    return second ? BUTTON_DOUBLE_HOLD : BUTTON_LONG_PRESS;
+  }
+  if (phase == PHASE_GAP && now - phaseSince >= BUTTON_DOUBLE_WINDOW) {
+    phase = PHASE_IDLE;
+    return BUTTON_SHORT_PRESS;
+  }
+  return BUTTON_NONE;
+}
+
+uint32_t ButtonInput::nextDeadline(uint32_t now) const {
+  uint32_t deadline;
+  switch (phase) {
+    case PHASE_FIRST_PRESS:
+    case PHASE_SECOND_PRESS:
+      deadline = phaseSince + BUTTON_LONG_PRESS_TIME;
+      break;
+    case PHASE_GAP:
+      deadline = phaseSince + BUTTON_DOUBLE_WINDOW;
+      break;
+    default:
+      return 0;
+  }
+  // At least 1 ms so a due deadline is not mistaken for "never"
+  int32_t left = (int32_t)(deadline - now);
+  return left > 0 ? (uint32_t)left : 1;
+}
@@ -0,0 +1,69 @@
+/**
+ * PlanetPlant ESP32 Button Input
+ * Edge interrupts on the button pin queue timestamps for the sensing
+ * task; debouncing and gesture detection run there on scheduler
+ * deadlines, so nothing ever waits on the button. A new level counts
+ * once no edge has been seen for BUTTON_DEBOUNCE_TIME.
+ *
+ * Gestures: a short press is reported BUTTON_DOUBLE_WINDOW after its
+ * release if no second press follows, a double press on the second
+ * release, a long press as soon as the button has been held for
+ * BUTTON_LONG_PRESS_TIME, and a double hold when it is the second press
+ * that is held that long.
+ *
+ * Owned by the sensing task; the ISR only touches the edge queue.
+ */
+
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <Arduino.h>
+#include "spsc_queue.h"
+
+#define BUTTON_DEBOUNCE_TIME    50      // Level must be stable this long (ms)
+#define BUTTON_DOUBLE_WINDOW    400     // Longest gap inside a double press (ms)
+#define BUTTON_LONG_PRESS_TIME  3000    // Hold time of a long press (ms)
+#define BUTTON_EDGE_QUEUE       16      // Edges buffered between services (power of two)
+
+enum ButtonGesture : uint8_t {
+  BUTTON_NONE,
+  BUTTON_SHORT_PRESS,
+  BUTTON_DOUBLE_PRESS,
+  BUTTON_LONG_PRESS,
+  BUTTON_DOUBLE_HOLD        // Press, release, press and hold
+};
+
+class ButtonInput {
+public:
+  // Active-low input with pull-up. *notify is read at interrupt time, so
+  // the task it names may be created later.
+  void begin(uint8_t pin, TaskHandle_t* notify);
+
+  // Edges arrived since the last service().
+  bool pending() const { return edges.size() > 0; }
+
+  // Drain edges and advance detection. Returns the gesture completed, if
+  // any; *waitMs is when to call again without a new edge, 0 for never.
+  ButtonGesture service(uint32_t now, uint32_t* waitMs);
+
+  bool pressed() const { return down; }
+
+private:
+  enum Phase : uint8_t { PHASE_IDLE, PHASE_FIRST_PRESS, PHASE_GAP, PHASE_SECOND_PRESS, PHASE_HELD };
+
+  uint8_t pin = 0;
+  TaskHandle_t* notify = nullptr;
+  SpscQueue<uint32_t, BUTTON_EDGE_QUEUE> edges;
+  bool settling = false;
+  uint32_t lastEdge = 0;
+  bool down = false;
+  Phase phase = PHASE_IDLE;
+  uint32_t phaseSince = 0;
+
+  static void IRAM_ATTR onEdge(void* arg);
+  ButtonGesture onLevel(bool pressedNow, uint32_t at);
+  ButtonGesture onDeadline(uint32_t now);
+  uint32_t nextDeadline(uint32_t now) const;
+};
+
+#endif // BUTTON_H
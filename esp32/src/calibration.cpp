@@ -0,0 +1,231 @@
+/**
+ * PlanetPlant ESP32 Sensor Calibration
+ * One versioned blob per channel in the "calibration" NVS namespace
+ * ("zone0".."zone6", "light"), so changing ZONE_COUNT keeps the probes
+ * that are still wired
+ */
+
+#include <string.h>
+#include "hal.h"
+#include "calibration.h"
+#include "zones.h"
+
+#define CALIBRATION_NAMESPACE "calibration"
+#define CALIBRATION_LAYOUT    1       // Bump when CalibrationCurve changes shape
+
+struct StoredCurve {
+  uint8_t layout;
+  CalibrationCurve curve;
+};
+
+SensorCalibration calibration;
+
+static void channelKey(uint8_t channel, char* key, size_t size) {
+  if (channel == CALIBRATION_CHANNEL_LIGHT) {
+    strlcpy(key, "light", size);
+  } else {
+    snprintf(key, size, "zone%u", channel);
+  }
+}
+
+void SensorCalibration::begin() {
+  Preferences prefs;
+  bool opened = prefs.begin(CALIBRATION_NAMESPACE, true);
+
+  for (uint8_t channel = 0; channel < CALIBRATION_CHANNELS; channel++) {
+    char key[8];
+    channelKey(channel, key, sizeof(key));
+
+    StoredCurve stored;
+    size_t length = opened ? prefs.getBytes(key, &stored, sizeof(stored)) : 0;
+    bool valid = length == sizeof(stored) && stored.layout == CALIBRATION_LAYOUT &&
+                 stored.curve.count >= 2 && stored.curve.count <= CALIBRATION_MAX_POINTS &&
+                 monotonic(stored.curve);
+    curves[channel] = valid ? stored.curve : factoryCurve(channel);
+    if (valid) {
+      Serial.printf("📐 Calibration %s: %u points\n", key, stored.curve.count);
+    }
+    build(channel);
+  }
+
+  if (opened) {
+    prefs.end();
+  }
+}
+
+bool SensorCalibration::start(uint8_t channel, int target, uint32_t now, CalibrationReport& report) {
+  if (active) {
+    describe(channel, CALIBRATION_BUSY, target, report);
+    return false;
+  }
+
+  lastActivity = now;
+  sessionStarted = true;
+
+  if (target == CALIBRATION_TARGET_RESET) {
+    curves[channel] = factoryCurve(channel);
+    build(channel);
+    describe(channel, store(channel) ? CALIBRATION_RESET : CALIBRATION_STORAGE_FAILED, target, report);
+    return false;
+  }
+
+  active = true;
+  captureChannel = channel;
+  captureTarget = target;
+  captureCount = 0;
+  captureSum = 0;
+  captureMin = UINT16_MAX;
+  captureMax = 0;
+  describe(channel, CALIBRATION_CAPTURING, target, report);
+  return true;
+}
+
+bool SensorCalibration::capture(int millivolts, uint32_t now, CalibrationReport& report) {
+  if (!active) {
+    return false;
+  }
+  lastActivity = now;
+
+  CalibrationResult result;
+  if (millivolts < 0) {
+    result = CALIBRATION_NO_SIGNAL;
+  } else {
+    captureSum += millivolts;
+    captureMin = millivolts < captureMin ? millivolts : captureMin;
+    captureMax = millivolts > captureMax ? millivolts : captureMax;
+    if (++captureCount < CALIBRATION_CAPTURE_SAMPLES) {
+      return false;
+    }
+    uint16_t mean = captureSum / captureCount;
+    result = captureMax - captureMin > CALIBRATION_MAX_SPREAD ? CALIBRATION_UNSTABLE
+                                                              : addPoint(captureChannel, mean, captureTarget);
+  }
+
+  active = false;
+  describe(captureChannel, result, captureTarget, report);
+  if (captureCount > 0) {
+    report.millivolts = captureSum / captureCount;
+    report.spreadMv = captureMax - captureMin;
+  }
+  return true;
+}
+
+bool SensorCalibration::inSession(uint32_t now) const {
+  return active || (sessionStarted && now - lastActivity < CALIBRATION_SESSION_TIMEOUT);
+}
+
+CalibrationCurve SensorCalibration::factoryCurve(uint8_t channel) {
+  CalibrationCurve curve = {};
+  curve.count = 2;
+  if (channel == CALIBRATION_CHANNEL_LIGHT) {
+    curve.points[0] = { LIGHT_DARK_MV, 0 };
+    curve.points[1] = { LIGHT_FULL_SCALE_MV, 100 };
+  } else {
+    // The probe reads lower when wet
+    curve.points[0] = { zones[channel].wetMv, 100 };
+    curve.points[1] = { zones[channel].dryMv, 0 };
+  }
+  return curve;
+}
+
+bool SensorCalibration::monotonic(const CalibrationCurve& curve) {
+  // Strictly rising or strictly falling in both coordinates, or a reading
+  // would map to more than one value
+  int direction = curve.points[1].value > curve.points[0].value ? 1 : -1;
+  for (uint8_t i = 1; i < curve.count; i++) {
+    const CalibrationPoint& previous = curve.points[i - 1];
+    const CalibrationPoint& point = curve.points[i];
+    int step = (int)point.value - previous.value;
+    if (point.millivolts <= previous.millivolts || step * direction <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+CalibrationResult SensorCalibration::addPoint(uint8_t channel, uint16_t millivolts, uint8_t target) {
+  // A new capture for a value replaces the old point for it
+  CalibrationCurve candidate = {};
+  for (uint8_t i = 0; i < curves[channel].count; i++) {
+    if (curves[channel].points[i].value != target) {
+      candidate.points[candidate.count++] = curves[channel].points[i];
+    }
+  }
+  if (candidate.count >= CALIBRATION_MAX_POINTS) {
+    return CALIBRATION_CURVE_FULL;
+  }
+
+  uint8_t at = 0;
+  while (at < candidate.count && candidate.points[at].millivolts < millivolts) {
+    at++;
+  }
+  memmove(&candidate.points[at + 1], &candidate.points[at], (candidate.count - at) * sizeof(CalibrationPoint));
+  candidate.points[at] = { millivolts, target };
+  candidate.count++;
+
+  if (!monotonic(candidate)) {
+    return CALIBRATION_NOT_MONOTONIC;
+  }
+
+  CalibrationCurve previous = curves[channel];
+  curves[channel] = candidate;
+  if (!store(channel)) {
+    curves[channel] = previous;
+    return CALIBRATION_STORAGE_FAILED;
+  }
+  build(channel);
+  return CALIBRATION_CAPTURED;
+}
+
+bool SensorCalibration::store(uint8_t channel) {
+  StoredCurve stored = {};
+  stored.layout = CALIBRATION_LAYOUT;
+  stored.curve = curves[channel];
+
+  char key[8];
+  channelKey(channel, key, sizeof(key));
+
+  Preferences prefs;
+  if (!prefs.begin(CALIBRATION_NAMESPACE, false)) {
+    return false;
+  }
+  bool written = prefs.putBytes(key, &stored, sizeof(stored)) == sizeof(stored);
+  prefs.end();
+  return written;
+}
+
+void SensorCalibration::build(uint8_t channel) {
+  // Each entry holds the value at the middle of its millivolt step
+  const CalibrationCurve& curve = curves[channel];
+  uint8_t segment = 0;
+  for (uint32_t index = 0; index < CALIBRATION_LUT_SIZE; index++) {
+    int32_t millivolts = (index << CALIBRATION_LUT_SHIFT) + (1 << CALIBRATION_LUT_SHIFT) / 2;
+    while (segment + 2 < curve.count && millivolts > curve.points[segment + 1].millivolts) {
+      segment++;
+    }
+
+    const CalibrationPoint& low = curve.points[segment];
+    const CalibrationPoint& high = curve.points[segment + 1];
+    int32_t value;
+    if (millivolts <= low.millivolts) {
+      value = low.value;
+    } else if (millivolts >= high.millivolts) {
+      value = high.value;
+    } else {
+      int32_t span = high.millivolts - low.millivolts;
+      int32_t offset = (millivolts - low.millivolts) * ((int32_t)high.value - low.value);
+      value = low.value + (offset + (offset >= 0 ? span / 2 : -span / 2)) / span;
+    }
+    tables[channel][index] = value < 0 ? 0 : value > 100 ? 100 : value;
+  }
+}
+
+void SensorCalibration::describe(uint8_t channel, CalibrationResult result, int target,
+                                 CalibrationReport& report) const {
+  report = {};
+  report.channel = channel;
+  report.result = result;
+  report.target = target;
+  report.pointCount = curves[channel].count;
+  memcpy(report.points, curves[channel].points, sizeof(report.points));
+}
@@ -0,0 +1,98 @@
+/**
+ * PlanetPlant ESP32 Sensor Calibration
+ * Piecewise-linear curves from calibrated ADC millivolts to % for every
+ * moisture probe and the light sensor. Each curve is a handful of
+ * captured points; readings outside them take the nearest end value.
+ * Every curve is expanded once into a CALIBRATION_LUT_SIZE table, so a
+ * conversion in the sampling path is a single table index.
+ *
+ * Points are captured on the device: the channel is read every
+ * CALIBRATION_CAPTURE_INTERVAL until CALIBRATION_CAPTURE_SAMPLES
+ * readings are in, and their mean becomes the point for the requested
+ * value (dry soil 0 %, water 100 %, or anything between, measured some
+ * other way). A capture that spreads more than CALIBRATION_MAX_SPREAD
+ * is rejected. Curves are stored per channel in the "calibration" NVS
+ * namespace; the factory curves are the zone table's dry/wet points and
+ * LIGHT_DARK_MV/LIGHT_FULL_SCALE_MV.
+ *
+ * Owned by the sensing task; not thread-safe.
+ */
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+#include "messages.h"
+
+#define CALIBRATION_CHANNEL_LIGHT ZONE_COUNT           // Channels 0..ZONE_COUNT-1 are the zones
+#define CALIBRATION_CHANNELS      (ZONE_COUNT + 1)
+#define CALIBRATION_LUT_SHIFT     3                    // 8 mV per table entry
+#define CALIBRATION_LUT_SIZE      (4096 >> CALIBRATION_LUT_SHIFT)
+#define CALIBRATION_TARGET_RESET  -1
+
+struct CalibrationCurve {
+  uint8_t count;
+  CalibrationPoint points[CALIBRATION_MAX_POINTS];   // Ascending millivolts
+};
+
+class SensorCalibration {
+public:
+  // Load the stored curves (factory curves where there are none) and
+  // build the tables. Call once before sampling starts.
+  void begin();
+
+  // % for a calibrated reading, -1 without one
+  int value(uint8_t channel, int millivolts) const {
+    if (millivolts < 0) {
+      return -1;
+    }
+    uint32_t index = (uint32_t)millivolts >> CALIBRATION_LUT_SHIFT;
+    return tables[channel][index < CALIBRATION_LUT_SIZE ? index : CALIBRATION_LUT_SIZE - 1];
+  }
+
+  // Start capturing a point for target %, or go back to the factory curve
+  // for CALIBRATION_TARGET_RESET. Fills report and returns false when the
+  // step is refused or already finished (reset).
+  bool start(uint8_t channel, int target, uint32_t now, CalibrationReport& report);
+
+  // Feed the channel's reading every CALIBRATION_CAPTURE_INTERVAL while
+  // capturing(). True once the capture finished, with report filled.
+  bool capture(int millivolts, uint32_t now, CalibrationReport& report);
+
+  bool capturing() const { return active; }
+  uint8_t channel() const { return captureChannel; }
+
+  // A capture ran or finished within CALIBRATION_SESSION_TIMEOUT; the
+  // probe may be out of the soil
+  bool inSession(uint32_t now) const;
+
+  const CalibrationCurve& curve(uint8_t channel) const { return curves[channel]; }
+
+  // A report of result for the channel's current curve, e.g. to refuse a
+  // step the caller knows cannot run
+  void describe(uint8_t channel, CalibrationResult result, int target, CalibrationReport& report) const;
+
+private:
+  CalibrationCurve curves[CALIBRATION_CHANNELS];
+  uint8_t tables[CALIBRATION_CHANNELS][CALIBRATION_LUT_SIZE];
+
+  bool active = false;
+  bool sessionStarted = false;
+  uint8_t captureChannel = 0;
+  int8_t captureTarget = 0;
+  uint8_t captureCount = 0;
+  uint32_t captureSum = 0;
+  uint16_t captureMin = 0;
+  uint16_t captureMax = 0;
+  uint32_t lastActivity = 0;
+
+  static CalibrationCurve factoryCurve(uint8_t channel);
+  static bool monotonic(const CalibrationCurve& curve);
+  CalibrationResult addPoint(uint8_t channel, uint16_t millivolts, uint8_t target);
+  bool store(uint8_t channel);
+  void build(uint8_t channel);
+};
+
+extern SensorCalibration calibration;
+
+#endif // CALIBRATION_H
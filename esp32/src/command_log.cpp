@@ -0,0 +1,53 @@
+/**
+ * PlanetPlant ESP32 Command Log
+ * Ids are kept as FNV-1a hashes; 0 marks an empty slot.
+ */
+
+#include <Arduino.h>
+#include "command_log.h"
+#include "fnv1a.h"
+
+#define COMMAND_LOG_MAGIC   0x5050434c  // "PPCL"
+
+struct CommandLogState {
+  uint32_t magic;
+  uint8_t next;
+  uint32_t ids[COMMAND_LOG_SIZE];
+};
+
+RTC_NOINIT_ATTR static CommandLogState commandLog;
+
+static uint32_t hashId(const char* id) {
+  uint32_t hash = fnv1a32(id);
+  return hash != 0 ? hash : 1;
+}
+
+void commandLogBegin() {
+  if (commandLog.magic != COMMAND_LOG_MAGIC || esp_reset_reason() == ESP_RST_POWERON ||
+      commandLog.next >= COMMAND_LOG_SIZE) {
+    memset(&commandLog, 0, sizeof(commandLog));
+    commandLog.magic = COMMAND_LOG_MAGIC;
+  }
+}
+
+bool commandLogSeen(const char* id) {
+  if (id == nullptr || id[0] == 0) {
+    return false;
+  }
+
+  uint32_t hash = hashId(id);
+  for (uint8_t i = 0; i < COMMAND_LOG_SIZE; i++) {
+    if (commandLog.ids[i] == hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void commandLogAdd(const char* id) {
+  if (id == nullptr || id[0] == 0) {
+    return;
+  }
+  commandLog.ids[commandLog.next] = hashId(id);
+  commandLog.next = (commandLog.next + 1) % COMMAND_LOG_SIZE;
+}
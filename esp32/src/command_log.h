@@ -0,0 +1,28 @@
+/**
+ * PlanetPlant ESP32 Command Log
+ * Ids of the last COMMAND_LOG_SIZE commands. Command topics are
+ * subscribed at QoS 1 on a persistent session, so the broker redelivers
+ * anything not acknowledged before a disconnect; a redelivered command
+ * that already ran is acknowledged again but not acted on twice.
+ *
+ * RTC_NOINIT_ATTR like watchdog.cpp, so the log spans deep sleep and the
+ * resets that can land between running a command and its PUBACK.
+ * Network task only.
+ */
+
+#ifndef COMMAND_LOG_H
+#define COMMAND_LOG_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Keeps the log across deep sleep and resets, clears it at power-on.
+void commandLogBegin();
+
+// True if id was recorded before. Commands without an id never are.
+bool commandLogSeen(const char* id);
+
+// Record the id of a command that was acted on.
+void commandLogAdd(const char* id);
+
+#endif // COMMAND_LOG_H
@@ -18,71 +18,259 @@
 #define MOISTURE_READING_DELAY  2000    // Delay between moisture readings (ms)
 #define DHT_READING_DELAY       5000    // Delay between DHT readings (ms)
 #define SENSOR_READINGS_COUNT   5       // Number of readings to average
+#define SENSOR_READ_INTERVAL    60000   // Sampling period, runtime setting sensor_interval (1 minute)
 
-// Moisture Sensor Calibration Values
-#define MOISTURE_DRY_VALUE      1023    // Sensor value in completely dry soil
-#define MOISTURE_WET_VALUE      0       // Sensor value in completely wet soil
+// Sensing Task Timing (adc_sampler.h, dht_rmt.h; the host benchmark replays these)
+#define ADC_POLL_INTERVAL       20      // DMA drain period (ms), well inside the driver buffer
+#define DHT_READ_INTERVAL       10000   // Background DHT22 refresh (ms)
+#define DHT_START_PULSE_MS      2       // Host low time (DHT22 needs >= 1 ms)
+#define DHT_RETRY_DELAY         2100    // Sensor minimum sampling period (ms)
+
+// Sensor Calibration (calibration.h; factory curves until a point is captured, all in calibrated ADC mV)
+#define MOISTURE_DRY_MV         2800    // Dry soil, per zone in zones.cpp
+#define MOISTURE_WET_MV         1250    // Probe in water
+#define LIGHT_DARK_MV           0       // Darkness
+#define LIGHT_FULL_SCALE_MV     3100    // Full brightness
+#define CALIBRATION_MAX_POINTS  8       // Points per piecewise-linear curve
+#define CALIBRATION_CAPTURE_SAMPLES 20  // Readings averaged into one captured point
+#define CALIBRATION_CAPTURE_INTERVAL 250  // Between those readings (ms)
+#define CALIBRATION_MAX_SPREAD  60      // Largest max - min of a capture (mV)
+#define CALIBRATION_SESSION_TIMEOUT 600000  // Local watering held off after calibration activity (10 minutes)
 
 // Water Pump Settings
+#define WATERING_DURATION       5000    // Default watering time, runtime setting watering_duration (ms)
+#define WATERING_MAX_DURATION   30000   // Upper bound for commanded durations (ms)
 #define PUMP_MAX_DURATION       10000   // Maximum pump run time in milliseconds (10 seconds)
 #define PUMP_COOLDOWN_TIME      300000  // Minimum time between pump activations (5 minutes)
 #define PUMP_FLOW_RATE          5       // ml per second (for volume calculations)
 
+// Local Watering Controller (pulse-and-soak on moisture feedback; runtime setting defaults)
+#define LOCAL_WATERING_ENABLED  true    // Water on-device below moisture_min
+#define WATERING_PULSE_DURATION 2000    // Pump time per pulse (ms)
+#define WATERING_SOAK_TIME      20000   // Pause between pulses so water reaches the probe (ms)
+#define WATERING_MAX_PULSES     5       // Pulses per cycle; pump time is also capped by PUMP_MAX_DURATION
+#define WATERING_SAMPLE_INTERVAL 200    // Moisture check period during a cycle (ms)
+
+// Adaptive Sampling (sample_rate.h; runtime setting defaults)
+#define ADAPTIVE_SAMPLING_ENABLED true  // Otherwise every sample is sensor_interval apart
+#define SAMPLE_INTERVAL_WATERING 500    // While a zone waters or soaks (ms)
+#define SAMPLE_INTERVAL_FAST    15000   // While moisture moves faster than SAMPLE_FAST_RATE (ms)
+#define SAMPLE_INTERVAL_SLOW    300000  // Once moisture has been flat for a while (5 minutes)
+#define SAMPLE_LOW_BATTERY_FACTOR 2     // Low battery samples every this many slow intervals
+#define SAMPLE_FAST_RATE        2.0     // %/h moisture trend of the fastest-moving zone
+#define SAMPLE_STABLE_FRACTION  0.25    // Flat below this fraction of the fast rate
+#define SAMPLE_TREND_WINDOW     600000  // Span each trend is measured over (10 minutes)
+#define SAMPLE_STABLE_WINDOWS   3       // Flat trend windows in a row before backing off
+#define SAMPLE_SMOOTHING        0.3f    // Weight of each moisture sample in the trend
+
+// Battery Monitoring (divider on BATTERY_SENSE_PIN, pins.h)
+#ifndef BATTERY_SENSE_ENABLED
+#define BATTERY_SENSE_ENABLED   false   // Battery-powered boards (override via build_flags)
+#endif
+#define BATTERY_DIVIDER_RATIO   2.0f    // Battery voltage over pin voltage (100k/100k)
+#define BATTERY_LOW_MV          3500    // Low-battery threshold, runtime setting battery_low
+#define BATTERY_HYSTERESIS_MV   100     // Recovered once this far above the threshold
+
+// Watering Zones (moisture probe, relay and calibration each; table in zones.cpp)
+#ifndef ZONE_COUNT
+#define ZONE_COUNT              1       // Zones wired on this board, 1..ZONE_MAX
+#endif
+#define ZONE_MAX                7       // ADC1 inputs left beside the light sensor
+#define PUMP_MAX_CONCURRENT     1       // Pumps the supply can drive at once; other zones wait their turn
+
 // WiFi Configuration
 #define WIFI_CONNECT_TIMEOUT    30000   // WiFi connection timeout (30 seconds)
 #define WIFI_RECONNECT_INTERVAL 60000   // WiFi reconnection attempt interval (1 minute)
 #define WIFI_MAX_RETRY_COUNT    5       // Maximum WiFi connection retries
+#define WIFI_FAST_CONNECT_TIMEOUT 1500  // Cached BSSID/channel/IP attempt before a full connect (ms)
+#define WIFI_CACHE_MAX_USES     48      // Full connect (scan + DHCP) at least this often
+#define WIFI_ATTEMPT_TIMEOUT    8000    // Per full-connect attempt (ms)
+#define WIFI_BACKOFF_BASE       500     // Jitter window before the first full attempt (ms)
+#define WIFI_BACKOFF_MAX        8000    // Jitter window cap, doubled per attempt (ms)
 
 // MQTT Configuration
+#ifndef MQTT_SERVER
+#define MQTT_SERVER             "192.168.1.100"  // Raspberry Pi broker address (override via build_flags)
+#endif
+#ifndef MQTT_USER
+#define MQTT_USER               nullptr  // Anonymous unless overridden
+#endif
+#ifndef MQTT_PASS
+#define MQTT_PASS               nullptr
+#endif
+#ifndef MQTT_TLS_ENABLED
+#define MQTT_TLS_ENABLED        false   // TLS 1.2 to the broker (override via build_flags)
+#endif
+#if MQTT_TLS_ENABLED
+#define MQTT_PORT               8883
+#ifndef MQTT_TLS_SERVER_NAME
+#define MQTT_TLS_SERVER_NAME    MQTT_SERVER      // Name in the broker certificate, if MQTT_SERVER is an IP
+#endif
+#ifndef MQTT_CA_CERT
+#error "MQTT_TLS_ENABLED needs MQTT_CA_CERT, the PEM of the CA that signed the broker certificate"
+#endif
+#else
 #define MQTT_PORT               1883
+#endif
 #define MQTT_KEEPALIVE          60
 #define MQTT_CONNECT_TIMEOUT    10000   // MQTT connection timeout (10 seconds)
-#define MQTT_RECONNECT_INTERVAL 5000    // MQTT reconnection interval (5 seconds)
-#define MQTT_MAX_RETRY_COUNT    10      // Maximum MQTT connection retries
-#define MQTT_QOS                1       // Quality of Service level
-
-// MQTT Topics
-#define MQTT_TOPIC_MOISTURE     "plantplant/sensors/moisture"
-#define MQTT_TOPIC_TEMPERATURE  "plantplant/sensors/temperature"
-#define MQTT_TOPIC_HUMIDITY     "plantplant/sensors/humidity"
-#define MQTT_TOPIC_PUMP_CONTROL "plantplant/control/pump"
-#define MQTT_TOPIC_STATUS       "plantplant/status/device"
-#define MQTT_TOPIC_CONFIG       "plantplant/config/device"
-#define MQTT_TOPIC_HEARTBEAT    "plantplant/heartbeat"
+#define MQTT_RECONNECT_INTERVAL 5000    // Initial reconnect backoff, doubled per failure (5 seconds)
+#define MQTT_RECONNECT_MAX_INTERVAL 120000  // Backoff cap (2 minutes)
+#define MQTT_MAX_RETRY_COUNT    10      // Consecutive failures before WiFi is bounced
+#define MQTT_QOS                1       // Commands, samples and results; heartbeat and metrics use QoS 0
+#define MQTT_CLEAN_SESSION      false   // Broker queues commands while the device is offline
+#ifndef MQTT_MAX_PACKET_SIZE
+#define MQTT_MAX_PACKET_SIZE    4096    // Largest packet sent or received (override via build_flags)
+#endif
+#define MQTT_OUTBOX_SIZE        8192    // Queued and unacknowledged publishes (bytes)
+#define MQTT_MAX_INFLIGHT       8       // QoS 1 publishes awaiting PUBACK
+#if MQTT_TLS_ENABLED
+#define MQTT_RX_STREAM_SIZE     8192    // Received bytes between network task wakes; holds a handshake flight
+#else
+#define MQTT_RX_STREAM_SIZE     4096    // Received bytes between network task wakes (power of two)
+#endif
+#define TLS_SESSION_CACHE_SIZE  1024    // Serialized TLS session, peer certificate left out, kept in RTC memory (tls_channel.h)
+#define COMMAND_LOG_SIZE        16      // Command ids remembered to drop redeliveries (command_log.h)
+
+// Time Synchronization (SNTP; wire timestamps are epoch ms once synced)
+#ifndef NTP_SERVER
+#define NTP_SERVER              "pool.ntp.org"   // Point at the Raspberry Pi for offline installs
+#endif
+#define NTP_SERVER_FALLBACK     "time.google.com"
+#define TIME_RESYNC_INTERVAL    3600000 // SNTP period; duty-cycle wakes extrapolate in between (1 hour)
+#define TIME_DRIFT_MIN_SPAN     600000  // Shortest sync interval drift is measured over (10 minutes)
+#define TIME_DRIFT_MAX_PPM      50000   // Larger rate errors are clock steps, not drift
+#define TIME_DRIFT_SMOOTHING    0.3f    // Weight of each new drift measurement
+
+// MQTT Topics (layout in topics.h)
+#ifndef MQTT_SITE
+#define MQTT_SITE               "default"  // Site segment of every topic; no '/', '+' or '#' (override via build_flags)
+#endif
 
 // Data Transmission Settings
+#define TELEMETRY_FORMAT_JSON   0       // Self-describing JSON (default)
+#define TELEMETRY_FORMAT_PACKED 1       // 30-byte versioned frame, see telemetry_codec.h
+#ifndef TELEMETRY_FORMAT
+#define TELEMETRY_FORMAT        TELEMETRY_FORMAT_JSON
+#endif
 #define DATA_SEND_INTERVAL      60000   // Send sensor data every 60 seconds
-#define HEARTBEAT_INTERVAL      30000   // Send heartbeat every 30 seconds
+#define HEARTBEAT_INTERVAL      120000  // Well inside the backend's 5-minute offline threshold (2 minutes)
 #define STATUS_UPDATE_INTERVAL  300000  // Send status update every 5 minutes
+#define METRICS_INTERVAL        300000  // evt/metrics, runtime setting metrics_interval (5 minutes)
+
+// Batched Publishing (one evt/batch message per N samples or T ms)
+#define PUBLISH_BATCH_ENABLED   false   // Ignored in deep-sleep duty-cycle mode
+#define BATCH_SAMPLE_INTERVAL   10000   // Sampling period while batching (ms)
+#define BATCH_MAX_SAMPLES       24      // Flush when this many samples are queued
+#define BATCH_MAX_AGE           120000  // Flush when the oldest sample is this old (ms)
+#define BATCH_INCLUDE_HEARTBEAT true    // Fold heartbeat fields into each batch
+
+// Report-by-Exception (publish on change, plus periodic aggregates; runtime setting defaults)
+#define REPORT_BY_EXCEPTION     true    // Ignored while batching
+#define REPORT_MAX_SILENCE      900000  // Publish a sample at least this often (15 minutes)
+#define AGGREGATE_WINDOW        900000  // min/max/mean/slope window (15 minutes)
+#define REPORT_DEADBAND_TEMPERATURE 0.5 // °C change since the last published sample
+#define REPORT_DEADBAND_HUMIDITY    3.0 // %RH
+#define REPORT_DEADBAND_MOISTURE    3.0 // %
+#define REPORT_DEADBAND_LIGHT       10.0 // %
+#define REPORT_RATE_TEMPERATURE     0.2 // °C/min between consecutive samples
+#define REPORT_RATE_HUMIDITY        1.0 // %RH/min
+#define REPORT_RATE_MOISTURE        1.0 // %/min
+#define REPORT_RATE_LIGHT           5.0 // %/min
+
+// FreeRTOS Task Layout (single-core chips such as the ESP32-C3 run both on core 0)
+#define NETWORK_TASK_CORE       0       // WiFi/MQTT share the core with the WiFi driver
+#define SENSING_TASK_CORE       (portNUM_PROCESSORS > 1 ? 1 : 0)  // Sensors, pump and UI never wait on the network
+#define NETWORK_TASK_STACK      8192
+#define SENSING_TASK_STACK      4096
+#define NETWORK_TASK_PRIORITY   1
+#define SENSING_TASK_PRIORITY   2
+#define EVENT_QUEUE_LENGTH      16      // Sensing -> network (power of two)
+#define COMMAND_QUEUE_LENGTH    8       // Network -> sensing (power of two)
+#define NETWORK_LOOP_INTERVAL   1000    // Max idle wait; MQTT traffic wakes the task (ms)
+#define SENSING_LOOP_INTERVAL   50      // Max idle wait of the sensing task (ms)
+
+// Offline Sample Buffer (store-and-forward while MQTT is down)
+#define SAMPLE_BUFFER_RTC_RECORDS 192   // 16-byte records kept in RTC memory (3 KB)
+#define SAMPLE_SPILL_BATCH      32      // RTC records moved to flash per spill
+#define SAMPLE_PARTITION_LABEL  "samples"  // Data partition in partitions.csv
+#define SAMPLE_REPLAY_INTERVAL  500     // Replay slot period after reconnect (ms)
+#define SAMPLE_REPLAY_HEADROOM  2048    // Outbox bytes replay leaves free for live traffic
+
+// ESP-NOW Mesh (espnow_link.h; leaves skip WiFi association and MQTT, a gateway publishes for them)
+#define ESPNOW_ROLE_NONE        0
+#define ESPNOW_ROLE_LEAF        1
+#define ESPNOW_ROLE_GATEWAY     2
+#ifndef ESPNOW_ROLE
+#define ESPNOW_ROLE             ESPNOW_ROLE_NONE  // Override via build_flags, e.g. -DESPNOW_ROLE=ESPNOW_ROLE_LEAF
+#endif
+#define ESPNOW_NETWORK_ID       0x5050  // Frames of other installations nearby are ignored
+#define ESPNOW_CHANNEL          1       // Leaf channel until the gateway has been found (it follows the AP)
+#define ESPNOW_REPLY_TIMEOUT    40      // Leaf wait for the gateway's reply per attempt (ms)
+#define ESPNOW_SEND_ATTEMPTS    3       // Leaf attempts on the known channel before a scan
+#define ESPNOW_MAX_LEAVES       16      // Gateway peer table (ESP-NOW allows 20 peers)
+#define ESPNOW_LEAF_COMMANDS    2       // Commands a gateway holds per leaf until its next wake
+#define ESPNOW_BATCH_MAX        16      // Gateway flushes evt/mesh at this many leaf samples
+#define ESPNOW_BATCH_INTERVAL   5000    // ...or this long after the first one (ms)
 
 // Power Management
+#ifndef DEEP_SLEEP_ENABLED
 #define DEEP_SLEEP_ENABLED      false   // Enable deep sleep mode (disable for always-on operation)
+#endif
 #define SLEEP_DURATION          300     // Deep sleep duration in seconds (5 minutes)
 #define WAKE_UP_PIN             GPIO_NUM_0  // Pin to wake up from deep sleep
+#define AWAKE_BUDGET            8000    // Force sleep after this long awake, pump excepted (ms)
+#define DUTY_CYCLE_CHECK_INTERVAL 20    // Sleep readiness check period (ms)
+#define BATCHING_ACTIVE         (PUBLISH_BATCH_ENABLED && !DEEP_SLEEP_ENABLED)
+#define REPORT_FILTER_ACTIVE    (REPORT_BY_EXCEPTION && !BATCHING_ACTIVE)
 
 // System Settings
 #define SERIAL_BAUD_RATE        115200
 #define DEVICE_ID_PREFIX        "PlanetPlant_"
-#define FIRMWARE_VERSION        "1.0.0"
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION        "1.0.0" // Compared with the version in OTA manifests
+#endif
 #define HARDWARE_VERSION        "1.0"
 
-// Watchdog Timer
-#define WATCHDOG_TIMEOUT        30000   // Watchdog timeout in milliseconds (30 seconds)
-#define WATCHDOG_ENABLED        true
+// Watchdog Timer (watchdog.h)
+#define WATCHDOG_TIMEOUT        30000   // Task check-in timeout before a panic reset (30 seconds)
+#define WATCHDOG_ENABLED        true    // Fault recovery tiers run either way
 
-// OTA Update Settings
-#define OTA_ENABLED             true
-#define OTA_PASSWORD            "plantplant123"  // Change this in production!
-#define OTA_PORT                8266
+// OTA Updates (pulled over HTTP(S) on cmd/ota)
+#define OTA_DEFAULT_WINDOW      600000  // Stagger window when the manifest has none (10 minutes)
+#define OTA_MAX_WINDOW          86400000 // Longest accepted stagger window (24 hours)
+#define OTA_HTTP_TIMEOUT        15000   // Connect and stall timeout of the download (ms)
+#define OTA_TRIAL_BOOTS         3       // Boots a new image gets to pass the health gate
+#define OTA_HEALTH_TIMEOUT      180000  // Gate deadline after each trial boot (ms)
+#define OTA_HEALTH_MQTT_BUDGET  10000   // Longest acceptable MQTT connect (ms)
+#define OTA_HEALTH_LOOP_BUDGET  20000   // Longest acceptable sensing loop iteration (us)
+#define OTA_HEALTH_JITTER_BUDGET 100    // Worst acceptable sensing scheduler lateness (ms)
+#define OTA_STATUS_INTERVAL     1000    // Gate evaluation and progress reporting period (ms)
+#define OTA_TASK_STACK          8192    // TLS handshake plus the HTTP client
+#define OTA_TASK_PRIORITY       1
 
-// Web Server Settings (for configuration interface)
+// Web Server Settings (http_server.h; not started in deep-sleep mode)
 #define WEB_SERVER_ENABLED      true
 #define WEB_SERVER_PORT         80
+#define HTTP_MAX_STREAMS        3       // Concurrent responses; more get 503
+#define HTTP_STREAM_BUFFER_SIZE 2048    // Per response, one metrics family or sample row at a time
+#define SAMPLE_HISTORY_SIZE     256     // Recent samples kept for /samples (16 bytes each, power of two)
+#define HTTP_STATS_INTERVAL     1000    // Refresh of the network task figures /metrics serves (ms)
 #define CONFIG_PORTAL_TIMEOUT   180     // Configuration portal timeout (3 minutes)
+#define CONFIG_PORTAL_SSID      "PlanetPlant-Setup"
+#define CONFIG_PORTAL_PASSWORD  "plantplant123"
+#define CONFIG_PORTAL_POLL_INTERVAL 50  // Portal request servicing while open (ms)
+
+// Error Handling (watchdog.h)
+#define MAX_CONSECUTIVE_ERRORS  5       // Consecutive failures before the next recovery tier
+#define ERROR_RECOVERY_DELAY    10000   // Grace period after a recovery before failures count (10 seconds)
 
-// Error Handling
-#define MAX_CONSECUTIVE_ERRORS  5       // Maximum consecutive errors before restart
-#define ERROR_RECOVERY_DELAY    10000   // Delay before attempting recovery (10 seconds)
+// Profiling Trace (trace.h; env:profile, per-phase timing for the host's profile-trace script)
+#ifndef PROFILE_TRACE_ENABLED
+#define PROFILE_TRACE_ENABLED   false
+#endif
+#define PROFILE_TRACE_RECORDS   1024    // Buffered trace records, 12 bytes each
+#define PROFILE_TRACE_DUMP_INTERVAL 10000  // evt/trace while MQTT is up, serial otherwise (ms)
 
 // Debug Settings
 #ifdef DEBUG
@@ -104,6 +292,19 @@
 // JSON Buffer Sizes
 #define JSON_BUFFER_SIZE        512
 #define CONFIG_JSON_SIZE        1024
+#define JSON_BATCH_SIZE         (JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(5) + \
+                                 JSON_ARRAY_SIZE(BATCH_MAX_SAMPLES) + \
+                                 BATCH_MAX_SAMPLES * JSON_ARRAY_SIZE(6) + 64)
+#define JSON_MESH_SIZE          (ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY ? \
+                                 JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(ESPNOW_BATCH_MAX) + \
+                                 ESPNOW_BATCH_MAX * (JSON_ARRAY_SIZE(9) + JSON_ARRAY_SIZE(ZONE_MAX)) + 64 : 0)
+#define JSON_TX_BASE_SIZE       (JSON_BATCH_SIZE > JSON_BUFFER_SIZE ? JSON_BATCH_SIZE : JSON_BUFFER_SIZE)
+#define JSON_TX_DOC_SIZE        (JSON_MESH_SIZE > JSON_TX_BASE_SIZE ? JSON_MESH_SIZE : JSON_TX_BASE_SIZE)
+#define JSON_RX_DOC_SIZE        768     // Inbound commands; config updates carry ~20 keys
+
+// Static String Buffers
+#define DEVICE_ID_LENGTH        24      // "esp32_" + 32-bit hex MAC suffix
+#define TOPIC_LENGTH            80      // Longest precomputed MQTT topic; MQTT_SITE up to 31 characters
 
 // Memory Management
 #define HEAP_WARNING_THRESHOLD  10000   // Warn if free heap falls below this value
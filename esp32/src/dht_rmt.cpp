@@ -0,0 +1,169 @@
+/**
+ * PlanetPlant ESP32 DHT22 Driver
+ * Frame: 80 us low + 80 us high response, then 40 bits of 50 us low
+ * followed by ~27 us (0) or ~70 us (1) high; MSB first, humidity,
+ * temperature, checksum
+ */
+
+#include <Arduino.h>
+#include <freertos/ringbuf.h>
+#include "dht_rmt.h"
+
+#define DHT_RMT_CLK_DIV       80      // 1 us ticks from the 80 MHz APB clock
+#define DHT_IDLE_THRESHOLD    200     // Line high this long ends the frame (us)
+#define DHT_FILTER_TICKS      100     // Glitch filter, APB ticks (~1.25 us)
+#define DHT_BIT_THRESHOLD     48      // High time above this is a 1 (us)
+#define DHT_FRAME_BITS        40
+
+bool DhtRmt::begin(uint8_t dhtPin, rmt_channel_t rmtChannel, DhtCallback onReading) {
+  pin = dhtPin;
+  channel = rmtChannel;
+  callback = onReading;
+
+  // Open drain with the pull-up: the host only ever pulls the line low,
+  // and the RMT keeps seeing the pad through the input path
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode((gpio_num_t)pin, GPIO_PULLUP_ONLY);
+  gpio_set_level((gpio_num_t)pin, 1);
+
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)pin, channel);
+  config.clk_div = DHT_RMT_CLK_DIV;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = DHT_FILTER_TICKS;
+  config.rx_config.idle_threshold = DHT_IDLE_THRESHOLD;
+
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(channel, 512, 0) != ESP_OK ||
+      rmt_get_ringbuf_handle(channel, &ringbuf) != ESP_OK) {
+    Serial.println("❌ DHT RMT channel setup failed");
+    ringbuf = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool DhtRmt::reset() {
+  if (ringbuf != nullptr) {
+    rmt_rx_stop(channel);
+    rmt_driver_uninstall(channel);
+    ringbuf = nullptr;
+  }
+  state = STATE_IDLE;
+  attempt = 0;
+  return begin(pin, channel, callback);
+}
+
+bool DhtRmt::read(uint32_t now) {
+  if (ringbuf == nullptr || state != STATE_IDLE) {
+    return false;
+  }
+  attempt = 0;
+  startPulse();
+  return true;
+}
+
+uint32_t DhtRmt::service(uint32_t now) {
+  switch (state) {
+    case STATE_START_PULSE:
+      startCapture();
+      return DHT_CAPTURE_MS;
+
+    case STATE_CAPTURE: {
+      rmt_rx_stop(channel);
+      int result = collect(now);
+      if (result > 0) {
+        state = STATE_IDLE;
+        return 0;
+      }
+      if (result == 0) {
+        checksumErrorCount++;
+      } else {
+        timeoutCount++;
+      }
+      return fail();
+    }
+
+    case STATE_RETRY_WAIT:
+      startPulse();
+      return DHT_START_PULSE_MS;
+
+    case STATE_IDLE:
+    default:
+      return 0;
+  }
+}
+
+bool DhtRmt::latest(DhtReading& reading, uint32_t now, uint32_t maxAgeMs) const {
+  if (!hasReading || now - last.timestamp > maxAgeMs) {
+    return false;
+  }
+  reading = last;
+  return true;
+}
+
+void DhtRmt::startPulse() {
+  readCount++;
+  gpio_set_level((gpio_num_t)pin, 0);
+  state = STATE_START_PULSE;
+}
+
+void DhtRmt::startCapture() {
+  // Release the line and capture the response in hardware
+  rmt_rx_start(channel, true);
+  gpio_set_level((gpio_num_t)pin, 1);
+  state = STATE_CAPTURE;
+}
+
+int DhtRmt::collect(uint32_t now) {
+  size_t length = 0;
+  rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(ringbuf, &length, 0);
+  if (items == nullptr) {
+    return -1;
+  }
+
+  size_t count = length / sizeof(rmt_item32_t);
+  uint8_t data[5] = {};
+  int bits = 0;
+
+  // Skip everything up to and including the 80/80 us response
+  size_t i = 0;
+  while (i < count && !(items[i].level0 == 0 && items[i].duration0 > 60 && items[i].duration1 > 60)) {
+    i++;
+  }
+  for (i++; i < count && bits < DHT_FRAME_BITS; i++, bits++) {
+    data[bits / 8] <<= 1;
+    if (items[i].duration1 > DHT_BIT_THRESHOLD) {
+      data[bits / 8] |= 1;
+    }
+  }
+  vRingbufferReturnItem(ringbuf, items);
+
+  if (bits < DHT_FRAME_BITS || (uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+    return 0;
+  }
+
+  float temperature = ((data[2] & 0x7F) << 8 | data[3]) * 0.1f;
+  if (data[2] & 0x80) {
+    temperature = -temperature;
+  }
+
+  last.humidity = (data[0] << 8 | data[1]) * 0.1f;
+  last.temperature = temperature;
+  last.timestamp = now;
+  hasReading = true;
+
+  if (callback != nullptr) {
+    callback(last);
+  }
+  return 1;
+}
+
+uint32_t DhtRmt::fail() {
+  // The sensor ignores requests closer than its sampling period
+  if (attempt++ < DHT_MAX_RETRIES) {
+    state = STATE_RETRY_WAIT;
+    return DHT_RETRY_DELAY;
+  }
+  Serial.println("❌ Failed to read DHT sensor!");
+  state = STATE_IDLE;
+  return 0;
+}
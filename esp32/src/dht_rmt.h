@@ -0,0 +1,76 @@
+/**
+ * PlanetPlant ESP32 DHT22 Driver
+ * Single-wire DHT22/AM2302 reads captured by the RMT peripheral: the CPU
+ * only drives the start pulse, the pulse train is timed in hardware, so
+ * interrupts stay enabled and WiFi is not disturbed. service() advances a
+ * small state machine and never blocks; checksum or timeout failures are
+ * retried after the sensor's minimum interval. The last valid reading is
+ * cached and delivered through an optional callback.
+ *
+ * Owned by the sensing task; not thread-safe.
+ */
+
+#ifndef DHT_RMT_H
+#define DHT_RMT_H
+
+#include <stdint.h>
+#include <driver/rmt.h>
+#include "config.h"
+
+#define DHT_CAPTURE_MS        10      // Response + 40 bits take ~5 ms
+#define DHT_MAX_RETRIES       2       // Extra attempts per read() after a failure
+
+struct DhtReading {
+  float temperature;        // °C
+  float humidity;           // %RH
+  uint32_t timestamp;       // millis() when captured
+};
+
+typedef void (*DhtCallback)(const DhtReading& reading);
+
+class DhtRmt {
+public:
+  bool begin(uint8_t pin, rmt_channel_t channel, DhtCallback callback = nullptr);
+
+  // Abort any read, reinstall the RMT channel and release the line. The
+  // cached reading is kept.
+  bool reset();
+
+  // Start a read; returns false if one is already in progress.
+  bool read(uint32_t now);
+
+  // Advance the read. Returns ms until it wants to run again, 0 when idle.
+  uint32_t service(uint32_t now);
+
+  bool busy() const { return state != STATE_IDLE; }
+
+  // Latest valid reading, if it is younger than maxAgeMs.
+  bool latest(DhtReading& reading, uint32_t now, uint32_t maxAgeMs) const;
+
+  uint32_t reads() const { return readCount; }
+  uint32_t checksumErrors() const { return checksumErrorCount; }
+  uint32_t timeouts() const { return timeoutCount; }
+
+private:
+  enum State { STATE_IDLE, STATE_START_PULSE, STATE_CAPTURE, STATE_RETRY_WAIT };
+
+  uint8_t pin = 0;
+  rmt_channel_t channel = RMT_CHANNEL_0;
+  RingbufHandle_t ringbuf = nullptr;
+  DhtCallback callback = nullptr;
+  State state = STATE_IDLE;
+  uint8_t attempt = 0;
+  bool hasReading = false;
+  DhtReading last = {};
+  uint32_t readCount = 0;
+  uint32_t checksumErrorCount = 0;
+  uint32_t timeoutCount = 0;
+
+  void startPulse();
+  void startCapture();
+  // Returns 1 on success, 0 on a bad frame, -1 if nothing was captured
+  int collect(uint32_t now);
+  uint32_t fail();
+};
+
+#endif // DHT_RMT_H
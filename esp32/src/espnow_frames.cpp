@@ -0,0 +1,138 @@
+/**
+ * PlanetPlant ESP-NOW Frames
+ */
+
+#include <string.h>
+#include "espnow_frames.h"
+
+static uint8_t* putU16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+  return out + 2;
+}
+
+static uint8_t* putU32(uint8_t* out, uint32_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+  out[3] = value >> 24;
+  return out + 4;
+}
+
+static uint16_t getU16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static uint8_t* putHeader(uint8_t* out, uint8_t type, uint8_t flags, uint16_t seq) {
+  *out++ = ESPNOW_FRAME_MAGIC;
+  *out++ = ESPNOW_FRAME_VERSION;
+  *out++ = type;
+  *out++ = flags;
+  out = putU16(out, ESPNOW_NETWORK_ID);
+  return putU16(out, seq);
+}
+
+size_t encodeEspNowSample(const EspNowSample& sample, uint8_t* buffer, size_t capacity) {
+  uint8_t zones = sample.zoneCount < ZONE_MAX ? sample.zoneCount : ZONE_MAX;
+  if (capacity < ESPNOW_SAMPLE_SIZE(zones)) {
+    return 0;
+  }
+
+  uint8_t* out = putHeader(buffer, ESPNOW_FRAME_SAMPLE, sample.flags, sample.seq);
+  out = putU32(out, sample.leaf);
+  out = putU32(out, sample.ageMs);
+  out = putU16(out, (uint16_t)sample.temperature);
+  out = putU16(out, sample.humidity);
+  *out++ = sample.moisture;
+  *out++ = sample.light;
+  *out++ = zones;
+  *out++ = sample.zonePumps;
+  memcpy(out, sample.zoneMoisture, zones);
+  out += zones;
+
+  return out - buffer;
+}
+
+size_t encodeEspNowReply(const EspNowReply& reply, uint8_t* buffer, size_t capacity) {
+  uint8_t count = reply.count < ESPNOW_REPLY_COMMANDS ? reply.count : ESPNOW_REPLY_COMMANDS;
+  if (capacity < ESPNOW_REPLY_SIZE(count)) {
+    return 0;
+  }
+
+  uint8_t* out = putHeader(buffer, ESPNOW_FRAME_REPLY, 0, reply.seq);
+  *out++ = count;
+  for (uint8_t i = 0; i < count; i++) {
+    *out++ = reply.commands[i].action;
+    *out++ = reply.commands[i].zone;
+    out = putU32(out, reply.commands[i].duration);
+  }
+
+  return out - buffer;
+}
+
+uint8_t espNowFrameType(const uint8_t* frame, size_t length) {
+  // Newer versions only ever append, like the telemetry frames
+  if (length < ESPNOW_HEADER_SIZE || frame[0] != ESPNOW_FRAME_MAGIC || frame[1] < ESPNOW_FRAME_VERSION ||
+      getU16(frame + 4) != ESPNOW_NETWORK_ID) {
+    return 0;
+  }
+  return frame[2];
+}
+
+bool decodeEspNowSample(const uint8_t* frame, size_t length, EspNowSample& sample) {
+  if (length < ESPNOW_SAMPLE_SIZE(0)) {
+    return false;
+  }
+
+  sample = {};
+  sample.flags = frame[3];
+  sample.seq = getU16(frame + 6);
+  sample.leaf = getU32(frame + 8);
+  sample.ageMs = getU32(frame + 12);
+  sample.temperature = (int16_t)getU16(frame + 16);
+  sample.humidity = getU16(frame + 18);
+  sample.moisture = frame[20];
+  sample.light = frame[21];
+  sample.zoneCount = frame[22];
+  sample.zonePumps = frame[23];
+
+  // A leaf with more zones than this build knows keeps the ones we can show
+  if (length < ESPNOW_SAMPLE_SIZE(sample.zoneCount)) {
+    return false;
+  }
+  if (sample.zoneCount > ZONE_MAX) {
+    sample.zoneCount = ZONE_MAX;
+  }
+  memcpy(sample.zoneMoisture, frame + 24, sample.zoneCount);
+  return true;
+}
+
+bool decodeEspNowReply(const uint8_t* frame, size_t length, EspNowReply& reply) {
+  if (length < ESPNOW_REPLY_SIZE(0)) {
+    return false;
+  }
+
+  reply = {};
+  reply.seq = getU16(frame + 6);
+  uint8_t count = frame[8];
+  if (count > ESPNOW_REPLY_COMMANDS || length < ESPNOW_REPLY_SIZE(count)) {
+    return false;
+  }
+
+  const uint8_t* in = frame + 9;
+  for (uint8_t i = 0; i < count; i++, in += 6) {
+    EspNowCommand& command = reply.commands[i];
+    if (in[0] != ESPNOW_ACTION_WATER_START && in[0] != ESPNOW_ACTION_WATER_STOP) {
+      return false;
+    }
+    command.action = (EspNowAction)in[0];
+    command.zone = in[1];
+    command.duration = getU32(in + 2);
+  }
+  reply.count = count;
+  return true;
+}
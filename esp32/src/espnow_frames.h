@@ -0,0 +1,97 @@
+/**
+ * PlanetPlant ESP-NOW Frames
+ * Wire format between leaf nodes and their gateway (ESPNOW_ROLE in
+ * config.h). Little-endian, well inside the 250-byte ESP-NOW payload.
+ *
+ * Header (8 bytes):
+ *   0  u8   magic 0xA9
+ *   1  u8   version
+ *   2  u8   frame type (ESPNOW_FRAME_*)
+ *   3  u8   flags (ESPNOW_FLAG_*)
+ *   4  u16  network id (ESPNOW_NETWORK_ID)
+ *   6  u16  sequence, per leaf; a reply echoes the sample's
+ *
+ * Sample, leaf to gateway (24 bytes + one per zone):
+ *   8  u32  leaf id, the hex digits of its esp32_<id> device id
+ *   12 u32  age_ms, capture to send
+ *   16 i16  temperature (0.01 °C)
+ *   18 u16  humidity (0.01 %)
+ *   20 u8   moisture (%, zone 0)
+ *   21 u8   light (%)
+ *   22 u8   zone count
+ *   23 u8   pumping zones (bit per zone)
+ *   24      moisture per zone (u8 %)
+ *
+ * Reply, gateway to leaf (9 bytes + 6 per command):
+ *   8  u8   command count
+ *   9       per command: u8 action (ESPNOW_ACTION_*), u8 zone, u32 duration (ms)
+ *
+ * Kept free of the ESP-NOW driver so the host build covers it.
+ */
+
+#ifndef ESPNOW_FRAMES_H
+#define ESPNOW_FRAMES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define ESPNOW_FRAME_MAGIC      0xA9
+#define ESPNOW_FRAME_VERSION    1
+#define ESPNOW_FRAME_SAMPLE     1
+#define ESPNOW_FRAME_REPLY      2
+
+#define ESPNOW_FLAG_PUMP_ACTIVE 0x01
+#define ESPNOW_FLAG_DUTY_CYCLE  0x02    // Leaf sleeps between samples
+
+#define ESPNOW_HEADER_SIZE      8
+#define ESPNOW_SAMPLE_SIZE(zones) (24u + (zones))
+#define ESPNOW_REPLY_SIZE(commands) (9u + (commands) * 6u)
+#define ESPNOW_REPLY_COMMANDS   ESPNOW_LEAF_COMMANDS
+#define ESPNOW_FRAME_MAX        ESPNOW_SAMPLE_SIZE(ZONE_MAX)
+
+static_assert(ESPNOW_REPLY_SIZE(ESPNOW_REPLY_COMMANDS) <= ESPNOW_FRAME_MAX, "Reply must fit ESPNOW_FRAME_MAX");
+
+struct EspNowSample {
+  uint32_t leaf;
+  uint16_t seq;
+  uint8_t flags;
+  uint32_t ageMs;
+  int16_t temperature;      // 0.01 °C
+  uint16_t humidity;        // 0.01 %
+  uint8_t moisture;
+  uint8_t light;
+  uint8_t zoneCount;
+  uint8_t zonePumps;
+  uint8_t zoneMoisture[ZONE_MAX];
+};
+
+enum EspNowAction : uint8_t {
+  ESPNOW_ACTION_WATER_START = 1,
+  ESPNOW_ACTION_WATER_STOP = 2
+};
+
+struct EspNowCommand {
+  EspNowAction action;
+  uint8_t zone;
+  uint32_t duration;        // ESPNOW_ACTION_WATER_START, 0 = the leaf's default
+};
+
+struct EspNowReply {
+  uint16_t seq;
+  uint8_t count;
+  EspNowCommand commands[ESPNOW_REPLY_COMMANDS];
+};
+
+// Return the frame length, or 0 if capacity is too small
+size_t encodeEspNowSample(const EspNowSample& sample, uint8_t* buffer, size_t capacity);
+size_t encodeEspNowReply(const EspNowReply& reply, uint8_t* buffer, size_t capacity);
+
+// Frame type of a valid header for this network, 0 otherwise
+uint8_t espNowFrameType(const uint8_t* frame, size_t length);
+
+// False for truncated frames or unknown actions
+bool decodeEspNowSample(const uint8_t* frame, size_t length, EspNowSample& sample);
+bool decodeEspNowReply(const uint8_t* frame, size_t length, EspNowReply& reply);
+
+#endif // ESPNOW_FRAMES_H
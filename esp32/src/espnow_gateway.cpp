@@ -0,0 +1,222 @@
+/**
+ * PlanetPlant ESP32 ESP-NOW Gateway
+ */
+
+#include <stdlib.h>
+#include "espnow_link.h"
+#include "espnow_gateway.h"
+
+EspNowGateway meshGateway;
+
+bool meshLeafId(const char* deviceId, uint32_t& leaf) {
+  if (strncmp(deviceId, "esp32_", 6) != 0 || deviceId[6] == 0) {
+    return false;
+  }
+  char* end;
+  unsigned long id = strtoul(deviceId + 6, &end, 16);
+  if (*end != 0 || id == 0 || id > UINT32_MAX) {
+    return false;
+  }
+  leaf = id;
+  return true;
+}
+
+bool EspNowGateway::begin() {
+  if (running) {
+    return true;
+  }
+  running = espNow.begin(&networkTaskHandle);
+  if (running) {
+    Serial.printf("📡 ESP-NOW gateway on channel %u\n", espNow.channel());
+  }
+  return running;
+}
+
+void EspNowGateway::service(uint32_t now, uint64_t epochMs) {
+  if (!running) {
+    return;
+  }
+
+  // Results come back in send order; only replies carry commands
+  EspNowSendResult result;
+  while (espNow.sendResult(result)) {
+    Leaf* leaf = findMac(result.mac);
+    if (leaf == nullptr || leaf->inFlight == 0) {
+      continue;
+    }
+    if (result.delivered) {
+      for (uint8_t sent = leaf->inFlight; sent > 0; sent--) {
+        settle(*leaf, 0, true);
+      }
+    }
+    // Unacked ones go out again with the reply to the next sample
+    leaf->inFlight = 0;
+  }
+
+  EspNowPacket packet;
+  while (espNow.receive(packet)) {
+    EspNowSample sample;
+    if (espNowFrameType(packet.data, packet.length) == ESPNOW_FRAME_SAMPLE &&
+        decodeEspNowSample(packet.data, packet.length, sample) && sample.leaf != 0) {
+      onSample(packet.mac, sample, now);
+    }
+  }
+
+  if (epochMs == 0) {
+    return;
+  }
+  for (Leaf& leaf : leaves) {
+    for (uint8_t i = leaf.inFlight; i < leaf.heldCount;) {
+      if (leaf.held[i].expiresAt > 0 && epochMs > leaf.held[i].expiresAt) {
+        settle(leaf, i, false);
+      } else {
+        i++;
+      }
+    }
+  }
+}
+
+void EspNowGateway::onSample(const uint8_t mac[6], const EspNowSample& sample, uint32_t now) {
+  Leaf* leaf = find(sample.leaf);
+  if (leaf == nullptr) {
+    leaf = admit(sample.leaf);
+  }
+  if (leaf == nullptr) {
+    dropped++;
+    return;
+  }
+
+  // A retry after a lost reply is answered again but batched once
+  bool retry = leaf->heard && leaf->lastSeq == sample.seq;
+  if (leaf->heard && memcmp(leaf->mac, mac, 6) != 0) {
+    espNow.removePeer(leaf->mac);
+  }
+  memcpy(leaf->mac, mac, 6);
+  leaf->heard = true;
+  leaf->lastSeq = sample.seq;
+  leaf->lastSeen = now;
+
+  if (!retry) {
+    if (batchCount < ESPNOW_BATCH_MAX) {
+      batch[batchCount].sample = sample;
+      batch[batchCount].receivedAt = now;
+      batchCount++;
+    } else {
+      dropped++;
+    }
+  }
+
+  reply(*leaf, sample.seq);
+}
+
+void EspNowGateway::reply(Leaf& leaf, uint16_t seq) {
+  EspNowReply reply = {};
+  reply.seq = seq;
+  reply.count = leaf.heldCount;
+  for (uint8_t i = 0; i < leaf.heldCount; i++) {
+    reply.commands[i] = leaf.held[i].command;
+  }
+
+  uint8_t frame[ESPNOW_FRAME_MAX];
+  size_t length = encodeEspNowReply(reply, frame, sizeof(frame));
+  if (length == 0 || !espNow.addPeer(leaf.mac)) {
+    return;
+  }
+  leaf.inFlight = espNow.send(leaf.mac, frame, length) ? reply.count : 0;
+}
+
+bool EspNowGateway::relay(uint32_t id, const Command& command, const char* requestId, uint64_t expiresAt) {
+  Leaf* leaf = find(id);
+  if (leaf == nullptr) {
+    leaf = admit(id);
+  }
+  if (leaf == nullptr || leaf->heldCount >= ESPNOW_LEAF_COMMANDS) {
+    return false;
+  }
+
+  HeldCommand& held = leaf->held[leaf->heldCount++];
+  held.command.action = command.type == COMMAND_WATER_START ? ESPNOW_ACTION_WATER_START : ESPNOW_ACTION_WATER_STOP;
+  held.command.zone = command.zone;
+  held.command.duration = command.type == COMMAND_WATER_START ? command.value : 0;
+  strlcpy(held.requestId, requestId, sizeof(held.requestId));
+  held.expiresAt = expiresAt;
+  return true;
+}
+
+bool EspNowGateway::takeOutcome(RelayOutcome& outcome) {
+  if (outcomeCount == 0) {
+    return false;
+  }
+  outcome = outcomes[outcomeHead];
+  outcomeHead = (outcomeHead + 1) % ESPNOW_OUTCOME_MAX;
+  outcomeCount--;
+  return true;
+}
+
+uint8_t EspNowGateway::leafCount() const {
+  uint8_t count = 0;
+  for (const Leaf& leaf : leaves) {
+    if (leaf.id != 0 && leaf.heard) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void EspNowGateway::settle(Leaf& leaf, uint8_t index, bool delivered) {
+  // Overflow only if the network task stopped draining; the backend
+  // times the command out instead
+  if (outcomeCount < ESPNOW_OUTCOME_MAX) {
+    RelayOutcome& outcome = outcomes[(outcomeHead + outcomeCount) % ESPNOW_OUTCOME_MAX];
+    strlcpy(outcome.requestId, leaf.held[index].requestId, sizeof(outcome.requestId));
+    outcome.delivered = delivered;
+    outcomeCount++;
+  }
+
+  for (uint8_t i = index + 1; i < leaf.heldCount; i++) {
+    leaf.held[i - 1] = leaf.held[i];
+  }
+  leaf.heldCount--;
+}
+
+EspNowGateway::Leaf* EspNowGateway::find(uint32_t id) {
+  for (Leaf& leaf : leaves) {
+    if (leaf.id == id) {
+      return &leaf;
+    }
+  }
+  return nullptr;
+}
+
+EspNowGateway::Leaf* EspNowGateway::findMac(const uint8_t mac[6]) {
+  for (Leaf& leaf : leaves) {
+    if (leaf.id != 0 && leaf.heard && memcmp(leaf.mac, mac, 6) == 0) {
+      return &leaf;
+    }
+  }
+  return nullptr;
+}
+
+EspNowGateway::Leaf* EspNowGateway::admit(uint32_t id) {
+  // A free slot, else the longest silent leaf with nothing held
+  Leaf* slot = nullptr;
+  for (Leaf& leaf : leaves) {
+    if (leaf.id == 0) {
+      slot = &leaf;
+      break;
+    }
+    if (leaf.heldCount == 0 && (slot == nullptr || (int32_t)(leaf.lastSeen - slot->lastSeen) < 0)) {
+      slot = &leaf;
+    }
+  }
+  if (slot == nullptr) {
+    return nullptr;
+  }
+
+  if (slot->id != 0 && slot->heard) {
+    espNow.removePeer(slot->mac);
+  }
+  *slot = {};
+  slot->id = id;
+  return slot;
+}
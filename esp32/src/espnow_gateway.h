@@ -0,0 +1,97 @@
+/**
+ * PlanetPlant ESP32 ESP-NOW Gateway
+ * What a gateway build (ESPNOW_ROLE_GATEWAY) runs on top of its normal
+ * WiFi/MQTT stack for the leaves around it (espnow_leaf.cpp). Every leaf
+ * sample is answered with a reply carrying the water commands held for
+ * that leaf; the samples are batched for one evt/mesh publish.
+ *
+ * Leaves are keyed by the id in their samples, so commands can be held
+ * for a leaf the gateway hasn't heard since it booted. A held command
+ * settles once the leaf's MAC layer acked the reply that carried it, or
+ * when it expires; network.cpp acks it to the backend then.
+ *
+ * Network task only.
+ */
+
+#ifndef ESPNOW_GATEWAY_H
+#define ESPNOW_GATEWAY_H
+
+#include "messages.h"
+#include "espnow_frames.h"
+
+#define ESPNOW_REQUEST_ID_LENGTH 40     // Backend command ids, as in handleDeviceCommand()
+#define ESPNOW_OUTCOME_MAX      (ESPNOW_MAX_LEAVES * ESPNOW_LEAF_COMMANDS)
+
+struct MeshSample {
+  EspNowSample sample;
+  uint32_t receivedAt;      // millis()
+};
+
+struct RelayOutcome {
+  char requestId[ESPNOW_REQUEST_ID_LENGTH];
+  bool delivered;           // false: expired before the leaf woke
+};
+
+class EspNowGateway {
+public:
+  // Once WiFi is up; the radio stays on the access point's channel
+  bool begin();
+  bool started() const { return running; }
+
+  // Drain received samples and send results. epochMs is 0 while the
+  // clock isn't synced; commands only expire once it is.
+  void service(uint32_t now, uint64_t epochMs);
+
+  // Hold a water command until the leaf's next sample. False if the
+  // leaf's slots, or the table, are full.
+  bool relay(uint32_t leaf, const Command& command, const char* requestId, uint64_t expiresAt);
+  bool takeOutcome(RelayOutcome& outcome);
+
+  const MeshSample* samples() const { return batch; }
+  uint8_t sampleCount() const { return batchCount; }
+  void clearSamples() { batchCount = 0; }
+
+  uint8_t leafCount() const;
+  uint32_t samplesDropped() const { return dropped; }
+
+private:
+  struct HeldCommand {
+    EspNowCommand command;
+    char requestId[ESPNOW_REQUEST_ID_LENGTH];
+    uint64_t expiresAt;     // Epoch ms, 0 = never
+  };
+
+  struct Leaf {
+    uint32_t id;            // 0 = free slot
+    uint8_t mac[6];
+    bool heard;             // mac and lastSeq are valid
+    uint16_t lastSeq;
+    uint32_t lastSeen;
+    HeldCommand held[ESPNOW_LEAF_COMMANDS];
+    uint8_t heldCount;
+    uint8_t inFlight;       // held[0..inFlight) went out with the last reply
+  };
+
+  bool running = false;
+  Leaf leaves[ESPNOW_MAX_LEAVES] = {};
+  MeshSample batch[ESPNOW_BATCH_MAX];
+  uint8_t batchCount = 0;
+  uint32_t dropped = 0;
+  RelayOutcome outcomes[ESPNOW_OUTCOME_MAX];
+  uint8_t outcomeHead = 0;
+  uint8_t outcomeCount = 0;
+
+  void onSample(const uint8_t mac[6], const EspNowSample& sample, uint32_t now);
+  void reply(Leaf& leaf, uint16_t seq);
+  void settle(Leaf& leaf, uint8_t index, bool delivered);
+  Leaf* find(uint32_t id);
+  Leaf* findMac(const uint8_t mac[6]);
+  Leaf* admit(uint32_t id);
+};
+
+extern EspNowGateway meshGateway;
+
+// The leaf id behind an esp32_<hex> device id; false for anything else
+bool meshLeafId(const char* deviceId, uint32_t& leaf);
+
+#endif // ESPNOW_GATEWAY_H
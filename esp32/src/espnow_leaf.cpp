@@ -0,0 +1,241 @@
+/**
+ * PlanetPlant ESP32 ESP-NOW Leaf
+ * The network task of a leaf build (ESPNOW_ROLE_LEAF), in place of
+ * network.cpp: no association, DHCP or broker session, just one frame
+ * per sample to the gateway and its reply. A duty-cycled leaf sleeps as
+ * soon as the reply is in, tens of milliseconds after the sample.
+ *
+ * The gateway's MAC and channel are kept across deep sleep. Without
+ * them, or after ESPNOW_SEND_ATTEMPTS unanswered frames, the leaf
+ * broadcasts the sample on every channel until a gateway replies.
+ * Samples no gateway answered are dropped (counted in samplesDropped);
+ * aggregates, pump and watering events stay on the leaf, the gateway
+ * sees pump state in each sample.
+ */
+
+#include "config.h"
+
+#if ESPNOW_ROLE == ESPNOW_ROLE_LEAF
+
+#include <WiFi.h>
+#include <math.h>
+#include "messages.h"
+#include "power.h"
+#include "watchdog.h"
+#include "espnow_link.h"
+#include "trace.h"
+#include "network.h"
+
+#define ESPNOW_CHANNEL_COUNT    13
+
+// Where the gateway was last heard; all-zero means not found yet
+struct LeafLink {
+  uint8_t gateway[6];
+  uint8_t channel;
+  uint16_t seq;
+};
+
+RTC_DATA_ATTR LeafLink leafLink;
+
+char deviceId[DEVICE_ID_LENGTH];
+uint32_t leafId = 0;
+
+struct LeafStats {
+  uint32_t sent;
+  uint32_t delivered;
+  uint32_t dropped;
+  uint32_t scans;
+};
+
+LeafStats leafStats = {};
+
+// Relayed commands are picked up within a sensing loop; the pump only
+// holds the wake off once the sensing task has started it
+uint32_t sleepHeldUntil = 0;
+
+void leafTask(void* parameter);
+void sendSample(const SensorData& data, uint32_t timestamp);
+bool exchange(const uint8_t* frame, size_t length, uint16_t seq, EspNowReply& reply);
+bool scanForGateway(const uint8_t* frame, size_t length, uint16_t seq, EspNowReply& reply);
+bool waitForReply(uint16_t seq, bool unicast, EspNowReply& reply, uint8_t* from);
+void applyReply(const EspNowReply& reply);
+bool gatewayKnown();
+
+void setupWiFi() {
+  // Station mode only starts the radio; it never associates
+  Serial.println("📡 ESP-NOW leaf, no WiFi association");
+  WiFi.mode(WIFI_STA);
+  espNow.begin(&networkTaskHandle);
+  espNow.setChannel(gatewayKnown() ? leafLink.channel : ESPNOW_CHANNEL);
+  if (gatewayKnown()) {
+    espNow.addPeer(leafLink.gateway);
+  }
+}
+
+void setupMQTT() {
+  // The gateway publishes under this id
+  leafId = (uint32_t)ESP.getEfuseMac();
+  snprintf(deviceId, sizeof(deviceId), "esp32_%x", leafId);
+}
+
+void startNetworkTask() {
+  if (xTaskCreatePinnedToCore(leafTask, "network", NETWORK_TASK_STACK, nullptr,
+                              NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE) != pdPASS) {
+    Serial.println("❌ Failed to start the network task, restarting...");
+    ESP.restart();
+  }
+}
+
+NetworkStats networkStats() {
+  NetworkStats stats = {};
+  stats.samplesDropped = leafStats.dropped;
+  return stats;
+}
+
+bool gatewayKnown() {
+  return leafLink.channel != 0;
+}
+
+void leafTask(void* parameter) {
+  watchdogRegister(WATCHDOG_TASK_NETWORK);
+
+  for (;;) {
+    watchdogFeed(WATCHDOG_TASK_NETWORK);
+
+    NetEvent event;
+    while (eventQueue.pop(event)) {
+      if (event.type == EVENT_SENSOR_DATA) {
+        sendSample(event.data, event.timestamp);
+        powerSampleHandled();
+      }
+    }
+
+    // Sleep once the sample is out, never over the pump cutoff
+    bool commandsPending = commandQueue.size() > 0 || (int32_t)(sleepHeldUntil - millis()) > 0;
+    if (DEEP_SLEEP_ENABLED && !powerPumpActive() && !commandsPending && eventQueue.size() == 0 &&
+        (powerSampleDone() || powerAwakeTime() >= AWAKE_BUDGET)) {
+      enterDeepSleep();
+    }
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DEEP_SLEEP_ENABLED ? DUTY_CYCLE_CHECK_INTERVAL : NETWORK_LOOP_INTERVAL));
+  }
+}
+
+void sendSample(const SensorData& data, uint32_t timestamp) {
+  EspNowSample sample = {};
+  sample.leaf = leafId;
+  sample.seq = ++leafLink.seq;
+  sample.flags = (data.pumpActive ? ESPNOW_FLAG_PUMP_ACTIVE : 0) | (DEEP_SLEEP_ENABLED ? ESPNOW_FLAG_DUTY_CYCLE : 0);
+  sample.ageMs = millis() - timestamp;
+  sample.temperature = (int16_t)lroundf(data.temperature * 100.0f);
+  sample.humidity = (uint16_t)lroundf(data.humidity * 100.0f);
+  sample.moisture = data.moisture;
+  sample.light = data.lightLevel;
+  sample.zoneCount = ZONE_COUNT;
+  sample.zonePumps = data.zonePumps;
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    sample.zoneMoisture[zone] = data.zoneMoisture[zone];
+  }
+
+  uint8_t frame[ESPNOW_FRAME_MAX];
+  size_t length = encodeEspNowSample(sample, frame, sizeof(frame));
+
+  uint32_t started = micros();
+  EspNowReply reply;
+  traceBegin(TRACE_ESPNOW_SEND);
+  bool answered = exchange(frame, length, sample.seq, reply) || scanForGateway(frame, length, sample.seq, reply);
+  traceEnd(TRACE_ESPNOW_SEND, answered ? leafLink.channel : 0);
+  leafStats.sent++;
+  if (!answered) {
+    leafStats.dropped++;
+    Serial.println("❌ No ESP-NOW gateway answered, sample dropped");
+    return;
+  }
+
+  leafStats.delivered++;
+  Serial.printf("📡 Sample %u delivered on channel %u in %lu us\n", sample.seq, leafLink.channel,
+                (unsigned long)(micros() - started));
+  applyReply(reply);
+}
+
+bool exchange(const uint8_t* frame, size_t length, uint16_t seq, EspNowReply& reply) {
+  if (!gatewayKnown()) {
+    return false;
+  }
+  for (uint8_t attempt = 0; attempt < ESPNOW_SEND_ATTEMPTS; attempt++) {
+    uint8_t from[6];
+    if (espNow.send(leafLink.gateway, frame, length) && waitForReply(seq, true, reply, from)) {
+      return true;
+    }
+  }
+
+  // Gateway moved channel with its AP, or is gone
+  Serial.println("⚠️  ESP-NOW gateway not answering, scanning");
+  espNow.removePeer(leafLink.gateway);
+  leafLink.channel = 0;
+  return false;
+}
+
+bool scanForGateway(const uint8_t* frame, size_t length, uint16_t seq, EspNowReply& reply) {
+  leafStats.scans++;
+  for (uint8_t channel = 1; channel <= ESPNOW_CHANNEL_COUNT; channel++) {
+    espNow.setChannel(channel);
+    uint8_t from[6];
+    if (espNow.send(ESPNOW_BROADCAST, frame, length) && waitForReply(seq, false, reply, from)) {
+      memcpy(leafLink.gateway, from, sizeof(leafLink.gateway));
+      leafLink.channel = channel;
+      espNow.addPeer(leafLink.gateway);
+      Serial.printf("📡 ESP-NOW gateway %02x:%02x:%02x:%02x:%02x:%02x on channel %u\n", from[0], from[1],
+                    from[2], from[3], from[4], from[5], channel);
+      return true;
+    }
+  }
+  espNow.setChannel(ESPNOW_CHANNEL);
+  return false;
+}
+
+bool waitForReply(uint16_t seq, bool unicast, EspNowReply& reply, uint8_t* from) {
+  uint32_t started = millis();
+  for (;;) {
+    EspNowSendResult result;
+    while (espNow.sendResult(result)) {
+      // A unicast frame nobody acked won't be answered either
+      if (unicast && !result.delivered) {
+        return false;
+      }
+    }
+
+    EspNowPacket packet;
+    while (espNow.receive(packet)) {
+      if (espNowFrameType(packet.data, packet.length) == ESPNOW_FRAME_REPLY &&
+          decodeEspNowReply(packet.data, packet.length, reply) && reply.seq == seq) {
+        memcpy(from, packet.mac, 6);
+        return true;
+      }
+    }
+
+    uint32_t elapsed = millis() - started;
+    if (elapsed >= ESPNOW_REPLY_TIMEOUT) {
+      return false;
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ESPNOW_REPLY_TIMEOUT - elapsed));
+  }
+}
+
+void applyReply(const EspNowReply& reply) {
+  // Commands the gateway held since the last sample
+  for (uint8_t i = 0; i < reply.count; i++) {
+    const EspNowCommand& relayed = reply.commands[i];
+    if (relayed.zone >= ZONE_COUNT) {
+      continue;
+    }
+    Command command = {};
+    command.type = relayed.action == ESPNOW_ACTION_WATER_START ? COMMAND_WATER_START : COMMAND_WATER_STOP;
+    command.value = relayed.duration;
+    command.zone = relayed.zone;
+    postCommand(command);
+    sleepHeldUntil = millis() + 2 * SENSING_LOOP_INTERVAL;
+  }
+}
+
+#endif // ESPNOW_ROLE == ESPNOW_ROLE_LEAF
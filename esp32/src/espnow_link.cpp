@@ -0,0 +1,83 @@
+/**
+ * PlanetPlant ESP32 ESP-NOW Link
+ */
+
+#include <esp_wifi.h>
+#include "espnow_link.h"
+
+EspNowLink espNow;
+
+const uint8_t ESPNOW_BROADCAST[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+bool EspNowLink::begin(TaskHandle_t* notifyTask) {
+  notify = notifyTask;
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("❌ ESP-NOW init failed");
+    return false;
+  }
+  esp_now_register_recv_cb(onReceive);
+  esp_now_register_send_cb(onSent);
+  return addPeer(ESPNOW_BROADCAST);
+}
+
+bool EspNowLink::setChannel(uint8_t channel) {
+  return esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+}
+
+uint8_t EspNowLink::channel() const {
+  uint8_t primary = 0;
+  wifi_second_chan_t second;
+  esp_wifi_get_channel(&primary, &second);
+  return primary;
+}
+
+bool EspNowLink::addPeer(const uint8_t mac[6]) {
+  if (esp_now_is_peer_exist(mac)) {
+    return true;
+  }
+  
+  // Channel 0 follows the radio, so a leaf's scan and a gateway's AP
+  // changes need no peer updates
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, mac, 6);
+  peer.channel = 0;
+  peer.ifidx = WIFI_IF_STA;
+  peer.encrypt = false;
+  return esp_now_add_peer(&peer) == ESP_OK;
+}
+
+void EspNowLink::removePeer(const uint8_t mac[6]) {
+  esp_now_del_peer(mac);
+}
+
+bool EspNowLink::send(const uint8_t mac[6], const uint8_t* data, size_t length) {
+  return esp_now_send(mac, data, length) == ESP_OK;
+}
+
+void EspNowLink::onReceive(const uint8_t* mac, const uint8_t* data, int length) {
+  // The header check happens on the task
+  if (length <= 0) {
+    return;
+  }
+  EspNowPacket packet;
+  memcpy(packet.mac, mac, 6);
+  packet.length = length < ESPNOW_PACKET_MAX ? length : ESPNOW_PACKET_MAX;
+  memcpy(packet.data, data, packet.length);
+  espNow.rx.push(packet);
+  espNow.wake();
+}
+
+void EspNowLink::onSent(const uint8_t* mac, esp_now_send_status_t status) {
+  EspNowSendResult result;
+  memcpy(result.mac, mac, 6);
+  result.delivered = status == ESP_NOW_SEND_SUCCESS;
+  espNow.tx.push(result);
+  espNow.wake();
+}
+
+void EspNowLink::wake() {
+  TaskHandle_t task = notify != nullptr ? *notify : nullptr;
+  if (task != nullptr) {
+    xTaskNotifyGive(task);
+  }
+}
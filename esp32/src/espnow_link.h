@@ -0,0 +1,75 @@
+/**
+ * PlanetPlant ESP32 ESP-NOW Link
+ * Connectionless frames between a leaf node and its gateway on the WiFi
+ * radio, without association, DHCP or TCP (frames in espnow_frames.h).
+ *
+ * Leaves (ESPNOW_ROLE_LEAF) replace the whole WiFi/MQTT stack with it,
+ * see espnow_leaf.cpp: each sample goes to the gateway, whose reply
+ * carries the commands held for the leaf. A gateway (ESPNOW_ROLE_GATEWAY)
+ * runs the normal network task with espnow_gateway.h on top, on the
+ * channel of its access point.
+ *
+ * The driver callbacks run on the WiFi task and only copy frames and
+ * send results into queues and wake the owning task, which drains them.
+ * Owning task only, apart from those callbacks.
+ */
+
+#ifndef ESPNOW_LINK_H
+#define ESPNOW_LINK_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include "spsc_queue.h"
+#include "espnow_frames.h"
+
+#define ESPNOW_RX_QUEUE         16      // Received frames between services (power of two)
+#define ESPNOW_TX_QUEUE         8       // Send results between services (power of two)
+#define ESPNOW_PACKET_MAX       64      // Bytes kept per frame; newer frames only append
+
+struct EspNowPacket {
+  uint8_t mac[6];
+  uint8_t length;
+  uint8_t data[ESPNOW_PACKET_MAX];
+};
+
+struct EspNowSendResult {
+  uint8_t mac[6];
+  bool delivered;           // The peer's MAC layer acked it
+};
+
+class EspNowLink {
+public:
+  // WiFi already in station mode. *notify is woken for every received
+  // frame and send result.
+  bool begin(TaskHandle_t* notify);
+
+  // Leaves only: a gateway stays on its access point's channel
+  bool setChannel(uint8_t channel);
+  uint8_t channel() const;
+
+  // Unicast needs the peer registered; true once it is. The broadcast
+  // address reaches every node on the channel, unacknowledged.
+  bool addPeer(const uint8_t mac[6]);
+  void removePeer(const uint8_t mac[6]);
+
+  bool send(const uint8_t mac[6], const uint8_t* data, size_t length);
+
+  bool receive(EspNowPacket& packet) { return rx.pop(packet); }
+  bool sendResult(EspNowSendResult& result) { return tx.pop(result); }
+  uint32_t dropped() const { return rx.droppedCount(); }
+
+private:
+  TaskHandle_t* notify = nullptr;
+  SpscQueue<EspNowPacket, ESPNOW_RX_QUEUE> rx;
+  SpscQueue<EspNowSendResult, ESPNOW_TX_QUEUE> tx;
+
+  static void onReceive(const uint8_t* mac, const uint8_t* data, int length);
+  static void onSent(const uint8_t* mac, esp_now_send_status_t status);
+  void wake();
+};
+
+extern EspNowLink espNow;
+
+extern const uint8_t ESPNOW_BROADCAST[6];
+
+#endif // ESPNOW_LINK_H
@@ -0,0 +1,23 @@
+/**
+ * PlanetPlant ESP32 FNV-1a Hash
+ * 32-bit FNV-1a over the bytes of a string, for ids that pick a slot or
+ * shard. raspberry-pi/src/config/topics.js mirrors it for topic shards.
+ */
+
+#ifndef FNV1A_H
+#define FNV1A_H
+
+#include <stdint.h>
+
+#define FNV1A_OFFSET_BASIS  2166136261u
+#define FNV1A_PRIME         16777619u
+
+inline uint32_t fnv1a32(const char* text) {
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  for (const char* c = text; *c != 0; c++) {
+    hash = (hash ^ (uint8_t)*c) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+#endif // FNV1A_H
@@ -0,0 +1,23 @@
+/**
+ * PlanetPlant ESP32 Hardware Abstraction
+ * The platform surface the portable core (scheduler, filters, settings,
+ * payloads, codecs, queues) is allowed to use: millis()/micros(), Serial
+ * logging, RTC placement attributes, FreeRTOS task handles, critical
+ * sections and Preferences (NVS). On the device this is the Arduino core;
+ * the PlatformIO native env supplies host versions from native/hal_native.h.
+ *
+ * Hardware drivers, WiFi and MQTT stay outside the core and keep using
+ * the Arduino and IDF headers directly.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Preferences.h>
+#else
+#include "hal_native.h"
+#endif
+
+#endif // HAL_H
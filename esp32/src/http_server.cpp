@@ -0,0 +1,404 @@
+/**
+ * PlanetPlant ESP32 Local HTTP Endpoint
+ * Each response slot renders its next piece (a metrics family, a sample
+ * row, the config document) into its own buffer when the chunk callback
+ * asks for more, and hands it out across as many chunks as needed.
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+#include <stdarg.h>
+#include "config.h"
+#include "messages.h"
+#include "metrics.h"
+#include "runtime_settings.h"
+#include "sample_history.h"
+#include "network.h"
+#include "http_server.h"
+
+#define PROMETHEUS_CONTENT_TYPE "text/plain; version=0.0.4"
+#define CONFIG_DOC_SIZE         1024
+#define LABELS_LENGTH           96
+#define SAMPLE_CSV_HEADER       "timestamp,epoch,boot_id,temperature,humidity,moisture,light,pump\n"
+
+struct TextBuffer {
+  char* data;
+  size_t capacity;
+  size_t length;
+};
+
+struct ResponseStream;
+typedef bool (*StreamRenderer)(ResponseStream& stream, TextBuffer& text);
+
+struct ResponseStream {
+  bool busy;
+  StreamRenderer render;      // Next piece into text, false at the end
+  const char* header;         // Sent before the first piece
+  uint32_t cursor;
+  uint32_t end;
+  bool binary;
+  uint16_t length;
+  uint16_t sent;
+  char text[HTTP_STREAM_BUFFER_SIZE];
+};
+
+AsyncWebServer httpServer(WEB_SERVER_PORT);
+
+// Only touched on the AsyncTCP task
+ResponseStream streams[HTTP_MAX_STREAMS];
+StaticJsonDocument<CONFIG_DOC_SIZE> configDoc;
+char deviceLabel[DEVICE_ID_LENGTH + 12];
+
+static void append(TextBuffer& text, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(TextBuffer& text, const char* format, ...) {
+  if (text.length >= text.capacity) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(text.data + text.length, text.capacity - text.length, format, args);
+  va_end(args);
+  text.length = written > 0 ? min(text.capacity, text.length + written) : text.length;
+}
+
+static void family(TextBuffer& text, const char* name, const char* type, const char* help) {
+  append(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void sample(TextBuffer& text, const char* name, const char* labels, double value) {
+  append(text, "%s{%s} %.10g\n", name, labels, value);
+}
+
+static const char* labelled(char* labels, const char* key, const char* value) {
+  snprintf(labels, LABELS_LENGTH, "%s,%s=\"%s\"", deviceLabel, key, value);
+  return labels;
+}
+
+// Seconds without trailing zeros ("0.00005", "1"), as the backend writes
+// le, so both sources produce the same series
+static void formatBound(char* out, size_t size, uint32_t micros) {
+  snprintf(out, size, "%lu.%06lu", (unsigned long)(micros / 1000000), (unsigned long)(micros % 1000000));
+  char* end = out + strlen(out) - 1;
+  while (*end == '0') {
+    *end-- = 0;
+  }
+  if (*end == '.') {
+    *end = 0;
+  }
+}
+
+// Device buckets are per-bucket counts; Prometheus wants cumulative ones
+static void histogram(TextBuffer& text, const char* name, const char* labels, const LatencyHistogram& latency) {
+  uint32_t cumulative = 0;
+  char bound[16];
+  for (int i = 0; i < METRICS_BUCKET_COUNT - 1; i++) {
+    cumulative += latency.bucketCount(i);
+    formatBound(bound, sizeof(bound), metricsBucketBounds[i]);
+    append(text, "%s_bucket{%s,le=\"%s\"} %lu\n", name, labels, bound, (unsigned long)cumulative);
+  }
+  append(text, "%s_bucket{%s,le=\"+Inf\"} %lu\n", name, labels, (unsigned long)latency.samples());
+  append(text, "%s_sum{%s} %.6f\n", name, labels, latency.sumMicros() / 1e6);
+  append(text, "%s_count{%s} %lu\n", name, labels, (unsigned long)latency.samples());
+}
+
+// Metrics, a few families per piece so each fits HTTP_STREAM_BUFFER_SIZE.
+// Names and help match the backend's exposition of the MQTT metrics
+// report (metricsService.js)
+static void metricsSystem(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largestBlock = ESP.getMaxAllocHeap();
+
+  family(text, "planetplant_device_uptime_seconds", "gauge", "Device uptime");
+  sample(text, "planetplant_device_uptime_seconds", deviceLabel, millis() / 1000.0);
+  family(text, "planetplant_device_heap_free_bytes", "gauge", "Free heap");
+  sample(text, "planetplant_device_heap_free_bytes", deviceLabel, freeHeap);
+  family(text, "planetplant_device_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+  sample(text, "planetplant_device_heap_min_free_bytes", deviceLabel, ESP.getMinFreeHeap());
+  family(text, "planetplant_device_heap_largest_block_bytes", "gauge", "Largest allocatable heap block");
+  sample(text, "planetplant_device_heap_largest_block_bytes", deviceLabel, largestBlock);
+  family(text, "planetplant_device_heap_fragmentation_ratio", "gauge", "1 - largest block / free heap");
+  sample(text, "planetplant_device_heap_fragmentation_ratio", deviceLabel,
+         freeHeap > 0 ? 1.0 - (double)largestBlock / freeHeap : 0);
+
+  family(text, "planetplant_device_stack_free_bytes", "gauge", "Task stack high-water mark (unused bytes)");
+  sample(text, "planetplant_device_stack_free_bytes", labelled(labels, "task", "network"),
+         uxTaskGetStackHighWaterMark(networkTaskHandle));
+  sample(text, "planetplant_device_stack_free_bytes", labelled(labels, "task", "sensing"),
+         uxTaskGetStackHighWaterMark(sensingTaskHandle));
+
+  family(text, "planetplant_device_scheduler_jitter_max_seconds", "gauge", "Worst scheduler lateness since boot");
+  sample(text, "planetplant_device_scheduler_jitter_max_seconds", labelled(labels, "task", "network"),
+         stats.networkJitterMs / 1000.0);
+  sample(text, "planetplant_device_scheduler_jitter_max_seconds", labelled(labels, "task", "sensing"),
+         stats.metrics.sensingJitterMs / 1000.0);
+}
+
+static void metricsMqtt(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  family(text, "planetplant_device_mqtt_connected", "gauge", "1 while the MQTT session is up");
+  sample(text, "planetplant_device_mqtt_connected", deviceLabel, stats.mqttConnected ? 1 : 0);
+  family(text, "planetplant_device_mqtt_publish_total", "counter", "MQTT publishes by result");
+  sample(text, "planetplant_device_mqtt_publish_total", labelled(labels, "result", "ok"),
+         stats.metrics.publishOk);
+  sample(text, "planetplant_device_mqtt_publish_total", labelled(labels, "result", "failed"),
+         stats.metrics.publishFailed);
+  family(text, "planetplant_device_mqtt_inflight", "gauge", "QoS 1 publishes awaiting PUBACK");
+  sample(text, "planetplant_device_mqtt_inflight", deviceLabel, stats.mqttInFlight);
+  family(text, "planetplant_device_mqtt_outbox_bytes", "gauge", "Bytes queued in the MQTT outbox");
+  sample(text, "planetplant_device_mqtt_outbox_bytes", deviceLabel, stats.mqttQueuedBytes);
+  family(text, "planetplant_device_mqtt_outbox_refused_total", "counter", "Publishes refused with a full outbox");
+  sample(text, "planetplant_device_mqtt_outbox_refused_total", deviceLabel, stats.mqttRefused);
+}
+
+static void metricsMqttConnect(const NetworkStats& stats, TextBuffer& text) {
+  family(text, "planetplant_device_mqtt_connect_attempts_total", "counter", "MQTT connect attempts");
+  sample(text, "planetplant_device_mqtt_connect_attempts_total", deviceLabel, stats.mqttAttempts);
+  family(text, "planetplant_device_mqtt_connect_failures_total", "counter", "Failed MQTT connect attempts");
+  sample(text, "planetplant_device_mqtt_connect_failures_total", deviceLabel, stats.mqttFailures);
+  family(text, "planetplant_device_mqtt_connects_total", "counter", "Successful MQTT connects");
+  sample(text, "planetplant_device_mqtt_connects_total", deviceLabel, stats.mqttConnects);
+  family(text, "planetplant_device_mqtt_connect_duration_seconds", "gauge", "Duration of the last MQTT connect");
+  sample(text, "planetplant_device_mqtt_connect_duration_seconds", deviceLabel, stats.mqttConnectMs / 1000.0);
+  family(text, "planetplant_device_mqtt_downtime_seconds", "gauge", "Length of the last MQTT outage");
+  sample(text, "planetplant_device_mqtt_downtime_seconds", deviceLabel, stats.mqttDowntimeMs / 1000.0);
+}
+
+static void metricsSensors(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  family(text, "planetplant_device_dht_errors_total", "counter", "DHT22 failed reads by cause");
+  sample(text, "planetplant_device_dht_errors_total", labelled(labels, "cause", "checksum"),
+         stats.metrics.dhtChecksumErrors);
+  sample(text, "planetplant_device_dht_errors_total", labelled(labels, "cause", "timeout"),
+         stats.metrics.dhtTimeouts);
+  family(text, "planetplant_device_offline_samples", "gauge", "Samples waiting in the offline store");
+  sample(text, "planetplant_device_offline_samples", deviceLabel, stats.samplesPending);
+  family(text, "planetplant_device_offline_dropped_total", "counter", "Samples dropped with the offline store full");
+  sample(text, "planetplant_device_offline_dropped_total", deviceLabel, stats.samplesDropped);
+
+  // Newest sample the network task handled, published or not
+  StoredSample newest;
+  uint32_t written = sampleHistory.written();
+  if (written == 0 || !sampleHistory.read(written - 1, newest)) {
+    return;
+  }
+  family(text, "planetplant_device_temperature_celsius", "gauge", "Latest temperature");
+  sample(text, "planetplant_device_temperature_celsius", deviceLabel, newest.temperature / 100.0);
+  family(text, "planetplant_device_humidity_percent", "gauge", "Latest relative humidity");
+  sample(text, "planetplant_device_humidity_percent", deviceLabel, newest.humidity / 100.0);
+  family(text, "planetplant_device_moisture_percent", "gauge", "Latest soil moisture");
+  sample(text, "planetplant_device_moisture_percent", deviceLabel, newest.moisture);
+  family(text, "planetplant_device_light_percent", "gauge", "Latest light level");
+  sample(text, "planetplant_device_light_percent", deviceLabel, newest.light);
+  family(text, "planetplant_device_pump_active", "gauge", "Pump state in the latest sample");
+  sample(text, "planetplant_device_pump_active", deviceLabel, (newest.flags & SAMPLE_FLAG_PUMP_ACTIVE) ? 1 : 0);
+}
+
+static void metricsLoopNetwork(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  family(text, "planetplant_device_loop_duration_seconds", "histogram", "Work per task loop iteration");
+  histogram(text, "planetplant_device_loop_duration_seconds", labelled(labels, "task", "network"),
+            stats.metrics.networkLoop);
+}
+
+static void metricsLoopSensing(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  histogram(text, "planetplant_device_loop_duration_seconds", labelled(labels, "task", "sensing"),
+            stats.metrics.sensingLoop);
+}
+
+static void metricsPublish(const NetworkStats& stats, TextBuffer& text) {
+  family(text, "planetplant_device_mqtt_publish_duration_seconds", "histogram", "QoS 1 publish to PUBACK");
+  histogram(text, "planetplant_device_mqtt_publish_duration_seconds", deviceLabel, stats.metrics.publish);
+}
+
+static void metricsDht(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  family(text, "planetplant_device_sensor_read_duration_seconds", "histogram", "Sensor read duration");
+  histogram(text, "planetplant_device_sensor_read_duration_seconds", labelled(labels, "sensor", "dht"),
+            stats.metrics.dhtRead);
+}
+
+static void metricsAdc(const NetworkStats& stats, TextBuffer& text) {
+  char labels[LABELS_LENGTH];
+  histogram(text, "planetplant_device_sensor_read_duration_seconds", labelled(labels, "sensor", "adc"),
+            stats.metrics.adcPoll);
+}
+
+static void metricsTlsFull(const NetworkStats& stats, TextBuffer& text) {
+  if (!MQTT_TLS_ENABLED) {
+    return;
+  }
+  char labels[LABELS_LENGTH];
+  family(text, "planetplant_device_tls_handshake_duration_seconds", "histogram", "MQTT TLS handshake duration");
+  histogram(text, "planetplant_device_tls_handshake_duration_seconds", labelled(labels, "mode", "full"),
+            stats.metrics.tlsFullHandshake);
+}
+
+static void metricsTlsResumed(const NetworkStats& stats, TextBuffer& text) {
+  if (!MQTT_TLS_ENABLED) {
+    return;
+  }
+  char labels[LABELS_LENGTH];
+  histogram(text, "planetplant_device_tls_handshake_duration_seconds", labelled(labels, "mode", "resumed"),
+            stats.metrics.tlsResumedHandshake);
+  family(text, "planetplant_device_tls_session_save_failures_total", "counter",
+         "TLS sessions too large for RTC memory");
+  sample(text, "planetplant_device_tls_session_save_failures_total", deviceLabel,
+         stats.metrics.tlsSessionSaveFailures);
+}
+
+typedef void (*MetricsSection)(const NetworkStats& stats, TextBuffer& text);
+
+static const MetricsSection metricsSections[] = {
+  metricsSystem, metricsMqtt, metricsMqttConnect, metricsSensors, metricsLoopNetwork, metricsLoopSensing,
+  metricsPublish, metricsDht, metricsAdc, metricsTlsFull, metricsTlsResumed
+};
+
+static bool renderMetrics(ResponseStream& stream, TextBuffer& text) {
+  if (stream.cursor >= sizeof(metricsSections) / sizeof(metricsSections[0])) {
+    return false;
+  }
+  // Figures of other tasks come from the network task's snapshot only
+  metricsSections[stream.cursor++](networkStats(), text);
+  return true;
+}
+
+static bool renderSamples(ResponseStream& stream, TextBuffer& text) {
+  StoredSample record;
+  while (stream.cursor < stream.end) {
+    // Records overwritten since the request started are skipped
+    if (!sampleHistory.read(stream.cursor++, record)) {
+      continue;
+    }
+    if (stream.binary) {
+      memcpy(text.data, &record, sizeof(record));
+      text.length = sizeof(record);
+      return true;
+    }
+    uint64_t epochMs = sampleEpochMs(record);
+    append(text, "%llu,%u,%u,%.2f,%.2f,%u,%u,%u\n",
+           (unsigned long long)(epochMs != 0 ? epochMs : record.timestamp), epochMs != 0 ? 1 : 0,
+           epochMs != 0 ? 0 : record.bootId, record.temperature / 100.0, record.humidity / 100.0,
+           record.moisture, record.light, (record.flags & SAMPLE_FLAG_PUMP_ACTIVE) ? 1 : 0);
+    return true;
+  }
+  return false;
+}
+
+static bool renderConfig(ResponseStream& stream, TextBuffer& text) {
+  if (stream.cursor++ > 0) {
+    return false;
+  }
+  configDoc.clear();
+  configDoc["device_id"] = deviceId;
+  uint32_t revision;
+  RuntimeSettings settings = settingsSnapshot(revision);
+  configDoc["revision"] = revision;
+  settingsToJson(settings, configDoc.createNestedObject("settings"));
+  text.length = serializeJson(configDoc, text.data, text.capacity);
+  return true;
+}
+
+// Copies out the current piece, rendering the next one when it is used up
+static size_t fillChunk(ResponseStream& stream, uint8_t* buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (stream.sent == stream.length) {
+      TextBuffer text = { stream.text, sizeof(stream.text), 0 };
+      stream.sent = 0;
+      stream.length = 0;
+      if (stream.header != nullptr) {
+        append(text, "%s", stream.header);
+        stream.header = nullptr;
+      } else if (!stream.render(stream, text)) {
+        break;
+      }
+      stream.length = text.length;
+      continue;
+    }
+    size_t length = min<size_t>(maxLen - written, stream.length - stream.sent);
+    memcpy(buffer + written, stream.text + stream.sent, length);
+    written += length;
+    stream.sent += length;
+  }
+  return written;
+}
+
+static void sendStream(AsyncWebServerRequest* request, const char* contentType, const char* header,
+                       StreamRenderer render, uint32_t cursor, uint32_t end, bool binary) {
+  ResponseStream* stream = nullptr;
+  for (int i = 0; i < HTTP_MAX_STREAMS; i++) {
+    if (!streams[i].busy) {
+      stream = &streams[i];
+      break;
+    }
+  }
+  if (stream == nullptr) {
+    request->send(503);
+    return;
+  }
+
+  stream->busy = true;
+  stream->render = render;
+  stream->header = header;
+  stream->cursor = cursor;
+  stream->end = end;
+  stream->binary = binary;
+  stream->length = 0;
+  stream->sent = 0;
+
+  // Capturing the slot pointer only keeps the callbacks in std::function's
+  // inline storage
+  AsyncWebServerResponse* response = request->beginChunkedResponse(contentType,
+    [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      return fillChunk(*stream, buffer, maxLen);
+    });
+  request->onDisconnect([stream]() {
+    stream->busy = false;
+  });
+  request->send(response);
+}
+
+static void handleMetrics(AsyncWebServerRequest* request) {
+  sendStream(request, PROMETHEUS_CONTENT_TYPE, nullptr, renderMetrics, 0, 0, false);
+}
+
+static void handleSamples(AsyncWebServerRequest* request) {
+  const AsyncWebParameter* format = request->getParam("format");
+  const AsyncWebParameter* count = request->getParam("count");
+  bool binary = format != nullptr && strcmp(format->value().c_str(), "binary") == 0;
+
+  uint32_t end = sampleHistory.written();
+  uint32_t first = sampleHistory.oldest();
+  if (count != nullptr) {
+    uint32_t newest = strtoul(count->value().c_str(), nullptr, 10);
+    first = max(first, end - min(newest, end));
+  }
+
+  if (binary) {
+    sendStream(request, "application/octet-stream", nullptr, renderSamples, first, end, true);
+    return;
+  }
+  sendStream(request, "text/csv", SAMPLE_CSV_HEADER, renderSamples, first, end, false);
+}
+
+static void handleConfig(AsyncWebServerRequest* request) {
+  sendStream(request, "application/json", nullptr, renderConfig, 0, 0, false);
+}
+
+void startHttpServer() {
+  snprintf(deviceLabel, sizeof(deviceLabel), "device=\"%s\"", deviceId);
+
+  httpServer.on("/metrics", HTTP_GET, handleMetrics);
+  httpServer.on("/samples", HTTP_GET, handleSamples);
+  httpServer.on("/config", HTTP_GET, handleConfig);
+  httpServer.onNotFound([](AsyncWebServerRequest* request) {
+    request->send(404);
+  });
+  httpServer.begin();
+
+  Serial.printf("🌐 HTTP endpoint on port %d: /metrics /samples /config\n", WEB_SERVER_PORT);
+}
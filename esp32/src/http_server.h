@@ -0,0 +1,27 @@
+/**
+ * PlanetPlant ESP32 Local HTTP Endpoint
+ * ESP Async WebServer on WEB_SERVER_PORT, for LAN collectors and debugging
+ * without the broker or a serial console:
+ *
+ *   GET /metrics   Prometheus text exposition, the same families the
+ *                  backend exposes for this device
+ *   GET /samples   Recent samples (sample_history.h), oldest first, as CSV
+ *                  or ?format=binary StoredSample records; ?count=N for
+ *                  the newest N
+ *   GET /config    Active runtime settings and revision (read-only;
+ *                  updates stay on cmd/config)
+ *
+ * Requests are served on the AsyncTCP task, which reads other tasks' state
+ * only through networkStats(), settingsSnapshot() and sampleHistory. Every
+ * response is chunked from one of HTTP_MAX_STREAMS static slots and
+ * rendered a piece at a time, so handlers allocate nothing themselves; a
+ * request finding all slots busy gets 503.
+ */
+
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+// Call once from startNetworkTask(), after deviceId is known.
+void startHttpServer();
+
+#endif // HTTP_SERVER_H
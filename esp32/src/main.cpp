@@ -4,399 +4,936 @@
  * 
  * Hardware:
  * - ESP32 DevKit v1
- * - Capacitive soil moisture sensor
+ * - Capacitive soil moisture sensor and pump relay per zone (zones.h)
  * - DHT22 temperature/humidity sensor
- * - Water pump with relay
  * - Optional: Light sensor (LDR)
+ *
+ * Tasks:
+ * - network (core 0): WiFi, MQTT, publishing - see network.cpp
+ * - sensing (core 1): sensors, pump, LED, button - this file
  */
 
-#include <WiFi.h>
-#include <PubSubClient.h>
-#include <DHT.h>
-#include <ArduinoJson.h>
-#include <WiFiManager.h>
+#include <Arduino.h>
 #include "config.h"
+#include "pins.h"
+#include "messages.h"
+#include "scheduler.h"
+#include "network.h"
+#include "power.h"
+#include "adc_sampler.h"
+#include "dht_rmt.h"
+#include "report_filter.h"
+#include "watering_controller.h"
+#include "runtime_settings.h"
+#include "metrics.h"
+#include "zones.h"
+#include "ota_update.h"
+#include "watchdog.h"
+#include "button.h"
+#include "sample_rate.h"
+#include "calibration.h"
+#include "payloads.h"
+#include "trace.h"
 
-// Pin Definitions
-#define DHT_PIN 4
-#define MOISTURE_PIN A0
-#define PUMP_RELAY_PIN 5
-#define LIGHT_SENSOR_PIN A3
-#define LED_PIN 2
-#define BUTTON_PIN 0
+#if BATTERY_SENSE_ENABLED && ZONE_COUNT > 4
+#error "BATTERY_SENSE_PIN is zone 4's moisture input; battery-powered boards take up to 4 zones"
+#endif
 
 // Sensor Configuration
-#define DHT_TYPE DHT22
-#define MOISTURE_SAMPLES 10
-#define SENSOR_READ_INTERVAL 60000  // 1 minute
-#define HEARTBEAT_INTERVAL 300000   // 5 minutes
-
-// WiFi and MQTT
-WiFiClient espClient;
-PubSubClient client(espClient);
-DHT dht(DHT_PIN, DHT_TYPE);
-
-// Device Configuration
-String deviceId = "esp32_" + String((uint32_t)ESP.getEfuseMac(), HEX);
-String mqttClientId = "plantplant_" + deviceId;
-
-// Timing variables
-unsigned long lastSensorReading = 0;
-unsigned long lastHeartbeat = 0;
-unsigned long pumpStartTime = 0;
-bool pumpActive = false;
-
-// Sensor data structure
-struct SensorData {
-  float temperature;
-  float humidity;
-  int moisture;
-  int lightLevel;
-  bool isValid;
+#define DHT_MAX_AGE 30000           // Oldest cached reading a sample may use (ms)
+#define DHT_DEFER_INTERVAL 100      // Sample retry while a DHT read is pending (ms)
+#if CONFIG_IDF_TARGET_ESP32C3
+#define DHT_RMT_CHANNEL RMT_CHANNEL_2  // RX-capable channels are 2-3 on the C3
+#else
+#define DHT_RMT_CHANNEL RMT_CHANNEL_0
+#endif
+
+DhtRmt dht;
+ButtonInput button;
+
+// Sensing task's copy of the runtime settings, refreshed on
+// COMMAND_SETTINGS_CHANGED
+RuntimeSettings settings;
+
+// Survives deep sleep so dead-bands and aggregate windows span wakes
+RTC_DATA_ATTR ReportFilter reportFilter;
+
+// Survives deep sleep so each zone's watering cooldown spans wakes
+RTC_DATA_ATTR WateringController watering[ZONE_COUNT];
+
+// Survives deep sleep so trends and flat stretches span wakes
+RTC_DATA_ATTR SampleRateController sampleRate;
+
+// Scheduler and task handles
+Scheduler scheduler;
+int sensorTaskId = SCHEDULER_INVALID_TASK;
+int adcTaskId = SCHEDULER_INVALID_TASK;
+int dhtTaskId = SCHEDULER_INVALID_TASK;
+int dhtServiceTaskId = SCHEDULER_INVALID_TASK;
+int pumpTaskId = SCHEDULER_INVALID_TASK;
+int ledTaskId = SCHEDULER_INVALID_TASK;
+int buttonTaskId = SCHEDULER_INVALID_TASK;
+int sleepBackstopTaskId = SCHEDULER_INVALID_TASK;
+int calibrationTaskId = SCHEDULER_INVALID_TASK;
+
+// Per-zone pump state; at most PUMP_MAX_CONCURRENT relays are closed
+struct ZonePump {
+  bool relayOn;
+  uint32_t startedAt;       // millis() when the relay closed
+  uint32_t duration;        // Manual run length (ms), 0 during local cycles
+  uint32_t pendingDuration; // Manual run waiting for a pump slot
 };
 
+ZonePump pumps[ZONE_COUNT] = {};
+uint8_t pumpsRunning = 0;
+uint8_t nextZone = 0;       // Round-robin start for handing out pump slots
+
+// LED pattern state
+int ledTogglesLeft = 0;
+int ledToggleInterval = 0;
+bool ledState = false;
+
+// DHT read timing (micros() at the start pulse)
+uint32_t dhtReadStartedAt = 0;
+
+// Next sample publishes whatever the report filter says (double press)
+bool forceReport = false;
+
+// Button calibration of zone 0: the dry capture is running, or it was
+// stored and the next short press in the session captures the wet point
+// instead of watering
+bool buttonDryPending = false;
+bool buttonWetPending = false;
+
+void setupTasks();
+void applySettings();
+uint32_t normalInterval();
+uint32_t sampleInterval();
+void adaptSampleRate(const SensorData& data);
+int readBatteryMillivolts();
+void sensingTask(void* parameter);
+void handleCommand(const Command& command);
+SensorData readSensors();
+int readZoneMoisture(uint8_t zone);
+void setRelay(uint8_t zone, bool on);
+void updatePumpState();
+bool pumpSlotFree();
+bool zoneBusy(uint8_t zone);
+bool anyZoneBusy();
+void startPump(uint8_t zone, int duration);
+void runPump(uint8_t zone, uint32_t duration);
+void stopPump(uint8_t zone);
+void stopAllPumps();
+void startPendingPumps();
+void schedulePumpTask();
+void startWatering(uint8_t zone, int moisture, uint32_t clock);
+void finishWatering(uint8_t zone);
+void manualWatering();
+void forcePublish();
+void openConfigPortal();
+void startCalibration(uint8_t channel, int target);
+void buttonCalibration();
+int readChannelMillivolts(uint8_t channel);
+void blinkLED(int times, int delayMs);
+void sensorTask();
+void adcTask();
+void dhtTask();
+void dhtServiceTask();
+void pumpTask();
+void ledTask();
+void buttonTask();
+void sleepBackstopTask();
+void calibrationTask();
+void resetSensorBus();
+
 void setup() {
+  traceBegin(TRACE_SETUP);
   Serial.begin(115200);
   Serial.println("🌱 PlanetPlant ESP32 Controller Starting...");
   
   // Initialize pins
-  pinMode(PUMP_RELAY_PIN, OUTPUT);
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    pinMode(zones[zone].relayPin, OUTPUT);
+  }
   pinMode(LED_PIN, OUTPUT);
-  pinMode(BUTTON_PIN, INPUT_PULLUP);
-  digitalWrite(PUMP_RELAY_PIN, LOW);
   
-  // Initialize sensors
-  dht.begin();
+  // Relay off, sleep holds released, RTC state validated
+  powerBegin();
+  
+  // Reset reason and crash counters, task watchdog armed
+  watchdogBegin();
+  
+  // A crash-looping trial image is rolled back before it gets further
+  otaBegin();
+  
+  // Stored runtime settings (or the config.h defaults)
+  traceBegin(TRACE_SETUP_STORAGE);
+  settingsBegin();
+  settings = settingsSnapshot();
+  
+  // Stored sensor curves (or the factory ones), expanded to lookup tables
+  calibration.begin();
+  traceEnd(TRACE_SETUP_STORAGE);
+  
+  // Initialize sensors; one ADC sweep covers every zone probe and the
+  // light sensor (and the battery divider) from here on
+  traceBegin(TRACE_SETUP_SENSORS);
+  dht.begin(DHT_PIN, DHT_RMT_CHANNEL);
+  uint8_t analogPins[ZONE_COUNT + 2];
+  uint8_t analogCount = 0;
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    analogPins[analogCount++] = zones[zone].moisturePin;
+  }
+  analogPins[analogCount++] = LIGHT_SENSOR_PIN;
+  if (BATTERY_SENSE_ENABLED) {
+    analogPins[analogCount++] = BATTERY_SENSE_PIN;
+  }
+  adcSampler.begin(analogPins, analogCount);
+  
+  // Edges wake the sensing task once it runs; gestures are decoded there
+  button.begin(BUTTON_PIN, &sensingTaskHandle);
+  traceEnd(TRACE_SETUP_SENSORS);
   
   // Initialize WiFi with WiFiManager
+  traceBegin(TRACE_WIFI_CONNECT);
   setupWiFi();
+  traceEnd(TRACE_WIFI_CONNECT);
   
   // Initialize MQTT
   setupMQTT();
   
+  // A reset interrupted watering; tell the backend the pumps are off
+  if (dutyState.pumpActive) {
+    powerSetPumpActive(false);
+    for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+      NetEvent event = {};
+      event.type = EVENT_PUMP_STOPPED;
+      event.timestamp = millis();
+      event.zone = zone;
+      postEvent(event);
+    }
+  }
+  
+  // Register periodic work with the scheduler
+  setupTasks();
+  
+  powerMarkTasksStarted();
+  
+  // Start the pinned tasks; the sensing task never blocks on the network
+  if (xTaskCreatePinnedToCore(sensingTask, "sensing", SENSING_TASK_STACK, nullptr,
+                              SENSING_TASK_PRIORITY, &sensingTaskHandle, SENSING_TASK_CORE) != pdPASS) {
+    Serial.println("❌ Failed to start the sensing task, restarting...");
+    ESP.restart();
+  }
+  startNetworkTask();
+  
   Serial.println("✅ ESP32 Controller initialized successfully!");
-  Serial.printf("📱 Device ID: %s\n", deviceId.c_str());
+  Serial.printf("📱 Device ID: %s\n", deviceId);
+  if (DEEP_SLEEP_ENABLED) {
+    Serial.printf("🔋 Duty cycle wake #%lu (%s)\n", (unsigned long)dutyState.wakeCount, wakeCauseName());
+  }
+  traceEnd(TRACE_SETUP);
 }
 
 void loop() {
-  // Maintain MQTT connection
-  if (!client.connected()) {
-    reconnectMQTT();
+  // All work happens in the pinned tasks; retire the Arduino loop task
+  vTaskDelete(nullptr);
+}
+
+void setupTasks() {
+  unsigned long now = millis();
+  
+  // A duty-cycle wake samples as soon as the ADC window is full
+  uint32_t firstSample = DEEP_SLEEP_ENABLED ? ADC_SETTLE_TIME : sampleInterval();
+  
+  sensorTaskId = scheduler.add(sensorTask, sampleInterval(), firstSample, now);
+  adcTaskId = scheduler.add(adcTask, ADC_POLL_INTERVAL, 0, now);
+  
+  // The DHT22 needs ~2 s after power-up; it stays powered through sleep
+  uint32_t firstDhtRead = DEEP_SLEEP_ENABLED ? 0 : DHT_RETRY_DELAY;
+  dhtTaskId = scheduler.add(dhtTask, DHT_READ_INTERVAL, firstDhtRead, now);
+  
+  // One-shot tasks, armed on demand with scheduler.runIn()
+  dhtServiceTaskId = scheduler.add(dhtServiceTask, 0, 0, now);
+  pumpTaskId = scheduler.add(pumpTask, 0, 0, now);
+  ledTaskId = scheduler.add(ledTask, 0, 0, now);
+  buttonTaskId = scheduler.add(buttonTask, 0, 0, now);
+  calibrationTaskId = scheduler.add(calibrationTask, 0, 0, now);
+  
+  if (DEEP_SLEEP_ENABLED) {
+    // The network task normally ends the wake; this catches it wedged
+    sleepBackstopTaskId = scheduler.add(sleepBackstopTask, 0, 0, now);
+    scheduler.runIn(sleepBackstopTaskId, AWAKE_BUDGET + WATERING_MAX_DURATION, now);
+    
+    // Button wake means the user asked for water
+    if (wakeCause() == WAKE_CAUSE_BUTTON) {
+      manualWatering();
+    }
   }
-  client.loop();
-  
-  // Handle pump timeout
-  if (pumpActive && (millis() - pumpStartTime > WATERING_DURATION)) {
-    stopPump();
+}
+
+uint32_t normalInterval() {
+  // Batching trades per-sample publishes for a faster sampling cadence
+  if (BATCHING_ACTIVE) {
+    return BATCH_SAMPLE_INTERVAL;
   }
+  // An adaptive duty cycle samples once per wake, so it adapts the sleep
+  return DEEP_SLEEP_ENABLED && settings.adaptiveSampling ? SLEEP_DURATION * 1000UL : settings.sensorInterval;
+}
+
+uint32_t sampleInterval() {
+  return settings.adaptiveSampling ? sampleRate.interval(normalInterval(), settings) : normalInterval();
+}
+
+void applySettings() {
+  uint32_t previousInterval = sampleInterval();
+  settings = settingsSnapshot();
   
-  // Read sensors periodically
-  if (millis() - lastSensorReading > SENSOR_READ_INTERVAL) {
-    SensorData data = readSensors();
-    if (data.isValid) {
-      publishSensorData(data);
-    }
-    lastSensorReading = millis();
+  if (!settings.adaptiveSampling) {
+    sampleRate.reset();
+    powerSetSleepInterval(SLEEP_DURATION * 1000UL);
   }
   
-  // Send heartbeat
-  if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL) {
-    publishHeartbeat();
-    lastHeartbeat = millis();
+  // New thresholds take effect on the next sample; only a changed
+  // interval touches the schedule
+  if (sampleInterval() != previousInterval) {
+    scheduler.setPeriod(sensorTaskId, sampleInterval(), millis());
   }
+  Serial.printf("⚙️  Settings revision %lu applied\n", (unsigned long)settingsRevision());
+}
+
+void sensingTask(void* parameter) {
+  watchdogRegister(WATCHDOG_TASK_SENSING);
   
-  // Handle manual button press
-  if (digitalRead(BUTTON_PIN) == LOW) {
-    delay(50); // Debounce
-    if (digitalRead(BUTTON_PIN) == LOW) {
-      manualWatering();
-      while (digitalRead(BUTTON_PIN) == LOW) delay(10);
+  for (;;) {
+    watchdogFeed(WATCHDOG_TASK_SENSING);
+    
+    // Apply commands forwarded by the network task
+    uint32_t started = micros();
+    
+    Command command;
+    while (commandQueue.pop(command)) {
+      handleCommand(command);
+    }
+    
+    // Button edges from the ISR restart the debounce timer
+    if (button.pending()) {
+      scheduler.runIn(buttonTaskId, 0, millis());
     }
+    
+    // Run due tasks (sampling, LED, button, pump cutoff)
+    scheduler.run(millis());
+    
+    metrics.sensingLoop.record(micros() - started);
+    metrics.sensingJitterMs = scheduler.maxJitter();
+    
+    // Sleep until the next deadline or until postCommand() or a button
+    // edge wakes us
+    uint32_t waitMs = scheduler.timeUntilNext(millis(), SENSING_LOOP_INTERVAL);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
   }
-  
-  delay(100);
 }
 
-void setupWiFi() {
-  WiFiManager wm;
-  
-  // LED indicates WiFi setup mode
-  digitalWrite(LED_PIN, HIGH);
-  
-  // Reset settings for testing (comment out for production)
-  // wm.resetSettings();
+void handleCommand(const Command& command) {
+  switch (command.type) {
+    case COMMAND_WATER_START:
+      startPump(command.zone, command.value);
+      break;
+    case COMMAND_WATER_STOP:
+      stopPump(command.zone);
+      break;
+    case COMMAND_BLINK:
+      // Keep the LED steady while a pump is running
+      if (pumpsRunning == 0) {
+        blinkLED(command.value, command.interval);
+      }
+      break;
+    case COMMAND_SETTINGS_CHANGED:
+      applySettings();
+      break;
+    case COMMAND_CALIBRATE:
+      startCalibration(command.zone, command.value);
+      break;
+  }
+}
+
+void sensorTask() {
+  // Wait for a read in flight (or its retry) rather than drop the sample
+  DhtReading reading;
+  if (!dht.latest(reading, millis(), DHT_MAX_AGE) && dht.busy()) {
+    scheduler.runIn(sensorTaskId, DHT_DEFER_INTERVAL, millis());
+    return;
+  }
   
-  Serial.println("🔌 Setting up WiFi connection...");
+  traceBegin(TRACE_SENSOR_CYCLE);
+  SensorData data = readSensors();
+  if (!data.isValid) {
+    if (watchdogFault(FAULT_SENSORS) == RECOVERY_RESET_SENSORS) {
+      resetSensorBus();
+    }
+    traceEnd(TRACE_SENSOR_CYCLE);
+    return;
+  }
+  watchdogClear(FAULT_SENSORS);
+  
+  uint32_t clock = powerClock();
+  
+  // Dry soil starts a local cycle; the backend only hears the result.
+  // Not while calibrating: a probe in the air or in a glass reads wrong.
+  bool localWatering = settings.localWatering && !calibration.inSession(millis());
+  for (uint8_t zone = 0; zone < ZONE_COUNT && localWatering; zone++) {
+    int moisture = data.zoneMoisture[zone];
+    if (!zoneBusy(zone) && watering[zone].shouldStart(moisture, clock, settings, zoneCooldown(zone, settings))) {
+      startWatering(zone, moisture, clock);
+      data.zonePumps |= 1 << zone;
+      data.pumpActive = true;
+    }
+  }
   
-  // Set custom parameters
-  wm.setAPName("PlanetPlant-Setup");
-  wm.setAPPassword("plantplant123");
-  wm.setConfigPortalTimeout(300); // 5 minutes timeout
+  if (settings.adaptiveSampling) {
+    adaptSampleRate(data);
+  }
   
-  // Add custom parameters
-  WiFiManagerParameter custom_mqtt_server("server", "MQTT Server", MQTT_SERVER, 40);
-  WiFiManagerParameter custom_device_name("device", "Device Name", "PlanetPlant ESP32", 32);
+  NetEvent event = {};
+  event.timestamp = millis();
   
-  wm.addParameter(&custom_mqtt_server);
-  wm.addParameter(&custom_device_name);
+  if (REPORT_FILTER_ACTIVE && reportFilter.takeAggregates(event.aggregates, clock, settings)) {
+    event.type = EVENT_SENSOR_AGGREGATE;
+    postEvent(event);
+  }
   
-  // Attempt to connect
-  if (!wm.autoConnect()) {
-    Serial.println("❌ Failed to connect to WiFi, restarting...");
-    ESP.restart();
+  // Report by exception: unchanged readings stay on the device
+  bool forced = forceReport;
+  forceReport = false;
+  if (REPORT_FILTER_ACTIVE && !reportFilter.update(data, clock, settings, forced)) {
+    powerSampleHandled();
+    traceEnd(TRACE_SENSOR_CYCLE);
+    return;
   }
   
-  digitalWrite(LED_PIN, LOW);
-  Serial.println("✅ WiFi connected!");
-  Serial.printf("📶 IP Address: %s\n", WiFi.localIP().toString().c_str());
+  event.type = EVENT_SENSOR_DATA;
+  event.data = data;
+  if (!postEvent(event)) {
+    Serial.println("⚠️  Event queue full, sensor sample dropped");
+  }
+  traceEnd(TRACE_SENSOR_CYCLE);
 }
 
-void setupMQTT() {
-  client.setServer(MQTT_SERVER, MQTT_PORT);
-  client.setCallback(mqttCallback);
-  client.setKeepAlive(60);
-  client.setSocketTimeout(30);
+void adaptSampleRate(const SensorData& data) {
+  SampleRateChange change;
+  int batteryMv = readBatteryMillivolts();
+  bool changed = sampleRate.update(data, anyZoneBusy(), batteryMv, powerClock(), normalInterval(), settings, change);
+  
+  // A duty cycle sleeps by the rate of its last sample; a wake never ends
+  // while watering
+  if (DEEP_SLEEP_ENABLED && sampleRate.mode() != SAMPLE_MODE_WATERING) {
+    powerSetSleepInterval(sampleRate.interval(normalInterval(), settings));
+  }
+  if (!changed) {
+    return;
+  }
+  
+  Serial.printf("⏱️  Sampling every %lu ms (%s)\n", (unsigned long)change.intervalMs, sampleModeName(change.mode));
+  scheduler.setPeriod(sensorTaskId, change.intervalMs, millis());
   
-  Serial.printf("🔗 MQTT Server: %s:%d\n", MQTT_SERVER, MQTT_PORT);
+  // Lets the backend tell sparse samples from missing ones
+  NetEvent event = {};
+  event.type = EVENT_SAMPLE_RATE;
+  event.timestamp = millis();
+  event.sampleRate = change;
+  postEvent(event);
 }
 
-void reconnectMQTT() {
-  int retryCount = 0;
-  while (!client.connected() && retryCount < 5) {
-    Serial.printf("🔄 Attempting MQTT connection (attempt %d)...\n", retryCount + 1);
-    
-    if (client.connect(mqttClientId.c_str(), MQTT_USER, MQTT_PASS)) {
-      Serial.println("✅ MQTT connected!");
-      
-      // Subscribe to command topics
-      String waterTopic = "commands/" + deviceId + "/water";
-      String configTopic = "commands/" + deviceId + "/config";
-      
-      client.subscribe(waterTopic.c_str());
-      client.subscribe(configTopic.c_str());
-      
-      Serial.printf("📡 Subscribed to: %s\n", waterTopic.c_str());
-      Serial.printf("📡 Subscribed to: %s\n", configTopic.c_str());
-      
-      // Publish online status
-      publishStatus("online");
-      
-    } else {
-      Serial.printf("❌ MQTT connection failed, rc=%d\n", client.state());
-      retryCount++;
-      delay(5000);
-    }
-  }
-  
-  if (!client.connected()) {
-    Serial.println("🔄 MQTT connection failed, continuing without MQTT...");
+int readBatteryMillivolts() {
+  if (!BATTERY_SENSE_ENABLED) {
+    return -1;
   }
+  int millivolts = adcSampler.readMillivolts(BATTERY_SENSE_PIN);
+  return millivolts >= 0 ? (int)(millivolts * BATTERY_DIVIDER_RATIO) : -1;
 }
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String message;
-  for (int i = 0; i < length; i++) {
-    message += (char)payload[i];
+void adcTask() {
+  // Keep the per-channel windows current; never blocks
+  uint32_t started = micros();
+  adcSampler.poll();
+  metrics.adcPoll.record(micros() - started);
+}
+
+void dhtTask() {
+  if (dht.read(millis())) {
+    dhtReadStartedAt = micros();
+    traceBegin(TRACE_DHT_READ);
+    scheduler.runIn(dhtServiceTaskId, DHT_START_PULSE_MS, millis());
   }
-  
-  Serial.printf("📨 Received: %s -> %s\n", topic, message.c_str());
-  
-  String topicStr = String(topic);
-  
-  // Handle watering commands
-  if (topicStr.indexOf("/water") > 0) {
-    DynamicJsonDocument doc(256);
-    deserializeJson(doc, message);
-    
-    if (doc["action"] == "start") {
-      int duration = doc["duration"] | WATERING_DURATION;
-      startPump(duration);
-    } else if (doc["action"] == "stop") {
-      stopPump();
-    }
+}
+
+void dhtServiceTask() {
+  uint32_t next = dht.service(millis());
+  if (next > 0) {
+    scheduler.runIn(dhtServiceTaskId, next, millis());
+    return;
   }
   
-  // Handle configuration updates
-  if (topicStr.indexOf("/config") > 0) {
-    // Handle configuration updates here
-    Serial.println("📝 Configuration update received");
-  }
+  // Read finished, successfully or after its last retry
+  traceEnd(TRACE_DHT_READ);
+  metrics.dhtRead.record(micros() - dhtReadStartedAt);
+  metrics.dhtChecksumErrors = dht.checksumErrors();
+  metrics.dhtTimeouts = dht.timeouts();
+}
+
+void resetSensorBus() {
+  // The read in flight is abandoned; dhtTask starts the next one
+  scheduler.cancel(dhtServiceTaskId);
+  bool dhtOk = dht.reset();
+  bool adcOk = adcSampler.restart();
+  Serial.printf("🔧 Sensor bus reset (DHT %s, ADC %s)\n", dhtOk ? "ok" : "failed",
+                adcOk ? "DMA" : "single reads");
 }
 
 SensorData readSensors() {
-  SensorData data;
+  traceBegin(TRACE_READ_SENSORS);
+  SensorData data = {};
   data.isValid = true;
   
-  // Read DHT22 sensor
-  data.temperature = dht.readTemperature();
-  data.humidity = dht.readHumidity();
-  
-  // Validate DHT readings
-  if (isnan(data.temperature) || isnan(data.humidity)) {
-    Serial.println("❌ Failed to read DHT sensor!");
+  // Latest DHT22 reading captured by the RMT driver; a single failed
+  // read keeps the previous value until it gets too old
+  DhtReading reading;
+  if (dht.latest(reading, millis(), DHT_MAX_AGE)) {
+    data.temperature = reading.temperature;
+    data.humidity = reading.humidity;
+  } else {
+    Serial.println("❌ No recent DHT reading!");
+    data.temperature = NAN;
+    data.humidity = NAN;
     data.isValid = false;
   }
   
-  // Read moisture sensor (average of multiple readings)
-  long moistureSum = 0;
-  for (int i = 0; i < MOISTURE_SAMPLES; i++) {
-    moistureSum += analogRead(MOISTURE_PIN);
-    delay(10);
+  // Trimmed means of the latest DMA windows, in calibrated mV; every
+  // zone comes from the same sweep
+  traceBegin(TRACE_ADC_AVERAGE);
+  int lightMv = adcSampler.readMillivolts(LIGHT_SENSOR_PIN);
+  bool haveAdc = lightMv >= 0;
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    int moisture = readZoneMoisture(zone);
+    haveAdc = haveAdc && moisture >= 0;
+    data.zoneMoisture[zone] = moisture;
+    if (zoneBusy(zone)) {
+      data.zonePumps |= 1 << zone;
+    }
+  }
+  traceEnd(TRACE_ADC_AVERAGE);
+  if (!haveAdc) {
+    Serial.println("❌ No ADC samples yet!");
+    data.isValid = false;
   }
-  int rawMoisture = moistureSum / MOISTURE_SAMPLES;
   
-  // Convert to percentage (calibrate these values for your sensor)
-  data.moisture = map(rawMoisture, MOISTURE_DRY, MOISTURE_WET, 0, 100);
-  data.moisture = constrain(data.moisture, 0, 100);
+  data.moisture = data.zoneMoisture[0];
   
   // Read light sensor
-  data.lightLevel = analogRead(LIGHT_SENSOR_PIN);
-  data.lightLevel = map(data.lightLevel, 0, 4095, 0, 100);
+  data.lightLevel = calibration.value(CALIBRATION_CHANNEL_LIGHT, lightMv);
+  
+  data.pumpActive = data.zonePumps != 0;
   
+  traceEnd(TRACE_READ_SENSORS);
   return data;
 }
 
-void publishSensorData(SensorData data) {
-  DynamicJsonDocument doc(512);
-  
-  doc["device_id"] = deviceId;
-  doc["timestamp"] = millis();
-  doc["sensors"]["temperature"] = data.temperature;
-  doc["sensors"]["humidity"] = data.humidity;
-  doc["sensors"]["moisture"] = data.moisture;
-  doc["sensors"]["light"] = data.lightLevel;
-  doc["sensors"]["pump_active"] = pumpActive;
-  doc["status"]["wifi_rssi"] = WiFi.RSSI();
-  doc["status"]["free_heap"] = ESP.getFreeHeap();
-  doc["status"]["uptime"] = millis();
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  String topic = "sensors/" + deviceId + "/data";
-  
-  if (client.connected()) {
-    if (client.publish(topic.c_str(), payload.c_str())) {
-      Serial.printf("📊 Sensor data published: T=%.1f°C, H=%.1f%%, M=%d%%, L=%d%%\n", 
-                   data.temperature, data.humidity, data.moisture, data.lightLevel);
-      blinkLED(1, 100);
-    } else {
-      Serial.println("❌ Failed to publish sensor data");
-    }
-  } else {
-    Serial.println("📡 MQTT not connected, sensor data not published");
-  }
+int readZoneMoisture(uint8_t zone) {
+  return zoneMoisturePercent(zone, adcSampler.readMillivolts(zones[zone].moisturePin));
 }
 
-void publishHeartbeat() {
-  DynamicJsonDocument doc(256);
-  
-  doc["device_id"] = deviceId;
-  doc["timestamp"] = millis();
-  doc["status"] = "online";
-  doc["wifi_rssi"] = WiFi.RSSI();
-  doc["free_heap"] = ESP.getFreeHeap();
-  doc["uptime"] = millis();
-  
-  String payload;
-  serializeJson(doc, payload);
-  
-  String topic = "devices/" + deviceId + "/heartbeat";
+void setRelay(uint8_t zone, bool on) {
+  ZonePump& pump = pumps[zone];
+  if (pump.relayOn == on) {
+    return;
+  }
   
-  if (client.connected()) {
-    client.publish(topic.c_str(), payload.c_str());
-    Serial.println("💓 Heartbeat sent");
+  digitalWrite(zones[zone].relayPin, on ? HIGH : LOW);
+  pump.relayOn = on;
+  if (on) {
+    pump.startedAt = millis();
+    pumpsRunning++;
+  } else {
+    pumpsRunning--;
   }
+  updatePumpState();
 }
 
-void publishStatus(String status) {
-  DynamicJsonDocument doc(256);
-  
-  doc["device_id"] = deviceId;
-  doc["timestamp"] = millis();
-  doc["status"] = status;
-  doc["ip_address"] = WiFi.localIP().toString();
-  doc["wifi_rssi"] = WiFi.RSSI();
+void updatePumpState() {
+  digitalWrite(LED_PIN, pumpsRunning > 0 ? HIGH : LOW);
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  String topic = "sensors/" + deviceId + "/status";
-  
-  if (client.connected()) {
-    client.publish(topic.c_str(), payload.c_str());
-    Serial.printf("📡 Status published: %s\n", status.c_str());
+  // Soak pauses and queued runs count as pumping so a duty-cycle wake
+  // outlasts them
+  powerSetPumpActive(anyZoneBusy());
+}
+
+bool pumpSlotFree() {
+  // The pump supply is sized for PUMP_MAX_CONCURRENT motors
+  return pumpsRunning < PUMP_MAX_CONCURRENT;
+}
+
+bool zoneBusy(uint8_t zone) {
+  return pumps[zone].relayOn || pumps[zone].pendingDuration > 0 || watering[zone].active();
+}
+
+bool anyZoneBusy() {
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    if (zoneBusy(zone)) {
+      return true;
+    }
   }
+  return false;
 }
 
-void startPump(int duration) {
-  if (pumpActive) {
-    Serial.println("⚠️  Pump already active, ignoring command");
+void startPump(uint8_t zone, int duration) {
+  if (zoneBusy(zone)) {
+    Serial.printf("⚠️  Zone %u already watering, ignoring command\n", zone);
     return;
   }
   
-  Serial.printf("💧 Starting pump for %d ms\n", duration);
-  digitalWrite(PUMP_RELAY_PIN, HIGH);
-  digitalWrite(LED_PIN, HIGH);
-  pumpActive = true;
-  pumpStartTime = millis();
+  // Fall back to the default for missing or out-of-range durations
+  if (duration <= 0 || duration > WATERING_MAX_DURATION) {
+    duration = settings.wateringDuration;
+  }
   
-  // Update watering duration if provided
-  if (duration > 0 && duration <= 30000) { // Max 30 seconds
-    // This would normally update a global variable, but we'll use the parameter
+  if (!pumpSlotFree()) {
+    // Runs as soon as another zone's pump stops
+    Serial.printf("💧 Zone %u queued for %d ms, %u pumps running\n", zone, duration, pumpsRunning);
+    pumps[zone].pendingDuration = duration;
+    updatePumpState();
+    return;
+  }
+  runPump(zone, duration);
+}
+
+void runPump(uint8_t zone, uint32_t duration) {
+  Serial.printf("💧 Starting zone %u pump for %lu ms\n", zone, (unsigned long)duration);
+  ZonePump& pump = pumps[zone];
+  pump.pendingDuration = 0;
+  pump.duration = duration;
+  setRelay(zone, true);
+  
+  // Arm the safety cutoff
+  schedulePumpTask();
+  
+  // Sample now; the watering rate starts with the pump
+  if (settings.adaptiveSampling) {
+    scheduler.runIn(sensorTaskId, 0, millis());
   }
   
   // Publish pump status
-  publishPumpStatus("started", duration);
+  NetEvent event = {};
+  event.type = EVENT_PUMP_STARTED;
+  event.timestamp = pump.startedAt;
+  event.pumpDuration = duration;
+  event.zone = zone;
+  postEvent(event);
 }
 
-void stopPump() {
-  if (!pumpActive) {
+void stopPump(uint8_t zone) {
+  ZonePump& pump = pumps[zone];
+  
+  // A stop command or the backstop also ends a local cycle
+  if (watering[zone].active()) {
+    watering[zone].abort(readZoneMoisture(zone), powerClock());
+    finishWatering(zone);
+    return;
+  }
+  
+  // A queued run never started, so there is nothing to report
+  if (pump.pendingDuration > 0) {
+    pump.pendingDuration = 0;
+    updatePumpState();
+    return;
+  }
+  
+  if (!pump.relayOn) {
     return;
   }
   
-  int actualDuration = millis() - pumpStartTime;
-  Serial.printf("💧 Stopping pump after %d ms\n", actualDuration);
+  int actualDuration = millis() - pump.startedAt;
+  Serial.printf("💧 Stopping zone %u pump after %d ms\n", zone, actualDuration);
   
-  digitalWrite(PUMP_RELAY_PIN, LOW);
-  digitalWrite(LED_PIN, LOW);
-  pumpActive = false;
+  pump.duration = 0;
+  setRelay(zone, false);
+  schedulePumpTask();
   
   // Publish pump status
-  publishPumpStatus("stopped", actualDuration);
+  NetEvent event = {};
+  event.type = EVENT_PUMP_STOPPED;
+  event.timestamp = millis();
+  event.pumpDuration = actualDuration;
+  event.zone = zone;
+  postEvent(event);
+  
+  startPendingPumps();
 }
 
-void publishPumpStatus(String action, int duration) {
-  DynamicJsonDocument doc(256);
-  
-  doc["device_id"] = deviceId;
-  doc["timestamp"] = millis();
-  doc["action"] = action;
-  doc["duration"] = duration;
-  doc["pump_active"] = pumpActive;
-  
-  String payload;
-  serializeJson(doc, payload);
+void stopAllPumps() {
+  // Drop the queue first so stopping one zone does not start the next
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    pumps[zone].pendingDuration = 0;
+  }
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    stopPump(zone);
+  }
+}
+
+void startPendingPumps() {
+  // Queued manual runs take free slots before waiting local cycles
+  for (uint8_t zone = 0; zone < ZONE_COUNT && pumpSlotFree(); zone++) {
+    if (pumps[zone].pendingDuration > 0) {
+      runPump(zone, pumps[zone].pendingDuration);
+    }
+  }
+}
+
+void schedulePumpTask() {
+  // Next manual cutoff or moisture check, whichever comes first
+  uint32_t now = millis();
+  uint32_t next = UINT32_MAX;
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    const ZonePump& pump = pumps[zone];
+    if (pump.relayOn && pump.duration > 0) {
+      uint32_t elapsed = now - pump.startedAt;
+      uint32_t remaining = elapsed < pump.duration ? pump.duration - elapsed : 0;
+      next = remaining < next ? remaining : next;
+    } else if (watering[zone].active() && WATERING_SAMPLE_INTERVAL < next) {
+      next = WATERING_SAMPLE_INTERVAL;
+    }
+  }
   
-  String topic = "sensors/" + deviceId + "/pump";
+  if (next == UINT32_MAX) {
+    scheduler.cancel(pumpTaskId);
+  } else {
+    scheduler.runIn(pumpTaskId, next, now);
+  }
+}
+
+void pumpTask() {
+  uint32_t now = millis();
+  uint32_t clock = powerClock();
+  
+  // Waiting zones take turns at free pump slots
+  for (uint8_t i = 0; i < ZONE_COUNT; i++) {
+    uint8_t zone = (nextZone + i) % ZONE_COUNT;
+    ZonePump& pump = pumps[zone];
+    
+    if (pump.relayOn && pump.duration > 0) {
+      if (now - pump.startedAt >= pump.duration) {
+        stopPump(zone);
+      }
+      continue;
+    }
+    if (!watering[zone].active()) {
+      continue;
+    }
+    
+    // Fast moisture checks while the cycle runs; the ADC windows are
+    // refreshed by adcTask() every ADC_POLL_INTERVAL
+    int moisture = readZoneMoisture(zone);
+    if (moisture < 0) {
+      continue;
+    }
+    bool on = watering[zone].update(moisture, clock, settings, pump.relayOn || pumpSlotFree());
+    if (!watering[zone].active()) {
+      finishWatering(zone);
+      continue;
+    }
+    setRelay(zone, on);
+    if (!on) {
+      startPendingPumps();
+    }
+  }
+  nextZone = (nextZone + 1) % ZONE_COUNT;
   
-  if (client.connected()) {
-    client.publish(topic.c_str(), payload.c_str());
-    Serial.printf("💧 Pump status published: %s (%dms)\n", action.c_str(), duration);
+  schedulePumpTask();
+}
+
+void startWatering(uint8_t zone, int moisture, uint32_t clock) {
+  Serial.printf("🌱 Zone %u moisture %d%% below %d%%, starting local watering\n",
+                zone, moisture, settings.moistureMin);
+  watering[zone].start(moisture, clock);
+  updatePumpState();
+  
+  // First pulse as soon as a pump slot is free
+  scheduler.runIn(pumpTaskId, 0, millis());
+  
+  if (DEEP_SLEEP_ENABLED) {
+    // Stay awake for the whole cycle, soak pauses and turns of other
+    // zones at the pumps included
+    uint32_t rounds = (ZONE_COUNT + PUMP_MAX_CONCURRENT - 1) / PUMP_MAX_CONCURRENT;
+    scheduler.runIn(sleepBackstopTaskId,
+                    AWAKE_BUDGET + rounds * WateringController::maxCycleTime(settings), millis());
   }
 }
 
+void finishWatering(uint8_t zone) {
+  setRelay(zone, false);
+  updatePumpState();
+  
+  const WateringResult& result = watering[zone].result();
+  Serial.printf("🌱 Zone %u watering done: %u pulses, %lu ms pumped, %d%% -> %d%%\n", zone,
+                result.pulses, (unsigned long)result.pumpMs, result.startMoisture, result.endMoisture);
+  
+  NetEvent event = {};
+  event.type = EVENT_WATERING_RESULT;
+  event.timestamp = millis();
+  event.watering = result;
+  event.zone = zone;
+  postEvent(event);
+  
+  startPendingPumps();
+}
+
+void sleepBackstopTask() {
+  Serial.println("⚠️  Awake budget exceeded, forcing sleep");
+  stopAllPumps();
+  enterDeepSleep();
+}
+
 void manualWatering() {
+  // The button waters zone 0; other zones are watered by command
   Serial.println("🔘 Manual watering button pressed");
-  startPump(WATERING_DURATION);
+  startPump(0, settings.wateringDuration);
   blinkLED(3, 200);
 }
 
+void forcePublish() {
+  Serial.println("🔘 Publishing a sample now");
+  forceReport = true;
+  scheduler.runIn(sensorTaskId, 0, millis());
+  blinkLED(2, 100);
+}
+
+void openConfigPortal() {
+  // The portal itself runs on the network task
+  NetEvent event = {};
+  event.type = EVENT_CONFIG_PORTAL;
+  event.timestamp = millis();
+  if (postEvent(event)) {
+    Serial.println("🔘 Opening the WiFi configuration portal");
+    blinkLED(5, 100);
+  }
+}
+
+void startCalibration(uint8_t channel, int target) {
+  CalibrationReport report;
+  bool capturing;
+  if (channel < ZONE_COUNT && zoneBusy(channel)) {
+    calibration.describe(channel, CALIBRATION_BUSY, target, report);
+    capturing = false;
+  } else {
+    capturing = calibration.start(channel, target, millis(), report);
+  }
+  
+  if (capturing) {
+    Serial.printf("📐 Calibrating channel %u at %d%%, hold the sensor still\n", channel, target);
+    scheduler.runIn(calibrationTaskId, 0, millis());
+    blinkLED(1, 500);
+  } else {
+    Serial.printf("📐 Calibration of channel %u: %s\n", channel, calibrationResultName(report.result));
+  }
+  
+  NetEvent event = {};
+  event.type = EVENT_CALIBRATION;
+  event.timestamp = millis();
+  event.calibration = report;
+  postEvent(event);
+}
+
+void buttonCalibration() {
+  // Guided two-point capture of zone 0: dry now, wet on the next short press
+  Serial.println("🔘 Calibrating zone 0: dry soil now, short press once the probe is in water");
+  buttonWetPending = false;
+  buttonDryPending = !calibration.capturing();
+  startCalibration(0, 0);
+}
+
+int readChannelMillivolts(uint8_t channel) {
+  uint8_t pin = channel == CALIBRATION_CHANNEL_LIGHT ? LIGHT_SENSOR_PIN : zones[channel].moisturePin;
+  return adcSampler.readMillivolts(pin);
+}
+
+void calibrationTask() {
+  // Each call takes the latest trimmed window; adcTask() refreshes them
+  // much faster than CALIBRATION_CAPTURE_INTERVAL
+  CalibrationReport report;
+  uint8_t channel = calibration.channel();
+  if (!calibration.capture(readChannelMillivolts(channel), millis(), report)) {
+    scheduler.runIn(calibrationTaskId, CALIBRATION_CAPTURE_INTERVAL, millis());
+    return;
+  }
+  
+  bool captured = report.result == CALIBRATION_CAPTURED;
+  Serial.printf("📐 Calibration of channel %u at %d%%: %s (%u mV, spread %u mV)\n", channel, report.target,
+                calibrationResultName(report.result), report.millivolts, report.spreadMv);
+  buttonWetPending = buttonDryPending && captured;
+  buttonDryPending = false;
+  // Long blinks for a stored point, a rapid burst for a rejected one
+  if (captured) {
+    blinkLED(2, 500);
+  } else {
+    blinkLED(6, 100);
+  }
+  
+  NetEvent event = {};
+  event.type = EVENT_CALIBRATION;
+  event.timestamp = millis();
+  event.calibration = report;
+  postEvent(event);
+}
+
+void buttonTask() {
+  uint32_t waitMs = 0;
+  ButtonGesture gesture = button.service(millis(), &waitMs);
+  
+  // Re-armed for the next debounce or gesture deadline; edges re-arm it too
+  if (waitMs > 0) {
+    scheduler.runIn(buttonTaskId, waitMs, millis());
+  }
+  
+  switch (gesture) {
+    case BUTTON_SHORT_PRESS:
+      if (buttonWetPending && calibration.inSession(millis())) {
+        buttonWetPending = false;
+        startCalibration(0, 100);
+      } else {
+        manualWatering();
+      }
+      break;
+    case BUTTON_DOUBLE_PRESS:
+      forcePublish();
+      break;
+    case BUTTON_LONG_PRESS:
+      openConfigPortal();
+      break;
+    case BUTTON_DOUBLE_HOLD:
+      buttonCalibration();
+      break;
+    case BUTTON_NONE:
+      break;
+  }
+}
+
 void blinkLED(int times, int delayMs) {
-  for (int i = 0; i < times; i++) {
-    digitalWrite(LED_PIN, HIGH);
-    delay(delayMs);
-    digitalWrite(LED_PIN, LOW);
-    delay(delayMs);
+  // Start a non-blocking pattern; ledTask() performs the remaining toggles
+  ledTogglesLeft = times * 2 - 1;
+  ledToggleInterval = delayMs;
+  ledState = true;
+  digitalWrite(LED_PIN, HIGH);
+  scheduler.runIn(ledTaskId, delayMs, millis());
+}
+
+void ledTask() {
+  if (ledTogglesLeft <= 0) {
+    // Pattern done, fall back to showing pump state
+    digitalWrite(LED_PIN, pumpsRunning > 0 ? HIGH : LOW);
+    return;
   }
-}
\ No newline at end of file
+  
+  ledState = !ledState;
+  digitalWrite(LED_PIN, ledState ? HIGH : LOW);
+  ledTogglesLeft--;
+  scheduler.runIn(ledTaskId, ledToggleInterval, millis());
+}
@@ -0,0 +1,31 @@
+/**
+ * PlanetPlant ESP32 Inter-Task Messages
+ */
+
+#include "messages.h"
+
+SpscQueue<NetEvent, EVENT_QUEUE_LENGTH> eventQueue;
+SpscQueue<Command, COMMAND_QUEUE_LENGTH> commandQueue;
+
+TaskHandle_t sensingTaskHandle = nullptr;
+TaskHandle_t networkTaskHandle = nullptr;
+
+bool postEvent(const NetEvent& event) {
+  if (!eventQueue.push(event)) {
+    return false;
+  }
+  if (networkTaskHandle != nullptr) {
+    xTaskNotifyGive(networkTaskHandle);
+  }
+  return true;
+}
+
+bool postCommand(const Command& command) {
+  if (!commandQueue.push(command)) {
+    return false;
+  }
+  if (sensingTaskHandle != nullptr) {
+    xTaskNotifyGive(sensingTaskHandle);
+  }
+  return true;
+}
@@ -0,0 +1,163 @@
+/**
+ * PlanetPlant ESP32 Inter-Task Messages
+ * Events flow from the sensing task (core 1) to the network task (core 0),
+ * commands flow back. Each direction is a lock-free SPSC queue.
+ */
+
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include "hal.h"
+#include "config.h"
+#include "spsc_queue.h"
+
+// Sensor data structure
+struct SensorData {
+  float temperature;
+  float humidity;
+  int moisture;             // Zone 0
+  int lightLevel;
+  bool pumpActive;          // Any zone
+  bool isValid;
+  int8_t zoneMoisture[ZONE_COUNT];  // %, live samples only
+  uint8_t zonePumps;        // Bit per zone watering, live samples only
+};
+
+// Per-channel statistics over one aggregate window
+struct ChannelAggregate {
+  float min;
+  float max;
+  float mean;
+  float slope;              // Least-squares trend, units per hour
+};
+
+enum SensorChannel : uint8_t {
+  CHANNEL_TEMPERATURE,
+  CHANNEL_HUMIDITY,
+  CHANNEL_MOISTURE,
+  CHANNEL_LIGHT,
+  CHANNEL_COUNT
+};
+
+struct SensorAggregates {
+  uint32_t windowMs;
+  uint16_t count;           // Samples in the window
+  ChannelAggregate channels[CHANNEL_COUNT];
+};
+
+enum WateringOutcome : uint8_t {
+  WATERING_TARGET_REACHED,
+  WATERING_PULSE_LIMIT,     // WATERING_MAX_PULSES used up
+  WATERING_TIME_LIMIT,      // PUMP_MAX_DURATION used up
+  WATERING_ABORTED          // Stopped by command or button
+};
+
+// Outcome of one local pulse-and-soak cycle
+struct WateringResult {
+  uint32_t pumpMs;          // Total pump on-time
+  uint32_t elapsedMs;       // Cycle start to end
+  uint8_t pulses;
+  int8_t startMoisture;     // %
+  int8_t endMoisture;       // %
+  WateringOutcome outcome;
+};
+
+enum SampleMode : uint8_t {
+  SAMPLE_MODE_NORMAL,       // sensor_interval
+  SAMPLE_MODE_WATERING,     // A zone is watering
+  SAMPLE_MODE_CHANGING,     // Moisture moving faster than sample_fast_rate
+  SAMPLE_MODE_STABLE,       // Moisture flat for SAMPLE_STABLE_WINDOWS
+  SAMPLE_MODE_LOW_BATTERY   // Battery below battery_low
+};
+
+// The sampling interval changed (sample_rate.h)
+struct SampleRateChange {
+  uint32_t intervalMs;
+  uint32_t previousMs;      // 0 for the first interval after power-on
+  float moistureRate;       // %/h of the fastest-moving zone, last trend window
+  int16_t batteryMv;        // -1 without battery sensing
+  SampleMode mode;
+};
+
+// One point of a sensor calibration curve (calibration.h)
+struct CalibrationPoint {
+  uint16_t millivolts;
+  uint8_t value;            // %
+};
+
+enum CalibrationResult : uint8_t {
+  CALIBRATION_CAPTURING,    // Capture started
+  CALIBRATION_CAPTURED,     // Point stored, curve updated
+  CALIBRATION_RESET,        // Back to the factory curve
+  CALIBRATION_UNSTABLE,     // Readings spread more than CALIBRATION_MAX_SPREAD
+  CALIBRATION_NO_SIGNAL,    // No ADC reading on the channel
+  CALIBRATION_NOT_MONOTONIC,  // The point would make the curve ambiguous
+  CALIBRATION_CURVE_FULL,   // CALIBRATION_MAX_POINTS already
+  CALIBRATION_BUSY,         // Another capture running, or the zone is watering
+  CALIBRATION_STORAGE_FAILED
+};
+
+// Outcome of a calibration step, with the channel's curve after it
+struct CalibrationReport {
+  uint8_t channel;          // Zone, or CALIBRATION_CHANNEL_LIGHT
+  CalibrationResult result;
+  int8_t target;            // % the capture was for, -1 for a reset
+  uint16_t millivolts;      // Mean of the capture
+  uint16_t spreadMv;        // Max - min of the capture
+  uint8_t pointCount;
+  CalibrationPoint points[CALIBRATION_MAX_POINTS];
+};
+
+enum NetEventType : uint8_t {
+  EVENT_SENSOR_DATA,
+  EVENT_SENSOR_AGGREGATE,
+  EVENT_WATERING_RESULT,
+  EVENT_PUMP_STARTED,
+  EVENT_PUMP_STOPPED,
+  EVENT_CONFIG_PORTAL,      // Long button press, no payload
+  EVENT_SAMPLE_RATE,
+  EVENT_CALIBRATION
+};
+
+// Sensing -> network
+struct NetEvent {
+  NetEventType type;
+  uint32_t timestamp;       // millis() when the event was raised
+  union {
+    SensorData data;              // EVENT_SENSOR_DATA
+    SensorAggregates aggregates;  // EVENT_SENSOR_AGGREGATE
+    WateringResult watering;      // EVENT_WATERING_RESULT
+    SampleRateChange sampleRate;  // EVENT_SAMPLE_RATE
+    CalibrationReport calibration;  // EVENT_CALIBRATION
+  };
+  int pumpDuration;         // EVENT_PUMP_* (ms)
+  uint8_t zone;             // EVENT_PUMP_*, EVENT_WATERING_RESULT
+};
+
+enum CommandType : uint8_t {
+  COMMAND_WATER_START,
+  COMMAND_WATER_STOP,
+  COMMAND_BLINK,
+  COMMAND_SETTINGS_CHANGED, // Runtime settings updated, re-read them
+  COMMAND_CALIBRATE
+};
+
+// Network -> sensing
+struct Command {
+  CommandType type;
+  int value;                // Watering duration, blink count or calibration target (%)
+  int interval;             // Blink interval (ms)
+  uint8_t zone;             // COMMAND_WATER_*, calibration channel
+};
+
+extern SpscQueue<NetEvent, EVENT_QUEUE_LENGTH> eventQueue;
+extern SpscQueue<Command, COMMAND_QUEUE_LENGTH> commandQueue;
+
+extern TaskHandle_t sensingTaskHandle;
+extern TaskHandle_t networkTaskHandle;
+
+// Enqueue and wake the consumer task. Return false if the queue was full.
+bool postEvent(const NetEvent& event);
+bool postCommand(const Command& command);
+
+#endif // MESSAGES_H
@@ -0,0 +1,35 @@
+/**
+ * PlanetPlant ESP32 Firmware Metrics
+ * Fixed log-spaced buckets from 50 us to 1 s
+ */
+
+#include "metrics.h"
+
+const uint32_t metricsBucketBounds[METRICS_BUCKET_COUNT - 1] = {
+  50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 1000000
+};
+
+FirmwareMetrics metrics = {};
+
+void LatencyHistogram::record(uint32_t micros) {
+  int bucket = 0;
+  while (bucket < METRICS_BUCKET_COUNT - 1 && micros > metricsBucketBounds[bucket]) {
+    bucket++;
+  }
+  buckets[bucket]++;
+  sum += micros;
+  count++;
+  if (micros > max) {
+    max = micros;
+  }
+}
+
+void LatencyHistogram::toJson(JsonObject out) const {
+  out["count"] = count;
+  out["sum"] = sum;
+  out["max"] = max;
+  JsonArray counts = out.createNestedArray("buckets");
+  for (int i = 0; i < METRICS_BUCKET_COUNT; i++) {
+    counts.add(buckets[i]);
+  }
+}
@@ -0,0 +1,63 @@
+/**
+ * PlanetPlant ESP32 Firmware Metrics
+ * Counters and latency histograms for loop iterations, publishes and
+ * sensor reads, published on evt/metrics and exposed to
+ * Prometheus by the backend.
+ *
+ * Everything is cumulative since boot so the backend can map it straight
+ * onto Prometheus counters and histograms (a reboot is an ordinary counter
+ * reset) and no task ever has to reset another task's figures. Each
+ * histogram is written by one task only; the network task reads them
+ * without locking, so a report may be off by the sample in flight.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+
+#define METRICS_BUCKET_COUNT 12     // Bounds below plus +Inf
+
+// Upper bucket bounds in microseconds; mirrored in the backend's
+// metricsService.js
+extern const uint32_t metricsBucketBounds[METRICS_BUCKET_COUNT - 1];
+
+class LatencyHistogram {
+public:
+  void record(uint32_t micros);
+
+  // {"count", "sum" (us), "max" (us), "buckets": per-bucket counts}
+  void toJson(JsonObject out) const;
+
+  uint32_t maxMicros() const { return max; }
+  uint32_t samples() const { return count; }
+  uint64_t sumMicros() const { return sum; }
+  uint32_t bucketCount(int bucket) const { return buckets[bucket]; }   // Per bucket, not cumulative
+
+private:
+  uint32_t buckets[METRICS_BUCKET_COUNT];
+  uint64_t sum;
+  uint32_t count;
+  uint32_t max;
+};
+
+struct FirmwareMetrics {
+  LatencyHistogram sensingLoop;     // Work per sensing task wake-up
+  LatencyHistogram networkLoop;     // Work per network task wake-up
+  LatencyHistogram publish;         // QoS 1 publish to PUBACK
+  LatencyHistogram dhtRead;         // DHT22 start pulse to result, retries included
+  LatencyHistogram adcPoll;         // DMA ring drain
+  LatencyHistogram tlsFullHandshake;      // TCP connected to TLS established
+  LatencyHistogram tlsResumedHandshake;   // Same, abbreviated with a cached session
+  uint32_t publishOk;
+  uint32_t publishFailed;
+  uint32_t dhtChecksumErrors;       // Bad frames, retried
+  uint32_t dhtTimeouts;             // No response, retried
+  uint32_t tlsSessionSaveFailures;  // Sessions that did not fit RTC memory
+  uint32_t sensingJitterMs;         // Sensing scheduler lateness, max since boot
+};
+
+extern FirmwareMetrics metrics;
+
+#endif // METRICS_H
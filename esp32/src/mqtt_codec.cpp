@@ -0,0 +1,208 @@
+/**
+ * PlanetPlant ESP32 MQTT 3.1.1 Codec
+ * Integers are big-endian; strings carry a 16-bit length prefix.
+ */
+
+#include <string.h>
+#include "mqtt_codec.h"
+
+#define MQTT_PROTOCOL_LEVEL     4       // 3.1.1
+#define MQTT_MAX_REMAINING      268435455
+
+#define CONNECT_FLAG_CLEAN      0x02
+#define CONNECT_FLAG_PASSWORD   0x40
+#define CONNECT_FLAG_USER       0x80
+
+static size_t lengthFieldSize(uint32_t remaining) {
+  return remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+}
+
+static uint8_t* putHeader(uint8_t* out, uint8_t header, uint32_t remaining) {
+  *out++ = header;
+  do {
+    uint8_t digit = remaining & 0x7F;
+    remaining >>= 7;
+    *out++ = remaining > 0 ? digit | 0x80 : digit;
+  } while (remaining > 0);
+  return out;
+}
+
+static uint8_t* putU16(uint8_t* out, uint16_t value) {
+  out[0] = value >> 8;
+  out[1] = value & 0xFF;
+  return out + 2;
+}
+
+static uint8_t* putString(uint8_t* out, const char* value, size_t length) {
+  out = putU16(out, (uint16_t)length);
+  memcpy(out, value, length);
+  return out + length;
+}
+
+static uint16_t getU16(const uint8_t* in) {
+  return (uint16_t)(in[0] << 8 | in[1]);
+}
+
+// Fits the whole packet, or returns false
+static bool reserve(uint32_t remaining, size_t capacity) {
+  return remaining <= MQTT_MAX_REMAINING && 1 + lengthFieldSize(remaining) + remaining <= capacity;
+}
+
+size_t mqttEncodeConnect(const MqttConnectOptions& options, uint8_t* out, size_t capacity) {
+  size_t idLength = strlen(options.clientId);
+  size_t userLength = options.user != nullptr ? strlen(options.user) : 0;
+  size_t passLength = options.pass != nullptr ? strlen(options.pass) : 0;
+  bool user = options.user != nullptr;
+  bool pass = user && options.pass != nullptr;
+
+  uint32_t remaining = 10 + 2 + idLength;
+  if (user) remaining += 2 + userLength;
+  if (pass) remaining += 2 + passLength;
+  if (!reserve(remaining, capacity)) {
+    return 0;
+  }
+
+  uint8_t flags = 0;
+  if (options.cleanSession) flags |= CONNECT_FLAG_CLEAN;
+  if (user) flags |= CONNECT_FLAG_USER;
+  if (pass) flags |= CONNECT_FLAG_PASSWORD;
+
+  uint8_t* start = out;
+  out = putHeader(out, MQTT_CONNECT << 4, remaining);
+  out = putString(out, "MQTT", 4);
+  *out++ = MQTT_PROTOCOL_LEVEL;
+  *out++ = flags;
+  out = putU16(out, options.keepAlive);
+  out = putString(out, options.clientId, idLength);
+  if (user) out = putString(out, options.user, userLength);
+  if (pass) out = putString(out, options.pass, passLength);
+  return out - start;
+}
+
+size_t mqttPublishSize(const char* topic, size_t length, uint8_t qos) {
+  uint32_t remaining = 2 + strlen(topic) + (qos > 0 ? 2 : 0) + length;
+  return 1 + lengthFieldSize(remaining) + remaining;
+}
+
+size_t mqttEncodePublish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos,
+                         uint16_t packetId, uint8_t* out, size_t capacity) {
+  size_t topicLength = strlen(topic);
+  uint32_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + length;
+  if (!reserve(remaining, capacity)) {
+    return 0;
+  }
+
+  uint8_t* start = out;
+  out = putHeader(out, MQTT_PUBLISH << 4 | (qos > 0 ? 1 : 0) << 1, remaining);
+  out = putString(out, topic, topicLength);
+  if (qos > 0) {
+    out = putU16(out, packetId);
+  }
+  memcpy(out, payload, length);
+  return out + length - start;
+}
+
+size_t mqttEncodeSubscribe(const char* topic, uint8_t qos, uint16_t packetId, uint8_t* out, size_t capacity) {
+  size_t topicLength = strlen(topic);
+  uint32_t remaining = 2 + 2 + topicLength + 1;
+  if (!reserve(remaining, capacity)) {
+    return 0;
+  }
+
+  // Reserved flag bits of SUBSCRIBE are 0010
+  uint8_t* start = out;
+  out = putHeader(out, MQTT_SUBSCRIBE << 4 | 0x02, remaining);
+  out = putU16(out, packetId);
+  out = putString(out, topic, topicLength);
+  *out++ = qos;
+  return out - start;
+}
+
+size_t mqttEncodePuback(uint16_t packetId, uint8_t* out, size_t capacity) {
+  if (capacity < 4) {
+    return 0;
+  }
+  uint8_t* start = out;
+  out = putHeader(out, MQTT_PUBACK << 4, 2);
+  out = putU16(out, packetId);
+  return out - start;
+}
+
+size_t mqttEncodeEmpty(MqttPacketType type, uint8_t* out, size_t capacity) {
+  if (capacity < 2) {
+    return 0;
+  }
+  out[0] = type << 4;
+  out[1] = 0;
+  return 2;
+}
+
+int mqttDecodeHeader(const uint8_t* data, size_t available, uint8_t* type, uint8_t* flags,
+                     uint32_t* remaining) {
+  if (available < 2) {
+    return 0;
+  }
+
+  uint32_t value = 0;
+  for (size_t i = 1; i < MQTT_HEADER_MAX; i++) {
+    if (i >= available) {
+      return 0;
+    }
+    value |= (uint32_t)(data[i] & 0x7F) << (7 * (i - 1));
+    if ((data[i] & 0x80) == 0) {
+      *type = data[0] >> 4;
+      *flags = data[0] & 0x0F;
+      *remaining = value;
+      return (int)i + 1;
+    }
+  }
+  return -1;
+}
+
+bool mqttParseConnack(const uint8_t* body, uint32_t length, bool* sessionPresent, uint8_t* returnCode) {
+  if (length != 2) {
+    return false;
+  }
+  *sessionPresent = (body[0] & 0x01) != 0;
+  *returnCode = body[1];
+  return true;
+}
+
+bool mqttParsePublish(uint8_t flags, uint8_t* body, uint32_t length, MqttPublish& publish) {
+  publish.qos = (flags >> 1) & 0x03;
+  uint32_t idLength = publish.qos > 0 ? 2 : 0;
+  if (length < 2 || publish.qos > 2) {
+    return false;
+  }
+  uint16_t topicLength = getU16(body);
+  if (topicLength == 0 || 2 + topicLength + idLength > length) {
+    return false;
+  }
+
+  publish.packetId = idLength > 0 ? getU16(body + 2 + topicLength) : 0;
+  publish.payload = body + 2 + topicLength + idLength;
+  publish.length = length - 2 - topicLength - idLength;
+
+  // Over the length prefix, so the terminator lands inside the old topic
+  memmove(body, body + 2, topicLength);
+  body[topicLength] = 0;
+  publish.topic = (char*)body;
+  return true;
+}
+
+bool mqttParsePuback(const uint8_t* body, uint32_t length, uint16_t* packetId) {
+  if (length != 2) {
+    return false;
+  }
+  *packetId = getU16(body);
+  return true;
+}
+
+bool mqttParseSuback(const uint8_t* body, uint32_t length, uint16_t* packetId, uint8_t* granted) {
+  if (length < 3) {
+    return false;
+  }
+  *packetId = getU16(body);
+  *granted = body[2];
+  return true;
+}
@@ -0,0 +1,73 @@
+/**
+ * PlanetPlant ESP32 MQTT 3.1.1 Codec
+ * The control packets the firmware exchanges with the broker, encoded
+ * into and parsed from caller buffers: CONNECT/CONNACK, PUBLISH at QoS 0
+ * and 1 with PUBACK, SUBSCRIBE/SUBACK, PINGREQ/PINGRESP and DISCONNECT.
+ * No I/O and no heap, so the host benchmark runs it as is.
+ */
+
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum MqttPacketType : uint8_t {
+  MQTT_CONNECT = 1,
+  MQTT_CONNACK = 2,
+  MQTT_PUBLISH = 3,
+  MQTT_PUBACK = 4,
+  MQTT_SUBSCRIBE = 8,
+  MQTT_SUBACK = 9,
+  MQTT_PINGREQ = 12,
+  MQTT_PINGRESP = 13,
+  MQTT_DISCONNECT = 14
+};
+
+#define MQTT_HEADER_MAX         5       // Type byte plus up to four length bytes
+#define MQTT_PUBLISH_DUP        0x08    // Fixed header flag of a retransmitted PUBLISH
+#define MQTT_SUBACK_FAILURE     0x80
+
+struct MqttConnectOptions {
+  const char* clientId;
+  const char* user;         // nullptr for none
+  const char* pass;
+  uint16_t keepAlive;       // Seconds
+  bool cleanSession;
+};
+
+struct MqttPublish {
+  char* topic;              // NUL-terminated in place
+  uint8_t* payload;
+  size_t length;
+  uint8_t qos;
+  uint16_t packetId;        // QoS 1 only
+};
+
+// Encoders return the packet length, or 0 if it does not fit in capacity.
+size_t mqttEncodeConnect(const MqttConnectOptions& options, uint8_t* out, size_t capacity);
+size_t mqttEncodePublish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos,
+                         uint16_t packetId, uint8_t* out, size_t capacity);
+size_t mqttEncodeSubscribe(const char* topic, uint8_t qos, uint16_t packetId, uint8_t* out, size_t capacity);
+size_t mqttEncodePuback(uint16_t packetId, uint8_t* out, size_t capacity);
+
+// Header-only packets: PINGREQ and DISCONNECT
+size_t mqttEncodeEmpty(MqttPacketType type, uint8_t* out, size_t capacity);
+
+// Encoded size of a PUBLISH, for reserving room before encoding.
+size_t mqttPublishSize(const char* topic, size_t length, uint8_t qos);
+
+// Fixed header at the start of data. Returns its length with *type and
+// *flags set and *remaining the body length, 0 if more bytes are needed,
+// -1 if the length field is malformed.
+int mqttDecodeHeader(const uint8_t* data, size_t available, uint8_t* type, uint8_t* flags,
+                     uint32_t* remaining);
+
+// Body parsers; false for a malformed body. mqttParsePublish() moves the
+// topic within body to terminate it.
+bool mqttParseConnack(const uint8_t* body, uint32_t length, bool* sessionPresent, uint8_t* returnCode);
+bool mqttParsePublish(uint8_t flags, uint8_t* body, uint32_t length, MqttPublish& publish);
+bool mqttParsePuback(const uint8_t* body, uint32_t length, uint16_t* packetId);
+bool mqttParseSuback(const uint8_t* body, uint32_t length, uint16_t* packetId, uint8_t* granted);
+
+#endif // MQTT_CODEC_H
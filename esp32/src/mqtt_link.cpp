@@ -0,0 +1,584 @@
+/**
+ * PlanetPlant ESP32 MQTT Link
+ * Outbox entries are contiguous; one that does not fit before the end of
+ * the ring leaves a wrap marker and starts over at offset 0.
+ */
+
+#include "mqtt_link.h"
+
+#define ENTRY_CONTROL           0xFF    // OutboxEntry::qos of PUBACK, PINGREQ, SUBSCRIBE
+#define CONNECT_PACKET_SIZE     256
+
+uint32_t MqttLink::footprint(uint32_t length) {
+  return (sizeof(OutboxEntry) + length + 3) & ~3u;
+}
+
+void MqttLink::begin(const char* brokerHost, uint16_t brokerPort, TaskHandle_t* notifyTask) {
+  host = brokerHost;
+  port = brokerPort;
+  notify = notifyTask;
+
+  tcp.onConnect(onTcpConnect, this);
+  tcp.onDisconnect(onTcpDisconnect, this);
+  tcp.onData(onTcpData, this);
+  tcp.onAck(onTcpAck, this);
+  tcp.onError(onTcpError, this);
+}
+
+bool MqttLink::enableTls(const char* serverName, const char* caPem) {
+  tlsEnabled = true;
+  tlsReady = tls.begin(serverName, caPem, &tcp, &rxStream);
+  if (!tlsReady) {
+    Serial.printf("❌ TLS setup failed: -0x%04x\n", -tls.lastError());
+  }
+  return tlsReady;
+}
+
+void MqttLink::raise(uint32_t event) {
+  events.fetch_or(event);
+  if (*notify != nullptr) {
+    xTaskNotifyGive(*notify);
+  }
+}
+
+void MqttLink::onTcpConnect(void* arg, AsyncClient* client) {
+  ((MqttLink*)arg)->raise(EVENT_TCP_CONNECTED);
+}
+
+void MqttLink::onTcpDisconnect(void* arg, AsyncClient* client) {
+  ((MqttLink*)arg)->raise(EVENT_TCP_CLOSED);
+}
+
+void MqttLink::onTcpData(void* arg, AsyncClient* client, void* data, size_t length) {
+  MqttLink* link = (MqttLink*)arg;
+  bool stored = link->rxStream.write((const uint8_t*)data, length);
+  link->raise(stored ? 0 : EVENT_RX_OVERFLOW);
+}
+
+void MqttLink::onTcpAck(void* arg, AsyncClient* client, size_t length, uint32_t time) {
+  // Send buffer space freed; queued packets can go out
+  ((MqttLink*)arg)->raise(EVENT_SENT);
+}
+
+void MqttLink::onTcpError(void* arg, AsyncClient* client, int8_t error) {
+  ((MqttLink*)arg)->raise(EVENT_TCP_ERROR);
+}
+
+bool MqttLink::connect(uint32_t now) {
+  if (state != LINK_IDLE) {
+    return false;
+  }
+  if (tlsEnabled && !tlsReady) {
+    error = MQTT_LINK_TLS_FAILED;
+    return false;
+  }
+
+  events.store(0);
+  state = LINK_TCP_CONNECTING;
+  stateSince = now;
+  if (!tcp.connect(host, port)) {
+    state = LINK_IDLE;
+    error = MQTT_LINK_CONNECT_FAILED;
+    return false;
+  }
+  return true;
+}
+
+void MqttLink::disconnect() {
+  if (state == LINK_IDLE) {
+    return;
+  }
+  if (state == LINK_CONNECTED) {
+    uint8_t packet[2];
+    size_t length = mqttEncodeEmpty(MQTT_DISCONNECT, packet, sizeof(packet));
+    if (transportFits(length)) {
+      transportWrite(packet, length);
+    }
+    tcp.send();
+  }
+  if (tlsEnabled && (state == LINK_AWAIT_CONNACK || state == LINK_CONNECTED)) {
+    tls.close();
+  }
+  close(MQTT_LINK_DISCONNECTED, false);
+}
+
+void MqttLink::close(int8_t reason, bool notifyOwner) {
+  state = LINK_IDLE;
+  error = reason;
+  tcp.close(true);
+
+  // Nothing from this connection is wanted any more, including the
+  // callbacks the close itself raised
+  uint8_t scratch[64];
+  while (rxStream.read(scratch, sizeof(scratch)) > 0) {
+  }
+  events.store(0);
+  rxLength = 0;
+  rxSkip = 0;
+  pingOutstanding = false;
+
+  // Acks and pings belong to the connection; publishes are sent again
+  // from the oldest, unacknowledged QoS 1 ones flagged as duplicates
+  uint32_t pos = tail;
+  for (uint32_t i = 0; i < entryCount; i++) {
+    OutboxEntry* entry = entryAt(pos);
+    if (entry->qos == ENTRY_CONTROL) {
+      entry->state = ENTRY_DONE;
+    } else if (entry->state == ENTRY_SENT) {
+      entry->state = ENTRY_QUEUED;
+      ((uint8_t*)(entry + 1))[0] |= MQTT_PUBLISH_DUP;
+    }
+    advance(pos);
+  }
+  sendPos = tail;
+  sendIndex = 0;
+  inFlightCount = 0;
+  release();
+
+  if (notifyOwner && disconnectHandler != nullptr) {
+    disconnectHandler(reason);
+  }
+}
+
+bool MqttLink::publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+  if (state != LINK_CONNECTED) {
+    return false;
+  }
+
+  qos = qos > 0 ? 1 : 0;
+  size_t size = mqttPublishSize(topic, length, qos);
+  uint16_t packetId = qos > 0 ? nextPacketId : 0;
+  uint8_t* packet = size <= UINT16_MAX ? reserve(size, packetId, qos) : nullptr;
+  if (packet == nullptr) {
+    refused++;
+    return false;
+  }
+  if (qos > 0) {
+    takePacketId();
+  }
+  mqttEncodePublish(topic, payload, length, qos, packetId, packet, size);
+
+  drain(millis());
+  return true;
+}
+
+bool MqttLink::subscribe(const char* topic, uint8_t qos) {
+  if (state != LINK_CONNECTED) {
+    return false;
+  }
+  uint8_t packet[TOPIC_LENGTH + 8];
+  size_t length = mqttEncodeSubscribe(topic, qos, takePacketId(), packet, sizeof(packet));
+  if (length == 0) {
+    return false;
+  }
+  sendControl(packet, length, millis());
+  return true;
+}
+
+void MqttLink::service(uint32_t now) {
+  uint32_t pending = events.exchange(0);
+  if (state == LINK_IDLE) {
+    return;
+  }
+
+  if ((pending & EVENT_TCP_CONNECTED) && state == LINK_TCP_CONNECTING) {
+    tcp.setNoDelay(true);
+    if (tlsEnabled) {
+      tls.start();
+      state = LINK_TLS_HANDSHAKE;
+      stateSince = now;
+    } else {
+      sendConnect(now);
+    }
+  }
+
+  if (state == LINK_TLS_HANDSHAKE) {
+    TlsStep step = tls.handshake();
+    if (step == TLS_STEP_FAILED) {
+      Serial.printf("❌ TLS handshake failed: -0x%04x, verify flags 0x%lx\n", -tls.lastError(),
+                    (unsigned long)tls.verifyFlags());
+      close(MQTT_LINK_TLS_FAILED, true);
+      return;
+    }
+    if (step == TLS_STEP_DONE) {
+      if (securedHandler != nullptr) {
+        securedHandler(tls.handshakeMicros(), tls.resumed());
+      }
+      sendConnect(now);
+    }
+  }
+
+  // Data that arrived before a close is still handled
+  if (state == LINK_AWAIT_CONNACK || state == LINK_CONNECTED) {
+    receive(now);
+  }
+  if (state == LINK_IDLE) {
+    return;
+  }
+
+  if (pending & (EVENT_TCP_CLOSED | EVENT_TCP_ERROR | EVENT_RX_OVERFLOW)) {
+    close(state < LINK_AWAIT_CONNACK ? MQTT_LINK_CONNECT_FAILED : MQTT_LINK_LOST, true);
+    return;
+  }
+
+  if (state != LINK_CONNECTED) {
+    if (now - stateSince >= MQTT_CONNECT_TIMEOUT) {
+      close(MQTT_LINK_TIMEOUT, true);
+    }
+    return;
+  }
+
+  // The broker drops us after 1.5 keep-alives of silence; so do we
+  uint32_t keepAliveMs = session.keepAlive * 1000UL;
+  if (keepAliveMs > 0) {
+    if (now - lastReceived >= keepAliveMs + keepAliveMs / 2) {
+      close(MQTT_LINK_TIMEOUT, true);
+      return;
+    }
+    if (!pingOutstanding && (now - lastSent >= keepAliveMs || now - lastReceived >= keepAliveMs)) {
+      uint8_t packet[2];
+      sendControl(packet, mqttEncodeEmpty(MQTT_PINGREQ, packet, sizeof(packet)), now);
+      pingOutstanding = true;
+    }
+  }
+
+  drain(now);
+}
+
+uint32_t MqttLink::timeUntilService(uint32_t now) const {
+  if (state == LINK_IDLE) {
+    return UINT32_MAX;
+  }
+
+  uint32_t deadline;
+  if (state != LINK_CONNECTED) {
+    deadline = stateSince + MQTT_CONNECT_TIMEOUT;
+  } else if (session.keepAlive == 0) {
+    return UINT32_MAX;
+  } else {
+    uint32_t keepAliveMs = session.keepAlive * 1000UL;
+    uint32_t timeout = lastReceived + keepAliveMs + keepAliveMs / 2;
+    uint32_t ping = min(lastSent, lastReceived) + keepAliveMs;
+    deadline = pingOutstanding || (int32_t)(timeout - ping) < 0 ? timeout : ping;
+  }
+  int32_t left = (int32_t)(deadline - now);
+  return left > 0 ? (uint32_t)left : 0;
+}
+
+uint32_t MqttLink::queuedBytes() const {
+  if (entryCount == 0) {
+    return 0;
+  }
+  return head > tail ? head - tail : MQTT_OUTBOX_SIZE - tail + head;
+}
+
+void MqttLink::sendConnect(uint32_t now) {
+  uint8_t packet[CONNECT_PACKET_SIZE];
+  size_t length = mqttEncodeConnect(session, packet, sizeof(packet));
+  if (length == 0 || !transportFits(length) || !transportWrite(packet, length)) {
+    close(MQTT_LINK_CONNECT_FAILED, true);
+    return;
+  }
+  tcp.send();
+  state = LINK_AWAIT_CONNACK;
+  stateSince = now;
+  lastSent = now;
+  lastReceived = now;
+}
+
+bool MqttLink::transportFits(size_t length) {
+  return tcp.space() >= (tlsEnabled ? tls.wireSize(length) : length);
+}
+
+bool MqttLink::transportWrite(const uint8_t* data, size_t length) {
+  if (tlsEnabled) {
+    if (!tls.write(data, length)) {
+      // Closed by the next service(), not from inside a publish
+      raise(EVENT_TCP_ERROR);
+      return false;
+    }
+    return true;
+  }
+  return tcp.add((const char*)data, length) == length;
+}
+
+int MqttLink::transportRead(uint8_t* out, size_t max) {
+  if (tlsEnabled) {
+    return tls.read(out, max);
+  }
+  return rxStream.read(out, max);
+}
+
+void MqttLink::receive(uint32_t now) {
+  for (;;) {
+    if (rxSkip > 0) {
+      uint8_t scratch[64];
+      int skipped = transportRead(scratch, min<uint32_t>(rxSkip, sizeof(scratch)));
+      if (skipped < 0) {
+        close(MQTT_LINK_LOST, true);
+        return;
+      }
+      if (skipped == 0) {
+        return;
+      }
+      rxSkip -= skipped;
+      continue;
+    }
+
+    int added = transportRead(rx + rxLength, sizeof(rx) - rxLength);
+    if (added < 0) {
+      close(MQTT_LINK_LOST, true);
+      return;
+    }
+    rxLength += added;
+
+    uint32_t offset = 0;
+    for (;;) {
+      uint8_t type;
+      uint8_t flags;
+      uint32_t remaining;
+      int headerLength = mqttDecodeHeader(rx + offset, rxLength - offset, &type, &flags, &remaining);
+      if (headerLength < 0) {
+        close(MQTT_LINK_LOST, true);
+        return;
+      }
+      if (headerLength == 0) {
+        break;
+      }
+
+      uint32_t total = headerLength + remaining;
+      if (total > sizeof(rx)) {
+        // Larger than any command we accept; drop it but stay connected
+        Serial.printf("❌ MQTT packet too large (%lu bytes), skipped\n", (unsigned long)total);
+        rxSkip = total - (rxLength - offset);
+        offset = rxLength;
+        break;
+      }
+      if (rxLength - offset < total) {
+        break;
+      }
+
+      lastReceived = now;
+      handlePacket(type, flags, rx + offset + headerLength, remaining, now);
+      if (state == LINK_IDLE) {
+        return;
+      }
+      offset += total;
+    }
+
+    memmove(rx, rx + offset, rxLength - offset);
+    rxLength -= offset;
+    if (added == 0 && rxSkip == 0) {
+      return;
+    }
+  }
+}
+
+void MqttLink::handlePacket(uint8_t type, uint8_t flags, uint8_t* body, uint32_t length, uint32_t now) {
+  switch (type) {
+    case MQTT_CONNACK: {
+      bool sessionPresent;
+      uint8_t returnCode;
+      if (state != LINK_AWAIT_CONNACK || !mqttParseConnack(body, length, &sessionPresent, &returnCode)) {
+        close(MQTT_LINK_LOST, true);
+        return;
+      }
+      if (returnCode != 0) {
+        close((int8_t)returnCode, true);
+        return;
+      }
+      state = LINK_CONNECTED;
+      error = MQTT_LINK_CONNECTED;
+      if (connectHandler != nullptr) {
+        connectHandler(sessionPresent);
+      }
+      break;
+    }
+    case MQTT_PUBLISH: {
+      MqttPublish publish;
+      if (state != LINK_CONNECTED || !mqttParsePublish(flags, body, length, publish)) {
+        close(MQTT_LINK_LOST, true);
+        return;
+      }
+      if (messageHandler != nullptr) {
+        messageHandler(publish.topic, publish.payload, publish.length);
+      }
+      // Acked after handling: a reset in between means a redelivery
+      if (publish.qos > 0 && state == LINK_CONNECTED) {
+        uint8_t packet[4];
+        sendControl(packet, mqttEncodePuback(publish.packetId, packet, sizeof(packet)), now);
+      }
+      break;
+    }
+    case MQTT_PUBACK: {
+      uint16_t packetId;
+      if (!mqttParsePuback(body, length, &packetId)) {
+        break;
+      }
+      uint32_t pos = tail;
+      for (uint32_t i = 0; i < entryCount; i++) {
+        OutboxEntry* entry = entryAt(pos);
+        if (entry->state == ENTRY_SENT && entry->packetId == packetId) {
+          entry->state = ENTRY_DONE;
+          inFlightCount--;
+          if (publishedHandler != nullptr) {
+            publishedHandler(micros() - entry->queuedAt);
+          }
+          break;
+        }
+        advance(pos);
+      }
+      release();
+      break;
+    }
+    case MQTT_SUBACK: {
+      uint16_t packetId;
+      uint8_t granted;
+      if (mqttParseSuback(body, length, &packetId, &granted) && granted == MQTT_SUBACK_FAILURE) {
+        Serial.println("❌ MQTT subscription refused by the broker");
+      }
+      break;
+    }
+    case MQTT_PINGRESP:
+      pingOutstanding = false;
+      break;
+    default:
+      break;
+  }
+}
+
+void MqttLink::sendControl(const uint8_t* packet, size_t length, uint32_t now) {
+  // Straight out when there is room; they may overtake queued publishes
+  if (transportFits(length)) {
+    if (transportWrite(packet, length)) {
+      tcp.send();
+      lastSent = now;
+    }
+    return;
+  }
+  uint8_t* slot = reserve(length, 0, ENTRY_CONTROL);
+  if (slot != nullptr) {
+    memcpy(slot, packet, length);
+  }
+}
+
+void MqttLink::drain(uint32_t now) {
+  if (state != LINK_CONNECTED) {
+    return;
+  }
+
+  bool added = false;
+  while (sendIndex < entryCount) {
+    OutboxEntry* entry = entryAt(sendPos);
+    if (entry->state == ENTRY_QUEUED) {
+      // In order: a full window holds back everything behind it
+      if (entry->qos == 1 && inFlightCount >= MQTT_MAX_INFLIGHT) {
+        break;
+      }
+      if (!transportFits(entry->length)) {
+        break;
+      }
+      if (!transportWrite((const uint8_t*)(entry + 1), entry->length)) {
+        break;
+      }
+      added = true;
+      if (entry->qos == 1) {
+        entry->state = ENTRY_SENT;
+        inFlightCount++;
+      } else {
+        entry->state = ENTRY_DONE;
+      }
+    }
+    advance(sendPos);
+    sendIndex++;
+  }
+
+  if (added) {
+    tcp.send();
+    lastSent = now;
+  }
+  release();
+}
+
+uint8_t* MqttLink::reserve(size_t length, uint16_t packetId, uint8_t qos) {
+  uint32_t need = footprint(length);
+  uint32_t at;
+
+  if (entryCount == 0) {
+    head = tail = sendPos = 0;
+    sendIndex = 0;
+  }
+
+  if (entryCount > 0 && head == tail) {
+    return nullptr;
+  } else if (head >= tail) {
+    if (MQTT_OUTBOX_SIZE - head >= need) {
+      at = head;
+    } else if (tail >= need) {
+      // Readers skip to offset 0 at the marker, or when no header fits
+      if (MQTT_OUTBOX_SIZE - head >= sizeof(OutboxEntry)) {
+        ((OutboxEntry*)(outbox + head))->state = ENTRY_WRAP;
+      }
+      at = 0;
+    } else {
+      return nullptr;
+    }
+  } else if (tail - head >= need) {
+    at = head;
+  } else {
+    return nullptr;
+  }
+
+  OutboxEntry* entry = (OutboxEntry*)(outbox + at);
+  entry->length = (uint16_t)length;
+  entry->packetId = packetId;
+  entry->qos = qos;
+  entry->state = ENTRY_QUEUED;
+  entry->queuedAt = micros();
+
+  head = at + need;
+  if (head == MQTT_OUTBOX_SIZE) {
+    head = 0;
+  }
+  entryCount++;
+  return (uint8_t*)(entry + 1);
+}
+
+MqttLink::OutboxEntry* MqttLink::entryAt(uint32_t& pos) {
+  if (MQTT_OUTBOX_SIZE - pos < sizeof(OutboxEntry) || ((OutboxEntry*)(outbox + pos))->state == ENTRY_WRAP) {
+    pos = 0;
+  }
+  return (OutboxEntry*)(outbox + pos);
+}
+
+void MqttLink::advance(uint32_t& pos) {
+  OutboxEntry* entry = entryAt(pos);
+  pos += footprint(entry->length);
+  if (pos == MQTT_OUTBOX_SIZE) {
+    pos = 0;
+  }
+}
+
+void MqttLink::release() {
+  while (entryCount > 0 && entryAt(tail)->state == ENTRY_DONE) {
+    advance(tail);
+    entryCount--;
+    if (sendIndex > 0) {
+      sendIndex--;
+    } else {
+      sendPos = tail;
+    }
+  }
+  if (entryCount == 0) {
+    head = tail = sendPos = 0;
+    sendIndex = 0;
+  }
+}
+
+uint16_t MqttLink::takePacketId() {
+  uint16_t packetId = nextPacketId++;
+  if (nextPacketId == 0) {
+    nextPacketId = 1;
+  }
+  return packetId;
+}
@@ -0,0 +1,185 @@
+/**
+ * PlanetPlant ESP32 MQTT Link
+ * Asynchronous MQTT 3.1.1 client on AsyncTCP (packets in mqtt_codec.h).
+ * The TCP callbacks run on the AsyncTCP task and only copy received
+ * bytes and raise flags; the protocol, and every handler below, runs in
+ * service() on the owning task, which the callbacks wake.
+ *
+ * Publishes are encoded straight into a static outbox ring and handed to
+ * the TCP stack as its send buffer frees up, with up to MQTT_MAX_INFLIGHT
+ * QoS 1 messages awaiting their PUBACK. publish() returns false when the
+ * outbox is full; that is the backpressure signal, the caller keeps the
+ * data. QoS 1 messages stay in the outbox until acknowledged and are
+ * resent with DUP after a reconnect; QoS 0 ones are gone once TCP has
+ * them, and acks and pings are dropped with the connection.
+ *
+ * With enableTls() the same bytes travel through a TlsChannel; the
+ * handshake runs in service() like the rest of the protocol.
+ *
+ * Error codes follow PubSubClient's state() so reported values keep
+ * their meaning. Owning task only, apart from the TCP callbacks.
+ */
+
+#ifndef MQTT_LINK_H
+#define MQTT_LINK_H
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <atomic>
+#include "config.h"
+#include "spsc_queue.h"
+#include "mqtt_codec.h"
+#include "tls_channel.h"
+
+enum MqttLinkError : int8_t {
+  MQTT_LINK_TLS_FAILED = -5,        // Handshake failed or certificate rejected
+  MQTT_LINK_TIMEOUT = -4,           // No CONNACK, or keep-alive expired
+  MQTT_LINK_LOST = -3,              // TCP connection closed or failed
+  MQTT_LINK_CONNECT_FAILED = -2,    // TCP connect refused or unreachable
+  MQTT_LINK_DISCONNECTED = -1,      // Closed by us
+  MQTT_LINK_CONNECTED = 0
+  // 1-5: CONNACK return codes
+};
+
+typedef void (*MqttConnectHandler)(bool sessionPresent);
+typedef void (*MqttDisconnectHandler)(int8_t reason);
+typedef void (*MqttMessageHandler)(char* topic, uint8_t* payload, size_t length);
+typedef void (*MqttPublishedHandler)(uint32_t latencyUs);
+typedef void (*MqttSecuredHandler)(uint32_t handshakeUs, bool resumed);
+
+class MqttLink {
+public:
+  // *notify is woken from the TCP callbacks; it may be created later.
+  void begin(const char* host, uint16_t port, TaskHandle_t* notify);
+  void setSession(const MqttConnectOptions& options) { session = options; }
+
+  // Run every later connection over TLS, verifying the broker against
+  // caPem for serverName. False when the TLS context cannot be set up.
+  bool enableTls(const char* serverName, const char* caPem);
+
+  void onConnect(MqttConnectHandler handler) { connectHandler = handler; }
+  void onDisconnect(MqttDisconnectHandler handler) { disconnectHandler = handler; }
+  void onMessage(MqttMessageHandler handler) { messageHandler = handler; }
+  void onPublished(MqttPublishedHandler handler) { publishedHandler = handler; }
+  void onSecured(MqttSecuredHandler handler) { securedHandler = handler; }   // TLS handshake done
+
+  // Start connecting; the outcome arrives through the connect or
+  // disconnect handler. False if already connected or connecting.
+  bool connect(uint32_t now);
+
+  // Send DISCONNECT and close. The disconnect handler is not called.
+  void disconnect();
+
+  bool connected() const { return state == LINK_CONNECTED; }
+  bool idle() const { return state == LINK_IDLE; }
+
+  // Queue a PUBLISH. False when not connected or the outbox is full.
+  bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos);
+
+  bool subscribe(const char* topic, uint8_t qos);
+
+  // Process received packets, keep-alive and timeouts, and hand queued
+  // packets to TCP. Call on every wake of the owning task.
+  void service(uint32_t now);
+
+  // ms until service() has timed work (keep-alive, connect timeout)
+  uint32_t timeUntilService(uint32_t now) const;
+
+  uint8_t inFlight() const { return inFlightCount; }
+  uint32_t queuedBytes() const;
+  uint32_t refusedCount() const { return refused; }   // Publishes refused with a full outbox
+  uint32_t tlsSessionSaveFailures() const { return tls.sessionSaveFailures(); }
+  int8_t lastError() const { return error; }
+
+private:
+  enum LinkState : uint8_t {
+    LINK_IDLE, LINK_TCP_CONNECTING, LINK_TLS_HANDSHAKE, LINK_AWAIT_CONNACK, LINK_CONNECTED
+  };
+  enum EntryState : uint8_t { ENTRY_QUEUED, ENTRY_SENT, ENTRY_DONE, ENTRY_WRAP };
+
+  struct OutboxEntry {
+    uint16_t length;        // Packet bytes following the entry
+    uint16_t packetId;      // QoS 1 PUBLISH, else 0
+    uint8_t qos;            // 0 or 1, or ENTRY_CONTROL for acks and pings
+    EntryState state;
+    uint32_t queuedAt;      // micros()
+  };
+
+  static const uint32_t EVENT_TCP_CONNECTED = 0x01;
+  static const uint32_t EVENT_TCP_CLOSED = 0x02;
+  static const uint32_t EVENT_TCP_ERROR = 0x04;
+  static const uint32_t EVENT_SENT = 0x08;
+  static const uint32_t EVENT_RX_OVERFLOW = 0x10;
+
+  AsyncClient tcp;
+  const char* host = nullptr;
+  uint16_t port = 0;
+  TaskHandle_t* notify = nullptr;
+  MqttConnectOptions session = {};
+
+  MqttConnectHandler connectHandler = nullptr;
+  MqttDisconnectHandler disconnectHandler = nullptr;
+  MqttMessageHandler messageHandler = nullptr;
+  MqttPublishedHandler publishedHandler = nullptr;
+  MqttSecuredHandler securedHandler = nullptr;
+
+  TlsChannel tls;
+  bool tlsEnabled = false;
+  bool tlsReady = false;      // Never plaintext once TLS was asked for
+
+  // Written by the TCP callbacks, read by service()
+  std::atomic<uint32_t> events{0};
+  MqttRxStream rxStream;     // Ciphertext when TLS is on
+
+  LinkState state = LINK_IDLE;
+  int8_t error = MQTT_LINK_DISCONNECTED;
+  uint32_t stateSince = 0;
+  uint32_t lastSent = 0;
+  uint32_t lastReceived = 0;
+  bool pingOutstanding = false;
+  uint16_t nextPacketId = 1;
+
+  // Packet being reassembled; an oversize packet is skipped
+  uint8_t rx[MQTT_MAX_PACKET_SIZE];
+  uint32_t rxLength = 0;
+  uint32_t rxSkip = 0;
+
+  // Outbox ring of OutboxEntry headers and packets; tail is the oldest
+  // entry still needed, sendPos the next one to hand to TCP
+  alignas(4) uint8_t outbox[MQTT_OUTBOX_SIZE];
+  uint32_t head = 0;
+  uint32_t tail = 0;
+  uint32_t sendPos = 0;
+  uint32_t entryCount = 0;
+  uint32_t sendIndex = 0;   // Entries between tail and sendPos
+  uint8_t inFlightCount = 0;
+  uint32_t refused = 0;
+
+  static void onTcpConnect(void* arg, AsyncClient* client);
+  static void onTcpDisconnect(void* arg, AsyncClient* client);
+  static void onTcpData(void* arg, AsyncClient* client, void* data, size_t length);
+  static void onTcpAck(void* arg, AsyncClient* client, size_t length, uint32_t time);
+  static void onTcpError(void* arg, AsyncClient* client, int8_t error);
+  void raise(uint32_t event);
+
+  // Plaintext to and from the connection, through TLS when enabled
+  bool transportFits(size_t length);
+  bool transportWrite(const uint8_t* data, size_t length);
+  int transportRead(uint8_t* out, size_t max);
+
+  void sendConnect(uint32_t now);
+  void receive(uint32_t now);
+  void handlePacket(uint8_t type, uint8_t flags, uint8_t* body, uint32_t length, uint32_t now);
+  void sendControl(const uint8_t* packet, size_t length, uint32_t now);
+  void drain(uint32_t now);
+  void close(int8_t reason, bool notifyOwner);
+
+  static uint32_t footprint(uint32_t length);
+  uint8_t* reserve(size_t length, uint16_t packetId, uint8_t qos);
+  OutboxEntry* entryAt(uint32_t& pos);
+  void advance(uint32_t& pos);
+  void release();
+  uint16_t takePacketId();
+};
+
+#endif // MQTT_LINK_H
@@ -0,0 +1,1499 @@
+/**
+ * PlanetPlant ESP32 Network Task
+ * Drains sensing events into MQTT publishes and turns incoming MQTT
+ * commands into Command messages for the sensing task. Leaf builds
+ * (ESPNOW_ROLE_LEAF) use espnow_leaf.cpp instead.
+ */
+
+#include "config.h"
+
+#if ESPNOW_ROLE != ESPNOW_ROLE_LEAF
+
+#include <WiFi.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include <WiFiManager.h>
+#include <esp_wifi.h>
+#include "config.h"
+#include "pins.h"
+#include "messages.h"
+#include "scheduler.h"
+#include "sample_store.h"
+#include "telemetry_codec.h"
+#include "power.h"
+#include "wifi_cache.h"
+#include "runtime_settings.h"
+#include "metrics.h"
+#include "payloads.h"
+#include "time_sync.h"
+#include "ota_update.h"
+#include "watchdog.h"
+#include "command_log.h"
+#include "mqtt_link.h"
+#include "sample_history.h"
+#include "http_server.h"
+#include "topics.h"
+#include "sample_rate.h"
+#include "espnow_link.h"
+#include "espnow_gateway.h"
+#include "trace.h"
+#include "network.h"
+
+// MQTT over AsyncTCP; serviced from the network task loop
+MqttLink client;
+
+// Device Configuration (filled once by setupIdentity())
+char deviceId[DEVICE_ID_LENGTH];
+char mqttClientId[DEVICE_ID_LENGTH + 12];
+
+// Topics (topics.h), computed once after deviceId is known
+char topicData[TOPIC_LENGTH];
+char topicBatch[TOPIC_LENGTH];
+char topicAggregate[TOPIC_LENGTH];
+char topicStatus[TOPIC_LENGTH];
+char topicPump[TOPIC_LENGTH];
+char topicWatering[TOPIC_LENGTH];
+char topicHeartbeat[TOPIC_LENGTH];
+char topicWaterCommand[TOPIC_LENGTH];
+char topicConfigCommand[TOPIC_LENGTH];
+char topicConfigAck[TOPIC_LENGTH];
+char topicCommandAck[TOPIC_LENGTH];
+char topicMetrics[TOPIC_LENGTH];
+char topicOtaCommand[TOPIC_LENGTH];
+char topicOta[TOPIC_LENGTH];
+char topicSampleRate[TOPIC_LENGTH];
+char topicCalibration[TOPIC_LENGTH];
+char topicCalibrateCommand[TOPIC_LENGTH];
+char topicMesh[TOPIC_LENGTH];
+char topicTrace[TOPIC_LENGTH];
+
+// Static JSON documents and payload buffer: the publish path never
+// touches the heap once running. Only the network task uses them.
+StaticJsonDocument<JSON_TX_DOC_SIZE> txDoc;
+StaticJsonDocument<JSON_RX_DOC_SIZE> rxDoc;
+char txBuffer[MQTT_MAX_PACKET_SIZE];
+
+// Heap watermarks; steady state starts after the first MQTT connection
+uint32_t steadyMinFreeHeap = UINT32_MAX;
+bool steadyState = false;
+
+// Network-side periodic work
+Scheduler netScheduler;
+int batchFlushTaskId = SCHEDULER_INVALID_TASK;
+int mqttReconnectTaskId = SCHEDULER_INVALID_TASK;
+int heartbeatTaskId = SCHEDULER_INVALID_TASK;
+uint32_t heartbeatInterval = 0;
+int metricsTaskId = SCHEDULER_INVALID_TASK;
+uint32_t metricsInterval = 0;
+int configPortalTaskId = SCHEDULER_INVALID_TASK;
+int replayTaskId = SCHEDULER_INVALID_TASK;
+int meshFlushTaskId = SCHEDULER_INVALID_TASK;
+
+// Runtime config portal (long button press); serviced by configPortalTask()
+// so the network task keeps running while it is open
+WiFiManager configPortal;
+
+// Last OTA state published on evt/ota
+OtaState otaReportedState = OTA_IDLE;
+uint8_t otaReportedChecks = 0;
+uint8_t otaReportedTenth = 0;   // Download progress in tenths
+
+// MQTT link: reconnects are scheduled attempts, never a blocking loop
+struct MqttLinkStats {
+  uint32_t attempts;        // connect() calls
+  uint32_t failures;
+  uint32_t connects;
+  uint32_t lastLatencyMs;   // Duration of the last successful connect()
+  uint32_t maxLatencyMs;
+  uint32_t lastDowntimeMs;  // Loss to reconnect, last outage
+  int lastError;            // MqttLinkError after the last failure
+};
+
+MqttLinkStats mqttStats = {};
+bool mqttLinkUp = false;
+uint32_t mqttDownSince = 0;
+uint32_t mqttAttemptStartedAt = 0;
+uint32_t mqttConsecutiveFailures = 0;
+
+// Pending batch, in wire units (see telemetry_codec.h)
+TelemetryBatchSample batchSamples[BATCH_MAX_SAMPLES];
+uint8_t batchCount = 0;
+
+// networkStats() copy; odd sequence while the network task rewrites it
+NetworkStats statsCopy = {};
+std::atomic<uint32_t> statsSequence{0};
+
+void setupIdentity();
+void setDeviceTopic(char* topic, const char* direction, const char* name);
+bool fastConnectWiFi(const wifi_config_t& stored);
+bool connectWithBackoff(const wifi_config_t& stored);
+bool waitForWiFi(uint32_t timeoutMs);
+void onWiFiConnected(bool dhcp);
+void networkTask(void* parameter);
+void mqttReconnectTask();
+void onNetworkFault();
+void restartNetworkStack();
+void startConfigPortal();
+void configPortalTask();
+void onMqttSession(bool sessionPresent);
+void onMqttClosed(int8_t reason);
+void onMqttPublished(uint32_t latencyUs);
+void onMqttSecured(uint32_t handshakeUs, bool resumed);
+void onMqttConnected(uint32_t now, uint32_t latencyMs);
+void onMqttConnectFailed();
+void onMqttLost(uint32_t now);
+uint32_t mqttBackoff();
+void addMqttStats(JsonObject mqtt);
+void mqttCallback(char* topic, byte* payload, size_t length);
+void handleEvent(const NetEvent& event);
+typedef bool (*CommandParser)(JsonDocument& doc, char* payload, size_t length, Command& command,
+                              const char** error);
+void handleDeviceCommand(const char* name, CommandParser parse, byte* payload, unsigned int length);
+void publishCommandAck(const char* requestId, const char* command, const char* result, const char* error);
+void handleConfigCommand(byte* payload, unsigned int length);
+void handleOtaCommand(byte* payload, unsigned int length);
+void onSettingsChanged();
+void publishConfigAck(SettingsResult result, const char* error, const char* requestId);
+bool publishOtaStatus(const OtaStatus& ota, const char* rejected);
+void otaStatusTask();
+bool publishSensorData(SensorData data, uint32_t timestamp);
+bool publishStoredSample(const StoredSample& sample);
+bool publishSample(const SensorData& data, uint64_t epochMs, uint32_t timestamp, uint16_t bootId, bool replayed);
+bool publishAggregates(const SensorAggregates& aggregates, uint32_t timestamp);
+void publishHeartbeat();
+void publishStatus(const char* status);
+void publishPumpStatus(const char* action, int duration, uint8_t zone, uint32_t timestamp);
+void publishWateringResult(const WateringResult& result, uint8_t zone, uint32_t timestamp);
+void publishSampleRate(const SampleRateChange& change, uint32_t timestamp);
+void publishCalibration(const CalibrationReport& report, uint32_t timestamp);
+void heartbeatTask();
+void publishMetrics();
+void metricsTask();
+void replayTask();
+void addToBatch(const SensorData& data, uint32_t timestamp);
+bool publishBatch();
+void batchFlushTask();
+void dutyCycleTask();
+void serviceMesh(uint32_t now);
+void meshFlushTask();
+void traceDumpTask();
+void statsTask();
+bool publishJson(const char* topic, uint8_t qos = MQTT_QOS);
+bool publishFrame(const char* topic, const uint8_t* payload, size_t length, uint8_t qos = MQTT_QOS);
+void updateHeapWatermark();
+
+void setupWiFi() {
+  Serial.println("🔌 Setting up WiFi connection...");
+  
+  // Credentials saved by WiFiManager live in the WiFi driver's NVS
+  WiFi.mode(WIFI_STA);
+  wifi_config_t stored;
+  bool haveCredentials = esp_wifi_get_config(WIFI_IF_STA, &stored) == ESP_OK && stored.sta.ssid[0] != 0;
+  
+  if (haveCredentials) {
+    // Don't let the pinned BSSID/channel overwrite the saved config
+    WiFi.persistent(false);
+    bool connected = fastConnectWiFi(stored);
+    bool dhcp = !connected;
+    if (!connected) {
+      connected = connectWithBackoff(stored);
+    }
+    WiFi.persistent(true);
+    
+    if (connected) {
+      onWiFiConnected(dhcp);
+      return;
+    }
+    Serial.println("⚠️  Saved network unreachable, opening config portal");
+  }
+  
+  WiFiManager wm;
+  
+  // LED indicates WiFi setup mode
+  digitalWrite(LED_PIN, HIGH);
+  
+  // Reset settings for testing (comment out for production)
+  // wm.resetSettings();
+  
+  // Set custom parameters
+  wm.setAPName(CONFIG_PORTAL_SSID);
+  wm.setAPPassword(CONFIG_PORTAL_PASSWORD);
+  wm.setConfigPortalTimeout(300); // 5 minutes timeout
+  
+  // Add custom parameters
+  WiFiManagerParameter custom_mqtt_server("server", "MQTT Server", MQTT_SERVER, 40);
+  WiFiManagerParameter custom_device_name("device", "Device Name", "PlanetPlant ESP32", 32);
+  
+  wm.addParameter(&custom_mqtt_server);
+  wm.addParameter(&custom_device_name);
+  
+  // Attempt to connect
+  if (!wm.autoConnect()) {
+    Serial.println("❌ Failed to connect to WiFi, restarting...");
+    ESP.restart();
+  }
+  
+  digitalWrite(LED_PIN, LOW);
+  onWiFiConnected(true);
+}
+
+bool fastConnectWiFi(const wifi_config_t& stored) {
+  WifiCache cache;
+  if (!loadWifiCache(cache)) {
+    return false;
+  }
+  
+  // Renew the lease now and then so a reassigned IP can't linger
+  if (wifiFastConnectCount() >= WIFI_CACHE_MAX_USES) {
+    return false;
+  }
+  
+  unsigned long start = millis();
+  WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+  WiFi.begin((const char*)stored.sta.ssid, (const char*)stored.sta.password, cache.channel, cache.bssid);
+  
+  if (!waitForWiFi(WIFI_FAST_CONNECT_TIMEOUT)) {
+    // AP moved or lease gone: forget it and let the full path use DHCP
+    Serial.println("⚠️  Fast WiFi connect failed, doing a full connect");
+    clearWifiCache();
+    WiFi.disconnect();
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());
+    return false;
+  }
+  
+  countWifiFastConnect();
+  Serial.printf("⚡ WiFi fast connect in %lu ms (ch %u)\n", millis() - start, cache.channel);
+  return true;
+}
+
+bool connectWithBackoff(const wifi_config_t& stored) {
+  uint32_t backoff = WIFI_BACKOFF_BASE;
+  
+  for (int attempt = 1; attempt <= WIFI_MAX_RETRY_COUNT; attempt++) {
+    // Full jitter: devices that lost power together spread their scans
+    // over the window instead of hitting the AP at once
+    uint32_t wait = esp_random() % backoff;
+    Serial.printf("🔄 WiFi attempt %d in %lu ms\n", attempt, (unsigned long)wait);
+    delay(wait);
+    
+    WiFi.begin((const char*)stored.sta.ssid, (const char*)stored.sta.password);
+    if (waitForWiFi(WIFI_ATTEMPT_TIMEOUT)) {
+      return true;
+    }
+    
+    WiFi.disconnect();
+    backoff = min<uint32_t>(backoff * 2, WIFI_BACKOFF_MAX);
+  }
+  return false;
+}
+
+bool waitForWiFi(uint32_t timeoutMs) {
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED) {
+    if (millis() - start >= timeoutMs) {
+      return false;
+    }
+    delay(10);
+  }
+  return true;
+}
+
+void onWiFiConnected(bool dhcp) {
+  Serial.println("✅ WiFi connected!");
+  Serial.printf("📶 IP Address: %s\n", WiFi.localIP().toString().c_str());
+  
+  // Leaves find us on the channel the access point put us on
+  if (ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY) {
+    meshGateway.begin();
+  }
+  
+  if (!dhcp) {
+    return;
+  }
+  
+  // Fresh lease and association; the next boot can skip scan and DHCP
+  WifiCache cache = {};
+  cache.ip = WiFi.localIP();
+  cache.gateway = WiFi.gatewayIP();
+  cache.subnet = WiFi.subnetMask();
+  cache.dns = WiFi.dnsIP();
+  memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+  cache.channel = WiFi.channel();
+  saveWifiCache(cache);
+  resetWifiFastConnectCount();
+}
+
+void setupIdentity() {
+  snprintf(deviceId, sizeof(deviceId), "esp32_%x", (uint32_t)ESP.getEfuseMac());
+  snprintf(mqttClientId, sizeof(mqttClientId), "plantplant_%s", deviceId);
+  
+  setDeviceTopic(topicData, TOPIC_EVENTS, TOPIC_DATA);
+  setDeviceTopic(topicBatch, TOPIC_EVENTS, TOPIC_BATCH);
+  setDeviceTopic(topicAggregate, TOPIC_EVENTS, TOPIC_AGGREGATE);
+  setDeviceTopic(topicStatus, TOPIC_EVENTS, TOPIC_STATUS);
+  setDeviceTopic(topicPump, TOPIC_EVENTS, TOPIC_PUMP);
+  setDeviceTopic(topicWatering, TOPIC_EVENTS, TOPIC_WATERING);
+  setDeviceTopic(topicHeartbeat, TOPIC_EVENTS, TOPIC_HEARTBEAT);
+  setDeviceTopic(topicConfigAck, TOPIC_EVENTS, TOPIC_CONFIG_ACK);
+  setDeviceTopic(topicCommandAck, TOPIC_EVENTS, TOPIC_COMMAND_ACK);
+  setDeviceTopic(topicMetrics, TOPIC_EVENTS, TOPIC_METRICS);
+  setDeviceTopic(topicOta, TOPIC_EVENTS, TOPIC_OTA_STATUS);
+  setDeviceTopic(topicSampleRate, TOPIC_EVENTS, TOPIC_SAMPLE_RATE);
+  setDeviceTopic(topicCalibration, TOPIC_EVENTS, TOPIC_CALIBRATION);
+  setDeviceTopic(topicMesh, TOPIC_EVENTS, TOPIC_MESH);
+  setDeviceTopic(topicTrace, TOPIC_EVENTS, TOPIC_TRACE);
+  setDeviceTopic(topicWaterCommand, TOPIC_COMMANDS, TOPIC_WATER_COMMAND);
+  setDeviceTopic(topicConfigCommand, TOPIC_COMMANDS, TOPIC_CONFIG_COMMAND);
+  setDeviceTopic(topicOtaCommand, TOPIC_COMMANDS, TOPIC_OTA_COMMAND);
+  setDeviceTopic(topicCalibrateCommand, TOPIC_COMMANDS, TOPIC_CALIBRATE_COMMAND);
+}
+
+void setDeviceTopic(char* topic, const char* direction, const char* name) {
+  if (formatDeviceTopic(topic, TOPIC_LENGTH, MQTT_SITE, deviceId, direction, name) == 0) {
+    Serial.printf("❌ Topic %s/%s does not fit TOPIC_LENGTH, MQTT_SITE too long\n", direction, name);
+  }
+}
+
+void setupMQTT() {
+  setupIdentity();
+  
+  // Without a clean session the broker keeps the subscriptions and the
+  // QoS 1 commands that arrive while we are away
+  client.begin(MQTT_SERVER, MQTT_PORT, &networkTaskHandle);
+  client.setSession({ mqttClientId, MQTT_USER, MQTT_PASS, MQTT_KEEPALIVE, MQTT_CLEAN_SESSION });
+  client.onConnect(onMqttSession);
+  client.onDisconnect(onMqttClosed);
+  client.onMessage(mqttCallback);
+  client.onPublished(onMqttPublished);
+#if MQTT_TLS_ENABLED
+  client.enableTls(MQTT_TLS_SERVER_NAME, MQTT_CA_CERT);
+  client.onSecured(onMqttSecured);
+#endif
+  
+  Serial.printf("🔗 MQTT Server: %s:%d%s\n", MQTT_SERVER, MQTT_PORT, MQTT_TLS_ENABLED ? " (TLS)" : "");
+}
+
+void startNetworkTask() {
+  sampleStore.begin();
+  commandLogBegin();
+  
+  // Before any event is handled: stored and published timestamps depend on it
+  timeSyncBegin();
+  
+  // Batches carry the heartbeat fields themselves when configured to
+  if (!(BATCHING_ACTIVE && BATCH_INCLUDE_HEARTBEAT)) {
+    heartbeatInterval = settingsSnapshot().heartbeatInterval;
+    heartbeatTaskId = netScheduler.add(heartbeatTask, heartbeatInterval, heartbeatInterval, millis());
+  }
+  metricsInterval = settingsSnapshot().metricsInterval;
+  metricsTaskId = netScheduler.add(metricsTask, metricsInterval, metricsInterval, millis());
+  replayTaskId = netScheduler.add(replayTask, SAMPLE_REPLAY_INTERVAL, SAMPLE_REPLAY_INTERVAL, millis());
+  netScheduler.add(otaStatusTask, OTA_STATUS_INTERVAL, OTA_STATUS_INTERVAL, millis());
+  batchFlushTaskId = netScheduler.add(batchFlushTask, 0, 0, millis());
+  mqttReconnectTaskId = netScheduler.add(mqttReconnectTask, 0, 0, millis());
+  configPortalTaskId = netScheduler.add(configPortalTask, 0, 0, millis());
+  if (DEEP_SLEEP_ENABLED) {
+    netScheduler.add(dutyCycleTask, DUTY_CYCLE_CHECK_INTERVAL, DUTY_CYCLE_CHECK_INTERVAL, millis());
+  }
+  if (ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY) {
+    meshFlushTaskId = netScheduler.add(meshFlushTask, 0, 0, millis());
+  }
+  if (PROFILE_TRACE_ENABLED) {
+    netScheduler.add(traceDumpTask, PROFILE_TRACE_DUMP_INTERVAL, PROFILE_TRACE_DUMP_INTERVAL, millis());
+  }
+  
+  // Local endpoint; a duty-cycled device is asleep most of the time
+  if (WEB_SERVER_ENABLED && !DEEP_SLEEP_ENABLED) {
+    statsTask();
+    netScheduler.add(statsTask, HTTP_STATS_INTERVAL, HTTP_STATS_INTERVAL, millis());
+    startHttpServer();
+  }
+  
+  // First connect straight away; later ones follow the backoff
+  mqttDownSince = millis();
+  netScheduler.runIn(mqttReconnectTaskId, 0, millis());
+  
+  if (xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                              NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE) != pdPASS) {
+    Serial.println("❌ Failed to start the network task, restarting...");
+    ESP.restart();
+  }
+}
+
+void networkTask(void* parameter) {
+  watchdogRegister(WATCHDOG_TASK_NETWORK);
+  
+  for (;;) {
+    watchdogFeed(WATCHDOG_TASK_NETWORK);
+    
+    // Received packets, acks and keep-alive. Losing the broker only arms
+    // mqttReconnectTask; events keep being drained (into the sample
+    // store) meanwhile
+    uint32_t started = micros();
+    client.service(millis());
+    
+    // Leaf samples wait at most a reply timeout for their answer
+    if (ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY) {
+      serviceMesh(millis());
+    }
+    
+    // Publish everything the sensing task has queued
+    NetEvent event;
+    while (eventQueue.pop(event)) {
+      handleEvent(event);
+    }
+    
+    netScheduler.run(millis());
+    
+    metrics.networkLoop.record(micros() - started);
+    
+    // Sleep until the next deadline, or until postEvent() or MQTT
+    // traffic wakes us
+    uint32_t now = millis();
+    uint32_t waitMs = min(netScheduler.timeUntilNext(now, NETWORK_LOOP_INTERVAL), client.timeUntilService(now));
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+  }
+}
+
+void mqttReconnectTask() {
+  uint32_t now = millis();
+  if (!client.idle()) {
+    return;
+  }
+  
+  // WiFi reconnects on its own; don't burn attempts meanwhile. An open
+  // portal is the user changing networks, not a fault
+  if (WiFi.status() != WL_CONNECTED) {
+    if (!configPortal.getConfigPortalActive()) {
+      onNetworkFault();
+    }
+    netScheduler.runIn(mqttReconnectTaskId, MQTT_RECONNECT_INTERVAL, now);
+    return;
+  }
+  
+  mqttStats.attempts++;
+  Serial.printf("🔄 Attempting MQTT connection (attempt %lu)...\n",
+                (unsigned long)(mqttConsecutiveFailures + 1));
+  
+  // Returns at once; the outcome arrives in onMqttSession() or
+  // onMqttClosed(), at the latest after MQTT_CONNECT_TIMEOUT
+  mqttAttemptStartedAt = now;
+  traceBegin(TRACE_MQTT_CONNECT);
+  if (!client.connect(now)) {
+    onMqttConnectFailed();
+  }
+}
+
+void onMqttSession(bool sessionPresent) {
+  onMqttConnected(millis(), millis() - mqttAttemptStartedAt);
+}
+
+void onMqttClosed(int8_t reason) {
+  if (mqttLinkUp) {
+    onMqttLost(millis());
+  } else {
+    onMqttConnectFailed();
+  }
+}
+
+void onMqttPublished(uint32_t latencyUs) {
+  metrics.publish.record(latencyUs);
+  
+  // Acks free outbox room; the backlog follows at the pace they arrive
+  if (sampleStore.pending() > 0) {
+    netScheduler.runIn(replayTaskId, 0, millis());
+  }
+}
+
+void onMqttSecured(uint32_t handshakeUs, bool resumed) {
+  // Wall time, round trips included; resumed ones skip the key exchange
+  (resumed ? metrics.tlsResumedHandshake : metrics.tlsFullHandshake).record(handshakeUs);
+  metrics.tlsSessionSaveFailures = client.tlsSessionSaveFailures();
+  Serial.printf("🔒 TLS %s handshake in %lu ms\n", resumed ? "resumed" : "full",
+                (unsigned long)(handshakeUs / 1000));
+}
+
+void onMqttConnectFailed() {
+  traceEnd(TRACE_MQTT_CONNECT, 0);
+  mqttStats.failures++;
+  mqttStats.lastError = client.lastError();
+  mqttConsecutiveFailures++;
+  onNetworkFault();
+  
+  // A stale association is the usual culprit when the broker stays
+  // unreachable, so bounce WiFi every MQTT_MAX_RETRY_COUNT failures
+  if (mqttConsecutiveFailures % MQTT_MAX_RETRY_COUNT == 0) {
+    Serial.println("🔄 MQTT keeps failing, reconnecting WiFi");
+    WiFi.reconnect();
+  }
+  
+  uint32_t backoff = mqttBackoff();
+  Serial.printf("❌ MQTT connection failed, rc=%d, retry in %lu ms\n",
+                mqttStats.lastError, (unsigned long)backoff);
+  netScheduler.runIn(mqttReconnectTaskId, backoff, millis());
+}
+
+void onNetworkFault() {
+  if (watchdogFault(FAULT_NETWORK) == RECOVERY_RESTART_NETWORK) {
+    restartNetworkStack();
+  }
+}
+
+void restartNetworkStack() {
+  // Full WiFi driver stop and start; MQTT follows through the scheduled
+  // reconnect attempts as usual
+  Serial.println("🔧 Restarting the network stack");
+  client.disconnect();
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin();
+}
+
+void startConfigPortal() {
+  if (configPortal.getConfigPortalActive()) {
+    return;
+  }
+  
+  // Access point next to the station link; MQTT stays up while the
+  // current network is reachable
+  Serial.printf("📶 Config portal open on %s for %d s\n", CONFIG_PORTAL_SSID, CONFIG_PORTAL_TIMEOUT);
+  configPortal.setConfigPortalBlocking(false);
+  configPortal.setConfigPortalTimeout(CONFIG_PORTAL_TIMEOUT);
+  configPortal.startConfigPortal(CONFIG_PORTAL_SSID, CONFIG_PORTAL_PASSWORD);
+  netScheduler.runIn(configPortalTaskId, CONFIG_PORTAL_POLL_INTERVAL, millis());
+}
+
+void configPortalTask() {
+  // Serves pending requests; saving credentials or the timeout closes it
+  configPortal.process();
+  if (configPortal.getConfigPortalActive()) {
+    netScheduler.runIn(configPortalTaskId, CONFIG_PORTAL_POLL_INTERVAL, millis());
+    return;
+  }
+  Serial.println("📶 Config portal closed");
+}
+
+uint32_t mqttBackoff() {
+  // Exponential window with equal jitter: never faster than half the
+  // window, and a fleet dropped by a broker restart drifts apart
+  uint32_t window = MQTT_RECONNECT_INTERVAL;
+  for (uint32_t i = 1; i < mqttConsecutiveFailures && window < MQTT_RECONNECT_MAX_INTERVAL; i++) {
+    window *= 2;
+  }
+  window = min<uint32_t>(window, MQTT_RECONNECT_MAX_INTERVAL);
+  return window / 2 + esp_random() % (window / 2 + 1);
+}
+
+void onMqttConnected(uint32_t now, uint32_t latencyMs) {
+  traceEnd(TRACE_MQTT_CONNECT, 1);
+  mqttLinkUp = true;
+  mqttConsecutiveFailures = 0;
+  watchdogClear(FAULT_NETWORK);
+  mqttStats.connects++;
+  mqttStats.lastLatencyMs = latencyMs;
+  mqttStats.maxLatencyMs = max(mqttStats.maxLatencyMs, latencyMs);
+  mqttStats.lastDowntimeMs = now - mqttDownSince;
+  
+  Serial.printf("✅ MQTT connected in %lu ms!\n", (unsigned long)latencyMs);
+  if (latencyMs <= OTA_HEALTH_MQTT_BUDGET) {
+    otaReportCheck(OTA_CHECK_MQTT);
+  }
+  
+  // Subscribe to command topics; renewed every time in case the broker
+  // dropped the session
+  client.subscribe(topicWaterCommand, MQTT_QOS);
+  client.subscribe(topicConfigCommand, MQTT_QOS);
+  client.subscribe(topicOtaCommand, MQTT_QOS);
+  client.subscribe(topicCalibrateCommand, MQTT_QOS);
+  
+  Serial.printf("📡 Subscribed to: %s\n", topicWaterCommand);
+  Serial.printf("📡 Subscribed to: %s\n", topicConfigCommand);
+  Serial.printf("📡 Subscribed to: %s\n", topicOtaCommand);
+  Serial.printf("📡 Subscribed to: %s\n", topicCalibrateCommand);
+  
+  // Publish online status
+  publishStatus("online");
+  steadyState = true;
+}
+
+void onMqttLost(uint32_t now) {
+  mqttLinkUp = false;
+  mqttDownSince = now;
+  mqttStats.lastError = client.lastError();
+  Serial.printf("📡 MQTT connection lost, rc=%d\n", mqttStats.lastError);
+  
+  // Jitter the first retry as well; the whole fleet lost the broker at once
+  netScheduler.runIn(mqttReconnectTaskId, esp_random() % MQTT_RECONNECT_INTERVAL, now);
+}
+
+void statsTask() {
+  NetworkStats stats = {};
+  stats.mqttConnected = client.connected();
+  stats.mqttAttempts = mqttStats.attempts;
+  stats.mqttFailures = mqttStats.failures;
+  stats.mqttConnects = mqttStats.connects;
+  stats.mqttConnectMs = mqttStats.lastLatencyMs;
+  stats.mqttDowntimeMs = mqttStats.lastDowntimeMs;
+  stats.mqttInFlight = client.inFlight();
+  stats.mqttQueuedBytes = client.queuedBytes();
+  stats.mqttRefused = client.refusedCount();
+  stats.networkJitterMs = netScheduler.maxJitter();
+  stats.samplesPending = sampleStore.pending();
+  stats.samplesDropped = sampleStore.dropped();
+  stats.metrics = metrics;
+  
+  // Single writer: mark the copy in progress, rewrite it, close it
+  uint32_t sequence = statsSequence.load(std::memory_order_relaxed);
+  statsSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  statsCopy = stats;
+  statsSequence.store(sequence + 2, std::memory_order_release);
+}
+
+NetworkStats networkStats() {
+  for (;;) {
+    uint32_t sequence = statsSequence.load(std::memory_order_acquire);
+    if ((sequence & 1) == 0) {
+      NetworkStats stats = statsCopy;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (statsSequence.load(std::memory_order_relaxed) == sequence) {
+        return stats;
+      }
+    }
+    // Mid-refresh; the writer may share our core, so let it finish
+    vTaskDelay(1);
+  }
+}
+
+void addMqttStats(JsonObject mqtt) {
+  mqtt["attempts"] = mqttStats.attempts;
+  mqtt["failures"] = mqttStats.failures;
+  mqtt["connects"] = mqttStats.connects;
+  mqtt["connect_ms"] = mqttStats.lastLatencyMs;
+  mqtt["max_connect_ms"] = mqttStats.maxLatencyMs;
+  mqtt["downtime_ms"] = mqttStats.lastDowntimeMs;
+  mqtt["last_error"] = mqttStats.lastError;
+}
+
+void mqttCallback(char* topic, byte* payload, size_t length) {
+  Serial.printf("📨 Received: %s -> %.*s\n", topic, (int)length, (const char*)payload);
+  
+  // Handle watering commands
+  if (strcmp(topic, topicWaterCommand) == 0) {
+    handleDeviceCommand("water", parseWaterCommand, payload, length);
+  }
+  
+  // Handle calibration steps
+  if (strcmp(topic, topicCalibrateCommand) == 0) {
+    handleDeviceCommand("calibrate", parseCalibrationCommand, payload, length);
+  }
+  
+  // Handle configuration updates
+  if (strcmp(topic, topicConfigCommand) == 0) {
+    handleConfigCommand(payload, length);
+  }
+  
+  // Handle firmware update manifests
+  if (strcmp(topic, topicOtaCommand) == 0) {
+    handleOtaCommand(payload, length);
+  }
+}
+
+void handleDeviceCommand(const char* name, CommandParser parse, byte* payload, unsigned int length) {
+  // Parsed in place inside the link's receive buffer, which the next
+  // packet reuses; keep a copy of the id
+  Command command;
+  const char* error = nullptr;
+  bool valid = parse(rxDoc, (char*)payload, length, command, &error);
+  char requestId[40];
+  strlcpy(requestId, rxDoc["id"] | "", sizeof(requestId));
+  uint64_t expiresAt = rxDoc["expires_at"] | 0ULL;
+  char target[DEVICE_ID_LENGTH];
+  strlcpy(target, rxDoc["device_id"] | deviceId, sizeof(target));
+  
+  if (!valid) {
+    Serial.printf("❌ Invalid %s command: %s\n", name, error);
+    publishCommandAck(requestId, name, "rejected", error);
+    return;
+  }
+  
+  // Queued by the broker while we were offline for too long; only
+  // checkable once the clock is synced
+  if (expiresAt > 0 && timeSynced() && timeEpochMs(millis()) > expiresAt) {
+    Serial.printf("⌛ %s command %s expired\n", name, requestId);
+    publishCommandAck(requestId, name, "expired", nullptr);
+    return;
+  }
+  
+  // A redelivery: the first copy already ran, only the ack was lost
+  if (commandLogSeen(requestId)) {
+    Serial.printf("🔁 %s command %s already handled\n", name, requestId);
+    publishCommandAck(requestId, name, "duplicate", nullptr);
+    return;
+  }
+  
+  // Water commands for a leaf behind this gateway wait for its next
+  // sample and are acked once it has them
+  if (strcmp(target, deviceId) != 0) {
+    uint32_t leaf;
+    if (ESPNOW_ROLE != ESPNOW_ROLE_GATEWAY || parse != parseWaterCommand || !meshLeafId(target, leaf)) {
+      publishCommandAck(requestId, name, "rejected", "unknown device");
+      return;
+    }
+    if (!meshGateway.relay(leaf, command, requestId, expiresAt)) {
+      publishCommandAck(requestId, name, "rejected", "relay queue full");
+      return;
+    }
+    commandLogAdd(requestId);
+    Serial.printf("📡 %s command %s held for %s\n", name, requestId, target);
+    return;
+  }
+  
+  if (!postCommand(command)) {
+    publishCommandAck(requestId, name, "rejected", "queue full");
+    return;
+  }
+  commandLogAdd(requestId);
+  publishCommandAck(requestId, name, "accepted", nullptr);
+}
+
+void publishCommandAck(const char* requestId, const char* command, const char* result, const char* error) {
+  // Acks pair with the backend's pending command by id
+  if (requestId[0] == 0) {
+    return;
+  }
+  
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(millis());
+  doc["request_id"] = requestId;
+  doc["command"] = command;
+  doc["result"] = result;
+  if (error != nullptr) {
+    doc["error"] = error;
+  }
+  
+  if (client.connected()) {
+    publishJson(topicCommandAck);
+  }
+}
+
+void handleConfigCommand(byte* payload, unsigned int length) {
+  DeserializationError error = deserializeJson(rxDoc, (char*)payload, length);
+  if (error) {
+    Serial.printf("❌ Invalid configuration update: %s\n", error.c_str());
+    return;
+  }
+  
+  // The parsed strings live in the link's receive buffer, which the next
+  // packet reuses; keep copies of what the ack echoes
+  char requestId[40];
+  char failedKey[32] = "";
+  strlcpy(requestId, rxDoc["id"] | "", sizeof(requestId));
+  
+  SettingsResult result;
+  if (rxDoc["reset"] | false) {
+    result = settingsReset();
+  } else {
+    JsonObject changes = rxDoc["settings"].as<JsonObject>();
+    const char* rejected = "settings";
+    result = changes.isNull() ? SETTINGS_REJECTED : settingsApply(changes, &rejected);
+    if (result == SETTINGS_REJECTED) {
+      strlcpy(failedKey, rejected, sizeof(failedKey));
+    }
+  }
+  
+  if (result == SETTINGS_APPLIED) {
+    onSettingsChanged();
+  }
+  publishConfigAck(result, failedKey, requestId);
+}
+
+void handleOtaCommand(byte* payload, unsigned int length) {
+  OtaManifest manifest;
+  const char* error = nullptr;
+  if (parseOtaManifest(rxDoc, (char*)payload, length, manifest, &error)) {
+    otaStart(manifest, deviceId, &error);
+  }
+  if (error != nullptr) {
+    Serial.printf("❌ Firmware update rejected: %s\n", error);
+    publishOtaStatus(otaStatus(), error);
+  }
+}
+
+void onSettingsChanged() {
+  RuntimeSettings settings = settingsSnapshot();
+  
+  if (heartbeatTaskId != SCHEDULER_INVALID_TASK && settings.heartbeatInterval != heartbeatInterval) {
+    heartbeatInterval = settings.heartbeatInterval;
+    netScheduler.setPeriod(heartbeatTaskId, heartbeatInterval, millis());
+  }
+  if (settings.metricsInterval != metricsInterval) {
+    metricsInterval = settings.metricsInterval;
+    netScheduler.setPeriod(metricsTaskId, metricsInterval, millis());
+  }
+  
+  // Sampling, thresholds and watering live on the sensing task
+  Command command = {};
+  command.type = COMMAND_SETTINGS_CHANGED;
+  postCommand(command);
+  
+  Serial.printf("⚙️  Settings revision %lu stored\n", (unsigned long)settingsRevision());
+}
+
+void handleEvent(const NetEvent& event) {
+  switch (event.type) {
+    case EVENT_SENSOR_DATA:
+      if (event.data.isValid) {
+        otaReportCheck(OTA_CHECK_SENSORS);
+      }
+      sampleHistory.record(packSample(event.data, event.timestamp, sampleStore.bootId(),
+                                      timeEpochMs(event.timestamp)));
+      if (BATCHING_ACTIVE) {
+        addToBatch(event.data, event.timestamp);
+      } else {
+        publishSensorData(event.data, event.timestamp);
+      }
+      powerSampleHandled();
+      break;
+    case EVENT_SENSOR_AGGREGATE:
+      // Summaries are not buffered; the samples behind them are
+      if (client.connected()) {
+        publishAggregates(event.aggregates, event.timestamp);
+      }
+      break;
+    case EVENT_PUMP_STARTED:
+      publishPumpStatus("started", event.pumpDuration, event.zone, event.timestamp);
+      break;
+    case EVENT_PUMP_STOPPED:
+      publishPumpStatus("stopped", event.pumpDuration, event.zone, event.timestamp);
+      break;
+    case EVENT_WATERING_RESULT:
+      publishWateringResult(event.watering, event.zone, event.timestamp);
+      break;
+    case EVENT_SAMPLE_RATE:
+      publishSampleRate(event.sampleRate, event.timestamp);
+      break;
+    case EVENT_CALIBRATION:
+      publishCalibration(event.calibration, event.timestamp);
+      break;
+    case EVENT_CONFIG_PORTAL:
+      startConfigPortal();
+      break;
+  }
+}
+
+bool publishSensorData(SensorData data, uint32_t timestamp) {
+  traceBegin(TRACE_PUBLISH_SAMPLE);
+  if (client.connected()) {
+    if (publishSample(data, timeEpochMs(timestamp), timestamp, sampleStore.bootId(), false)) {
+      Serial.printf("📊 Sensor data published: T=%.1f°C, H=%.1f%%, M=%d%%, L=%d%%\n", 
+                   data.temperature, data.humidity, data.moisture, data.lightLevel);
+      
+      // LED belongs to the sensing task
+      Command blink = {};
+      blink.type = COMMAND_BLINK;
+      blink.value = 1;
+      blink.interval = 100;
+      postCommand(blink);
+      traceEnd(TRACE_PUBLISH_SAMPLE);
+      return true;
+    }
+    Serial.println("❌ Failed to publish sensor data, buffering");
+  } else {
+    Serial.println("📡 MQTT not connected, buffering sensor data");
+  }
+  
+  // Keep it for replay once the broker is reachable again
+  sampleStore.push(data, timestamp);
+  traceEnd(TRACE_PUBLISH_SAMPLE);
+  return false;
+}
+
+bool publishStoredSample(const StoredSample& sample) {
+  // Samples buffered before the first sync of this boot can be placed now
+  uint64_t epochMs = sampleEpochMs(sample);
+  if (epochMs == 0 && sample.bootId == sampleStore.bootId()) {
+    epochMs = timeEpochMs(sample.timestamp);
+  }
+  return publishSample(unpackSample(sample), epochMs, sample.timestamp, sample.bootId, true);
+}
+
+bool publishSample(const SensorData& data, uint64_t epochMs, uint32_t timestamp, uint16_t bootId, bool replayed) {
+  // Without an epoch time, age lets the backend place replayed samples
+  // from this boot on its own clock
+  bool epoch = epochMs != 0;
+  bool hasAge = replayed && !epoch && bootId == sampleStore.bootId();
+  uint32_t ageMs = hasAge ? millis() - timestamp : 0;
+  
+  TelemetrySample sample = {};
+  sample.timestamp = epoch ? epochMs : timestamp;
+  sample.epoch = epoch;
+  sample.temperature = data.temperature;
+  sample.humidity = data.humidity;
+  sample.moisture = data.moisture;
+  sample.light = data.lightLevel;
+  sample.pumpActive = data.pumpActive;
+  sample.bootId = bootId;
+  sample.replayed = replayed;
+  sample.hasAge = hasAge;
+  sample.ageMs = ageMs;
+  if (!replayed) {
+    sample.wifiRssi = WiFi.RSSI();
+    sample.freeHeap = ESP.getFreeHeap();
+    sample.uptime = millis();
+  }
+  
+#if TELEMETRY_FORMAT == TELEMETRY_FORMAT_PACKED
+  uint8_t frame[TELEMETRY_SAMPLE_FRAME_SIZE];
+  traceBegin(TRACE_PAYLOAD_BUILD);
+  size_t length = encodeSampleFrame(sample, frame, sizeof(frame));
+  traceEnd(TRACE_PAYLOAD_BUILD);
+  return publishFrame(topicData, frame, length);
+#else
+  traceBegin(TRACE_PAYLOAD_BUILD);
+  buildSamplePayload(txDoc, deviceId, sample);
+  if (!replayed) {
+    // The offline store keeps zone 0 only
+    addSampleZones(txDoc, data);
+  }
+  traceEnd(TRACE_PAYLOAD_BUILD);
+  return publishJson(topicData);
+#endif
+}
+
+void replayTask() {
+  // Live traffic first: only drain the backlog while nothing else is
+  // queued, and leave outbox room for what comes next. PUBACKs re-run
+  // this task, so the backlog drains as fast as the broker acks it
+  if (!client.connected() || eventQueue.size() > 0) {
+    return;
+  }
+  
+  StoredSample sample;
+  int sent = 0;
+  while (client.queuedBytes() + SAMPLE_REPLAY_HEADROOM < MQTT_OUTBOX_SIZE && sampleStore.peek(sample)) {
+    if (!publishStoredSample(sample)) {
+      break;
+    }
+    sampleStore.pop();
+    sent++;
+  }
+  
+  if (sent > 0) {
+    Serial.printf("📤 Replayed %d buffered samples, %u pending\n", sent, sampleStore.pending());
+  }
+}
+
+void addToBatch(const SensorData& data, uint32_t timestamp) {
+  TelemetryBatchSample& sample = batchSamples[batchCount++];
+  sample.timestamp = timestamp;
+  sample.temperature = (int16_t)lroundf(data.temperature * 100.0f);
+  sample.humidity = (uint16_t)lroundf(data.humidity * 100.0f);
+  sample.moisture = (uint8_t)constrain(data.moisture, 0, 100);
+  sample.light = (uint8_t)constrain(data.lightLevel, 0, 100);
+  sample.flags = data.pumpActive ? TELEMETRY_FLAG_PUMP_ACTIVE : 0;
+  
+  if (batchCount >= BATCH_MAX_SAMPLES) {
+    batchFlushTask();
+  } else if (batchCount == 1) {
+    // The first sample starts the age window
+    netScheduler.runIn(batchFlushTaskId, BATCH_MAX_AGE, millis());
+  }
+}
+
+void batchFlushTask() {
+  netScheduler.cancel(batchFlushTaskId);
+  if (batchCount == 0) {
+    return;
+  }
+  
+  if (client.connected() && publishBatch()) {
+    Serial.printf("📦 Batch of %d samples published\n", batchCount);
+    Command blink = {};
+    blink.type = COMMAND_BLINK;
+    blink.value = 1;
+    blink.interval = 100;
+    postCommand(blink);
+  } else {
+    // Fall back to store-and-forward, one record per sample
+    Serial.printf("📡 Batch not published, buffering %d samples\n", batchCount);
+    for (uint8_t i = 0; i < batchCount; i++) {
+      const TelemetryBatchSample& sample = batchSamples[i];
+      SensorData data = {};
+      data.temperature = sample.temperature / 100.0f;
+      data.humidity = sample.humidity / 100.0f;
+      data.moisture = sample.moisture;
+      data.lightLevel = sample.light;
+      data.pumpActive = sample.flags & TELEMETRY_FLAG_PUMP_ACTIVE;
+      data.isValid = true;
+      sampleStore.push(data, sample.timestamp);
+    }
+  }
+  
+  batchCount = 0;
+}
+
+bool publishBatch() {
+  uint32_t sentAt = millis();
+  
+  TelemetryHeartbeat heartbeat = { (int8_t)WiFi.RSSI(), ESP.getFreeHeap(), sentAt };
+  bool withHeartbeat = BATCH_INCLUDE_HEARTBEAT;
+  
+  // Samples keep device ms deltas; a synced clock only moves the base
+  uint64_t epochMs = timeEpochMs(batchSamples[0].timestamp);
+  
+#if TELEMETRY_FORMAT == TELEMETRY_FORMAT_PACKED
+  uint8_t frame[TELEMETRY_BATCH_FRAME_SIZE(BATCH_MAX_SAMPLES)];
+  size_t length = encodeBatchFrame(batchSamples, batchCount, sentAt, sampleStore.bootId(), epochMs,
+                                   withHeartbeat ? &heartbeat : nullptr, frame, sizeof(frame));
+  return length > 0 && publishFrame(topicBatch, frame, length);
+#else
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  if (epochMs != 0) {
+    doc["timestamp"] = epochMs;
+    doc["sent_at"] = epochMs + (sentAt - batchSamples[0].timestamp);
+  } else {
+    doc["timestamp"] = batchSamples[0].timestamp;
+    doc["sent_at"] = sentAt;
+    doc["boot_id"] = sampleStore.bootId();
+  }
+  
+  if (withHeartbeat) {
+    doc["heartbeat"]["wifi_rssi"] = heartbeat.wifiRssi;
+    doc["heartbeat"]["free_heap"] = heartbeat.freeHeap;
+    doc["heartbeat"]["uptime"] = heartbeat.uptime;
+    doc["heartbeat"]["min_free_heap"] = ESP.getMinFreeHeap();
+    doc["heartbeat"]["steady_min_free_heap"] = steadyMinFreeHeap;
+  }
+  
+  JsonArray samples = doc.createNestedArray("samples");
+  int32_t delta[5];
+  for (uint8_t i = 0; i < batchCount; i++) {
+    batchSampleDelta(i > 0 ? &batchSamples[i - 1] : nullptr, batchSamples[i], delta);
+    JsonArray row = samples.createNestedArray();
+    for (int field = 0; field < 5; field++) {
+      row.add(delta[field]);
+    }
+    row.add(batchSamples[i].flags);
+  }
+  
+  return publishJson(topicBatch);
+#endif
+}
+
+void serviceMesh(uint32_t now) {
+  uint8_t before = meshGateway.sampleCount();
+  meshGateway.service(now, timeSynced() ? timeEpochMs(now) : 0);
+  
+  RelayOutcome outcome;
+  while (meshGateway.takeOutcome(outcome)) {
+    publishCommandAck(outcome.requestId, "water", outcome.delivered ? "accepted" : "expired", nullptr);
+  }
+  
+  uint8_t count = meshGateway.sampleCount();
+  if (count >= ESPNOW_BATCH_MAX) {
+    netScheduler.runIn(meshFlushTaskId, 0, now);
+  } else if (before == 0 && count > 0) {
+    // The first sample starts the age window, as for batches
+    netScheduler.runIn(meshFlushTaskId, ESPNOW_BATCH_INTERVAL, now);
+  }
+}
+
+void meshFlushTask() {
+  netScheduler.cancel(meshFlushTaskId);
+  uint8_t count = meshGateway.sampleCount();
+  if (count == 0) {
+    return;
+  }
+  
+  // Leaf samples aren't stored; ESPNOW_BATCH_MAX more are kept meanwhile
+  uint32_t now = millis();
+  buildMeshPayload(txDoc, deviceId, meshGateway.samples(), count, now, timeStamp(now));
+  if (client.connected() && publishJson(topicMesh, 1)) {
+    Serial.printf("📡 %d leaf samples published\n", count);
+    meshGateway.clearSamples();
+  } else {
+    netScheduler.runIn(meshFlushTaskId, ESPNOW_BATCH_INTERVAL, now);
+  }
+}
+
+void traceDumpTask() {
+  if (!client.connected()) {
+    traceDumpSerial();
+    return;
+  }
+  
+  // Binary, like packed telemetry; QoS 0 keeps the outbox free for samples
+  static uint8_t frame[TRACE_FRAME_SIZE(TRACE_FRAME_RECORDS)];
+  size_t length;
+  while ((length = traceTakeFrame(frame, sizeof(frame))) > 0) {
+    publishFrame(topicTrace, frame, length, 0);
+  }
+}
+
+void heartbeatTask() {
+  publishHeartbeat();
+}
+
+void metricsTask() {
+  publishMetrics();
+}
+
+void dutyCycleTask() {
+  // The pump cutoff runs on the sensing task; never sleep over it, nor
+  // over a firmware download or an open config portal
+  if (powerPumpActive() || otaBusy() || configPortal.getConfigPortalActive()) {
+    return;
+  }
+  
+  // QoS 1 publishes are only delivered once the broker acked them
+  bool replayDone = !client.connected() || (sampleStore.pending() == 0 && client.queuedBytes() == 0);
+  bool cycleDone = powerSampleDone() && eventQueue.size() == 0 && replayDone;
+  bool budgetSpent = powerAwakeTime() >= AWAKE_BUDGET;
+  if (!cycleDone && !budgetSpent) {
+    return;
+  }
+  
+  // Out of budget: keep whatever is still queued for the next wake
+  NetEvent event;
+  while (eventQueue.pop(event)) {
+    if (event.type == EVENT_SENSOR_DATA) {
+      sampleStore.push(event.data, event.timestamp);
+    }
+  }
+  
+  // A trial image gets its gate evaluated on every wake
+  otaUpdateHealth();
+  
+  client.disconnect();
+  WiFi.disconnect(true);
+  enterDeepSleep();
+}
+
+bool publishAggregates(const SensorAggregates& aggregates, uint32_t timestamp) {
+  buildAggregatePayload(txDoc, deviceId, aggregates, timeStamp(timestamp));
+  bool published = publishJson(topicAggregate);
+  if (published) {
+    Serial.printf("📈 Aggregates published over %u samples\n", aggregates.count);
+  }
+  return published;
+}
+
+void publishHeartbeat() {
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(millis());
+  doc["status"] = "online";
+  doc["wifi_rssi"] = WiFi.RSSI();
+  doc["free_heap"] = ESP.getFreeHeap();
+  doc["min_free_heap"] = ESP.getMinFreeHeap();
+  doc["steady_min_free_heap"] = steadyMinFreeHeap;
+  doc["max_alloc_heap"] = ESP.getMaxAllocHeap();
+  doc["uptime"] = millis();
+  addMqttStats(doc.createNestedObject("mqtt"));
+  
+  if (client.connected()) {
+    publishJson(topicHeartbeat, 0);
+    Serial.println("💓 Heartbeat sent");
+  }
+}
+
+void publishMetrics() {
+  if (!client.connected()) {
+    return;
+  }
+  
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(millis());
+  doc["uptime"] = millis();
+  
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largestBlock = ESP.getMaxAllocHeap();
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["free"] = freeHeap;
+  heap["min_free"] = ESP.getMinFreeHeap();
+  heap["largest_block"] = largestBlock;
+  heap["fragmentation"] = freeHeap > 0 ? 1.0f - (float)largestBlock / freeHeap : 0;
+  
+  // Unused stack, in bytes on the ESP32 port
+  JsonObject stack = doc.createNestedObject("stack_free");
+  stack["network"] = uxTaskGetStackHighWaterMark(networkTaskHandle);
+  stack["sensing"] = uxTaskGetStackHighWaterMark(sensingTaskHandle);
+  
+  JsonObject jitter = doc.createNestedObject("jitter_ms");
+  jitter["network"] = netScheduler.maxJitter();
+  jitter["sensing"] = metrics.sensingJitterMs;
+  
+  JsonObject loop = doc.createNestedObject("loop_us");
+  metrics.networkLoop.toJson(loop.createNestedObject("network"));
+  metrics.sensingLoop.toJson(loop.createNestedObject("sensing"));
+  
+  JsonObject publish = doc.createNestedObject("publish");
+  publish["ok"] = metrics.publishOk;
+  publish["failed"] = metrics.publishFailed;
+  publish["in_flight"] = client.inFlight();
+  publish["queued_bytes"] = client.queuedBytes();
+  publish["refused"] = client.refusedCount();
+  metrics.publish.toJson(publish.createNestedObject("latency_us"));
+  
+  JsonObject sensors = doc.createNestedObject("sensor_us");
+  metrics.dhtRead.toJson(sensors.createNestedObject("dht"));
+  metrics.adcPoll.toJson(sensors.createNestedObject("adc"));
+  doc["dht_checksum_errors"] = metrics.dhtChecksumErrors;
+  doc["dht_timeouts"] = metrics.dhtTimeouts;
+  
+  addMqttStats(doc.createNestedObject("mqtt"));
+  
+  if (ESPNOW_ROLE == ESPNOW_ROLE_GATEWAY) {
+    JsonObject mesh = doc.createNestedObject("mesh");
+    mesh["leaves"] = meshGateway.leafCount();
+    mesh["pending"] = meshGateway.sampleCount();
+    mesh["dropped"] = meshGateway.samplesDropped();
+    mesh["rx_dropped"] = espNow.dropped();
+  }
+  
+#if MQTT_TLS_ENABLED
+  JsonObject tls = doc.createNestedObject("tls_us");
+  metrics.tlsFullHandshake.toJson(tls.createNestedObject("full"));
+  metrics.tlsResumedHandshake.toJson(tls.createNestedObject("resumed"));
+  doc["tls_session_save_failures"] = metrics.tlsSessionSaveFailures;
+#endif
+  
+  publishJson(topicMetrics, 0);
+}
+
+void publishStatus(const char* status) {
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  IPAddress ip = WiFi.localIP();
+  char ipAddress[16];
+  snprintf(ipAddress, sizeof(ipAddress), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(millis());
+  doc["status"] = status;
+  doc["firmware"] = FIRMWARE_VERSION;
+  doc["ota"] = otaStateName(otaStatus().state);
+  doc["ip_address"] = ipAddress;
+  doc["wifi_rssi"] = WiFi.RSSI();
+  doc["local_watering"] = settingsSnapshot().localWatering;
+  doc["zones"] = ZONE_COUNT;
+  doc["config_revision"] = settingsRevision();
+  addMqttStats(doc.createNestedObject("mqtt"));
+  
+  FaultStatus faults = watchdogStatus();
+  JsonObject fault = doc.createNestedObject("faults");
+  fault["reset_reason"] = faults.resetReason;
+  fault["boots"] = faults.boots;
+  fault["crashes"] = faults.crashes;
+  fault["consecutive_crashes"] = faults.consecutiveCrashes;
+  if (faults.stalledTask != nullptr) {
+    fault["stalled_task"] = faults.stalledTask;
+  }
+  if (faults.rebootCause != nullptr) {
+    fault["reboot_cause"] = faults.rebootCause;
+  }
+  JsonObject recoveries = fault.createNestedObject("recoveries");
+  for (uint8_t action = RECOVERY_RESET_SENSORS; action < RECOVERY_ACTION_COUNT; action++) {
+    recoveries[recoveryActionName((RecoveryAction)action)] = faults.recoveries[action];
+  }
+  
+  TimeSyncStatus time = timeSyncStatus();
+  JsonObject clock = doc.createNestedObject("time");
+  clock["synced"] = time.synced;
+  if (time.synced) {
+    clock["syncs"] = time.syncCount;
+    clock["since_sync_ms"] = time.sinceSyncMs;
+    clock["drift_ppm"] = time.driftPpm;
+    clock["correction_ms"] = time.lastCorrectionMs;
+  }
+  
+  if (DEEP_SLEEP_ENABLED) {
+    // Previous cycle's figures; this wake is still running
+    doc["wake_count"] = dutyState.wakeCount;
+    doc["wake_cause"] = wakeCauseName();
+    doc["last_awake_ms"] = dutyState.lastAwakeMs;
+    doc["max_awake_ms"] = dutyState.maxAwakeMs;
+    doc["budget_overruns"] = dutyState.budgetOverruns;
+  }
+  
+  if (client.connected()) {
+    publishJson(topicStatus);
+    Serial.printf("📡 Status published: %s\n", status);
+  }
+}
+
+void publishPumpStatus(const char* action, int duration, uint8_t zone, uint32_t timestamp) {
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(timestamp);
+  doc["zone"] = zone;
+  doc["action"] = action;
+  doc["duration"] = duration;
+  doc["pump_active"] = strcmp(action, "started") == 0;
+  
+  if (client.connected()) {
+    publishJson(topicPump);
+    Serial.printf("💧 Pump status published: zone %u %s (%dms)\n", zone, action, duration);
+  }
+}
+
+void publishWateringResult(const WateringResult& result, uint8_t zone, uint32_t timestamp) {
+  buildWateringPayload(txDoc, deviceId, zone, result, timeStamp(timestamp));
+  if (client.connected() && publishJson(topicWatering)) {
+    Serial.printf("🌱 Watering result published: %s\n", wateringOutcomeName(result.outcome));
+  }
+}
+
+void publishSampleRate(const SampleRateChange& change, uint32_t timestamp) {
+  buildSampleRatePayload(txDoc, deviceId, change, timeStamp(timestamp));
+  if (client.connected() && publishJson(topicSampleRate)) {
+    Serial.printf("⏱️  Sample rate published: %s, %lu ms\n", sampleModeName(change.mode),
+                  (unsigned long)change.intervalMs);
+  }
+}
+
+void publishCalibration(const CalibrationReport& report, uint32_t timestamp) {
+  buildCalibrationPayload(txDoc, deviceId, report, timeStamp(timestamp));
+  if (client.connected() && publishJson(topicCalibration)) {
+    Serial.printf("📐 Calibration result published: %s\n", calibrationResultName(report.result));
+  }
+}
+
+void publishConfigAck(SettingsResult result, const char* error, const char* requestId) {
+  static const char* const results[] = { "applied", "unchanged", "rejected" };
+  
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(millis());
+  if (requestId[0] != 0) {
+    doc["request_id"] = requestId;
+  }
+  doc["result"] = results[result];
+  if (error[0] != 0) {
+    doc["error"] = error;
+  }
+  doc["revision"] = settingsRevision();
+  settingsToJson(settingsSnapshot(), doc.createNestedObject("settings"));
+  
+  if (client.connected() && publishJson(topicConfigAck)) {
+    Serial.printf("📝 Configuration %s\n", results[result]);
+  }
+}
+
+void otaStatusTask() {
+  otaUpdateHealth();
+  
+  OtaStatus ota = otaStatus();
+  uint8_t tenth = ota.size > 0 ? (uint8_t)((uint64_t)ota.bytes * 10 / ota.size) : 0;
+  bool changed = ota.state != otaReportedState || ota.checksPassed != otaReportedChecks ||
+                 (ota.state == OTA_DOWNLOADING && tenth != otaReportedTenth);
+  if (!changed || !client.connected() || !publishOtaStatus(ota, nullptr)) {
+    return;
+  }
+  
+  otaReportedState = ota.state;
+  otaReportedChecks = ota.checksPassed;
+  otaReportedTenth = tenth;
+  
+  // Outcomes are reported once, then the record is cleared
+  if (ota.state == OTA_VALIDATED || ota.state == OTA_ROLLED_BACK || ota.state == OTA_FAILED) {
+    otaAcknowledge();
+    otaReportedState = OTA_IDLE;
+  }
+}
+
+bool publishOtaStatus(const OtaStatus& ota, const char* rejected) {
+  JsonDocument& doc = txDoc;
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timeStamp(millis());
+  doc["state"] = otaStateName(ota.state);
+  doc["running"] = FIRMWARE_VERSION;
+  if (ota.version[0] != 0) {
+    doc["version"] = ota.version;
+  }
+  if (ota.state == OTA_DOWNLOADING) {
+    doc["bytes"] = ota.bytes;
+    doc["size"] = ota.size;
+  }
+  if (ota.state == OTA_TRIAL) {
+    JsonObject checks = doc.createNestedObject("checks");
+    checks["sensors"] = (ota.checksPassed & OTA_CHECK_SENSORS) != 0;
+    checks["mqtt"] = (ota.checksPassed & OTA_CHECK_MQTT) != 0;
+    checks["loop"] = (ota.checksPassed & OTA_CHECK_LOOP) != 0;
+  }
+  if (ota.error[0] != 0) {
+    doc["error"] = ota.error;
+  }
+  if (rejected != nullptr) {
+    doc["rejected"] = rejected;
+  }
+  
+  bool published = client.connected() && publishJson(topicOta);
+  if (published) {
+    Serial.printf("🆕 OTA status published: %s\n", otaStateName(ota.state));
+  }
+  return published;
+}
+
+bool publishJson(const char* topic, uint8_t qos) {
+  // Serialize straight into the static buffer; oversize documents are
+  // refused rather than truncated
+  traceBegin(TRACE_JSON_SERIALIZE);
+  size_t length = measureJson(txDoc);
+  if (txDoc.overflowed() || length >= sizeof(txBuffer)) {
+    traceEnd(TRACE_JSON_SERIALIZE);
+    Serial.printf("❌ Payload for %s too large (%u bytes)\n", topic, (unsigned)length);
+    return false;
+  }
+  
+  serializeJson(txDoc, txBuffer, sizeof(txBuffer));
+  traceEnd(TRACE_JSON_SERIALIZE, length);
+  return publishFrame(topic, (const uint8_t*)txBuffer, length, qos);
+}
+
+bool publishFrame(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+  // Every publish goes through here, JSON or binary, so the metrics
+  // count them all
+  traceBegin(TRACE_MQTT_PUBLISH);
+  bool published = client.publish(topic, payload, length, qos);
+  traceEnd(TRACE_MQTT_PUBLISH, length);
+  if (published) {
+    metrics.publishOk++;
+  } else {
+    metrics.publishFailed++;
+  }
+  updateHeapWatermark();
+  return published;
+}
+
+void updateHeapWatermark() {
+  if (!steadyState) {
+    return;
+  }
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < steadyMinFreeHeap) {
+    steadyMinFreeHeap = freeHeap;
+  }
+}
+
+#endif // ESPNOW_ROLE != ESPNOW_ROLE_LEAF
@@ -0,0 +1,39 @@
+/**
+ * PlanetPlant ESP32 Network Task
+ * Owns WiFi and the MQTT client; runs pinned to NETWORK_TASK_CORE
+ */
+
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <Arduino.h>
+#include "metrics.h"
+
+extern char deviceId[];
+
+// Network task figures for readers on other tasks (http_server.h). The
+// network task refreshes one copy every HTTP_STATS_INTERVAL under a
+// sequence counter; networkStats() returns a whole refresh, never a torn
+// one. The sensing task histograms in it are taken as on evt/metrics.
+struct NetworkStats {
+  bool mqttConnected;
+  uint32_t mqttAttempts;
+  uint32_t mqttFailures;
+  uint32_t mqttConnects;
+  uint32_t mqttConnectMs;       // Last successful connect
+  uint32_t mqttDowntimeMs;      // Last outage
+  uint8_t mqttInFlight;
+  uint32_t mqttQueuedBytes;
+  uint32_t mqttRefused;
+  uint32_t networkJitterMs;
+  uint32_t samplesPending;      // Offline store backlog
+  uint32_t samplesDropped;
+  FirmwareMetrics metrics;
+};
+
+void setupWiFi();
+void setupMQTT();
+void startNetworkTask();
+NetworkStats networkStats();
+
+#endif // NETWORK_H
@@ -0,0 +1,463 @@
+/**
+ * PlanetPlant ESP32 OTA Updates
+ * The trial record ("ota" NVS namespace) survives the reboot into the new
+ * slot and the rollback out of it, so both images know how the update
+ * went. Rollback goes through the bootloader when it was built with
+ * CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE (the image is then still pending
+ * verification), otherwise the boot slot is switched back directly.
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#if CONFIG_IDF_TARGET_ESP32C3
+#include <esp32c3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+#include "config.h"
+#include "power.h"
+#include "metrics.h"
+#include "ota_update.h"
+#include "fnv1a.h"
+
+#define OTA_NAMESPACE       "ota"
+#define OTA_KEY             "record"
+#define OTA_LAYOUT          1
+#define OTA_BUFFER_SIZE     1024
+#define OTA_REBOOT_DELAY    2000      // Lets the network task publish "rebooting"
+#define OTA_PUMP_WAIT       600000    // Longest wait for a watering cycle to end
+
+struct OtaRecord {
+  uint8_t layout;
+  OtaState state;                   // OTA_TRIAL, OTA_VALIDATED or OTA_ROLLED_BACK
+  uint8_t boots;                    // Boots of the trial image so far
+  char version[OTA_VERSION_LENGTH];
+  char partition[17];               // Label of the trial slot
+  char error[OTA_ERROR_LENGTH];
+};
+
+// Zlib stream inflated with the ROM copy of miniz into a 32 KB ring,
+// allocated for the duration of one download only
+struct Inflater {
+  tinfl_decompressor decompressor;
+  uint8_t window[TINFL_LZ_DICT_SIZE];
+  size_t position;
+  tinfl_status result;
+};
+
+struct ImageWriter {
+  uint32_t written;
+  uint32_t size;
+  mbedtls_sha256_context sha;
+};
+
+static OtaStatus status = {};
+static portMUX_TYPE otaLock = portMUX_INITIALIZER_UNLOCKED;
+static OtaManifest manifest;
+static uint32_t startDelay = 0;
+static TaskHandle_t otaTaskHandle = nullptr;
+static uint8_t buffer[OTA_BUFFER_SIZE];
+
+// Arduino validates a pending image right after boot unless told that
+// the application will decide
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+static bool loadRecord(OtaRecord& record) {
+  Preferences prefs;
+  if (!prefs.begin(OTA_NAMESPACE, true)) {
+    return false;
+  }
+  size_t length = prefs.getBytes(OTA_KEY, &record, sizeof(record));
+  prefs.end();
+  return length == sizeof(record) && record.layout == OTA_LAYOUT;
+}
+
+static void saveRecord(const OtaRecord& record) {
+  Preferences prefs;
+  if (prefs.begin(OTA_NAMESPACE, false)) {
+    prefs.putBytes(OTA_KEY, &record, sizeof(record));
+    prefs.end();
+  }
+}
+
+static void clearRecord() {
+  Preferences prefs;
+  if (prefs.begin(OTA_NAMESPACE, false)) {
+    prefs.remove(OTA_KEY);
+    prefs.end();
+  }
+}
+
+static void setStatus(OtaState state, const char* error) {
+  portENTER_CRITICAL(&otaLock);
+  status.state = state;
+  strlcpy(status.error, error, sizeof(status.error));
+  portEXIT_CRITICAL(&otaLock);
+}
+
+static void setProgress(uint32_t bytes) {
+  portENTER_CRITICAL(&otaLock);
+  status.bytes = bytes;
+  portEXIT_CRITICAL(&otaLock);
+}
+
+static void setCheck(uint8_t check) {
+  portENTER_CRITICAL(&otaLock);
+  status.checksPassed |= check;
+  portEXIT_CRITICAL(&otaLock);
+}
+
+static void rollBack(OtaRecord& record, const char* reason) __attribute__((noreturn));
+
+static void rollBack(OtaRecord& record, const char* reason) {
+  Serial.printf("⚠️  Firmware %s failed its health gate (%s), rolling back\n", record.version, reason);
+  record.state = OTA_ROLLED_BACK;
+  strlcpy(record.error, reason, sizeof(record.error));
+  saveRecord(record);
+  Serial.flush();
+
+  esp_ota_img_states_t imageState;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &imageState) == ESP_OK &&
+      imageState == ESP_OTA_IMG_PENDING_VERIFY) {
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+  }
+  esp_ota_set_boot_partition(esp_ota_get_next_update_partition(nullptr));
+  esp_restart();
+}
+
+void otaBegin() {
+  OtaRecord record;
+  if (!loadRecord(record)) {
+    return;
+  }
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  if (record.state == OTA_TRIAL && strcmp(running->label, record.partition) != 0) {
+    // The bootloader gave up on the image before it was confirmed
+    record.state = OTA_ROLLED_BACK;
+    strlcpy(record.error, "boot failed", sizeof(record.error));
+    saveRecord(record);
+  }
+
+  if (record.state == OTA_TRIAL) {
+    // Duty-cycle wakes count too: each one is a chance to pass the gate
+    record.boots++;
+    if (record.boots > OTA_TRIAL_BOOTS) {
+      rollBack(record, "no healthy boot");
+    }
+    saveRecord(record);
+    Serial.printf("🧪 Firmware %s on trial, boot %u of %u\n", record.version, record.boots, OTA_TRIAL_BOOTS);
+  }
+
+  strlcpy(status.version, record.version, sizeof(status.version));
+  setStatus(record.state, record.error);
+}
+
+static uint32_t deviceSlot(const char* deviceId, uint32_t windowMs) {
+  // Hashed device id: the same device always takes the same slot
+  return windowMs > 0 ? fnv1a32(deviceId) % windowMs : 0;
+}
+
+static bool writeImage(ImageWriter& writer, const uint8_t* data, size_t length, char* error) {
+  if (writer.written + length > writer.size) {
+    strlcpy(error, "image larger than manifest", OTA_ERROR_LENGTH);
+    return false;
+  }
+  if (Update.write((uint8_t*)data, length) != length) {
+    strlcpy(error, Update.errorString(), OTA_ERROR_LENGTH);
+    return false;
+  }
+  mbedtls_sha256_update_ret(&writer.sha, data, length);
+  writer.written += length;
+  setProgress(writer.written);
+  return true;
+}
+
+static bool inflateChunk(Inflater& inflater, ImageWriter& writer, const uint8_t* data, size_t length,
+                         char* error) {
+  do {
+    size_t in = length;
+    size_t out = TINFL_LZ_DICT_SIZE - inflater.position;
+    inflater.result = tinfl_decompress(&inflater.decompressor, data, &in, inflater.window,
+                                       inflater.window + inflater.position, &out,
+                                       TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+    data += in;
+    length -= in;
+
+    if (out > 0) {
+      if (!writeImage(writer, inflater.window + inflater.position, out, error)) {
+        return false;
+      }
+      inflater.position = (inflater.position + out) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+    if (inflater.result < TINFL_STATUS_DONE) {
+      strlcpy(error, "corrupt zlib stream", OTA_ERROR_LENGTH);
+      return false;
+    }
+  } while (inflater.result == TINFL_STATUS_HAS_MORE_OUTPUT ||
+           (length > 0 && inflater.result != TINFL_STATUS_DONE));
+  return true;
+}
+
+static bool digestMatches(ImageWriter& writer, const char* expected) {
+  uint8_t digest[32];
+  mbedtls_sha256_finish_ret(&writer.sha, digest);
+  char hex[OTA_SHA256_LENGTH];
+  for (int i = 0; i < 32; i++) {
+    snprintf(hex + i * 2, 3, "%02x", digest[i]);
+  }
+  return strcasecmp(hex, expected) == 0;
+}
+
+static bool downloadImage(char* error) {
+  WiFiClient plain;
+  WiFiClientSecure secure;
+  bool https = strncmp(manifest.url, "https://", 8) == 0;
+  if (https) {
+#ifdef OTA_ROOT_CA
+    secure.setCACert(OTA_ROOT_CA);
+#else
+    // Integrity still comes from the SHA-256 in the manifest
+    secure.setInsecure();
+#endif
+  }
+
+  HTTPClient http;
+  http.setTimeout(OTA_HTTP_TIMEOUT);
+  if (!http.begin(https ? (WiFiClient&)secure : plain, manifest.url)) {
+    strlcpy(error, "bad url", OTA_ERROR_LENGTH);
+    return false;
+  }
+  int code = http.GET();
+  int remaining = http.getSize();
+  if (code != HTTP_CODE_OK || remaining <= 0) {
+    snprintf(error, OTA_ERROR_LENGTH, code == HTTP_CODE_OK ? "no content length" : "http %d", code);
+    http.end();
+    return false;
+  }
+
+  Inflater* inflater = nullptr;
+  if (manifest.compressed) {
+    inflater = (Inflater*)malloc(sizeof(Inflater));
+    if (inflater == nullptr) {
+      strlcpy(error, "no memory for inflater", OTA_ERROR_LENGTH);
+      http.end();
+      return false;
+    }
+    tinfl_init(&inflater->decompressor);
+    inflater->position = 0;
+    inflater->result = TINFL_STATUS_NEEDS_MORE_INPUT;
+  }
+
+  ImageWriter writer = {};
+  writer.size = manifest.size;
+  mbedtls_sha256_init(&writer.sha);
+  mbedtls_sha256_starts_ret(&writer.sha, 0);
+
+  bool ok = Update.begin(manifest.size);
+  if (!ok) {
+    strlcpy(error, Update.errorString(), OTA_ERROR_LENGTH);
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  uint32_t lastData = millis();
+  while (ok && remaining > 0) {
+    size_t available = stream->available();
+    if (available == 0) {
+      if (!http.connected() || millis() - lastData > OTA_HTTP_TIMEOUT) {
+        strlcpy(error, "download stalled", OTA_ERROR_LENGTH);
+        ok = false;
+      }
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+
+    size_t length = stream->readBytes(buffer, min(available, min(sizeof(buffer), (size_t)remaining)));
+    remaining -= length;
+    lastData = millis();
+    ok = inflater != nullptr ? inflateChunk(*inflater, writer, buffer, length, error)
+                             : writeImage(writer, buffer, length, error);
+  }
+  http.end();
+
+  if (ok && inflater != nullptr && inflater->result != TINFL_STATUS_DONE) {
+    strlcpy(error, "truncated zlib stream", OTA_ERROR_LENGTH);
+    ok = false;
+  }
+  if (ok && writer.written != writer.size) {
+    strlcpy(error, "image shorter than manifest", OTA_ERROR_LENGTH);
+    ok = false;
+  }
+  if (ok && !digestMatches(writer, manifest.sha256)) {
+    strlcpy(error, "sha256 mismatch", OTA_ERROR_LENGTH);
+    ok = false;
+  }
+  mbedtls_sha256_free(&writer.sha);
+  free(inflater);
+
+  // end() switches the boot slot, so only a verified image gets that far
+  if (!ok) {
+    Update.abort();
+    return false;
+  }
+  if (!Update.end()) {
+    strlcpy(error, Update.errorString(), OTA_ERROR_LENGTH);
+    return false;
+  }
+  return true;
+}
+
+static void otaTask(void* parameter) {
+  vTaskDelay(pdMS_TO_TICKS(startDelay));
+
+  // The slot Update writes to, and the one the trial will run from
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  setStatus(OTA_DOWNLOADING, "");
+  Serial.printf("⬇️  Downloading firmware %s (%lu bytes%s)\n", manifest.version,
+                (unsigned long)manifest.size, manifest.compressed ? ", zlib" : "");
+
+  char error[OTA_ERROR_LENGTH] = "";
+  uint32_t started = millis();
+  if (!downloadImage(error)) {
+    Serial.printf("❌ Firmware update failed: %s\n", error);
+    setStatus(OTA_FAILED, error);
+    otaTaskHandle = nullptr;
+    vTaskDelete(nullptr);
+    return;
+  }
+  Serial.printf("✅ Firmware %s written to %s in %lu ms\n", manifest.version, target->label,
+                (unsigned long)(millis() - started));
+
+  OtaRecord record = {};
+  record.layout = OTA_LAYOUT;
+  record.state = OTA_TRIAL;
+  strlcpy(record.version, manifest.version, sizeof(record.version));
+  strlcpy(record.partition, target->label, sizeof(record.partition));
+  saveRecord(record);
+  setStatus(OTA_REBOOTING, "");
+
+  // Never cut a watering cycle short for a reboot
+  vTaskDelay(pdMS_TO_TICKS(OTA_REBOOT_DELAY));
+  uint32_t waitStarted = millis();
+  while (powerPumpActive() && millis() - waitStarted < OTA_PUMP_WAIT) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+  esp_restart();
+}
+
+bool otaStart(const OtaManifest& update, const char* deviceId, const char** error) {
+  OtaState state = otaStatus().state;
+  if (otaTaskHandle != nullptr || state == OTA_REBOOTING) {
+    *error = "update in progress";
+    return false;
+  }
+  if (state == OTA_TRIAL) {
+    *error = "running image on trial";
+    return false;
+  }
+  if (strcmp(update.version, FIRMWARE_VERSION) == 0) {
+    *error = "already installed";
+    return false;
+  }
+
+  manifest = update;
+  // Duty-cycle wakes are too short to wait out a window; they go at once
+  startDelay = DEEP_SLEEP_ENABLED ? 0 : deviceSlot(deviceId, manifest.windowMs);
+
+  portENTER_CRITICAL(&otaLock);
+  strlcpy(status.version, manifest.version, sizeof(status.version));
+  status.bytes = 0;
+  status.size = manifest.size;
+  status.checksPassed = 0;
+  portEXIT_CRITICAL(&otaLock);
+  setStatus(OTA_SCHEDULED, "");
+
+  if (xTaskCreatePinnedToCore(otaTask, "ota", OTA_TASK_STACK, nullptr, OTA_TASK_PRIORITY,
+                              &otaTaskHandle, NETWORK_TASK_CORE) != pdPASS) {
+    otaTaskHandle = nullptr;
+    setStatus(OTA_FAILED, "no memory for task");
+    *error = "no memory for task";
+    return false;
+  }
+  Serial.printf("📅 Firmware %s scheduled in %lu ms\n", manifest.version, (unsigned long)startDelay);
+  return true;
+}
+
+void otaReportCheck(OtaCheck check) {
+  if (otaStatus().state == OTA_TRIAL) {
+    setCheck(check);
+  }
+}
+
+void otaUpdateHealth() {
+  OtaStatus current = otaStatus();
+  if (current.state != OTA_TRIAL) {
+    return;
+  }
+
+  // Latency maxima only grow, so an overrun fails the gate right away;
+  // within budget counts once the sensing task has produced a sample
+  const char* failure = nullptr;
+  if (metrics.sensingLoop.maxMicros() > OTA_HEALTH_LOOP_BUDGET ||
+      metrics.sensingJitterMs > OTA_HEALTH_JITTER_BUDGET) {
+    failure = "loop latency";
+  } else if (current.checksPassed & OTA_CHECK_SENSORS) {
+    setCheck(OTA_CHECK_LOOP);
+    current.checksPassed |= OTA_CHECK_LOOP;
+  }
+  if (failure == nullptr && current.checksPassed != OTA_CHECKS_ALL && millis() >= OTA_HEALTH_TIMEOUT) {
+    failure = (current.checksPassed & OTA_CHECK_SENSORS) ? "no mqtt" : "no sensor data";
+  }
+  if (failure == nullptr && current.checksPassed != OTA_CHECKS_ALL) {
+    return;
+  }
+
+  OtaRecord record;
+  if (!loadRecord(record)) {
+    return;
+  }
+  if (failure != nullptr) {
+    rollBack(record, failure);
+  }
+
+  esp_ota_mark_app_valid_cancel_rollback();
+  record.state = OTA_VALIDATED;
+  saveRecord(record);
+  setStatus(OTA_VALIDATED, "");
+  Serial.printf("✅ Firmware %s passed its health gate\n", record.version);
+}
+
+bool otaBusy() {
+  OtaState state = otaStatus().state;
+  return state == OTA_SCHEDULED || state == OTA_DOWNLOADING || state == OTA_REBOOTING;
+}
+
+OtaStatus otaStatus() {
+  portENTER_CRITICAL(&otaLock);
+  OtaStatus copy = status;
+  portEXIT_CRITICAL(&otaLock);
+  return copy;
+}
+
+const char* otaStateName(OtaState state) {
+  static const char* const names[] = {
+    "idle", "scheduled", "downloading", "rebooting", "failed", "trial", "validated", "rolled_back"
+  };
+  return names[state];
+}
+
+void otaAcknowledge() {
+  OtaState state = otaStatus().state;
+  if (state == OTA_VALIDATED || state == OTA_ROLLED_BACK || state == OTA_FAILED) {
+    clearRecord();
+    setStatus(OTA_IDLE, "");
+  }
+}
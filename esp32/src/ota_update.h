@@ -0,0 +1,88 @@
+/**
+ * PlanetPlant ESP32 OTA Updates
+ * Pull-based: the backend publishes a manifest on cmd/ota, the
+ * device waits a per-device share of the manifest's stagger window, then
+ * streams the image over HTTP(S) into the inactive A/B app slot
+ * (partitions.csv), inflating zlib-compressed images on the fly and
+ * checking the SHA-256 of the result before switching slots.
+ *
+ * A new image boots on trial. It is marked valid only once every health
+ * check has passed within OTA_HEALTH_TIMEOUT of a boot: a valid sensor
+ * sample, an MQTT connect within OTA_HEALTH_MQTT_BUDGET and sensing loop
+ * latency and jitter within budget. A failed gate, or OTA_TRIAL_BOOTS
+ * boots without passing, switches back to the previous slot.
+ *
+ * The download runs on its own task; everything else is network task only.
+ */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OTA_VERSION_LENGTH  24
+#define OTA_URL_LENGTH      160
+#define OTA_SHA256_LENGTH   65      // Hex digest plus terminator
+#define OTA_ERROR_LENGTH    48
+
+struct OtaManifest {
+  char version[OTA_VERSION_LENGTH];
+  char url[OTA_URL_LENGTH];
+  char sha256[OTA_SHA256_LENGTH];   // Of the decompressed image
+  uint32_t size;                    // Decompressed image size (bytes)
+  bool compressed;                  // "encoding": "zlib"
+  uint32_t windowMs;                // Stagger window
+};
+
+enum OtaState : uint8_t {
+  OTA_IDLE,
+  OTA_SCHEDULED,      // Waiting for this device's slot in the window
+  OTA_DOWNLOADING,
+  OTA_REBOOTING,      // Image verified, waiting for the pumps to stop
+  OTA_FAILED,         // Download or verification failed; still on the old image
+  OTA_TRIAL,          // Running a new image that has not passed the gate yet
+  OTA_VALIDATED,
+  OTA_ROLLED_BACK     // Back on the previous image, see error
+};
+
+// Health gate checks, reported by the network task as they pass
+enum OtaCheck : uint8_t {
+  OTA_CHECK_SENSORS = 0x01,
+  OTA_CHECK_MQTT    = 0x02,
+  OTA_CHECK_LOOP    = 0x04,
+  OTA_CHECKS_ALL    = 0x07
+};
+
+struct OtaStatus {
+  OtaState state;
+  char version[OTA_VERSION_LENGTH];   // Target image, or the trial image
+  uint32_t bytes;                     // Image bytes written so far
+  uint32_t size;
+  uint8_t checksPassed;               // OtaCheck bits, during a trial
+  char error[OTA_ERROR_LENGTH];
+};
+
+// Call early in setup(): counts trial boots and rolls back a crash-looping
+// image before anything else can go wrong.
+void otaBegin();
+
+// Start an update; false with *error set when one is running, the image
+// is already installed or the running image is still on trial.
+bool otaStart(const OtaManifest& manifest, const char* deviceId, const char** error);
+
+void otaReportCheck(OtaCheck check);
+
+// Network task, every OTA_STATUS_INTERVAL: evaluates the health gate.
+void otaUpdateHealth();
+
+// Keep the duty cycle awake while an update is in flight.
+bool otaBusy();
+
+OtaStatus otaStatus();
+const char* otaStateName(OtaState state);
+
+// Trial outcome has been published; back to idle.
+void otaAcknowledge();
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,295 @@
+/**
+ * PlanetPlant ESP32 Payloads
+ */
+
+#include "payloads.h"
+#include "sample_rate.h"
+#include "calibration.h"
+
+static const char* const channelNames[CHANNEL_COUNT] = { "temperature", "humidity", "moisture", "light" };
+static const char* const outcomeNames[] = { "target_reached", "pulse_limit", "time_limit", "aborted" };
+static const char* const calibrationResultNames[] = {
+  "capturing", "captured", "reset", "unstable", "no_signal", "not_monotonic", "curve_full", "busy", "storage_failed"
+};
+
+void buildSamplePayload(JsonDocument& doc, const char* deviceId, const TelemetrySample& sample) {
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = sample.timestamp;
+  doc["sensors"]["temperature"] = sample.temperature;
+  doc["sensors"]["humidity"] = sample.humidity;
+  doc["sensors"]["moisture"] = sample.moisture;
+  doc["sensors"]["light"] = sample.light;
+  doc["sensors"]["pump_active"] = sample.pumpActive;
+  
+  if (sample.replayed) {
+    if (!sample.epoch) {
+      doc["boot_id"] = sample.bootId;
+    }
+    doc["replayed"] = true;
+    if (sample.hasAge) {
+      doc["age_ms"] = sample.ageMs;
+    }
+  } else {
+    doc["status"]["wifi_rssi"] = sample.wifiRssi;
+    doc["status"]["free_heap"] = sample.freeHeap;
+    doc["status"]["uptime"] = sample.uptime;
+  }
+}
+
+void addSampleZones(JsonDocument& doc, const SensorData& data) {
+  if (ZONE_COUNT < 2) {
+    return;
+  }
+  
+  JsonArray zones = doc.createNestedArray("zones");
+  for (int i = 0; i < ZONE_COUNT; i++) {
+    JsonObject zone = zones.createNestedObject();
+    zone["moisture"] = data.zoneMoisture[i];
+    zone["pump_active"] = (data.zonePumps & (1 << i)) != 0;
+  }
+}
+
+void buildAggregatePayload(JsonDocument& doc, const char* deviceId,
+                           const SensorAggregates& aggregates, uint64_t timestamp) {
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timestamp;
+  doc["window_ms"] = aggregates.windowMs;
+  doc["count"] = aggregates.count;
+  
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    JsonObject channel = doc.createNestedObject(channelNames[i]);
+    channel["min"] = aggregates.channels[i].min;
+    channel["max"] = aggregates.channels[i].max;
+    channel["mean"] = aggregates.channels[i].mean;
+    channel["slope"] = aggregates.channels[i].slope;
+  }
+}
+
+void buildWateringPayload(JsonDocument& doc, const char* deviceId, uint8_t zone,
+                          const WateringResult& result, uint64_t timestamp) {
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timestamp;
+  doc["zone"] = zone;
+  doc["trigger"] = "local";
+  doc["outcome"] = wateringOutcomeName(result.outcome);
+  doc["pulses"] = result.pulses;
+  doc["pump_ms"] = result.pumpMs;
+  doc["elapsed_ms"] = result.elapsedMs;
+  doc["moisture_start"] = result.startMoisture;
+  doc["moisture_end"] = result.endMoisture;
+}
+
+const char* wateringOutcomeName(WateringOutcome outcome) {
+  return outcomeNames[outcome];
+}
+
+void buildSampleRatePayload(JsonDocument& doc, const char* deviceId,
+                            const SampleRateChange& change, uint64_t timestamp) {
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timestamp;
+  doc["mode"] = sampleModeName(change.mode);
+  doc["interval_ms"] = change.intervalMs;
+  if (change.previousMs != 0) {
+    doc["previous_interval_ms"] = change.previousMs;
+  }
+  doc["moisture_rate"] = change.moistureRate;
+  if (change.batteryMv >= 0) {
+    doc["battery_mv"] = change.batteryMv;
+  }
+}
+
+void buildCalibrationPayload(JsonDocument& doc, const char* deviceId,
+                             const CalibrationReport& report, uint64_t timestamp) {
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timestamp;
+  if (report.channel == CALIBRATION_CHANNEL_LIGHT) {
+    doc["sensor"] = "light";
+  } else {
+    doc["sensor"] = "moisture";
+    doc["zone"] = report.channel;
+  }
+  doc["result"] = calibrationResultName(report.result);
+  if (report.target >= 0) {
+    doc["target"] = report.target;
+  }
+  if (report.millivolts > 0) {
+    doc["millivolts"] = report.millivolts;
+    doc["spread_mv"] = report.spreadMv;
+  }
+  
+  // [[mV, %], ...] in ascending mV
+  JsonArray curve = doc.createNestedArray("curve");
+  for (uint8_t i = 0; i < report.pointCount; i++) {
+    JsonArray point = curve.createNestedArray();
+    point.add(report.points[i].millivolts);
+    point.add(report.points[i].value);
+  }
+}
+
+const char* calibrationResultName(CalibrationResult result) {
+  return calibrationResultNames[result];
+}
+
+void buildMeshPayload(JsonDocument& doc, const char* deviceId, const MeshSample* samples, uint8_t count,
+                      uint32_t now, uint64_t timestamp) {
+  doc.clear();
+  
+  doc["device_id"] = deviceId;
+  doc["timestamp"] = timestamp;
+  
+  JsonArray rows = doc.createNestedArray("samples");
+  for (uint8_t i = 0; i < count; i++) {
+    const EspNowSample& sample = samples[i].sample;
+    JsonArray row = rows.createNestedArray();
+    row.add(sample.leaf);
+    row.add(now - samples[i].receivedAt + sample.ageMs);
+    row.add(sample.temperature);
+    row.add(sample.humidity);
+    row.add(sample.moisture);
+    row.add(sample.light);
+    row.add(sample.flags);
+    row.add(sample.zonePumps);
+    JsonArray zones = row.createNestedArray();
+    for (uint8_t zone = 0; zone < sample.zoneCount; zone++) {
+      zones.add(sample.zoneMoisture[zone]);
+    }
+  }
+}
+
+bool parseWaterCommand(JsonDocument& doc, char* payload, size_t length,
+                       Command& command, const char** error) {
+  // Zero-copy: strings stay in the payload buffer
+  DeserializationError parsed = deserializeJson(doc, payload, length);
+  if (parsed) {
+    *error = parsed.c_str();
+    return false;
+  }
+  
+  command = {};
+  int zone = doc["zone"] | 0;
+  if (zone < 0 || zone >= ZONE_COUNT) {
+    *error = "unknown zone";
+    return false;
+  }
+  command.zone = zone;
+  
+  if (doc["action"] == "start") {
+    command.type = COMMAND_WATER_START;
+    command.value = doc["duration"] | 0;  // 0 = pump default
+  } else if (doc["action"] == "stop") {
+    command.type = COMMAND_WATER_STOP;
+  } else {
+    *error = "unknown action";
+    return false;
+  }
+  return true;
+}
+
+bool parseCalibrationCommand(JsonDocument& doc, char* payload, size_t length,
+                             Command& command, const char** error) {
+  DeserializationError parsed = deserializeJson(doc, payload, length);
+  if (parsed) {
+    *error = parsed.c_str();
+    return false;
+  }
+  
+  command = {};
+  command.type = COMMAND_CALIBRATE;
+  
+  const char* sensor = doc["sensor"] | "moisture";
+  if (strcmp(sensor, "light") == 0) {
+    command.zone = CALIBRATION_CHANNEL_LIGHT;
+  } else if (strcmp(sensor, "moisture") == 0) {
+    int zone = doc["zone"] | 0;
+    if (zone < 0 || zone >= ZONE_COUNT) {
+      *error = "unknown zone";
+      return false;
+    }
+    command.zone = zone;
+  } else {
+    // Temperature and humidity come calibrated from the DHT22
+    *error = "unknown sensor";
+    return false;
+  }
+  
+  const char* type = doc["type"] | "";
+  if (strcmp(type, "dry") == 0 || strcmp(type, "zero") == 0) {
+    command.value = 0;
+  } else if (strcmp(type, "wet") == 0 || strcmp(type, "span") == 0) {
+    command.value = 100;
+  } else if (strcmp(type, "reset") == 0) {
+    command.value = CALIBRATION_TARGET_RESET;
+  } else if (strcmp(type, "point") == 0) {
+    JsonVariant value = doc["value"];
+    if (!value.is<int>() || value.as<int>() < 0 || value.as<int>() > 100) {
+      *error = "value must be 0-100";
+      return false;
+    }
+    command.value = value.as<int>();
+  } else {
+    *error = "unknown type";
+    return false;
+  }
+  return true;
+}
+
+bool parseOtaManifest(JsonDocument& doc, char* payload, size_t length,
+                      OtaManifest& manifest, const char** error) {
+  DeserializationError parsed = deserializeJson(doc, payload, length);
+  if (parsed) {
+    *error = parsed.c_str();
+    return false;
+  }
+
+  manifest = {};
+  const char* version = doc["version"] | "";
+  const char* url = doc["url"] | "";
+  const char* sha256 = doc["sha256"] | "";
+  const char* encoding = doc["encoding"] | "none";
+
+  if (version[0] == 0 || strlen(version) >= sizeof(manifest.version)) {
+    *error = "version";
+    return false;
+  }
+  if ((strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) ||
+      strlen(url) >= sizeof(manifest.url)) {
+    *error = "url";
+    return false;
+  }
+  if (strlen(sha256) != OTA_SHA256_LENGTH - 1 ||
+      strspn(sha256, "0123456789abcdefABCDEF") != OTA_SHA256_LENGTH - 1) {
+    *error = "sha256";
+    return false;
+  }
+  if (!doc["size"].is<uint32_t>() || doc["size"].as<uint32_t>() == 0) {
+    *error = "size";
+    return false;
+  }
+  if (strcmp(encoding, "none") != 0 && strcmp(encoding, "zlib") != 0) {
+    *error = "encoding";
+    return false;
+  }
+  uint32_t window = doc["window_ms"] | (uint32_t)OTA_DEFAULT_WINDOW;
+  if (window > OTA_MAX_WINDOW) {
+    *error = "window_ms";
+    return false;
+  }
+
+  strlcpy(manifest.version, version, sizeof(manifest.version));
+  strlcpy(manifest.url, url, sizeof(manifest.url));
+  strlcpy(manifest.sha256, sha256, sizeof(manifest.sha256));
+  manifest.size = doc["size"];
+  manifest.compressed = strcmp(encoding, "zlib") == 0;
+  manifest.windowMs = window;
+  return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * PlanetPlant ESP32 Payloads
+ * JSON bodies of the sample, aggregate, watering, rate, calibration and
+ * mesh topics and the parsers for cmd/water and cmd/calibrate. Kept free of WiFi and MQTT so the host benchmark
+ * (PlatformIO native env) measures exactly what the network task runs.
+ */
+
+#ifndef PAYLOADS_H
+#define PAYLOADS_H
+
+#include <ArduinoJson.h>
+#include "messages.h"
+#include "telemetry_codec.h"
+#include "ota_update.h"
+#include "espnow_gateway.h"
+
+// evt/data. Live samples carry the status block, replayed ones
+// replayed plus boot_id/age_ms for uptime timestamps instead. Timestamps
+// here are wire timestamps (time_sync.h), epoch ms once synced.
+void buildSamplePayload(JsonDocument& doc, const char* deviceId, const TelemetrySample& sample);
+
+// Per-zone moisture and pump state of a live sample, "zones": [{...}, ...]
+// indexed by zone. Adds nothing on single-zone boards.
+void addSampleZones(JsonDocument& doc, const SensorData& data);
+
+// evt/aggregate
+void buildAggregatePayload(JsonDocument& doc, const char* deviceId,
+                           const SensorAggregates& aggregates, uint64_t timestamp);
+
+// evt/watering
+void buildWateringPayload(JsonDocument& doc, const char* deviceId, uint8_t zone,
+                          const WateringResult& result, uint64_t timestamp);
+
+const char* wateringOutcomeName(WateringOutcome outcome);
+
+// evt/rate
+void buildSampleRatePayload(JsonDocument& doc, const char* deviceId,
+                            const SampleRateChange& change, uint64_t timestamp);
+
+// evt/calibration: the step's result and the channel's curve after it
+void buildCalibrationPayload(JsonDocument& doc, const char* deviceId,
+                             const CalibrationReport& report, uint64_t timestamp);
+
+const char* calibrationResultName(CalibrationResult result);
+
+// evt/mesh, a gateway's leaf samples: "samples": [[leaf, age_ms,
+// temperature, humidity, moisture, light, flags, zone_pumps, [zone
+// moisture...]], ...] in frame units (espnow_frames.h). age_ms runs to
+// now, the moment of timestamp.
+void buildMeshPayload(JsonDocument& doc, const char* deviceId, const MeshSample* samples, uint8_t count,
+                      uint32_t now, uint64_t timestamp);
+
+// Parse in place (payload is modified and must outlive doc's use). Returns
+// false with *error set for malformed JSON, an unknown action or zone.
+bool parseWaterCommand(JsonDocument& doc, char* payload, size_t length,
+                       Command& command, const char** error);
+
+// cmd/calibrate: {"sensor": "moisture"|"light", "zone", "type":
+// "dry"|"wet"|"zero"|"span"|"point"|"reset", "value"}. point takes the %
+// in value; dry/zero are 0 %, wet/span 100 %. Same contract as
+// parseWaterCommand.
+bool parseCalibrationCommand(JsonDocument& doc, char* payload, size_t length,
+                             Command& command, const char** error);
+
+// cmd/ota: {"version", "url", "size", "sha256", "encoding":
+// "none"|"zlib", "window_ms"}. Strings are copied into manifest. Returns
+// false with *error naming the first bad field.
+bool parseOtaManifest(JsonDocument& doc, char* payload, size_t length,
+                      OtaManifest& manifest, const char** error);
+
+#endif // PAYLOADS_H
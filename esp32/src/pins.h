@@ -0,0 +1,37 @@
+/**
+ * PlanetPlant ESP32 Pin Assignments
+ * Shared by the sensing and network tasks
+ */
+
+#ifndef PINS_H
+#define PINS_H
+
+// Pin Definitions
+#define DHT_PIN 4
+#define MOISTURE_PIN A0
+#define PUMP_RELAY_PIN 5
+#define LIGHT_SENSOR_PIN A3
+#define LED_PIN 2
+#define BUTTON_PIN 0
+
+// Extra watering zones (ZONE_COUNT > 1). Moisture inputs must be ADC1
+// pins, ADC2 is unusable while WiFi runs; GPIO 37/38 are not broken out
+// on the DevKit v1, which therefore takes up to 5 zones.
+#define ZONE1_MOISTURE_PIN 32
+#define ZONE1_RELAY_PIN 18
+#define ZONE2_MOISTURE_PIN 33
+#define ZONE2_RELAY_PIN 19
+#define ZONE3_MOISTURE_PIN 34
+#define ZONE3_RELAY_PIN 21
+#define ZONE4_MOISTURE_PIN 35
+#define ZONE4_RELAY_PIN 22
+#define ZONE5_MOISTURE_PIN 37
+#define ZONE5_RELAY_PIN 23
+#define ZONE6_MOISTURE_PIN 38
+#define ZONE6_RELAY_PIN 25
+
+// Battery divider (BATTERY_SENSE_ENABLED), on zone 4's ADC1 input, so
+// battery-powered boards take up to 4 zones
+#define BATTERY_SENSE_PIN 35
+
+#endif // PINS_H
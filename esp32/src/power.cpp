@@ -0,0 +1,133 @@
+/**
+ * PlanetPlant ESP32 Power Management
+ * RTC_NOINIT_ATTR memory survives deep sleep and software resets but is
+ * random after power-on, hence the magic check
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/gpio.h>
+#include "power.h"
+#include "pins.h"
+#include "zones.h"
+#include "trace.h"
+
+#define DUTY_STATE_MAGIC  0x50504443  // "PPDC"
+#define MIN_SLEEP_MS      1000
+
+RTC_NOINIT_ATTR DutyCycleState dutyState;
+
+static esp_sleep_wakeup_cause_t cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+static uint32_t tasksStartedAt = 0;
+static std::atomic<bool> pumpRunning(false);
+static std::atomic<bool> sampleHandled(false);
+static std::atomic<uint32_t> sleepIntervalMs(SLEEP_DURATION * 1000UL);
+
+void powerBegin() {
+  cause = esp_sleep_get_wakeup_cause();
+
+  if (dutyState.magic != DUTY_STATE_MAGIC) {
+    memset(&dutyState, 0, sizeof(dutyState));
+    dutyState.magic = DUTY_STATE_MAGIC;
+  }
+  dutyState.wakeCount++;
+
+  // The relay pins were held low through sleep; drive them before releasing
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    digitalWrite(zones[zone].relayPin, LOW);
+    gpio_hold_dis((gpio_num_t)zones[zone].relayPin);
+  }
+  gpio_deep_sleep_hold_dis();
+
+  if (dutyState.pumpActive) {
+    // Reset or crash while watering; the relay is off again now
+    Serial.println("⚠️  Pump was active at reset, relays forced off");
+  }
+}
+
+esp_sleep_wakeup_cause_t wakeCause() {
+  return cause;
+}
+
+const char* wakeCauseName() {
+  switch (cause) {
+    case ESP_SLEEP_WAKEUP_TIMER: return "timer";
+    case WAKE_CAUSE_BUTTON: return "button";
+    case ESP_SLEEP_WAKEUP_UNDEFINED: return "reset";
+    default: return "other";
+  }
+}
+
+void powerSetPumpActive(bool active) {
+  pumpRunning = active;
+  dutyState.pumpActive = active;
+}
+
+bool powerPumpActive() {
+  return pumpRunning;
+}
+
+void powerSampleHandled() {
+  sampleHandled = true;
+}
+
+bool powerSampleDone() {
+  return sampleHandled;
+}
+
+void powerSetSleepInterval(uint32_t intervalMs) {
+  sleepIntervalMs = intervalMs;
+}
+
+void powerMarkTasksStarted() {
+  tasksStartedAt = millis();
+}
+
+uint32_t powerClock() {
+  return dutyState.clockBase + millis();
+}
+
+uint32_t powerAwakeTime() {
+  return millis() - tasksStartedAt;
+}
+
+void enterDeepSleep() {
+  // Never sleep with a relay energized; hold them low while the digital
+  // pads are unpowered so a floating input cannot switch a pump on
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    digitalWrite(zones[zone].relayPin, LOW);
+    gpio_hold_en((gpio_num_t)zones[zone].relayPin);
+  }
+  powerSetPumpActive(false);
+  gpio_deep_sleep_hold_en();
+
+  // Budget covers the whole wake, boot and setup included
+  uint32_t awakeMs = millis();
+  dutyState.lastAwakeMs = awakeMs;
+  if (awakeMs > dutyState.maxAwakeMs) {
+    dutyState.maxAwakeMs = awakeMs;
+  }
+  if (powerAwakeTime() >= AWAKE_BUDGET) {
+    dutyState.budgetOverruns++;
+  }
+
+  // Subtract the time spent awake to keep the sampling cadence
+  uint32_t sleepMs = sleepIntervalMs;
+  sleepMs = sleepMs > awakeMs + MIN_SLEEP_MS ? sleepMs - awakeMs : MIN_SLEEP_MS;
+  dutyState.clockBase += awakeMs + sleepMs;
+
+  Serial.printf("😴 Sleeping %lu ms after %lu ms awake\n", (unsigned long)sleepMs, (unsigned long)awakeMs);
+  
+  // RAM doesn't survive the sleep; the wake's trace goes out on serial
+  traceMark(TRACE_DEEP_SLEEP, (sleepMs + 999) / 1000);
+  traceDumpSerial();
+  Serial.flush();
+
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+#if CONFIG_IDF_TARGET_ESP32C3
+  esp_deep_sleep_enable_gpio_wakeup(BIT(WAKE_UP_PIN), ESP_GPIO_WAKEUP_GPIO_LOW);  // Button pulls low
+#else
+  esp_sleep_enable_ext0_wakeup(WAKE_UP_PIN, 0);  // Button pulls low
+#endif
+  esp_deep_sleep_start();
+}
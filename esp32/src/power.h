@@ -0,0 +1,64 @@
+/**
+ * PlanetPlant ESP32 Power Management
+ * Deep-sleep duty cycle (DEEP_SLEEP_ENABLED): wake, sample, publish, sleep.
+ * State that must survive sleep lives in RTC memory; buffered samples are
+ * kept by the sample store, which is RTC-backed already, and the WiFi
+ * fast-connect cache by wifi_cache.h.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <esp_sleep.h>
+#include "config.h"
+
+struct DutyCycleState {
+  uint32_t magic;
+  uint32_t wakeCount;
+  uint32_t lastAwakeMs;     // Wake-to-sleep time of the previous cycle
+  uint32_t maxAwakeMs;
+  uint32_t budgetOverruns;  // Cycles that hit AWAKE_BUDGET
+  uint32_t clockBase;       // Awake + asleep time of all previous cycles
+  uint8_t pumpActive;       // Set while the relay is energized
+};
+
+extern DutyCycleState dutyState;
+
+// Call first thing in setup(): validates RTC state and releases the GPIO
+// holds taken before the previous sleep.
+void powerBegin();
+
+// The button wakes through ext0, or through the GPIO wake on the C3,
+// which has no ext0 (GPIO0-5 only)
+#if CONFIG_IDF_TARGET_ESP32C3
+#define WAKE_CAUSE_BUTTON ESP_SLEEP_WAKEUP_GPIO
+#else
+#define WAKE_CAUSE_BUTTON ESP_SLEEP_WAKEUP_EXT0
+#endif
+
+esp_sleep_wakeup_cause_t wakeCause();
+const char* wakeCauseName();
+
+// Sensing task: keep the duty cycle awake while the pump runs.
+void powerSetPumpActive(bool active);
+bool powerPumpActive();
+
+// Network task: this wake's sample has been published or buffered.
+void powerSampleHandled();
+bool powerSampleDone();
+
+// Sensing task: time from this wake to the next, SLEEP_DURATION until set.
+void powerSetSleepInterval(uint32_t intervalMs);
+
+// millis() that keeps counting across deep sleep (wraps like millis()).
+uint32_t powerClock();
+
+// Milliseconds since the tasks started, the clock AWAKE_BUDGET runs on.
+uint32_t powerAwakeTime();
+void powerMarkTasksStarted();
+
+// Relay off and held, timer/button wake armed, awake time recorded.
+void enterDeepSleep() __attribute__((noreturn));
+
+#endif // POWER_H
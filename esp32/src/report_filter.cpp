@@ -0,0 +1,109 @@
+/**
+ * PlanetPlant ESP32 Report-by-Exception Filter
+ * Defaults for the thresholds are REPORT_DEADBAND_* and REPORT_RATE_* in config.h
+ */
+
+#include <math.h>
+#include "report_filter.h"
+
+#define MS_PER_MINUTE 60000.0f
+#define MS_PER_HOUR   3600000.0f
+
+bool ReportFilter::update(const SensorData& data, uint32_t now, const RuntimeSettings& settings, bool force) {
+  const float values[CHANNEL_COUNT] = {
+    data.temperature, data.humidity, (float)data.moisture, (float)data.lightLevel
+  };
+
+  accumulate(values, now);
+
+  bool report = force || !hasReported || data.pumpActive != lastPumpActive || data.zonePumps != lastZonePumps ||
+                now - lastReportAt >= settings.reportMaxSilence;
+
+  float minutes = (now - lastSampleAt) / MS_PER_MINUTE;
+  for (int i = 0; i < CHANNEL_COUNT && !report; i++) {
+    if (fabsf(values[i] - channels[i].lastReported) >= settings.deadbands[i]) {
+      report = true;
+    } else if (hasSample && minutes > 0 && fabsf(values[i] - channels[i].lastValue) / minutes >= settings.rates[i]) {
+      report = true;
+    }
+  }
+
+  // Zone 0 is the moisture channel itself
+  for (int i = 1; i < ZONE_COUNT && !report; i++) {
+    report = fabsf(data.zoneMoisture[i] - zoneReported[i]) >= settings.deadbands[CHANNEL_MOISTURE];
+  }
+
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    channels[i].lastValue = values[i];
+    if (report) {
+      channels[i].lastReported = values[i];
+    }
+  }
+  for (int i = 0; i < ZONE_COUNT && report; i++) {
+    zoneReported[i] = data.zoneMoisture[i];
+  }
+  hasSample = true;
+  lastSampleAt = now;
+  lastPumpActive = data.pumpActive;
+  lastZonePumps = data.zonePumps;
+
+  if (report) {
+    hasReported = true;
+    lastReportAt = now;
+  } else {
+    suppressedCount++;
+  }
+  return report;
+}
+
+bool ReportFilter::takeAggregates(SensorAggregates& aggregates, uint32_t now, const RuntimeSettings& settings) {
+  if (windowCount == 0 || now - windowStart < settings.aggregateWindow) {
+    return false;
+  }
+
+  float n = windowCount;
+  aggregates.windowMs = now - windowStart;
+  aggregates.count = windowCount;
+
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    const ChannelState& channel = channels[i];
+    ChannelAggregate& out = aggregates.channels[i];
+    out.min = channel.min;
+    out.max = channel.max;
+    out.mean = channel.sum / n;
+
+    // Least-squares slope; zero when all samples share one timestamp
+    float denominator = n * channel.sumTT - channel.sumT * channel.sumT;
+    out.slope = denominator > 1e-9f ? (n * channel.sumTV - channel.sumT * channel.sum) / denominator : 0;
+  }
+
+  windowCount = 0;
+  return true;
+}
+
+void ReportFilter::accumulate(const float* values, uint32_t now) {
+  if (windowCount == 0) {
+    windowStart = now;
+  }
+
+  float t = (now - windowStart) / MS_PER_HOUR;
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    ChannelState& channel = channels[i];
+    float v = values[i];
+    if (windowCount == 0) {
+      channel.min = v;
+      channel.max = v;
+      channel.sum = 0;
+      channel.sumT = 0;
+      channel.sumTT = 0;
+      channel.sumTV = 0;
+    }
+    channel.min = fminf(channel.min, v);
+    channel.max = fmaxf(channel.max, v);
+    channel.sum += v;
+    channel.sumT += t;
+    channel.sumTT += t * t;
+    channel.sumTV += t * v;
+  }
+  windowCount++;
+}
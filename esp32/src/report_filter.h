@@ -0,0 +1,62 @@
+/**
+ * PlanetPlant ESP32 Report-by-Exception Filter
+ * Decides which samples are worth publishing: a channel must move past
+ * its dead-band since the last published sample, or change faster than
+ * its rate threshold between consecutive samples; pump transitions and
+ * the max-silence interval always publish. Each extra zone's moisture
+ * uses the moisture dead-band. Every sample also feeds the
+ * min/max/mean/slope aggregates of the current aggregate window.
+ * Thresholds and intervals come from the runtime settings.
+ *
+ * All-zero memory is a valid fresh state (no constructor), so an
+ * instance can live in RTC memory across deep sleep. Timestamps must
+ * be monotonic across sleep, see powerClock().
+ */
+
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stdint.h>
+#include "messages.h"
+#include "runtime_settings.h"
+
+class ReportFilter {
+public:
+  // Feed a valid sample. Returns true if it should be published; force
+  // publishes it whatever the thresholds say.
+  bool update(const SensorData& data, uint32_t now, const RuntimeSettings& settings, bool force = false);
+
+  // True once the aggregate window has elapsed; fills the aggregates and
+  // starts the next window.
+  bool takeAggregates(SensorAggregates& aggregates, uint32_t now, const RuntimeSettings& settings);
+
+  uint32_t suppressed() const { return suppressedCount; }
+
+private:
+  struct ChannelState {
+    float lastReported;
+    float lastValue;
+    float min;
+    float max;
+    float sum;
+    float sumT;             // t in hours since the window start
+    float sumTT;
+    float sumTV;
+  };
+
+  ChannelState channels[CHANNEL_COUNT];
+  float zoneReported[ZONE_COUNT];
+  uint32_t lastReportAt;
+  uint32_t lastSampleAt;
+  uint32_t windowStart;
+  uint32_t suppressedCount;
+  uint16_t windowCount;
+  bool hasReported;
+  bool hasSample;
+  bool lastPumpActive;
+  uint8_t lastZonePumps;
+
+  void accumulate(const float* values, uint32_t now);
+};
+
+#endif // REPORT_FILTER_H
@@ -0,0 +1,257 @@
+/**
+ * PlanetPlant ESP32 Runtime Settings
+ * One descriptor per wire key (type, bounds, field offset) drives parsing,
+ * validation and serialization; one versioned blob in the "settings" NVS
+ * namespace
+ */
+
+#include <stddef.h>
+#include "hal.h"
+#include "runtime_settings.h"
+
+#define SETTINGS_NAMESPACE    "settings"
+#define SETTINGS_KEY          "active"
+#define SETTINGS_LAYOUT       3       // Bump when RuntimeSettings changes shape
+
+enum SettingType : uint8_t { SETTING_U32, SETTING_U8, SETTING_FLOAT, SETTING_BOOL };
+
+struct SettingDescriptor {
+  const char* key;
+  SettingType type;
+  uint16_t offset;
+  float min;
+  float max;
+};
+
+#define SETTING(key, type, field, min, max) { key, type, offsetof(RuntimeSettings, field), min, max }
+
+static const SettingDescriptor descriptors[] = {
+  SETTING("sensor_interval",      SETTING_U32,   sensorInterval,          5000, 3600000),
+  SETTING("heartbeat_interval",   SETTING_U32,   heartbeatInterval,      30000, 3600000),
+  SETTING("metrics_interval",     SETTING_U32,   metricsInterval,        60000, 86400000),
+  SETTING("report_max_silence",   SETTING_U32,   reportMaxSilence,       60000, 86400000),
+  SETTING("aggregate_window",     SETTING_U32,   aggregateWindow,        60000, 86400000),
+  SETTING("deadband_temperature", SETTING_FLOAT, deadbands[CHANNEL_TEMPERATURE], 0, 50),
+  SETTING("deadband_humidity",    SETTING_FLOAT, deadbands[CHANNEL_HUMIDITY],    0, 100),
+  SETTING("deadband_moisture",    SETTING_FLOAT, deadbands[CHANNEL_MOISTURE],    0, 100),
+  SETTING("deadband_light",       SETTING_FLOAT, deadbands[CHANNEL_LIGHT],       0, 100),
+  SETTING("rate_temperature",     SETTING_FLOAT, rates[CHANNEL_TEMPERATURE],     0, 50),
+  SETTING("rate_humidity",        SETTING_FLOAT, rates[CHANNEL_HUMIDITY],        0, 100),
+  SETTING("rate_moisture",        SETTING_FLOAT, rates[CHANNEL_MOISTURE],        0, 100),
+  SETTING("rate_light",           SETTING_FLOAT, rates[CHANNEL_LIGHT],           0, 100),
+  SETTING("adaptive_sampling",    SETTING_BOOL,  adaptiveSampling,           0, 1),
+  SETTING("sample_fast_interval", SETTING_U32,   sampleFastInterval,       200, 3600000),
+  SETTING("sample_slow_interval", SETTING_U32,   sampleSlowInterval,      5000, 86400000),
+  SETTING("sample_fast_rate",     SETTING_FLOAT, sampleFastRate,           0.1, 100),
+  SETTING("battery_low",          SETTING_U32,   batteryLow,                 0, 5000),
+  SETTING("watering_duration",    SETTING_U32,   wateringDuration,        1000, WATERING_MAX_DURATION),
+  SETTING("watering_pulse",       SETTING_U32,   wateringPulse,            500, PUMP_MAX_DURATION),
+  SETTING("watering_soak",        SETTING_U32,   wateringSoak,            1000, 600000),
+  SETTING("pump_cooldown",        SETTING_U32,   pumpCooldown,               0, 86400000),
+  SETTING("watering_max_pulses",  SETTING_U8,    wateringMaxPulses,          1, 20),
+  SETTING("moisture_min",         SETTING_U8,    moistureMin,                0, 100),
+  SETTING("moisture_max",         SETTING_U8,    moistureMax,                0, 100),
+  SETTING("local_watering",       SETTING_BOOL,  localWatering,              0, 1),
+};
+
+#define DESCRIPTOR_COUNT (sizeof(descriptors) / sizeof(descriptors[0]))
+
+struct StoredSettings {
+  uint8_t layout;
+  uint32_t revision;
+  RuntimeSettings settings;
+};
+
+static RuntimeSettings active;
+static uint32_t revision = 0;
+static portMUX_TYPE settingsLock = portMUX_INITIALIZER_UNLOCKED;
+
+static RuntimeSettings defaults() {
+  RuntimeSettings settings = {};
+  settings.sensorInterval = SENSOR_READ_INTERVAL;
+  settings.heartbeatInterval = HEARTBEAT_INTERVAL;
+  settings.metricsInterval = METRICS_INTERVAL;
+  settings.reportMaxSilence = REPORT_MAX_SILENCE;
+  settings.aggregateWindow = AGGREGATE_WINDOW;
+  settings.deadbands[CHANNEL_TEMPERATURE] = REPORT_DEADBAND_TEMPERATURE;
+  settings.deadbands[CHANNEL_HUMIDITY] = REPORT_DEADBAND_HUMIDITY;
+  settings.deadbands[CHANNEL_MOISTURE] = REPORT_DEADBAND_MOISTURE;
+  settings.deadbands[CHANNEL_LIGHT] = REPORT_DEADBAND_LIGHT;
+  settings.rates[CHANNEL_TEMPERATURE] = REPORT_RATE_TEMPERATURE;
+  settings.rates[CHANNEL_HUMIDITY] = REPORT_RATE_HUMIDITY;
+  settings.rates[CHANNEL_MOISTURE] = REPORT_RATE_MOISTURE;
+  settings.rates[CHANNEL_LIGHT] = REPORT_RATE_LIGHT;
+  settings.adaptiveSampling = ADAPTIVE_SAMPLING_ENABLED;
+  settings.sampleFastInterval = SAMPLE_INTERVAL_FAST;
+  settings.sampleSlowInterval = SAMPLE_INTERVAL_SLOW;
+  settings.sampleFastRate = SAMPLE_FAST_RATE;
+  settings.batteryLow = BATTERY_LOW_MV;
+  settings.wateringDuration = WATERING_DURATION;
+  settings.wateringPulse = WATERING_PULSE_DURATION;
+  settings.wateringSoak = WATERING_SOAK_TIME;
+  settings.pumpCooldown = PUMP_COOLDOWN_TIME;
+  settings.wateringMaxPulses = WATERING_MAX_PULSES;
+  settings.moistureMin = DEFAULT_MOISTURE_THRESHOLD_MIN;
+  settings.moistureMax = DEFAULT_MOISTURE_THRESHOLD_MAX;
+  settings.localWatering = LOCAL_WATERING_ENABLED;
+  return settings;
+}
+
+static bool consistent(const RuntimeSettings& settings) {
+  return settings.moistureMin < settings.moistureMax;
+}
+
+static void publish(const RuntimeSettings& settings, uint32_t newRevision) {
+  portENTER_CRITICAL(&settingsLock);
+  active = settings;
+  revision = newRevision;
+  portEXIT_CRITICAL(&settingsLock);
+}
+
+static bool store(const RuntimeSettings& settings, uint32_t newRevision) {
+  StoredSettings stored = {};
+  stored.layout = SETTINGS_LAYOUT;
+  stored.revision = newRevision;
+  stored.settings = settings;
+
+  Preferences prefs;
+  if (!prefs.begin(SETTINGS_NAMESPACE, false)) {
+    return false;
+  }
+  bool written = prefs.putBytes(SETTINGS_KEY, &stored, sizeof(stored)) == sizeof(stored);
+  prefs.end();
+  return written;
+}
+
+void settingsBegin() {
+  StoredSettings stored;
+  size_t length = 0;
+
+  Preferences prefs;
+  if (prefs.begin(SETTINGS_NAMESPACE, true)) {
+    length = prefs.getBytes(SETTINGS_KEY, &stored, sizeof(stored));
+    prefs.end();
+  }
+
+  if (length == sizeof(stored) && stored.layout == SETTINGS_LAYOUT && consistent(stored.settings)) {
+    publish(stored.settings, stored.revision);
+    Serial.printf("⚙️  Settings revision %lu loaded\n", (unsigned long)stored.revision);
+  } else {
+    publish(defaults(), 0);
+  }
+}
+
+RuntimeSettings settingsSnapshot() {
+  portENTER_CRITICAL(&settingsLock);
+  RuntimeSettings settings = active;
+  portEXIT_CRITICAL(&settingsLock);
+  return settings;
+}
+
+RuntimeSettings settingsSnapshot(uint32_t& revisionOut) {
+  portENTER_CRITICAL(&settingsLock);
+  RuntimeSettings settings = active;
+  revisionOut = revision;
+  portEXIT_CRITICAL(&settingsLock);
+  return settings;
+}
+
+uint32_t settingsRevision() {
+  return revision;
+}
+
+SettingsResult settingsApply(JsonObject changes, const char** error) {
+  RuntimeSettings candidate = settingsSnapshot();
+  uint8_t* base = (uint8_t*)&candidate;
+  *error = nullptr;
+
+  for (JsonPair pair : changes) {
+    const SettingDescriptor* descriptor = nullptr;
+    for (size_t i = 0; i < DESCRIPTOR_COUNT; i++) {
+      if (strcmp(pair.key().c_str(), descriptors[i].key) == 0) {
+        descriptor = &descriptors[i];
+        break;
+      }
+    }
+
+    JsonVariant value = pair.value();
+    bool typed = descriptor != nullptr &&
+                 (descriptor->type == SETTING_BOOL ? value.is<bool>() : value.is<float>());
+    float number = typed ? value.as<float>() : 0;
+    if (!typed || number < descriptor->min || number > descriptor->max) {
+      *error = pair.key().c_str();
+      return SETTINGS_REJECTED;
+    }
+
+    void* field = base + descriptor->offset;
+    switch (descriptor->type) {
+      case SETTING_U32:
+        *(uint32_t*)field = value.as<uint32_t>();
+        break;
+      case SETTING_U8:
+        *(uint8_t*)field = value.as<uint8_t>();
+        break;
+      case SETTING_FLOAT:
+        *(float*)field = number;
+        break;
+      case SETTING_BOOL:
+        *(bool*)field = value.as<bool>();
+        break;
+    }
+  }
+
+  if (!consistent(candidate)) {
+    *error = "moisture_min";
+    return SETTINGS_REJECTED;
+  }
+
+  RuntimeSettings current = settingsSnapshot();
+  if (memcmp(&candidate, &current, sizeof(candidate)) == 0) {
+    return SETTINGS_UNCHANGED;
+  }
+
+  // Persist first so a reset never comes back with a half-applied set
+  if (!store(candidate, revision + 1)) {
+    *error = "storage";
+    return SETTINGS_REJECTED;
+  }
+  publish(candidate, revision + 1);
+  return SETTINGS_APPLIED;
+}
+
+SettingsResult settingsReset() {
+  RuntimeSettings current = settingsSnapshot();
+  RuntimeSettings initial = defaults();
+  if (memcmp(&initial, &current, sizeof(initial)) == 0) {
+    return SETTINGS_UNCHANGED;
+  }
+
+  // Stored rather than erased so the revision keeps counting up
+  if (!store(initial, revision + 1)) {
+    return SETTINGS_REJECTED;
+  }
+  publish(initial, revision + 1);
+  return SETTINGS_APPLIED;
+}
+
+void settingsToJson(const RuntimeSettings& settings, JsonObject out) {
+  const uint8_t* base = (const uint8_t*)&settings;
+  for (size_t i = 0; i < DESCRIPTOR_COUNT; i++) {
+    const SettingDescriptor& descriptor = descriptors[i];
+    const void* field = base + descriptor.offset;
+    switch (descriptor.type) {
+      case SETTING_U32:
+        out[descriptor.key] = *(const uint32_t*)field;
+        break;
+      case SETTING_U8:
+        out[descriptor.key] = *(const uint8_t*)field;
+        break;
+      case SETTING_FLOAT:
+        out[descriptor.key] = *(const float*)field;
+        break;
+      case SETTING_BOOL:
+        out[descriptor.key] = *(const bool*)field;
+        break;
+    }
+  }
+}
@@ -0,0 +1,71 @@
+/**
+ * PlanetPlant ESP32 Runtime Settings
+ * Tunables that can be changed over cmd/config without a
+ * reflash. Defaults come from config.h; accepted updates are persisted
+ * as one versioned blob in the "settings" NVS namespace and hot-applied.
+ *
+ * The network task validates and stores updates; other tasks read a
+ * consistent copy with settingsSnapshot() and refresh it when told to
+ * (COMMAND_SETTINGS_CHANGED).
+ */
+
+#ifndef RUNTIME_SETTINGS_H
+#define RUNTIME_SETTINGS_H
+
+#include <ArduinoJson.h>
+#include "messages.h"
+
+struct RuntimeSettings {
+  uint32_t sensorInterval;          // sensor_interval (ms)
+  uint32_t heartbeatInterval;       // heartbeat_interval (ms)
+  uint32_t metricsInterval;         // metrics_interval (ms)
+  uint32_t reportMaxSilence;        // report_max_silence (ms)
+  uint32_t aggregateWindow;         // aggregate_window (ms)
+  float deadbands[CHANNEL_COUNT];   // deadband_<channel>
+  float rates[CHANNEL_COUNT];       // rate_<channel>, per minute
+  uint32_t sampleFastInterval;      // sample_fast_interval (ms)
+  uint32_t sampleSlowInterval;      // sample_slow_interval (ms)
+  float sampleFastRate;             // sample_fast_rate (%/h)
+  uint32_t batteryLow;              // battery_low (mV)
+  uint32_t wateringDuration;        // watering_duration, manual/default (ms)
+  uint32_t wateringPulse;           // watering_pulse (ms)
+  uint32_t wateringSoak;            // watering_soak (ms)
+  uint32_t pumpCooldown;            // pump_cooldown (ms)
+  uint8_t wateringMaxPulses;        // watering_max_pulses
+  uint8_t moistureMin;              // moisture_min (%)
+  uint8_t moistureMax;              // moisture_max (%)
+  bool localWatering;               // local_watering
+  bool adaptiveSampling;            // adaptive_sampling
+};
+
+enum SettingsResult : uint8_t {
+  SETTINGS_APPLIED,
+  SETTINGS_UNCHANGED,
+  SETTINGS_REJECTED
+};
+
+// Load the stored settings, falling back to the defaults when the blob is
+// missing or from another layout version. Call once before the tasks start.
+void settingsBegin();
+
+// Consistent copy of the active settings, safe from any task.
+RuntimeSettings settingsSnapshot();
+
+// Same, with the revision the copy belongs to.
+RuntimeSettings settingsSnapshot(uint32_t& revisionOut);
+
+// Bumped on every applied update; reported in status and acks.
+uint32_t settingsRevision();
+
+// Validate and apply a partial update. All keys are checked before anything
+// changes; on rejection *error names the offending key. Applied updates are
+// persisted before this returns. Network task only.
+SettingsResult settingsApply(JsonObject changes, const char** error);
+
+// Back to the config.h defaults (persisted). Network task only.
+SettingsResult settingsReset();
+
+// Write every setting under its wire key.
+void settingsToJson(const RuntimeSettings& settings, JsonObject out);
+
+#endif // RUNTIME_SETTINGS_H
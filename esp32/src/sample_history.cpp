@@ -0,0 +1,30 @@
+/**
+ * PlanetPlant ESP32 Sample History
+ */
+
+#include "sample_history.h"
+
+SampleHistory sampleHistory;
+
+void SampleHistory::record(const StoredSample& sample) {
+  uint32_t number = count.load(std::memory_order_relaxed);
+  records[number & (SAMPLE_HISTORY_SIZE - 1)] = sample;
+  count.store(number + 1, std::memory_order_release);
+}
+
+uint32_t SampleHistory::oldest() const {
+  uint32_t newest = written();
+  return newest > SAMPLE_HISTORY_SIZE ? newest - SAMPLE_HISTORY_SIZE : 0;
+}
+
+bool SampleHistory::read(uint32_t number, StoredSample& sample) const {
+  if (number >= written() || number < oldest()) {
+    return false;
+  }
+  sample = records[number & (SAMPLE_HISTORY_SIZE - 1)];
+
+  // The slot is rewritten while the count stands at number + SIZE, so the
+  // copy is good as long as the count is still below that
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return written() - number < SAMPLE_HISTORY_SIZE;
+}
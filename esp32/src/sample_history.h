@@ -0,0 +1,40 @@
+/**
+ * PlanetPlant ESP32 Sample History
+ * The last SAMPLE_HISTORY_SIZE samples the network task handled, published
+ * or not, in StoredSample records; served by /samples.
+ *
+ * One writer (the network task) and any number of readers on other tasks
+ * without a lock: records are numbered, and a reader that was lapped by
+ * the writer while copying one gets false instead of a torn record.
+ */
+
+#ifndef SAMPLE_HISTORY_H
+#define SAMPLE_HISTORY_H
+
+#include <atomic>
+#include "config.h"
+#include "sample_store.h"
+
+class SampleHistory {
+  static_assert((SAMPLE_HISTORY_SIZE & (SAMPLE_HISTORY_SIZE - 1)) == 0, "SAMPLE_HISTORY_SIZE must be a power of two");
+
+public:
+  // Network task only
+  void record(const StoredSample& sample);
+
+  // Records written since boot; the newest has number written() - 1
+  uint32_t written() const { return count.load(std::memory_order_acquire); }
+
+  // Oldest record number still held
+  uint32_t oldest() const;
+
+  bool read(uint32_t number, StoredSample& sample) const;
+
+private:
+  StoredSample records[SAMPLE_HISTORY_SIZE];
+  std::atomic<uint32_t> count{0};
+};
+
+extern SampleHistory sampleHistory;
+
+#endif // SAMPLE_HISTORY_H
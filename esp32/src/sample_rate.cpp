@@ -0,0 +1,125 @@
+/**
+ * PlanetPlant ESP32 Adaptive Sampling
+ * Defaults for the intervals and thresholds are SAMPLE_* and
+ * BATTERY_LOW_MV in config.h
+ */
+
+#include <math.h>
+#include <string.h>
+#include "sample_rate.h"
+
+#define MS_PER_HOUR   3600000.0f
+
+bool SampleRateController::update(const SensorData& data, bool watering, int batteryMv, uint32_t now,
+                                  uint32_t baseInterval, const RuntimeSettings& settings,
+                                  SampleRateChange& change) {
+  // A step as large as the report dead-band is worth a closer look before
+  // the window ends, e.g. a plant watered by hand
+  bool jumped = false;
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    float value = data.zoneMoisture[zone];
+    if (!hasSample) {
+      smoothed[zone] = value;
+    }
+    jumped = jumped || fabsf(value - smoothed[zone]) >= settings.deadbands[CHANNEL_MOISTURE];
+    smoothed[zone] += SAMPLE_SMOOTHING * (value - smoothed[zone]);
+  }
+  if (!hasSample) {
+    hasSample = true;
+    restartTrend(now);
+  }
+
+  if (watering) {
+    restartTrend(now);
+    jumped = false;
+  } else if (now - referenceAt >= SAMPLE_TREND_WINDOW) {
+    float hours = (now - referenceAt) / MS_PER_HOUR;
+    trend = 0;
+    for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+      trend = fmaxf(trend, fabsf(smoothed[zone] - reference[zone]) / hours);
+      reference[zone] = smoothed[zone];
+    }
+    referenceAt = now;
+    hasTrend = true;
+    bool flat = trend < settings.sampleFastRate * SAMPLE_STABLE_FRACTION;
+    stableWindows = flat ? (stableWindows < UINT8_MAX ? stableWindows + 1 : stableWindows) : 0;
+  }
+
+  // Pumps pull the supply down; judge the battery between cycles
+  if (batteryMv >= 0 && !watering) {
+    if (batteryMv < (int)settings.batteryLow) {
+      lowBattery = true;
+    } else if (batteryMv >= (int)settings.batteryLow + BATTERY_HYSTERESIS_MV) {
+      lowBattery = false;
+    }
+  }
+
+  // Fast sampling holds until the trend drops below half the fast rate
+  bool fast = hasTrend && trend >= settings.sampleFastRate;
+  bool stillFast = currentMode == SAMPLE_MODE_CHANGING && hasTrend && trend >= settings.sampleFastRate / 2;
+
+  SampleMode next = SAMPLE_MODE_NORMAL;
+  if (watering) {
+    next = SAMPLE_MODE_WATERING;
+  } else if (lowBattery) {
+    next = SAMPLE_MODE_LOW_BATTERY;
+  } else if (jumped || fast || stillFast) {
+    next = SAMPLE_MODE_CHANGING;
+  } else if (stableWindows >= SAMPLE_STABLE_WINDOWS) {
+    next = SAMPLE_MODE_STABLE;
+  }
+
+  currentMode = next;
+  uint32_t nextInterval = interval(baseInterval, settings);
+  if (nextInterval == lastInterval) {
+    return false;
+  }
+
+  change.intervalMs = nextInterval;
+  change.previousMs = lastInterval;
+  change.moistureRate = hasTrend ? trend : 0;
+  change.batteryMv = batteryMv;
+  change.mode = next;
+  lastInterval = nextInterval;
+  return true;
+}
+
+uint32_t SampleRateController::interval(uint32_t baseInterval, const RuntimeSettings& settings) const {
+  uint32_t slow = settings.sampleSlowInterval > baseInterval ? settings.sampleSlowInterval : baseInterval;
+  switch (currentMode) {
+    case SAMPLE_MODE_WATERING:
+      return SAMPLE_INTERVAL_WATERING < baseInterval ? SAMPLE_INTERVAL_WATERING : baseInterval;
+    case SAMPLE_MODE_CHANGING:
+      return settings.sampleFastInterval < baseInterval ? settings.sampleFastInterval : baseInterval;
+    case SAMPLE_MODE_STABLE:
+      return slow;
+    case SAMPLE_MODE_LOW_BATTERY:
+      return slow * SAMPLE_LOW_BATTERY_FACTOR;
+    case SAMPLE_MODE_NORMAL:
+      break;
+  }
+  return baseInterval;
+}
+
+void SampleRateController::reset() {
+  memset(this, 0, sizeof(*this));
+}
+
+void SampleRateController::restartTrend(uint32_t now) {
+  memcpy(reference, smoothed, sizeof(reference));
+  referenceAt = now;
+  hasTrend = false;
+  trend = 0;
+  stableWindows = 0;
+}
+
+const char* sampleModeName(SampleMode mode) {
+  switch (mode) {
+    case SAMPLE_MODE_NORMAL: return "normal";
+    case SAMPLE_MODE_WATERING: return "watering";
+    case SAMPLE_MODE_CHANGING: return "changing";
+    case SAMPLE_MODE_STABLE: return "stable";
+    case SAMPLE_MODE_LOW_BATTERY: return "low_battery";
+  }
+  return "unknown";
+}
@@ -0,0 +1,63 @@
+/**
+ * PlanetPlant ESP32 Adaptive Sampling
+ * Picks the sampling interval from plant state and power budget:
+ * SAMPLE_INTERVAL_WATERING while a zone waters, sample_fast_interval
+ * while the fastest-moving zone's moisture trend is above
+ * sample_fast_rate or a sample jumps by the moisture dead-band,
+ * sample_slow_interval once the trend has been flat for
+ * SAMPLE_STABLE_WINDOWS, and SAMPLE_LOW_BATTERY_FACTOR slow intervals
+ * below battery_low. Watering wins over a low battery, a low battery
+ * over everything else. Otherwise samples stay sensor_interval apart.
+ *
+ * The trend is the change of the smoothed moisture over each
+ * SAMPLE_TREND_WINDOW, so it means the same at any interval. Watering is
+ * not a trend: the window restarts once a cycle ends, and battery
+ * readings taken while a pump draws current are ignored.
+ *
+ * All-zero memory is a valid fresh state (no constructor), so an
+ * instance can live in RTC memory across deep sleep. Timestamps must
+ * be monotonic across sleep, see powerClock().
+ */
+
+#ifndef SAMPLE_RATE_H
+#define SAMPLE_RATE_H
+
+#include <stdint.h>
+#include "messages.h"
+#include "runtime_settings.h"
+
+class SampleRateController {
+public:
+  // Feed a valid sample. watering is set while any zone waters, soaks or
+  // waits for a pump; batteryMv is -1 without battery sensing. Returns
+  // true when the interval for baseInterval changed, with change filled.
+  bool update(const SensorData& data, bool watering, int batteryMv, uint32_t now,
+              uint32_t baseInterval, const RuntimeSettings& settings, SampleRateChange& change);
+
+  // Interval of the current mode for a given normal interval
+  uint32_t interval(uint32_t baseInterval, const RuntimeSettings& settings) const;
+
+  SampleMode mode() const { return currentMode; }
+
+  // Back to the normal rate with no trend, e.g. when adaptive sampling is
+  // switched off
+  void reset();
+
+private:
+  float smoothed[ZONE_COUNT];
+  float reference[ZONE_COUNT];  // smoothed at referenceAt
+  uint32_t referenceAt;
+  uint32_t lastInterval;        // 0 until the first update
+  float trend;                  // %/h, last complete window
+  uint8_t stableWindows;
+  bool hasSample;
+  bool hasTrend;
+  bool lowBattery;
+  SampleMode currentMode;
+
+  void restartTrend(uint32_t now);
+};
+
+const char* sampleModeName(SampleMode mode);
+
+#endif // SAMPLE_RATE_H
@@ -0,0 +1,377 @@
+/**
+ * PlanetPlant ESP32 Offline Sample Store
+ *
+ * Flash layout: the partition is a circular log of 4 KB sectors. Slot 0 of
+ * each sector holds a header with a sequence number, the remaining slots
+ * hold one StoredSample each. Slot states only ever clear bits, so a sample
+ * is consumed by rewriting its state byte in place, without an erase:
+ *   0xFF erased -> SLOT_WRITTEN -> SLOT_CONSUMED
+ * Read/write positions are recovered by scanning the headers at boot.
+ */
+
+#include <Arduino.h>
+#include "sample_store.h"
+#include "time_sync.h"
+
+#define RTC_RING_MAGIC      0x50505242  // "PPRB"
+#define SECTOR_MAGIC        0x50505346  // "PPSF"
+#define SECTOR_SIZE         4096
+#define SLOT_SIZE           sizeof(StoredSample)
+#define SLOTS_PER_SECTOR    (SECTOR_SIZE / SLOT_SIZE)
+
+#define SLOT_WRITTEN        0x5A
+#define SLOT_CONSUMED       0x00
+
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t slotSize;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(SectorHeader) == SLOT_SIZE, "Sector header must fill slot 0");
+
+// Survives software resets and deep sleep; validated by magic at boot
+struct RtcRing {
+  uint32_t magic;
+  uint16_t bootCount;
+  uint16_t head;            // Index of the oldest record
+  uint16_t count;
+  uint16_t reserved;
+  StoredSample records[SAMPLE_BUFFER_RTC_RECORDS];
+};
+
+RTC_NOINIT_ATTR static RtcRing rtcRing;
+
+SampleStore sampleStore;
+
+static uint8_t crc8(const uint8_t* data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint8_t sampleCrc(const StoredSample& sample) {
+  return crc8((const uint8_t*)&sample, offsetof(StoredSample, state));
+}
+
+StoredSample packSample(const SensorData& data, uint32_t timestamp, uint16_t bootId, uint64_t epochMs) {
+  StoredSample sample = {};
+  sample.timestamp = epochMs != 0 ? (uint32_t)epochMs : timestamp;
+  sample.bootId = epochMs != 0 ? (uint16_t)(epochMs >> 32) : bootId;
+  sample.temperature = (int16_t)lroundf(data.temperature * 100.0f);
+  sample.humidity = (uint16_t)lroundf(data.humidity * 100.0f);
+  sample.moisture = (uint8_t)constrain(data.moisture, 0, 100);
+  sample.light = (uint8_t)constrain(data.lightLevel, 0, 100);
+  sample.flags = data.pumpActive ? SAMPLE_FLAG_PUMP_ACTIVE : 0;
+  if (epochMs != 0) {
+    sample.flags |= SAMPLE_FLAG_EPOCH;
+  }
+  sample.state = SLOT_WRITTEN;
+  sample.crc = sampleCrc(sample);
+  return sample;
+}
+
+SensorData unpackSample(const StoredSample& sample) {
+  SensorData data = {};
+  data.temperature = sample.temperature / 100.0f;
+  data.humidity = sample.humidity / 100.0f;
+  data.moisture = sample.moisture;
+  data.lightLevel = sample.light;
+  data.pumpActive = sample.flags & SAMPLE_FLAG_PUMP_ACTIVE;
+  data.isValid = true;
+  return data;
+}
+
+uint64_t sampleEpochMs(const StoredSample& sample) {
+  if (!(sample.flags & SAMPLE_FLAG_EPOCH)) {
+    return 0;
+  }
+  return (uint64_t)sample.bootId << 32 | sample.timestamp;
+}
+
+void SampleStore::begin() {
+  if (rtcRing.magic != RTC_RING_MAGIC ||
+      rtcRing.head >= SAMPLE_BUFFER_RTC_RECORDS ||
+      rtcRing.count > SAMPLE_BUFFER_RTC_RECORDS) {
+    memset(&rtcRing, 0, sizeof(rtcRing));
+    rtcRing.magic = RTC_RING_MAGIC;
+  }
+  rtcRing.bootCount++;
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                       SAMPLE_PARTITION_LABEL);
+  if (partition == nullptr) {
+    Serial.println("⚠️  No sample partition, offline buffer limited to RTC memory");
+  } else {
+    sectorCount = partition->size / SECTOR_SIZE;
+    recoverFlash();
+  }
+
+  Serial.printf("💾 Sample store: %u in RTC, %u in flash (boot %u)\n",
+                rtcRing.count, flashPending, rtcRing.bootCount);
+}
+
+uint16_t SampleStore::bootId() const {
+  return rtcRing.bootCount;
+}
+
+uint32_t SampleStore::pending() const {
+  return rtcRing.count + flashPending;
+}
+
+bool SampleStore::push(const SensorData& data, uint32_t timestamp) {
+  if (rtcRing.count == SAMPLE_BUFFER_RTC_RECORDS) {
+    if (partition != nullptr) {
+      spillToFlash();
+    }
+    if (rtcRing.count == SAMPLE_BUFFER_RTC_RECORDS) {
+      // No room anywhere: overwrite the oldest RTC record
+      rtcRing.head = (rtcRing.head + 1) % SAMPLE_BUFFER_RTC_RECORDS;
+      rtcRing.count--;
+      droppedCount++;
+    }
+  }
+
+  uint16_t tail = (rtcRing.head + rtcRing.count) % SAMPLE_BUFFER_RTC_RECORDS;
+  rtcRing.records[tail] = packSample(data, timestamp, rtcRing.bootCount, timeEpochMs(timestamp));
+  rtcRing.count++;
+  return true;
+}
+
+bool SampleStore::peek(StoredSample& sample) {
+  // Flash always holds older samples than the RTC ring
+  if (flashPending > 0 && peekFlash(sample)) {
+    peekedFromFlash = true;
+    return true;
+  }
+
+  while (rtcRing.count > 0) {
+    sample = rtcRing.records[rtcRing.head];
+    if (sample.crc == sampleCrc(sample)) {
+      peekedFromFlash = false;
+      return true;
+    }
+    // Corrupted by a brown-out while writing; skip it
+    rtcRing.head = (rtcRing.head + 1) % SAMPLE_BUFFER_RTC_RECORDS;
+    rtcRing.count--;
+    droppedCount++;
+  }
+  return false;
+}
+
+void SampleStore::pop() {
+  if (peekedFromFlash) {
+    uint8_t consumed = SLOT_CONSUMED;
+    size_t offset = readSector * SECTOR_SIZE + readSlot * SLOT_SIZE + offsetof(StoredSample, state);
+    esp_partition_write(partition, offset, &consumed, 1);
+    readSlot++;
+    flashPending--;
+    peekedFromFlash = false;
+    return;
+  }
+
+  if (rtcRing.count > 0) {
+    rtcRing.head = (rtcRing.head + 1) % SAMPLE_BUFFER_RTC_RECORDS;
+    rtcRing.count--;
+  }
+}
+
+void SampleStore::spillToFlash() {
+  // Move the oldest chunk to flash so order is preserved on replay
+  for (int i = 0; i < SAMPLE_SPILL_BATCH && rtcRing.count > 0; i++) {
+    if (!appendFlash(rtcRing.records[rtcRing.head])) {
+      return;
+    }
+    rtcRing.head = (rtcRing.head + 1) % SAMPLE_BUFFER_RTC_RECORDS;
+    rtcRing.count--;
+  }
+}
+
+bool SampleStore::readSlotAt(uint32_t sector, uint32_t slot, StoredSample& sample) {
+  size_t offset = sector * SECTOR_SIZE + slot * SLOT_SIZE;
+  return esp_partition_read(partition, offset, &sample, SLOT_SIZE) == ESP_OK;
+}
+
+bool SampleStore::peekFlash(StoredSample& sample) {
+  while (flashPending > 0) {
+    if (readSlot >= SLOTS_PER_SECTOR) {
+      if (readSector == newestSector) {
+        break;
+      }
+      // Fully consumed sector leaves the log and can be reused
+      readSector = (readSector + 1) % sectorCount;
+      readSlot = 1;
+      oldestSector = readSector;
+      activeSectors--;
+      continue;
+    }
+    if (readSector == newestSector && readSlot >= writeSlot) {
+      break;
+    }
+
+    bool readOk = readSlotAt(readSector, readSlot, sample);
+    if (readOk && sample.state == SLOT_WRITTEN && sample.crc == sampleCrc(sample)) {
+      return true;
+    }
+    if (readOk && sample.state == SLOT_WRITTEN) {
+      flashPending--;
+      droppedCount++;
+    }
+    readSlot++;
+  }
+
+  // Positions and counters disagree (e.g. torn write); resynchronise
+  flashPending = 0;
+  return false;
+}
+
+bool SampleStore::appendFlash(const StoredSample& sample) {
+  if (activeSectors == 0 || writeSlot >= SLOTS_PER_SECTOR) {
+    if (!openSector()) {
+      return false;
+    }
+  }
+
+  size_t offset = newestSector * SECTOR_SIZE + writeSlot * SLOT_SIZE;
+  if (esp_partition_write(partition, offset, &sample, SLOT_SIZE) != ESP_OK) {
+    return false;
+  }
+  writeSlot++;
+  flashPending++;
+  return true;
+}
+
+bool SampleStore::openSector() {
+  uint32_t next = activeSectors == 0 ? 0 : (newestSector + 1) % sectorCount;
+
+  if (activeSectors == sectorCount) {
+    // Log is full: the oldest sector is recycled and its samples are lost
+    uint32_t lost = countWritten(oldestSector);
+    flashPending -= min(lost, flashPending);
+    droppedCount += lost;
+    oldestSector = (oldestSector + 1) % sectorCount;
+    activeSectors--;
+    if (readSector == next) {
+      readSector = oldestSector;
+      readSlot = 1;
+    }
+  }
+
+  if (esp_partition_erase_range(partition, next * SECTOR_SIZE, SECTOR_SIZE) != ESP_OK) {
+    return false;
+  }
+
+  SectorHeader header = { SECTOR_MAGIC, ++lastSeq, SLOT_SIZE, 0 };
+  if (esp_partition_write(partition, next * SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+    return false;
+  }
+
+  if (activeSectors == 0) {
+    oldestSector = next;
+    readSector = next;
+    readSlot = 1;
+  }
+  newestSector = next;
+  writeSlot = 1;
+  activeSectors++;
+  return true;
+}
+
+uint32_t SampleStore::countWritten(uint32_t sector) {
+  uint32_t written = 0;
+  StoredSample sample;
+  for (uint32_t slot = 1; slot < SLOTS_PER_SECTOR; slot++) {
+    if (readSlotAt(sector, slot, sample) && sample.state == SLOT_WRITTEN) {
+      written++;
+    }
+  }
+  return written;
+}
+
+void SampleStore::recoverFlash() {
+  activeSectors = 0;
+  flashPending = 0;
+  lastSeq = 0;
+
+  // The newest sector has the highest sequence number
+  SectorHeader header;
+  bool found = false;
+  for (uint32_t sector = 0; sector < sectorCount; sector++) {
+    if (esp_partition_read(partition, sector * SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+      continue;
+    }
+    if (header.magic == SECTOR_MAGIC && header.slotSize == SLOT_SIZE &&
+        (!found || header.seq > lastSeq)) {
+      lastSeq = header.seq;
+      newestSector = sector;
+      found = true;
+    }
+  }
+  if (!found) {
+    return;
+  }
+
+  // Walk backwards while the sequence is contiguous to find the oldest
+  oldestSector = newestSector;
+  activeSectors = 1;
+  uint32_t expectedSeq = lastSeq;
+  while (activeSectors < sectorCount) {
+    uint32_t previous = (oldestSector + sectorCount - 1) % sectorCount;
+    esp_partition_read(partition, previous * SECTOR_SIZE, &header, sizeof(header));
+    if (header.magic != SECTOR_MAGIC || header.seq != expectedSeq - 1) {
+      break;
+    }
+    expectedSeq--;
+    oldestSector = previous;
+    activeSectors++;
+  }
+
+  // First pending sample is the read position, first blank slot of the
+  // newest sector is the write position
+  bool readFound = false;
+  StoredSample sample;
+  writeSlot = SLOTS_PER_SECTOR;
+  for (uint32_t i = 0; i < activeSectors; i++) {
+    uint32_t sector = (oldestSector + i) % sectorCount;
+    for (uint32_t slot = 1; slot < SLOTS_PER_SECTOR; slot++) {
+      if (!readSlotAt(sector, slot, sample)) {
+        continue;
+      }
+      if (sample.state == SLOT_WRITTEN) {
+        flashPending++;
+        if (!readFound) {
+          readSector = sector;
+          readSlot = slot;
+          readFound = true;
+        }
+      }
+      if (sector == newestSector && writeSlot == SLOTS_PER_SECTOR) {
+        const uint8_t* raw = (const uint8_t*)&sample;
+        bool blank = true;
+        for (size_t b = 0; b < SLOT_SIZE; b++) {
+          blank = blank && raw[b] == 0xFF;
+        }
+        if (blank) {
+          writeSlot = slot;
+        }
+      }
+    }
+  }
+
+  if (!readFound) {
+    readSector = newestSector;
+    readSlot = writeSlot;
+  }
+
+  // Fully consumed sectors ahead of the read position are free again
+  while (oldestSector != readSector) {
+    oldestSector = (oldestSector + 1) % sectorCount;
+    activeSectors--;
+  }
+}
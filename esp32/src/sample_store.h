@@ -0,0 +1,85 @@
+/**
+ * PlanetPlant ESP32 Offline Sample Store
+ * Keeps samples that could not be published: a ring of compact records in
+ * RTC memory, spilling its oldest entries to the "samples" flash partition
+ * when full. Replay order is always oldest first (flash, then RTC).
+ *
+ * Owned by the network task; not thread-safe.
+ */
+
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include <stdint.h>
+#include <esp_partition.h>
+#include "config.h"
+#include "messages.h"
+
+// Compact on-device record (16 bytes, also the flash slot size)
+struct __attribute__((packed)) StoredSample {
+  uint32_t timestamp;       // millis() at capture, or low epoch ms bits (SAMPLE_FLAG_EPOCH)
+  uint16_t bootId;          // Boot the timestamp belongs to, or high epoch ms bits
+  int16_t temperature;      // 0.01 °C
+  uint16_t humidity;        // 0.01 %
+  uint8_t moisture;         // %
+  uint8_t light;            // %
+  uint8_t flags;            // SAMPLE_FLAG_*
+  uint8_t reserved;
+  uint8_t state;            // Flash slot state, see sample_store.cpp
+  uint8_t crc;              // CRC-8 over the preceding bytes except state
+};
+
+static_assert(sizeof(StoredSample) == 16, "StoredSample must stay 16 bytes");
+
+#define SAMPLE_FLAG_PUMP_ACTIVE 0x01
+#define SAMPLE_FLAG_EPOCH       0x02  // Captured with a synced clock, see time_sync.h
+
+// epochMs 0 keeps the uptime timestamp and boot id
+StoredSample packSample(const SensorData& data, uint32_t timestamp, uint16_t bootId, uint64_t epochMs);
+SensorData unpackSample(const StoredSample& sample);
+
+// Capture time in epoch ms, 0 for samples taken before the clock was synced
+uint64_t sampleEpochMs(const StoredSample& sample);
+
+class SampleStore {
+public:
+  // Validate the RTC ring, mount the flash partition and recover its
+  // read/write positions. Call once at boot.
+  void begin();
+
+  // timestamp is millis() at capture; stored as epoch ms once synced
+  bool push(const SensorData& data, uint32_t timestamp);
+  bool peek(StoredSample& sample);  // Oldest pending sample
+  void pop();                       // Drop the sample returned by peek()
+
+  uint32_t pending() const;
+  uint32_t dropped() const { return droppedCount; }
+  uint16_t bootId() const;
+  bool hasFlash() const { return partition != nullptr; }
+
+private:
+  const esp_partition_t* partition = nullptr;
+  uint32_t sectorCount = 0;
+  uint32_t activeSectors = 0;
+  uint32_t oldestSector = 0;
+  uint32_t newestSector = 0;
+  uint32_t readSector = 0;
+  uint32_t readSlot = 0;
+  uint32_t writeSlot = 0;
+  uint32_t lastSeq = 0;
+  uint32_t flashPending = 0;
+  uint32_t droppedCount = 0;
+  bool peekedFromFlash = false;
+
+  void recoverFlash();
+  bool appendFlash(const StoredSample& sample);
+  bool openSector();
+  bool peekFlash(StoredSample& sample);
+  void spillToFlash();
+  uint32_t countWritten(uint32_t sector);
+  bool readSlotAt(uint32_t sector, uint32_t slot, StoredSample& sample);
+};
+
+extern SampleStore sampleStore;
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,174 @@
+/**
+ * PlanetPlant ESP32 Cooperative Scheduler
+ * Binary min-heap of task deadlines; all timestamps are wrap-safe millis()
+ */
+
+#include "scheduler.h"
+
+Scheduler::Scheduler() : taskCount(0), heapSize(0), maxJitterMs(0) {}
+
+int Scheduler::add(TaskCallback callback, uint32_t periodMs, uint32_t initialDelayMs, uint32_t now) {
+  if (taskCount >= SCHEDULER_MAX_TASKS || callback == nullptr) {
+    return SCHEDULER_INVALID_TASK;
+  }
+
+  int taskId = taskCount++;
+  tasks[taskId].callback = callback;
+  tasks[taskId].period = periodMs;
+  tasks[taskId].deadline = now + initialDelayMs;
+  tasks[taskId].heapIndex = -1;
+
+  if (periodMs > 0) {
+    push(taskId);
+  }
+  return taskId;
+}
+
+void Scheduler::runIn(int taskId, uint32_t delayMs, uint32_t now) {
+  if (taskId < 0 || taskId >= taskCount) {
+    return;
+  }
+
+  remove(taskId);
+  tasks[taskId].deadline = now + delayMs;
+  push(taskId);
+}
+
+void Scheduler::cancel(int taskId) {
+  if (taskId < 0 || taskId >= taskCount) {
+    return;
+  }
+  remove(taskId);
+}
+
+void Scheduler::setPeriod(int taskId, uint32_t periodMs, uint32_t now) {
+  if (taskId < 0 || taskId >= taskCount || periodMs == 0) {
+    return;
+  }
+
+  tasks[taskId].period = periodMs;
+  runIn(taskId, periodMs, now);
+}
+
+bool Scheduler::isPending(int taskId) const {
+  return taskId >= 0 && taskId < taskCount && tasks[taskId].heapIndex >= 0;
+}
+
+int Scheduler::run(uint32_t now) {
+  int executed = 0;
+
+  // Bound the work per call so a task that keeps re-arming itself with a
+  // zero delay cannot starve the caller
+  while (heapSize > 0 && executed < taskCount) {
+    int taskId = heap[0];
+    Task& task = tasks[taskId];
+
+    if (before(now, task.deadline)) {
+      break;
+    }
+
+    uint32_t lateness = now - task.deadline;
+    if (lateness > maxJitterMs) {
+      maxJitterMs = lateness;
+    }
+
+    remove(taskId);
+
+    // Reschedule before the callback so it can cancel or re-arm itself.
+    // Fixed-rate periods keep their phase; missed periods are skipped
+    // rather than replayed back-to-back.
+    if (task.period > 0) {
+      uint32_t next = task.deadline + task.period;
+      if (!before(now, next)) {
+        next = now + task.period;
+      }
+      task.deadline = next;
+      push(taskId);
+    }
+
+    task.callback();
+    executed++;
+  }
+
+  return executed;
+}
+
+uint32_t Scheduler::timeUntilNext(uint32_t now, uint32_t maxWaitMs) const {
+  if (heapSize == 0) {
+    return maxWaitMs;
+  }
+
+  uint32_t deadline = tasks[heap[0]].deadline;
+  if (!before(now, deadline)) {
+    return 0;
+  }
+
+  uint32_t wait = deadline - now;
+  return wait < maxWaitMs ? wait : maxWaitMs;
+}
+
+void Scheduler::push(int taskId) {
+  if (tasks[taskId].heapIndex >= 0) {
+    return;
+  }
+
+  heap[heapSize] = taskId;
+  tasks[taskId].heapIndex = heapSize;
+  heapSize++;
+  siftUp(heapSize - 1);
+}
+
+void Scheduler::remove(int taskId) {
+  int index = tasks[taskId].heapIndex;
+  if (index < 0) {
+    return;
+  }
+
+  heapSize--;
+  if (index != heapSize) {
+    swap(index, heapSize);
+    siftDown(index);
+    siftUp(index);
+  }
+  tasks[taskId].heapIndex = -1;
+}
+
+void Scheduler::siftUp(int index) {
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (!before(tasks[heap[index]].deadline, tasks[heap[parent]].deadline)) {
+      break;
+    }
+    swap(index, parent);
+    index = parent;
+  }
+}
+
+void Scheduler::siftDown(int index) {
+  while (true) {
+    int left = 2 * index + 1;
+    int right = left + 1;
+    int smallest = index;
+
+    if (left < heapSize && before(tasks[heap[left]].deadline, tasks[heap[smallest]].deadline)) {
+      smallest = left;
+    }
+    if (right < heapSize && before(tasks[heap[right]].deadline, tasks[heap[smallest]].deadline)) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      break;
+    }
+    swap(index, smallest);
+    index = smallest;
+  }
+}
+
+void Scheduler::swap(int a, int b) {
+  int taskA = heap[a];
+  int taskB = heap[b];
+  heap[a] = taskB;
+  heap[b] = taskA;
+  tasks[taskB].heapIndex = a;
+  tasks[taskA].heapIndex = b;
+}
@@ -0,0 +1,66 @@
+/**
+ * PlanetPlant ESP32 Cooperative Scheduler
+ * Deadline-ordered timers for non-blocking periodic and one-shot tasks
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#define SCHEDULER_MAX_TASKS     16      // Size of the static task table
+#define SCHEDULER_INVALID_TASK  -1
+
+typedef void (*TaskCallback)();
+
+class Scheduler {
+public:
+  Scheduler();
+
+  // Register a task. periodMs == 0 makes it a one-shot that stays
+  // registered but idle until triggered again with runIn().
+  int add(TaskCallback callback, uint32_t periodMs, uint32_t initialDelayMs, uint32_t now);
+
+  // (Re)arm a task to run once after delayMs, keeping its period.
+  void runIn(int taskId, uint32_t delayMs, uint32_t now);
+  void cancel(int taskId);
+
+  // Change a periodic task's period; the next run is one new period from now.
+  void setPeriod(int taskId, uint32_t periodMs, uint32_t now);
+  bool isPending(int taskId) const;
+
+  // Run every task whose deadline has passed, earliest first.
+  // Returns the number of tasks executed.
+  int run(uint32_t now);
+
+  // Milliseconds until the next deadline, capped at maxWaitMs.
+  uint32_t timeUntilNext(uint32_t now, uint32_t maxWaitMs) const;
+
+  // Worst observed lateness (now - deadline) since the last reset.
+  uint32_t maxJitter() const { return maxJitterMs; }
+  void resetJitter() { maxJitterMs = 0; }
+
+private:
+  struct Task {
+    TaskCallback callback;
+    uint32_t period;
+    uint32_t deadline;
+    int heapIndex;            // Position in the heap, -1 while idle
+  };
+
+  Task tasks[SCHEDULER_MAX_TASKS];
+  int heap[SCHEDULER_MAX_TASKS];  // Min-heap of task ids ordered by deadline
+  int taskCount;
+  int heapSize;
+  uint32_t maxJitterMs;
+
+  static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+  void push(int taskId);
+  void remove(int taskId);
+  void siftUp(int index);
+  void siftDown(int index);
+  void swap(int a, int b);
+};
+
+#endif // SCHEDULER_H
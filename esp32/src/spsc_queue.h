@@ -0,0 +1,100 @@
+/**
+ * PlanetPlant ESP32 Lock-Free Queue
+ * Single-producer/single-consumer ring buffer for passing messages between
+ * the pinned FreeRTOS tasks without taking a lock
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Capacity must be a power of two; one producer task, one consumer task
+template <typename T, uint32_t Capacity>
+class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  SpscQueue() : head(0), tail(0), dropped(0) {}
+
+  // Producer side. Returns false (and counts a drop) when full.
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= Capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots[h & (Capacity - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T& item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = slots[t & (Capacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  T slots[Capacity];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
+};
+
+// Byte stream variant with bulk writes and reads; same threading rules
+template <uint32_t Capacity>
+class SpscByteBuffer {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  SpscByteBuffer() : head(0), tail(0) {}
+
+  // Producer side. All or nothing: false when length does not fit.
+  bool write(const uint8_t* data, uint32_t length) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (Capacity - (h - tail.load(std::memory_order_acquire)) < length) {
+      return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+      bytes[(h + i) & (Capacity - 1)] = data[i];
+    }
+    head.store(h + length, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns the number of bytes copied, up to max.
+  uint32_t read(uint8_t* out, uint32_t max) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t available = head.load(std::memory_order_acquire) - t;
+    uint32_t length = available < max ? available : max;
+    for (uint32_t i = 0; i < length; i++) {
+      out[i] = bytes[(t + i) & (Capacity - 1)];
+    }
+    tail.store(t + length, std::memory_order_release);
+    return length;
+  }
+
+  uint32_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+private:
+  uint8_t bytes[Capacity];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,133 @@
+/**
+ * PlanetPlant ESP32 Telemetry Codec
+ */
+
+#include <math.h>
+#include "telemetry_codec.h"
+
+static uint8_t* putU16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+  return out + 2;
+}
+
+static uint8_t* putU32(uint8_t* out, uint32_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+  out[3] = value >> 24;
+  return out + 4;
+}
+
+static uint8_t clampPercent(int value) {
+  return value < 0 ? 0 : (value > 100 ? 100 : (uint8_t)value);
+}
+
+size_t encodeSampleFrame(const TelemetrySample& sample, uint8_t* buffer, size_t capacity) {
+  if (capacity < TELEMETRY_SAMPLE_FRAME_SIZE) {
+    return 0;
+  }
+
+  uint8_t flags = 0;
+  if (sample.pumpActive) flags |= TELEMETRY_FLAG_PUMP_ACTIVE;
+  if (sample.replayed) flags |= TELEMETRY_FLAG_REPLAYED;
+  if (sample.hasAge) flags |= TELEMETRY_FLAG_HAS_AGE;
+  if (sample.epoch) flags |= TELEMETRY_FLAG_EPOCH;
+
+  uint8_t* out = buffer;
+  *out++ = TELEMETRY_FRAME_MAGIC;
+  *out++ = TELEMETRY_FRAME_VERSION;
+  *out++ = TELEMETRY_FRAME_SAMPLE;
+  *out++ = flags;
+  out = putU32(out, (uint32_t)sample.timestamp);
+  out = putU16(out, (uint16_t)(int16_t)lroundf(sample.temperature * 100.0f));
+  out = putU16(out, (uint16_t)lroundf(sample.humidity * 100.0f));
+  *out++ = clampPercent(sample.moisture);
+  *out++ = clampPercent(sample.light);
+  *out++ = (uint8_t)sample.wifiRssi;
+  *out++ = 0;
+  out = putU32(out, sample.freeHeap);
+  out = putU32(out, sample.uptime);
+  out = putU16(out, sample.epoch ? (uint16_t)(sample.timestamp >> 32) : sample.bootId);
+  out = putU32(out, sample.hasAge ? sample.ageMs : 0);
+
+  return out - buffer;
+}
+
+static uint8_t* putVarint(uint8_t* out, int32_t value) {
+  // Zigzag so small negative deltas stay short
+  uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  while (zigzag >= 0x80) {
+    *out++ = (uint8_t)(zigzag | 0x80);
+    zigzag >>= 7;
+  }
+  *out++ = (uint8_t)zigzag;
+  return out;
+}
+
+void batchSampleDelta(const TelemetryBatchSample* previous, const TelemetryBatchSample& sample,
+                      int32_t delta[5]) {
+  if (previous == nullptr) {
+    delta[0] = 0;
+    delta[1] = sample.temperature;
+    delta[2] = sample.humidity;
+    delta[3] = sample.moisture;
+    delta[4] = sample.light;
+    return;
+  }
+
+  delta[0] = (int32_t)(sample.timestamp - previous->timestamp);
+  delta[1] = (int32_t)sample.temperature - previous->temperature;
+  delta[2] = (int32_t)sample.humidity - previous->humidity;
+  delta[3] = (int32_t)sample.moisture - previous->moisture;
+  delta[4] = (int32_t)sample.light - previous->light;
+}
+
+size_t encodeBatchFrame(const TelemetryBatchSample* samples, uint8_t count, uint32_t sentAt,
+                        uint16_t bootId, uint64_t epochMs, const TelemetryHeartbeat* heartbeat,
+                        uint8_t* buffer, size_t capacity) {
+  if (count == 0 || capacity < (size_t)TELEMETRY_BATCH_FRAME_SIZE(count)) {
+    return 0;
+  }
+
+  uint8_t flags = 0;
+  if (heartbeat != nullptr) flags |= TELEMETRY_FLAG_HAS_HEARTBEAT;
+  if (epochMs != 0) flags |= TELEMETRY_FLAG_EPOCH;
+
+  // The dt deltas stay in device ms either way; only the base moves
+  uint32_t base = samples[0].timestamp;
+  if (epochMs != 0) {
+    sentAt = (uint32_t)epochMs + (sentAt - base);
+    base = (uint32_t)epochMs;
+    bootId = (uint16_t)(epochMs >> 32);
+  }
+
+  uint8_t* out = buffer;
+  *out++ = TELEMETRY_FRAME_MAGIC;
+  *out++ = TELEMETRY_FRAME_VERSION;
+  *out++ = TELEMETRY_FRAME_BATCH;
+  *out++ = flags;
+  out = putU32(out, base);
+  out = putU32(out, sentAt);
+  out = putU16(out, bootId);
+  *out++ = count;
+  *out++ = 0;
+
+  if (heartbeat != nullptr) {
+    *out++ = (uint8_t)heartbeat->wifiRssi;
+    *out++ = 0;
+    out = putU32(out, heartbeat->freeHeap);
+    out = putU32(out, heartbeat->uptime);
+  }
+
+  int32_t delta[5];
+  for (uint8_t i = 0; i < count; i++) {
+    batchSampleDelta(i > 0 ? &samples[i - 1] : nullptr, samples[i], delta);
+    for (int field = 0; field < 5; field++) {
+      out = putVarint(out, delta[field]);
+    }
+    *out++ = samples[i].flags;
+  }
+
+  return out - buffer;
+}
@@ -0,0 +1,115 @@
+/**
+ * PlanetPlant ESP32 Telemetry Codec
+ * Versioned fixed binary layout for sensor samples, selected with
+ * TELEMETRY_FORMAT in config.h. Decoded by raspberry-pi/src/utils/telemetryCodec.js.
+ *
+ * Frame v1 (little-endian, 30 bytes):
+ *   0  u8   magic 0xA7 (never '{', so JSON and binary can share a topic)
+ *   1  u8   version
+ *   2  u8   frame type (TELEMETRY_FRAME_SAMPLE)
+ *   3  u8   flags (TELEMETRY_FLAG_*)
+ *   4  u32  timestamp (ms; low 32 bits with TELEMETRY_FLAG_EPOCH)
+ *   8  i16  temperature (0.01 °C)
+ *   10 u16  humidity (0.01 %)
+ *   12 u8   moisture (%)
+ *   13 u8   light (%)
+ *   14 i8   wifi_rssi (dBm)
+ *   15 u8   reserved
+ *   16 u32  free_heap (bytes)
+ *   20 u32  uptime (ms)
+ *   24 u16  boot_id (high 16 timestamp bits with TELEMETRY_FLAG_EPOCH)
+ *   26 u32  age_ms (valid with TELEMETRY_FLAG_HAS_AGE)
+ *
+ * Fields are only ever appended; decoders ignore trailing bytes they do not know.
+ *
+ * Timestamps are device uptime until the clock is synced (time_sync.h).
+ * TELEMETRY_FLAG_EPOCH then marks them as 48-bit epoch ms, the high bits
+ * taking the place of boot_id, which only qualifies uptime timestamps.
+ *
+ * Batch frame v1 (header little-endian, then varints):
+ *   0  u8   magic, 1 u8 version, 2 u8 frame type (TELEMETRY_FRAME_BATCH), 3 u8 flags
+ *   4  u32  timestamp of the first sample (ms), the base the dt deltas add to
+ *   8  u32  sent_at (ms); a sample's age is sent_at - its timestamp (mod 2^32)
+ *   12 u16  boot_id (high 16 bits of the base with TELEMETRY_FLAG_EPOCH)
+ *   14 u8   sample count
+ *   15 u8   reserved
+ *   16      heartbeat block if TELEMETRY_FLAG_HAS_HEARTBEAT:
+ *           i8 wifi_rssi, u8 reserved, u32 free_heap, u32 uptime
+ *   then per sample, each value delta-encoded against the previous sample
+ *   (the first against zero) as zigzag LEB128 varints:
+ *           dt (ms), temperature (0.01 °C), humidity (0.01 %), moisture, light
+ *   followed by one u8 of TELEMETRY_FLAG_PUMP_ACTIVE.
+ *
+ * The JSON batch carries the same deltas as
+ *   "samples": [[dt, temperature, humidity, moisture, light, flags], ...]
+ */
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_FRAME_MAGIC   0xA7
+#define TELEMETRY_FRAME_VERSION 1
+#define TELEMETRY_FRAME_SAMPLE  1
+#define TELEMETRY_FRAME_BATCH   2
+
+#define TELEMETRY_FLAG_PUMP_ACTIVE  0x01
+#define TELEMETRY_FLAG_REPLAYED     0x02
+#define TELEMETRY_FLAG_HAS_AGE      0x04
+#define TELEMETRY_FLAG_HAS_HEARTBEAT 0x08
+#define TELEMETRY_FLAG_EPOCH        0x10
+
+#define TELEMETRY_SAMPLE_FRAME_SIZE 30
+#define TELEMETRY_BATCH_HEADER_SIZE 26  // Including the heartbeat block
+#define TELEMETRY_BATCH_SAMPLE_MAX  16  // Worst-case encoded size of one sample
+
+#define TELEMETRY_BATCH_FRAME_SIZE(count) \
+  (TELEMETRY_BATCH_HEADER_SIZE + (count) * TELEMETRY_BATCH_SAMPLE_MAX)
+
+struct TelemetrySample {
+  uint64_t timestamp;       // Epoch ms with epoch set, uptime ms otherwise
+  bool epoch;
+  float temperature;
+  float humidity;
+  int moisture;
+  int light;
+  bool pumpActive;
+  int8_t wifiRssi;
+  uint32_t freeHeap;
+  uint32_t uptime;
+  uint16_t bootId;
+  bool replayed;
+  bool hasAge;
+  uint32_t ageMs;
+};
+
+// Batch entries are kept in wire units so deltas are exact
+struct TelemetryBatchSample {
+  uint32_t timestamp;       // millis() at capture
+  int16_t temperature;      // 0.01 °C
+  uint16_t humidity;        // 0.01 %
+  uint8_t moisture;
+  uint8_t light;
+  uint8_t flags;            // TELEMETRY_FLAG_PUMP_ACTIVE
+};
+
+struct TelemetryHeartbeat {
+  int8_t wifiRssi;
+  uint32_t freeHeap;
+  uint32_t uptime;
+};
+
+// Delta between consecutive batch entries, in the order they go on the wire
+void batchSampleDelta(const TelemetryBatchSample* previous, const TelemetryBatchSample& sample,
+                      int32_t delta[5]);
+
+// Return the frame length, or 0 if capacity is too small. For batches,
+// epochMs is the epoch time of samples[0]; 0 sends uptime and bootId.
+size_t encodeSampleFrame(const TelemetrySample& sample, uint8_t* buffer, size_t capacity);
+size_t encodeBatchFrame(const TelemetryBatchSample* samples, uint8_t count, uint32_t sentAt,
+                        uint16_t bootId, uint64_t epochMs, const TelemetryHeartbeat* heartbeat,
+                        uint8_t* buffer, size_t capacity);
+
+#endif // TELEMETRY_CODEC_H
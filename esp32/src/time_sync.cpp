@@ -0,0 +1,146 @@
+/**
+ * PlanetPlant ESP32 Time Synchronization
+ * RTC_NOINIT_ATTR like power.cpp: the sync point survives deep sleep, the
+ * magic check catches power-on garbage. The SNTP callback runs on the
+ * lwIP task, so the point is swapped under a lock.
+ */
+
+#include <Arduino.h>
+#include <esp_sntp.h>
+#include <math.h>
+#include "time_sync.h"
+#include "power.h"
+
+#define TIME_SYNC_MAGIC     0x50505453  // "PPTS"
+#define MAX_EXTRAPOLATION   INT32_MAX   // powerClock() differences stay signed (~24 days)
+
+struct TimeSyncState {
+  uint32_t magic;
+  uint32_t clockAtSync;     // powerClock() at the last sync
+  uint64_t epochAtSync;     // Epoch ms at clockAtSync
+  float driftPpm;
+  bool driftMeasured;
+  uint32_t syncCount;
+  int32_t lastCorrectionMs;
+};
+
+RTC_NOINIT_ATTR static TimeSyncState state;
+static portMUX_TYPE timeLock = portMUX_INITIALIZER_UNLOCKED;
+
+static TimeSyncState snapshot() {
+  portENTER_CRITICAL(&timeLock);
+  TimeSyncState copy = state;
+  portEXIT_CRITICAL(&timeLock);
+  return copy;
+}
+
+static void publish(const TimeSyncState& next) {
+  portENTER_CRITICAL(&timeLock);
+  state = next;
+  portEXIT_CRITICAL(&timeLock);
+}
+
+static bool valid(const TimeSyncState& sync, uint32_t clock) {
+  if (sync.magic != TIME_SYNC_MAGIC) {
+    return false;
+  }
+  int32_t elapsed = (int32_t)(clock - sync.clockAtSync);
+  return elapsed > -MAX_EXTRAPOLATION && elapsed < MAX_EXTRAPOLATION;
+}
+
+static uint64_t extrapolate(const TimeSyncState& sync, uint32_t clock) {
+  // Signed, so samples taken before the sync point are placed too
+  int32_t elapsed = (int32_t)(clock - sync.clockAtSync);
+  int64_t corrected = elapsed + (int64_t)lroundf(elapsed * sync.driftPpm * 1e-6f);
+  return sync.epochAtSync + corrected;
+}
+
+static void onTimeSync(struct timeval* tv) {
+  uint64_t epochMs = (uint64_t)tv->tv_sec * 1000ULL + tv->tv_usec / 1000;
+  uint32_t clock = powerClock();
+
+  TimeSyncState next = snapshot();
+  if (valid(next, clock)) {
+    int32_t elapsed = (int32_t)(clock - next.clockAtSync);
+    next.lastCorrectionMs = (int32_t)((int64_t)epochMs - (int64_t)extrapolate(next, clock));
+
+    // Rate error over the whole interval; short ones are dominated by
+    // SNTP round-trip jitter
+    if (elapsed >= TIME_DRIFT_MIN_SPAN) {
+      int64_t gained = (int64_t)(epochMs - next.epochAtSync) - elapsed;
+      float measured = gained * 1e6f / elapsed;
+      if (fabsf(measured) > TIME_DRIFT_MAX_PPM) {
+        // A clock step, not drift: start measuring afresh
+        next.driftPpm = 0;
+        next.driftMeasured = false;
+      } else if (!next.driftMeasured) {
+        next.driftPpm = measured;
+        next.driftMeasured = true;
+      } else {
+        next.driftPpm += TIME_DRIFT_SMOOTHING * (measured - next.driftPpm);
+      }
+    }
+    next.syncCount++;
+  } else {
+    next = {};
+    next.magic = TIME_SYNC_MAGIC;
+    next.syncCount = 1;
+  }
+  next.epochAtSync = epochMs;
+  next.clockAtSync = clock;
+  publish(next);
+
+  Serial.printf("🕒 Time synced: %+ld ms correction, drift %.1f ppm\n",
+                (long)next.lastCorrectionMs, next.driftPpm);
+}
+
+void timeSyncBegin() {
+  // powerClock() only runs on across deep sleep; after a reset it
+  // restarts behind the stored point
+  esp_sleep_wakeup_cause_t cause = wakeCause();
+  bool slept = cause == ESP_SLEEP_WAKEUP_TIMER || cause == WAKE_CAUSE_BUTTON;
+  if (!slept || !valid(state, powerClock())) {
+    TimeSyncState cleared = {};
+    publish(cleared);
+  }
+
+  // Recently synced duty-cycle wakes skip SNTP and extrapolate
+  if (DEEP_SLEEP_ENABLED && timeSynced() && timeSyncStatus().sinceSyncMs < TIME_RESYNC_INTERVAL) {
+    return;
+  }
+
+  sntp_set_time_sync_notification_cb(onTimeSync);
+  sntp_set_sync_interval(TIME_RESYNC_INTERVAL);
+  configTime(0, 0, NTP_SERVER, NTP_SERVER_FALLBACK);
+}
+
+bool timeSynced() {
+  return valid(snapshot(), powerClock());
+}
+
+uint64_t timeEpochMs(uint32_t uptimeMs) {
+  // Same offset powerClock() adds to millis()
+  uint32_t clock = dutyState.clockBase + uptimeMs;
+  TimeSyncState sync = snapshot();
+  return valid(sync, clock) ? extrapolate(sync, clock) : 0;
+}
+
+uint64_t timeStamp(uint32_t uptimeMs) {
+  uint64_t epochMs = timeEpochMs(uptimeMs);
+  return epochMs != 0 ? epochMs : uptimeMs;
+}
+
+TimeSyncStatus timeSyncStatus() {
+  TimeSyncState sync = snapshot();
+  uint32_t clock = powerClock();
+
+  TimeSyncStatus status = {};
+  status.synced = valid(sync, clock);
+  if (status.synced) {
+    status.syncCount = sync.syncCount;
+    status.sinceSyncMs = clock - sync.clockAtSync;
+    status.driftPpm = sync.driftPpm;
+    status.lastCorrectionMs = sync.lastCorrectionMs;
+  }
+  return status;
+}
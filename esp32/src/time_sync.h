@@ -0,0 +1,43 @@
+/**
+ * PlanetPlant ESP32 Time Synchronization
+ * SNTP sets one sync point (epoch ms at a powerClock() value) kept in RTC
+ * memory, so it survives deep sleep. Between syncs the epoch is
+ * extrapolated from powerClock(), corrected by the drift measured over
+ * previous syncs.
+ *
+ * Events keep millis() timestamps on the device; the network task turns
+ * them into epoch ms when it publishes or stores them. Before the first
+ * sync wire timestamps stay uptime ms, which the backend tells apart by
+ * magnitude (uptime never exceeds 2^32).
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include "config.h"
+
+struct TimeSyncStatus {
+  bool synced;
+  uint32_t syncCount;       // Since the sync point was first set
+  uint32_t sinceSyncMs;
+  float driftPpm;           // Local clock rate error; positive = runs slow
+  int32_t lastCorrectionMs; // Measured minus extrapolated epoch at the last sync
+};
+
+// Network task, before any event is handled: drops a sync point the
+// clock can no longer be trusted against (power-on, reset) and starts
+// SNTP. Deep-sleep wakes only resync every TIME_RESYNC_INTERVAL.
+void timeSyncBegin();
+
+bool timeSynced();
+
+// Epoch ms for a millis() value of this boot; 0 while unsynced.
+uint64_t timeEpochMs(uint32_t uptimeMs);
+
+// Wire timestamp: epoch ms once synced, uptimeMs itself before.
+uint64_t timeStamp(uint32_t uptimeMs);
+
+TimeSyncStatus timeSyncStatus();
+
+#endif // TIME_SYNC_H
@@ -0,0 +1,228 @@
+/**
+ * PlanetPlant ESP32 TLS Channel
+ * RTC_NOINIT_ATTR like command_log.cpp: the cached session survives deep
+ * sleep and software resets and is dropped at power-on. It is tied to the
+ * server name, so pointing the firmware at another broker starts afresh.
+ */
+
+#include <esp_system.h>
+#include "fnv1a.h"
+#include "tls_channel.h"
+
+#define TLS_SESSION_MAGIC   0x50505453  // "PPTS"
+
+struct TlsSessionCache {
+  uint32_t magic;
+  uint32_t server;          // fnv1a32() of the server name
+  uint32_t length;
+  uint8_t data[TLS_SESSION_CACHE_SIZE];   // mbedtls_ssl_session_save() format
+};
+
+RTC_NOINIT_ATTR static TlsSessionCache sessionCache;
+
+// AES-GCM only: both the cipher and the PRF hash run on the accelerators
+static const int cipherSuites[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+  MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,
+  0
+};
+
+bool TlsChannel::begin(const char* serverName, const char* caPem, AsyncClient* client, MqttRxStream* stream) {
+  tcp = client;
+  rx = stream;
+  serverHash = fnv1a32(serverName);
+
+  mbedtls_ssl_init(&ssl);
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_x509_crt_init(&ca);
+  mbedtls_ssl_session_init(&cached);
+
+  error = mbedtls_x509_crt_parse(&ca, (const unsigned char*)caPem, strlen(caPem) + 1);
+  if (error == 0) {
+    error = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                        MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (error != 0) {
+    return false;
+  }
+
+  mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+  mbedtls_ssl_conf_rng(&conf, fillRandom, nullptr);
+  mbedtls_ssl_conf_min_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+  mbedtls_ssl_conf_ciphersuites(&conf, cipherSuites);
+  mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+  // Keeps the broker's records within the received-bytes stream
+  mbedtls_ssl_conf_max_frag_len(&conf, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+#endif
+
+  error = mbedtls_ssl_setup(&ssl, &conf);
+  if (error == 0) {
+    error = mbedtls_ssl_set_hostname(&ssl, serverName);
+  }
+  if (error != 0) {
+    return false;
+  }
+  mbedtls_ssl_set_bio(&ssl, this, sendBytes, receiveBytes, nullptr);
+
+  loadSession();
+  return true;
+}
+
+void TlsChannel::start() {
+  mbedtls_ssl_session_reset(&ssl);
+  if (haveCached) {
+    mbedtls_ssl_set_session(&ssl, &cached);
+  }
+  startedAt = micros();
+  handshakeUs = 0;
+  wasResumed = false;
+  error = 0;
+}
+
+TlsStep TlsChannel::handshake() {
+  int result = mbedtls_ssl_handshake(&ssl);
+  tcp->send();
+  if (result == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return TLS_STEP_PENDING;
+  }
+  if (result != 0) {
+    // Never offer a session again that may have caused the failure
+    error = result;
+    mbedtls_ssl_session_free(&cached);
+    mbedtls_ssl_session_init(&cached);
+    haveCached = false;
+    sessionCache.magic = 0;
+    return TLS_STEP_FAILED;
+  }
+
+  handshakeUs = micros() - startedAt;
+  keepSession();
+  return TLS_STEP_DONE;
+}
+
+uint32_t TlsChannel::verifyFlags() const {
+  return mbedtls_ssl_get_verify_result(&ssl);
+}
+
+int TlsChannel::read(uint8_t* out, size_t max) {
+  if (max == 0) {
+    return 0;
+  }
+  int result = mbedtls_ssl_read(&ssl, out, max);
+  if (result > 0) {
+    return result;
+  }
+  if (result == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return 0;
+  }
+  // 0 is end of stream; close_notify and record errors end it as well
+  error = result;
+  return -1;
+}
+
+bool TlsChannel::write(const uint8_t* data, size_t length) {
+  // A record larger than the fragment limit is split; each call
+  // returns what it took
+  size_t written = 0;
+  while (written < length) {
+    int result = mbedtls_ssl_write(&ssl, data + written, length - written);
+    if (result <= 0) {
+      // WANT_WRITE included: wireSize() said it would fit
+      error = result;
+      return false;
+    }
+    written += result;
+  }
+  return true;
+}
+
+size_t TlsChannel::wireSize(size_t length) const {
+  int expansion = mbedtls_ssl_get_record_expansion(&ssl);
+  int payload = mbedtls_ssl_get_max_out_record_payload(&ssl);
+  if (expansion < 0 || payload <= 0) {
+    return SIZE_MAX;
+  }
+  size_t records = (length + payload - 1) / payload;
+  return length + records * expansion;
+}
+
+void TlsChannel::close() {
+  mbedtls_ssl_close_notify(&ssl);
+  tcp->send();
+}
+
+int TlsChannel::sendBytes(void* context, const unsigned char* data, size_t length) {
+  TlsChannel* channel = (TlsChannel*)context;
+  size_t room = min(channel->tcp->space(), length);
+  size_t added = room > 0 ? channel->tcp->add((const char*)data, room) : 0;
+  return added > 0 ? (int)added : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int TlsChannel::receiveBytes(void* context, unsigned char* out, size_t max) {
+  TlsChannel* channel = (TlsChannel*)context;
+  uint32_t length = channel->rx->read(out, max);
+  return length > 0 ? (int)length : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+int TlsChannel::fillRandom(void* context, unsigned char* out, size_t length) {
+  // Hardware RNG; true random while the radio is on, which it is here
+  esp_fill_random(out, length);
+  return 0;
+}
+
+void TlsChannel::keepSession() {
+  mbedtls_ssl_session negotiated;
+  mbedtls_ssl_session_init(&negotiated);
+  if (mbedtls_ssl_get_session(&ssl, &negotiated) != 0) {
+    mbedtls_ssl_session_free(&negotiated);
+    return;
+  }
+
+  // Resumption reuses the master secret; a full handshake derives a new one
+  wasResumed = haveCached && memcmp(negotiated.master, cached.master, sizeof(cached.master)) == 0;
+  mbedtls_ssl_session_free(&cached);
+  cached = negotiated;
+  haveCached = true;
+
+  // Resumption needs the ID, ticket and master secret only; with the
+  // peer certificate the broker's chain alone overflows RTC memory
+  size_t length = 0;
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+  mbedtls_x509_crt* peerCert = cached.peer_cert;
+  cached.peer_cert = nullptr;
+#endif
+  int result = mbedtls_ssl_session_save(&cached, sessionCache.data, sizeof(sessionCache.data), &length);
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+  cached.peer_cert = peerCert;
+#endif
+  if (result == 0) {
+    sessionCache.magic = TLS_SESSION_MAGIC;
+    sessionCache.server = serverHash;
+    sessionCache.length = length;
+  } else {
+    // Resumption only until the next reset
+    sessionCache.magic = 0;
+    saveFailures++;
+    Serial.printf("⚠️ TLS session not kept in RTC memory: -0x%04x, %u bytes\n", -result, (unsigned)length);
+  }
+}
+
+void TlsChannel::loadSession() {
+  if (sessionCache.magic != TLS_SESSION_MAGIC || esp_reset_reason() == ESP_RST_POWERON ||
+      sessionCache.server != serverHash || sessionCache.length > sizeof(sessionCache.data)) {
+    sessionCache.magic = 0;
+    return;
+  }
+  // Fails on data from firmware with a different mbedtls configuration
+  haveCached = mbedtls_ssl_session_load(&cached, sessionCache.data, sessionCache.length) == 0;
+  if (!haveCached) {
+    mbedtls_ssl_session_free(&cached);
+    mbedtls_ssl_session_init(&cached);
+    sessionCache.magic = 0;
+  }
+}
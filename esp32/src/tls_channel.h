@@ -0,0 +1,95 @@
+/**
+ * PlanetPlant ESP32 TLS Channel
+ * mbedtls TLS 1.2 client between MqttLink and its AsyncTCP connection:
+ * records go out through AsyncClient::add() and come in from the link's
+ * received-bytes stream, so the handshake and every read and write run on
+ * the owning task without blocking.
+ *
+ * Bulk crypto is limited to AES-GCM suites, which run on the ESP32's AES
+ * and SHA blocks, and RSA/ECDHE use the MPI accelerator, as enabled in
+ * the Arduino core's mbedtls build. The record buffers are allocated once
+ * in begin(); a handshake only allocates while it runs.
+ *
+ * The last negotiated session (ID and ticket) is offered on the next
+ * connect, so a reconnect after a WiFi drop resumes with an abbreviated
+ * handshake. A serialized copy lives in RTC memory to do the same after
+ * deep sleep or a software reset, without the peer certificate that a
+ * resumed handshake does not check again; it never leaves the chip.
+ */
+
+#ifndef TLS_CHANNEL_H
+#define TLS_CHANNEL_H
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include "config.h"
+#include "spsc_queue.h"
+
+typedef SpscByteBuffer<MQTT_RX_STREAM_SIZE> MqttRxStream;
+
+enum TlsStep : int8_t {
+  TLS_STEP_FAILED = -1,
+  TLS_STEP_PENDING = 0,     // Waiting for the peer or for send buffer space
+  TLS_STEP_DONE = 1
+};
+
+class TlsChannel {
+public:
+  // Once, before the first start(). False on a bad CA certificate or
+  // when mbedtls cannot allocate its buffers.
+  bool begin(const char* serverName, const char* caPem, AsyncClient* tcp, MqttRxStream* rx);
+
+  // New TCP connection: reset the context and offer the cached session.
+  void start();
+
+  // Advance the handshake as far as the received bytes allow
+  TlsStep handshake();
+
+  uint32_t handshakeMicros() const { return handshakeUs; }
+  bool resumed() const { return wasResumed; }
+  uint32_t sessionSaveFailures() const { return saveFailures; }   // Sessions too large for RTC memory
+  int lastError() const { return error; }   // mbedtls error code
+  uint32_t verifyFlags() const;             // MBEDTLS_X509_BADCERT_* of the last handshake
+
+  // Plaintext bytes copied into out, 0 when nothing has arrived, -1 once
+  // the peer closed or the record layer failed
+  int read(uint8_t* out, size_t max);
+
+  // Encrypt and hand to TCP. Check wireSize() against tcp.space() first;
+  // false when the record layer failed.
+  bool write(const uint8_t* data, size_t length);
+
+  // Bytes on the wire for length bytes of plaintext
+  size_t wireSize(size_t length) const;
+
+  // Send close_notify, best effort
+  void close();
+
+private:
+  AsyncClient* tcp = nullptr;
+  MqttRxStream* rx = nullptr;
+  uint32_t serverHash = 0;
+
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config conf;
+  mbedtls_x509_crt ca;
+  mbedtls_ssl_session cached;
+  bool haveCached = false;
+
+  uint32_t startedAt = 0;     // micros()
+  uint32_t handshakeUs = 0;
+  bool wasResumed = false;
+  uint32_t saveFailures = 0;
+  int error = 0;
+
+  static int sendBytes(void* context, const unsigned char* data, size_t length);
+  static int receiveBytes(void* context, unsigned char* out, size_t max);
+  static int fillRandom(void* context, unsigned char* out, size_t length);
+
+  void keepSession();
+  void loadSession();
+};
+
+#endif // TLS_CHANNEL_H
@@ -0,0 +1,26 @@
+/**
+ * PlanetPlant MQTT Topic Scheme
+ * fnv1a32() as in fnv1a.h; the backend computes the same shard for
+ * devices it has not heard from yet.
+ */
+
+#include <stdio.h>
+#include "fnv1a.h"
+#include "topics.h"
+
+uint8_t topicShard(const char* deviceId) {
+  return fnv1a32(deviceId) % TOPIC_SHARD_COUNT;
+}
+
+size_t formatDeviceTopic(char* out, size_t size, const char* site, const char* deviceId,
+                         const char* direction, const char* name) {
+  int length = snprintf(out, size, TOPIC_ROOT "/" TOPIC_VERSION "/%s/%02u/%s/%s/%s",
+                        site, (unsigned)topicShard(deviceId), deviceId, direction, name);
+  if (length < 0 || (size_t)length >= size) {
+    if (size > 0) {
+      out[0] = 0;
+    }
+    return 0;
+  }
+  return length;
+}
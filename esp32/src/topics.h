@@ -0,0 +1,61 @@
+/**
+ * PlanetPlant MQTT Topic Scheme
+ * One versioned hierarchy for every device topic:
+ *
+ *   planetplant/v1/<site>/<shard>/<device_id>/evt/<channel>   device to server
+ *   planetplant/v1/<site>/<shard>/<device_id>/cmd/<command>   server to device
+ *
+ * <site> is MQTT_SITE from config.h. <shard> is the FNV-1a hash of the
+ * device id modulo TOPIC_SHARD_COUNT as two digits, fixed per device, so
+ * consumers can take whole shards (planetplant/v1/+/03/+/evt/data) when
+ * they need per-device ordering, or split everything between workers with
+ * a shared subscription ($share/<group>/planetplant/v1/+/+/+/evt/data).
+ *
+ * The names below are mirrored in raspberry-pi/src/config/topics.js;
+ * `npm run check:topics` there compares the two. A change to the layout
+ * gets a new TOPIC_VERSION, the backend accepts both while fleets migrate.
+ */
+
+#ifndef TOPICS_H
+#define TOPICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOPIC_ROOT              "planetplant"
+#define TOPIC_VERSION           "v1"
+#define TOPIC_SHARD_COUNT       16
+#define TOPIC_EVENTS            "evt"
+#define TOPIC_COMMANDS          "cmd"
+
+// Event channels
+#define TOPIC_DATA              "data"
+#define TOPIC_BATCH             "batch"
+#define TOPIC_AGGREGATE         "aggregate"
+#define TOPIC_STATUS            "status"
+#define TOPIC_PUMP              "pump"
+#define TOPIC_WATERING          "watering"
+#define TOPIC_HEARTBEAT         "heartbeat"
+#define TOPIC_CONFIG_ACK        "config"
+#define TOPIC_COMMAND_ACK       "ack"
+#define TOPIC_METRICS           "metrics"
+#define TOPIC_OTA_STATUS        "ota"
+#define TOPIC_SAMPLE_RATE       "rate"
+#define TOPIC_CALIBRATION       "calibration"
+#define TOPIC_MESH              "mesh"
+#define TOPIC_TRACE             "trace"
+
+// Commands
+#define TOPIC_WATER_COMMAND     "water"
+#define TOPIC_CONFIG_COMMAND    "config"
+#define TOPIC_OTA_COMMAND       "ota"
+#define TOPIC_CALIBRATE_COMMAND "calibrate"
+
+uint8_t topicShard(const char* deviceId);
+
+// <root>/<version>/<site>/<shard>/<deviceId>/<direction>/<name>; the
+// length written, or 0 when it does not fit in size
+size_t formatDeviceTopic(char* out, size_t size, const char* site, const char* deviceId,
+                         const char* direction, const char* name);
+
+#endif // TOPICS_H
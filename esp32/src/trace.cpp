@@ -0,0 +1,120 @@
+/**
+ * PlanetPlant ESP32 Profiling Trace
+ */
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "trace.h"
+
+struct TraceRecord {
+  uint32_t timeUs;
+  uint32_t cycles;
+  uint8_t phase;
+  uint8_t flags;            // TraceEvent | core << 7
+  uint16_t arg;
+};
+
+// Normal builds keep a single slot rather than the whole buffer
+static TraceRecord traceRecords[PROFILE_TRACE_ENABLED ? PROFILE_TRACE_RECORDS : 1];
+static uint16_t traceHead = 0;
+static uint16_t traceCount = 0;
+static uint32_t traceDropped = 0;
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t* putU16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+  return out + 2;
+}
+
+static uint8_t* putU32(uint8_t* out, uint32_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+  out[3] = value >> 24;
+  return out + 4;
+}
+
+void traceRecord(TracePhase phase, TraceEvent event, uint16_t arg) {
+  TraceRecord record;
+  record.timeUs = (uint32_t)esp_timer_get_time();
+  record.cycles = ESP.getCycleCount();
+  record.phase = phase;
+  record.flags = event | (xPortGetCoreID() << 7);
+  record.arg = arg;
+
+  portENTER_CRITICAL(&traceLock);
+  if (traceCount < PROFILE_TRACE_RECORDS) {
+    traceRecords[(traceHead + traceCount) % PROFILE_TRACE_RECORDS] = record;
+    traceCount++;
+  } else {
+    traceDropped++;
+  }
+  portEXIT_CRITICAL(&traceLock);
+}
+
+size_t traceTakeFrame(uint8_t* buffer, size_t capacity) {
+  if (!PROFILE_TRACE_ENABLED || capacity < TRACE_FRAME_SIZE(1)) {
+    return 0;
+  }
+  size_t fits = (capacity - TRACE_HEADER_SIZE) / TRACE_RECORD_SIZE;
+  uint16_t limit = fits < TRACE_FRAME_RECORDS ? fits : TRACE_FRAME_RECORDS;
+
+  // Recorders only append past head + count, so the taken records stay
+  // put while they are encoded outside the lock
+  portENTER_CRITICAL(&traceLock);
+  uint16_t head = traceHead;
+  uint16_t count = traceCount < limit ? traceCount : limit;
+  uint32_t dropped = traceDropped;
+  traceDropped = 0;
+  portEXIT_CRITICAL(&traceLock);
+
+  if (count == 0 && dropped == 0) {
+    return 0;
+  }
+
+  uint8_t* out = buffer;
+  *out++ = TRACE_FRAME_MAGIC;
+  *out++ = TRACE_FRAME_VERSION;
+  out = putU16(out, count);
+  out = putU16(out, ESP.getCpuFreqMHz());
+  out = putU16(out, dropped < UINT16_MAX ? dropped : UINT16_MAX);
+  out = putU32(out, (uint32_t)esp_timer_get_time());
+  for (uint16_t i = 0; i < count; i++) {
+    const TraceRecord& record = traceRecords[(head + i) % PROFILE_TRACE_RECORDS];
+    out = putU32(out, record.timeUs);
+    out = putU32(out, record.cycles);
+    *out++ = record.phase;
+    *out++ = record.flags;
+    out = putU16(out, record.arg);
+  }
+
+  portENTER_CRITICAL(&traceLock);
+  traceHead = (head + count) % PROFILE_TRACE_RECORDS;
+  traceCount -= count;
+  portEXIT_CRITICAL(&traceLock);
+  return out - buffer;
+}
+
+void traceDumpSerial() {
+  static uint8_t frame[TRACE_FRAME_SIZE(TRACE_FRAME_RECORDS)];
+  static const char digits[] = "0123456789abcdef";
+
+  size_t length;
+  while ((length = traceTakeFrame(frame, sizeof(frame))) > 0) {
+    Serial.print("TRACE:");
+    char chunk[65];
+    size_t used = 0;
+    for (size_t i = 0; i < length; i++) {
+      chunk[used++] = digits[frame[i] >> 4];
+      chunk[used++] = digits[frame[i] & 0x0F];
+      if (used == sizeof(chunk) - 1 || i == length - 1) {
+        chunk[used] = 0;
+        Serial.print(chunk);
+        used = 0;
+      }
+    }
+    Serial.println();
+  }
+  Serial.flush();
+}
@@ -0,0 +1,101 @@
+/**
+ * PlanetPlant ESP32 Profiling Trace
+ * Begin/end timestamps of the phases of a cycle (boot, WiFi association,
+ * sensor reads, payload serialization, MQTT), for builds with
+ * PROFILE_TRACE_ENABLED (pio run -e profile). Each record carries the
+ * esp_timer microsecond clock and the CPU cycle counter of the core it
+ * ran on; raspberry-pi/scripts/profile-trace.js turns the records into a
+ * timeline and an energy estimate per cycle.
+ *
+ * Records go into a PROFILE_TRACE_RECORDS buffer shared by both tasks,
+ * each one a short copy under a spinlock. When it is full new records
+ * are dropped and counted. The network task drains it every
+ * PROFILE_TRACE_DUMP_INTERVAL, and enterDeepSleep() before sleeping.
+ * Without PROFILE_TRACE_ENABLED every call compiles to nothing.
+ *
+ * Frame, little-endian (12-byte header + 12 bytes per record):
+ *   0  u8   magic 0xAB
+ *   1  u8   version
+ *   2  u16  record count
+ *   4  u16  CPU clock (MHz)
+ *   6  u16  records dropped since the previous frame (saturating)
+ *   8  u32  esp_timer us when the frame was taken
+ *   per record:
+ *   0  u32  esp_timer us (low 32 bits)
+ *   4  u32  CPU cycle counter of the recording core
+ *   8  u8   phase (TracePhase)
+ *   9  u8   event (TRACE_EVENT_*) | core << 7
+ *   10 u16  arg: bytes for serialize/publish, 1 for a connect that got a
+ *           session, seconds for deep sleep, channel for ESP-NOW sends
+ *
+ * Serial dumps print one frame per line as "TRACE:<hex>".
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define TRACE_FRAME_MAGIC       0xAB
+#define TRACE_FRAME_VERSION     1
+#define TRACE_HEADER_SIZE       12
+#define TRACE_RECORD_SIZE       12
+#define TRACE_FRAME_RECORDS     128     // Records per frame, ~1.5 KB on evt/trace
+#define TRACE_FRAME_SIZE(records) (TRACE_HEADER_SIZE + (records) * TRACE_RECORD_SIZE)
+
+// Mirrored in profile-trace.js; append only
+enum TracePhase : uint8_t {
+  TRACE_SETUP = 1,          // setup(), all of it
+  TRACE_SETUP_STORAGE,      // Settings and calibration curves from NVS
+  TRACE_SETUP_SENSORS,      // DHT, ADC and button drivers
+  TRACE_WIFI_CONNECT,       // setupWiFi(): association and DHCP
+  TRACE_SENSOR_CYCLE,       // sensorTask(): one sample, read to queued
+  TRACE_READ_SENSORS,       // readSensors()
+  TRACE_DHT_READ,           // Start pulse to decoded frame (RMT, asynchronous)
+  TRACE_ADC_AVERAGE,        // Trimmed means of the DMA windows
+  TRACE_PUBLISH_SAMPLE,     // publishSensorData()
+  TRACE_PAYLOAD_BUILD,      // JSON document or packed frame
+  TRACE_JSON_SERIALIZE,     // Measure and serialize into txBuffer
+  TRACE_MQTT_PUBLISH,       // Framing into the MQTT outbox
+  TRACE_MQTT_CONNECT,       // Attempt to session or failure, TLS included
+  TRACE_DEEP_SLEEP,         // Mark, arg = sleep length (s)
+  TRACE_ESPNOW_SEND         // Leaf: sample frame to the gateway's reply
+};
+
+enum TraceEvent : uint8_t {
+  TRACE_EVENT_BEGIN = 0,
+  TRACE_EVENT_END = 1,
+  TRACE_EVENT_MARK = 2
+};
+
+void traceRecord(TracePhase phase, TraceEvent event, uint16_t arg);
+
+inline void traceBegin(TracePhase phase) {
+  if (PROFILE_TRACE_ENABLED) {
+    traceRecord(phase, TRACE_EVENT_BEGIN, 0);
+  }
+}
+
+inline void traceEnd(TracePhase phase, uint16_t arg = 0) {
+  if (PROFILE_TRACE_ENABLED) {
+    traceRecord(phase, TRACE_EVENT_END, arg);
+  }
+}
+
+inline void traceMark(TracePhase phase, uint16_t arg) {
+  if (PROFILE_TRACE_ENABLED) {
+    traceRecord(phase, TRACE_EVENT_MARK, arg);
+  }
+}
+
+// Move up to TRACE_FRAME_RECORDS of the oldest records into a frame.
+// Returns its length, 0 when there is nothing to take. One drainer at a
+// time: the network task, or the task ending the wake.
+size_t traceTakeFrame(uint8_t* buffer, size_t capacity);
+
+// Drain everything to Serial, one "TRACE:<hex>" line per frame
+void traceDumpSerial();
+
+#endif // TRACE_H
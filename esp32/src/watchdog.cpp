@@ -0,0 +1,231 @@
+/**
+ * PlanetPlant ESP32 Watchdog and Fault Recovery
+ * RTC_NOINIT_ATTR like power.cpp; counters restart at power-on. The task
+ * watchdog interrupt runs esp_task_wdt_isr_user_handler() just before it
+ * panics, which is where the stalled task is noted.
+ */
+
+#include <Arduino.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "power.h"
+#include "watchdog.h"
+
+#define FAULT_STATE_MAGIC   0x50505744  // "PPWD"
+#define FAULT_DOMAIN_NONE   0xff
+
+struct FaultState {
+  uint32_t magic;
+  uint32_t boots;
+  uint32_t crashes;
+  uint8_t consecutiveCrashes;
+  uint8_t stalledTasks;             // Bit per WatchdogTask, set from the watchdog ISR
+  uint8_t rebootDomain;             // Domain behind a recovery reboot in progress
+  uint8_t rebootedDomains;          // Bit per domain rebooted for and not healthy since
+  uint32_t recoveries[RECOVERY_ACTION_COUNT];
+};
+
+struct DomainState {
+  uint8_t failures;
+  RecoveryAction tier;              // Recovery the next run of failures gets
+  bool recovered;
+  uint32_t recoveredAt;
+};
+
+RTC_NOINIT_ATTR static FaultState faultState;
+
+static const RecoveryAction domainTiers[FAULT_DOMAIN_COUNT] = { RECOVERY_RESET_SENSORS, RECOVERY_RESTART_NETWORK };
+static const char* const domainNames[FAULT_DOMAIN_COUNT] = { "sensors", "network" };
+static const char* const taskNames[WATCHDOG_TASK_COUNT] = { "network", "sensing" };
+
+// Failure runs span duty-cycle wakes, so they are counted on powerClock()
+RTC_DATA_ATTR static DomainState domains[FAULT_DOMAIN_COUNT];
+static volatile int64_t lastFeedUs[WATCHDOG_TASK_COUNT];
+static volatile uint8_t registeredTasks = 0;
+static esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+static uint8_t previousStalls = 0;
+static uint8_t previousRebootDomain = FAULT_DOMAIN_NONE;
+static portMUX_TYPE faultLock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:   return "power_on";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "interrupt_watchdog";
+    case ESP_RST_TASK_WDT:  return "task_watchdog";
+    case ESP_RST_WDT:       return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep_sleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_SDIO:      return "sdio";
+    default:                return "unknown";
+  }
+}
+
+static bool isCrash(esp_reset_reason_t reason) {
+  return reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+         reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT;
+}
+
+// Anything that has not fed for half the timeout is taken to be the culprit
+extern "C" void IRAM_ATTR esp_task_wdt_isr_user_handler(void) {
+  int64_t now = esp_timer_get_time();
+  for (uint8_t task = 0; task < WATCHDOG_TASK_COUNT; task++) {
+    if ((registeredTasks & (1 << task)) && now - lastFeedUs[task] >= WATCHDOG_TIMEOUT * 500LL) {
+      faultState.stalledTasks |= 1 << task;
+    }
+  }
+}
+
+void watchdogBegin() {
+  resetReason = esp_reset_reason();
+  if (faultState.magic != FAULT_STATE_MAGIC || resetReason == ESP_RST_POWERON) {
+    memset(&faultState, 0, sizeof(faultState));
+    faultState.magic = FAULT_STATE_MAGIC;
+    faultState.rebootDomain = FAULT_DOMAIN_NONE;
+  }
+
+  if (resetReason != ESP_RST_DEEPSLEEP) {
+    faultState.boots++;
+  }
+  if (isCrash(resetReason)) {
+    faultState.crashes++;
+    faultState.consecutiveCrashes = min<uint8_t>(faultState.consecutiveCrashes + 1, UINT8_MAX);
+  } else {
+    faultState.consecutiveCrashes = 0;
+  }
+
+  previousStalls = resetReason == ESP_RST_TASK_WDT ? faultState.stalledTasks : 0;
+  previousRebootDomain = resetReason == ESP_RST_SW ? faultState.rebootDomain : FAULT_DOMAIN_NONE;
+  faultState.stalledTasks = 0;
+  faultState.rebootDomain = FAULT_DOMAIN_NONE;
+
+  for (uint8_t domain = 0; domain < FAULT_DOMAIN_COUNT && resetReason != ESP_RST_DEEPSLEEP; domain++) {
+    domains[domain] = { 0, domainTiers[domain], false, 0 };
+  }
+
+  if (resetReason != ESP_RST_DEEPSLEEP) {
+    FaultStatus status = watchdogStatus();
+    Serial.printf("🔁 Reset reason: %s (boot %lu, %lu crashes, %u in a row)\n", status.resetReason,
+                  (unsigned long)status.boots, (unsigned long)status.crashes, status.consecutiveCrashes);
+    if (status.stalledTask != nullptr) {
+      Serial.printf("⚠️  The %s task stopped checking in before the reset\n", status.stalledTask);
+    }
+    if (status.rebootCause != nullptr) {
+      Serial.printf("🔧 Rebooted to recover %s\n", status.rebootCause);
+    }
+  }
+
+  if (WATCHDOG_ENABLED) {
+    // Reconfigures the watchdog the Arduino core set up for the idle tasks
+    esp_task_wdt_init(WATCHDOG_TIMEOUT / 1000, true);
+  }
+}
+
+void watchdogRegister(WatchdogTask task) {
+  lastFeedUs[task] = esp_timer_get_time();
+  portENTER_CRITICAL(&faultLock);
+  registeredTasks |= 1 << task;
+  portEXIT_CRITICAL(&faultLock);
+  if (WATCHDOG_ENABLED) {
+    esp_task_wdt_add(nullptr);
+  }
+}
+
+void watchdogFeed(WatchdogTask task) {
+  lastFeedUs[task] = esp_timer_get_time();
+  if (WATCHDOG_ENABLED) {
+    esp_task_wdt_reset();
+  }
+}
+
+RecoveryAction watchdogFault(FaultDomain domain) {
+  DomainState& state = domains[domain];
+
+  // Failures while the last recovery is still taking effect don't count
+  if (state.recovered && powerClock() - state.recoveredAt < ERROR_RECOVERY_DELAY) {
+    return RECOVERY_NONE;
+  }
+  if (++state.failures < MAX_CONSECUTIVE_ERRORS) {
+    return RECOVERY_NONE;
+  }
+
+  RecoveryAction action = state.tier;
+  if (action == RECOVERY_REBOOT && powerPumpActive()) {
+    // Not in the middle of watering; try again on the next failure
+    state.failures = MAX_CONSECUTIVE_ERRORS - 1;
+    return RECOVERY_NONE;
+  }
+  state.failures = 0;
+
+  uint8_t bit = 1 << domain;
+  portENTER_CRITICAL(&faultLock);
+  faultState.recoveries[action]++;
+  bool rebootedBefore = (faultState.rebootedDomains & bit) != 0;
+  if (action == RECOVERY_REBOOT) {
+    faultState.rebootedDomains |= bit;
+    faultState.rebootDomain = domain;
+  }
+  portEXIT_CRITICAL(&faultLock);
+
+  Serial.printf("🔧 %u consecutive %s failures, recovery: %s\n", MAX_CONSECUTIVE_ERRORS,
+                domainNames[domain], recoveryActionName(action));
+  if (action == RECOVERY_REBOOT) {
+    Serial.flush();
+    esp_restart();
+  }
+
+  // A reboot only helps once; after that the domain keeps its own tier
+  state.tier = rebootedBefore ? domainTiers[domain] : RECOVERY_REBOOT;
+  state.recovered = true;
+  state.recoveredAt = powerClock();
+  return action;
+}
+
+void watchdogClear(FaultDomain domain) {
+  DomainState& state = domains[domain];
+  state.failures = 0;
+  state.tier = domainTiers[domain];
+
+  uint8_t bit = 1 << domain;
+  if (faultState.rebootedDomains & bit) {
+    portENTER_CRITICAL(&faultLock);
+    faultState.rebootedDomains &= ~bit;
+    portEXIT_CRITICAL(&faultLock);
+  }
+}
+
+FaultStatus watchdogStatus() {
+  FaultStatus status = {};
+  status.resetReason = resetReasonName(resetReason);
+
+  portENTER_CRITICAL(&faultLock);
+  status.boots = faultState.boots;
+  status.crashes = faultState.crashes;
+  status.consecutiveCrashes = faultState.consecutiveCrashes;
+  memcpy(status.recoveries, faultState.recoveries, sizeof(status.recoveries));
+  portEXIT_CRITICAL(&faultLock);
+
+  for (uint8_t task = 0; task < WATCHDOG_TASK_COUNT; task++) {
+    if (previousStalls & (1 << task)) {
+      status.stalledTask = taskNames[task];
+      break;
+    }
+  }
+  if (resetReason == ESP_RST_TASK_WDT && status.stalledTask == nullptr) {
+    status.stalledTask = "idle";
+  }
+  if (previousRebootDomain < FAULT_DOMAIN_COUNT) {
+    status.rebootCause = domainNames[previousRebootDomain];
+  }
+  return status;
+}
+
+const char* recoveryActionName(RecoveryAction action) {
+  static const char* const names[RECOVERY_ACTION_COUNT] = {
+    "none", "reset_sensors", "restart_network", "reboot"
+  };
+  return names[action];
+}
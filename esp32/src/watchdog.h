@@ -0,0 +1,73 @@
+/**
+ * PlanetPlant ESP32 Watchdog and Fault Recovery
+ * The network and sensing tasks are subscribed to the IDF task watchdog
+ * and feed it every loop iteration; one that stops checking in for
+ * WATCHDOG_TIMEOUT panics the chip, and the task that went quiet is
+ * recorded for the next boot.
+ *
+ * Failures that leave the tasks running are counted per fault domain.
+ * MAX_CONSECUTIVE_ERRORS in a row trigger the domain's own recovery
+ * (sensor bus reset, network stack restart); if that does not help, the
+ * next run of failures reboots. A domain that is still failing after its
+ * reboot stays on its own tier, so a missing sensor cannot reboot-loop.
+ *
+ * Reset reasons, crash and recovery counters live in RTC memory and are
+ * reported at boot and in the status message.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+
+enum WatchdogTask : uint8_t {
+  WATCHDOG_TASK_NETWORK,
+  WATCHDOG_TASK_SENSING,
+  WATCHDOG_TASK_COUNT
+};
+
+enum FaultDomain : uint8_t {
+  FAULT_SENSORS,            // No valid sample (sensing task)
+  FAULT_NETWORK,            // WiFi down or MQTT connect failed (network task)
+  FAULT_DOMAIN_COUNT
+};
+
+enum RecoveryAction : uint8_t {
+  RECOVERY_NONE,
+  RECOVERY_RESET_SENSORS,
+  RECOVERY_RESTART_NETWORK,
+  RECOVERY_REBOOT,
+  RECOVERY_ACTION_COUNT
+};
+
+struct FaultStatus {
+  const char* resetReason;          // Of this boot
+  uint32_t boots;                   // Since power-on; deep-sleep wakes excluded
+  uint32_t crashes;                 // Panic, watchdog and brownout resets
+  uint8_t consecutiveCrashes;
+  const char* stalledTask;          // Task that tripped the watchdog last boot, or nullptr
+  const char* rebootCause;          // Domain behind a recovery reboot last boot, or nullptr
+  uint32_t recoveries[RECOVERY_ACTION_COUNT];
+};
+
+// Call first thing in setup(): classifies the reset and reports it.
+void watchdogBegin();
+
+// From the task itself, before its loop.
+void watchdogRegister(WatchdogTask task);
+
+// Every loop iteration of a registered task.
+void watchdogFeed(WatchdogTask task);
+
+// One more consecutive failure in a domain. Returns the recovery the
+// caller has to carry out now, usually RECOVERY_NONE; never returns for
+// RECOVERY_REBOOT. Each domain is reported from one task only.
+RecoveryAction watchdogFault(FaultDomain domain);
+
+// The domain works again; its failure count and tier start over.
+void watchdogClear(FaultDomain domain);
+
+FaultStatus watchdogStatus();
+const char* recoveryActionName(RecoveryAction action);
+
+#endif // WATCHDOG_H
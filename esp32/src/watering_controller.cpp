@@ -0,0 +1,107 @@
+/**
+ * PlanetPlant ESP32 Local Watering Controller
+ * PUMP_MAX_DURATION in config.h caps pump time per cycle whatever the settings say
+ */
+
+#include "watering_controller.h"
+
+bool WateringController::shouldStart(int moisture, uint32_t now, const RuntimeSettings& settings,
+                                     uint32_t cooldownMs) const {
+  if (phase != PHASE_IDLE || moisture >= settings.moistureMin) {
+    return false;
+  }
+  return !hasRun || now - lastCycleEnd >= cooldownMs;
+}
+
+void WateringController::start(int moisture, uint32_t now) {
+  lastResult = {};
+  lastResult.startMoisture = moisture;
+  cycleStart = now;
+  phaseStart = now;
+  phase = PHASE_WAIT;
+}
+
+bool WateringController::update(int moisture, uint32_t now, const RuntimeSettings& settings, bool pumpAvailable) {
+  uint32_t inPhase = now - phaseStart;
+
+  switch (phase) {
+    case PHASE_PULSE: {
+      uint32_t pumpMs = lastResult.pumpMs + inPhase;
+      if (moisture >= settings.moistureMax) {
+        lastResult.pumpMs = pumpMs;
+        finish(moisture, now, WATERING_TARGET_REACHED);
+        return false;
+      }
+      if (pumpMs >= PUMP_MAX_DURATION) {
+        lastResult.pumpMs = pumpMs;
+        finish(moisture, now, WATERING_TIME_LIMIT);
+        return false;
+      }
+      if (inPhase >= settings.wateringPulse) {
+        lastResult.pumpMs = pumpMs;
+        phase = PHASE_SOAK;
+        phaseStart = now;
+        return false;
+      }
+      return true;
+    }
+
+    case PHASE_SOAK:
+      // Water keeps spreading while soaking, so the target can still be hit
+      if (moisture >= settings.moistureMax) {
+        finish(moisture, now, WATERING_TARGET_REACHED);
+        return false;
+      }
+      if (inPhase < settings.wateringSoak) {
+        return false;
+      }
+      if (lastResult.pulses >= settings.wateringMaxPulses) {
+        finish(moisture, now, WATERING_PULSE_LIMIT);
+        return false;
+      }
+      phase = PHASE_WAIT;
+      phaseStart = now;
+      // fall through
+
+    case PHASE_WAIT:
+      // Waiting for a pump slot; no pump time is spent meanwhile
+      if (moisture >= settings.moistureMax) {
+        finish(moisture, now, WATERING_TARGET_REACHED);
+        return false;
+      }
+      if (!pumpAvailable) {
+        return false;
+      }
+      lastResult.pulses++;
+      phase = PHASE_PULSE;
+      phaseStart = now;
+      return true;
+
+    case PHASE_IDLE:
+    default:
+      return false;
+  }
+}
+
+void WateringController::abort(int moisture, uint32_t now) {
+  if (phase == PHASE_IDLE) {
+    return;
+  }
+  if (phase == PHASE_PULSE) {
+    lastResult.pumpMs += now - phaseStart;
+  }
+  finish(moisture, now, WATERING_ABORTED);
+}
+
+uint32_t WateringController::maxCycleTime(const RuntimeSettings& settings) {
+  return settings.wateringMaxPulses * (settings.wateringPulse + settings.wateringSoak);
+}
+
+void WateringController::finish(int moisture, uint32_t now, WateringOutcome outcome) {
+  lastResult.endMoisture = moisture;
+  lastResult.elapsedMs = now - cycleStart;
+  lastResult.outcome = outcome;
+  lastCycleEnd = now;
+  hasRun = true;
+  phase = PHASE_IDLE;
+}
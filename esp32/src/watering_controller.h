@@ -0,0 +1,62 @@
+/**
+ * PlanetPlant ESP32 Local Watering Controller
+ * Closed-loop pulse-and-soak watering: a cycle starts when moisture falls
+ * below moisture_min and the pump cooldown has passed since the last one,
+ * then alternates pump pulses with soak pauses while moisture is checked
+ * every WATERING_SAMPLE_INTERVAL. The pump stops the moment moisture_max
+ * is reached. Thresholds and timings come from the runtime settings.
+ * A pulse only starts once the caller has a pump slot for it (see
+ * PUMP_MAX_CONCURRENT); until then the zone waits and keeps checking
+ * moisture.
+ *
+ * Pure decision logic: the caller feeds readings and drives the relay.
+ * All-zero memory is a valid idle state, so the controller can live in
+ * RTC memory and keep its cooldown across deep sleep (see powerClock()).
+ */
+
+#ifndef WATERING_CONTROLLER_H
+#define WATERING_CONTROLLER_H
+
+#include <stdint.h>
+#include "messages.h"
+#include "runtime_settings.h"
+
+class WateringController {
+public:
+  // True if a cycle should start for this reading.
+  bool shouldStart(int moisture, uint32_t now, const RuntimeSettings& settings, uint32_t cooldownMs) const;
+
+  // Begin a cycle; the first pulse starts with the first update() that
+  // has a pump available.
+  void start(int moisture, uint32_t now);
+
+  // Feed a moisture reading during a cycle. pumpAvailable says whether a
+  // pulse may start now (always true while this cycle holds the pump).
+  // Returns the wanted pump state.
+  bool update(int moisture, uint32_t now, const RuntimeSettings& settings, bool pumpAvailable);
+
+  // End the cycle early (manual stop, command).
+  void abort(int moisture, uint32_t now);
+
+  bool active() const { return phase != PHASE_IDLE; }
+
+  // Longest a cycle can take, for wake budgets.
+  static uint32_t maxCycleTime(const RuntimeSettings& settings);
+
+  // Result of the cycle that just ended; valid once active() turns false.
+  const WateringResult& result() const { return lastResult; }
+
+private:
+  enum Phase : uint8_t { PHASE_IDLE, PHASE_PULSE, PHASE_SOAK, PHASE_WAIT };
+
+  Phase phase;
+  bool hasRun;
+  uint32_t phaseStart;
+  uint32_t cycleStart;
+  uint32_t lastCycleEnd;
+  WateringResult lastResult;
+
+  void finish(int moisture, uint32_t now, WateringOutcome outcome);
+};
+
+#endif // WATERING_CONTROLLER_H
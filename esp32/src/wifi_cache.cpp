@@ -0,0 +1,74 @@
+/**
+ * PlanetPlant ESP32 WiFi Fast-Connect Cache
+ * One versioned blob in the "wifi" NVS namespace
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "wifi_cache.h"
+
+#define WIFI_CACHE_NAMESPACE  "wifi"
+#define WIFI_CACHE_KEY        "cache"
+#define WIFI_CACHE_VERSION    1
+
+struct StoredWifiCache {
+  uint8_t version;
+  WifiCache cache;
+};
+
+RTC_DATA_ATTR static uint16_t fastConnects = 0;
+
+bool loadWifiCache(WifiCache& cache) {
+  Preferences prefs;
+  if (!prefs.begin(WIFI_CACHE_NAMESPACE, true)) {
+    return false;
+  }
+
+  StoredWifiCache stored;
+  size_t length = prefs.getBytes(WIFI_CACHE_KEY, &stored, sizeof(stored));
+  prefs.end();
+
+  if (length != sizeof(stored) || stored.version != WIFI_CACHE_VERSION ||
+      stored.cache.ip == 0 || stored.cache.channel == 0) {
+    return false;
+  }
+  cache = stored.cache;
+  return true;
+}
+
+void saveWifiCache(const WifiCache& cache) {
+  WifiCache current;
+  if (loadWifiCache(current) && memcmp(&current, &cache, sizeof(cache)) == 0) {
+    return;
+  }
+
+  StoredWifiCache stored = {};
+  stored.version = WIFI_CACHE_VERSION;
+  stored.cache = cache;
+
+  Preferences prefs;
+  if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+    prefs.putBytes(WIFI_CACHE_KEY, &stored, sizeof(stored));
+    prefs.end();
+  }
+}
+
+void clearWifiCache() {
+  Preferences prefs;
+  if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+    prefs.remove(WIFI_CACHE_KEY);
+    prefs.end();
+  }
+}
+
+uint16_t wifiFastConnectCount() {
+  return fastConnects;
+}
+
+void countWifiFastConnect() {
+  fastConnects++;
+}
+
+void resetWifiFastConnectCount() {
+  fastConnects = 0;
+}
@@ -0,0 +1,34 @@
+/**
+ * PlanetPlant ESP32 WiFi Fast-Connect Cache
+ * Last good association (BSSID, channel, IP lease) kept in NVS so any
+ * boot, including after a power loss, can reconnect without a scan or
+ * DHCP. Credentials stay in the WiFi driver's own NVS storage.
+ */
+
+#ifndef WIFI_CACHE_H
+#define WIFI_CACHE_H
+
+#include <stdint.h>
+
+struct WifiCache {
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+};
+
+bool loadWifiCache(WifiCache& cache);
+// Writes only when the association changed, sparing NVS wear
+void saveWifiCache(const WifiCache& cache);
+void clearWifiCache();
+
+// Fast connects since the last DHCP lease, kept across deep sleep only;
+// a reboot or power loss resets it
+uint16_t wifiFastConnectCount();
+void countWifiFastConnect();
+void resetWifiFastConnectCount();
+
+#endif // WIFI_CACHE_H
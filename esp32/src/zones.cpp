@@ -0,0 +1,32 @@
+/**
+ * PlanetPlant ESP32 Watering Zones
+ * Pins are in pins.h. The dry/wet columns are only the factory curve:
+ * probes differ by a few hundred mV even within one batch, so capture
+ * each one's own points on the device (calibration.h).
+ */
+
+#include "zones.h"
+#include "pins.h"
+#include "calibration.h"
+
+static_assert(ZONE_COUNT >= 1 && ZONE_COUNT <= ZONE_MAX, "ZONE_COUNT must be 1..ZONE_MAX");
+static_assert(PUMP_MAX_CONCURRENT >= 1, "At least one pump must be allowed to run");
+
+const ZoneConfig zones[ZONE_MAX] = {
+  // moisture pin,     relay pin,       dry mV,          wet mV,          cooldown
+  { MOISTURE_PIN,       PUMP_RELAY_PIN,  MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+  { ZONE1_MOISTURE_PIN, ZONE1_RELAY_PIN, MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+  { ZONE2_MOISTURE_PIN, ZONE2_RELAY_PIN, MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+  { ZONE3_MOISTURE_PIN, ZONE3_RELAY_PIN, MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+  { ZONE4_MOISTURE_PIN, ZONE4_RELAY_PIN, MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+  { ZONE5_MOISTURE_PIN, ZONE5_RELAY_PIN, MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+  { ZONE6_MOISTURE_PIN, ZONE6_RELAY_PIN, MOISTURE_DRY_MV, MOISTURE_WET_MV, 0 },
+};
+
+int zoneMoisturePercent(uint8_t zone, int millivolts) {
+  return calibration.value(zone, millivolts);
+}
+
+uint32_t zoneCooldown(uint8_t zone, const RuntimeSettings& settings) {
+  return zones[zone].cooldownMs > 0 ? zones[zone].cooldownMs : settings.pumpCooldown;
+}
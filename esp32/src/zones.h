@@ -0,0 +1,33 @@
+/**
+ * PlanetPlant ESP32 Watering Zones
+ * One board can serve several plants: each zone has its own moisture
+ * probe, pump relay, calibration curve and watering cooldown. All zones are
+ * sampled in the same ADC sweep and published in one sample message;
+ * zone 0 is the board's primary moisture reading.
+ */
+
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <stdint.h>
+#include "config.h"
+#include "runtime_settings.h"
+
+struct ZoneConfig {
+  uint8_t moisturePin;      // ADC1 input
+  uint8_t relayPin;
+  uint16_t dryMv;           // Factory curve: calibrated mV in dry soil
+  uint16_t wetMv;           // Factory curve: calibrated mV in water
+  uint32_t cooldownMs;      // Minimum time between local cycles, 0 = pump_cooldown setting
+};
+
+// The first ZONE_COUNT entries are in use
+extern const ZoneConfig zones[ZONE_MAX];
+
+// Moisture in % from a zone's calibrated millivolts through its
+// calibration curve, or -1 without a reading.
+int zoneMoisturePercent(uint8_t zone, int millivolts);
+
+uint32_t zoneCooldown(uint8_t zone, const RuntimeSettings& settings);
+
+#endif // ZONES_H
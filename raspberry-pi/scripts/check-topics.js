@@ -0,0 +1,80 @@
+#!/usr/bin/env node
+// Compares the MQTT topic names in src/config/topics.js with the firmware's
+// esp32/src/topics.h and config.h, and the shard hash with fnv1a.h; exits
+// non-zero on any difference.
+//
+//   npm run check:topics
+
+import { readFileSync } from 'node:fs';
+import { fileURLToPath } from 'node:url';
+import * as topics from '../src/config/topics.js';
+
+const firmware = fileURLToPath(new URL('../../esp32/src/', import.meta.url));
+
+const readDefines = (file) => {
+  const defines = {};
+  const pattern = /^#define\s+(\w+)\s+(?:"([^"]*)"|(\d+))/gm;
+  for (const [, name, text, number] of readFileSync(firmware + file, 'utf8').matchAll(pattern)) {
+    defines[name] = text !== undefined ? text : Number(number);
+  }
+  return defines;
+};
+
+const header = { ...readDefines('config.h'), ...readDefines('topics.h') };
+
+const expected = {
+  TOPIC_ROOT: topics.TOPIC_ROOT,
+  TOPIC_VERSION: topics.TOPIC_VERSION,
+  TOPIC_SHARD_COUNT: topics.TOPIC_SHARD_COUNT,
+  TOPIC_EVENTS: topics.EVENTS,
+  TOPIC_COMMANDS: topics.COMMANDS,
+  MQTT_SITE: topics.DEFAULT_SITE,
+  TOPIC_DATA: topics.CHANNELS.data,
+  TOPIC_BATCH: topics.CHANNELS.batch,
+  TOPIC_AGGREGATE: topics.CHANNELS.aggregate,
+  TOPIC_STATUS: topics.CHANNELS.status,
+  TOPIC_PUMP: topics.CHANNELS.pump,
+  TOPIC_WATERING: topics.CHANNELS.watering,
+  TOPIC_HEARTBEAT: topics.CHANNELS.heartbeat,
+  TOPIC_CONFIG_ACK: topics.CHANNELS.configAck,
+  TOPIC_COMMAND_ACK: topics.CHANNELS.commandAck,
+  TOPIC_METRICS: topics.CHANNELS.metrics,
+  TOPIC_OTA_STATUS: topics.CHANNELS.otaStatus,
+  TOPIC_SAMPLE_RATE: topics.CHANNELS.sampleRate,
+  TOPIC_CALIBRATION: topics.CHANNELS.calibration,
+  TOPIC_MESH: topics.CHANNELS.mesh,
+  TOPIC_TRACE: topics.CHANNELS.trace,
+  TOPIC_WATER_COMMAND: topics.COMMAND_NAMES.water,
+  TOPIC_CONFIG_COMMAND: topics.COMMAND_NAMES.config,
+  TOPIC_OTA_COMMAND: topics.COMMAND_NAMES.ota,
+  TOPIC_CALIBRATE_COMMAND: topics.COMMAND_NAMES.calibrate
+};
+
+let mismatches = 0;
+for (const [name, value] of Object.entries(expected)) {
+  if (header[name] !== value) {
+    console.error(`${name}: firmware ${JSON.stringify(header[name])}, backend ${JSON.stringify(value)}`);
+    mismatches++;
+  }
+}
+
+// fnv1a32() with the firmware's constants, as topicShard() applies it
+const { FNV1A_OFFSET_BASIS, FNV1A_PRIME } = readDefines('fnv1a.h');
+const firmwareShard = (deviceId) => {
+  let hash = FNV1A_OFFSET_BASIS;
+  for (const byte of Buffer.from(deviceId, 'utf8')) {
+    hash = Number((BigInt((hash ^ byte) >>> 0) * BigInt(FNV1A_PRIME)) % 4294967296n);
+  }
+  return hash % header.TOPIC_SHARD_COUNT;
+};
+for (const deviceId of ['esp32_a1b2c3d4', 'plant-balcony', 'ä']) {
+  if (topics.topicShard(deviceId) !== firmwareShard(deviceId)) {
+    console.error(`topicShard: hash of ${deviceId} differs from the firmware`);
+    mismatches++;
+  }
+}
+
+if (mismatches > 0) {
+  process.exit(1);
+}
+console.log(`✅ ${Object.keys(expected).length} topic names match the firmware`);
@@ -0,0 +1,339 @@
+#!/usr/bin/env node
+// Timeline and energy estimate from the profiling trace of an ESP32 built
+// with `pio run -e profile` (frame layout in esp32/src/trace.h). Reads the
+// "TRACE:<hex>" lines of a serial capture, or listens on evt/trace:
+//
+//   pio device monitor | tee capture.log
+//   npm run profile:trace -- --log capture.log
+//   npm run profile:trace -- --listen 120 --device esp32_a1b2c3d4
+//
+// Writes a Chrome trace (open in https://ui.perfetto.dev or
+// chrome://tracing) with one lane per core plus one for the asynchronous
+// phases, and prints per-phase timings and the charge and energy of each
+// sample cycle. Currents come from the table below, typical ESP32-WROOM
+// figures at 3.3 V; pass --currents file.json ({"awake": 45, "sleep":
+// 0.15, "wifi_connect": 120, ...} in mA) to use measured ones.
+
+import { readFileSync, writeFileSync } from 'node:fs';
+import { CHANNELS, EVENTS, TOPIC_ROOT, TOPIC_VERSION } from '../src/config/topics.js';
+
+const options = {
+  log: '',              // Serial capture to read
+  listen: 0,            // Seconds to collect evt/trace instead
+  url: process.env.MQTT_URL || `mqtt://${process.env.MQTT_HOST || 'localhost'}:${process.env.MQTT_PORT || 1883}`,
+  device: '+',          // Device id to listen to, + for all
+  out: 'trace.json',
+  currents: '',
+  voltage: 3.3
+};
+
+for (let i = 2; i < process.argv.length; i += 2) {
+  const key = process.argv[i].replace(/^--/, '');
+  const value = process.argv[i + 1];
+  if (!(key in options) || value === undefined) {
+    console.error(`Unknown or incomplete option: ${process.argv[i]}`);
+    console.error(`Options: ${Object.keys(options).map((name) => `--${name}`).join(' ')}`);
+    process.exit(1);
+  }
+  options[key] = typeof options[key] === 'number' ? Number(value) : value;
+}
+
+if (!options.log && !options.listen) {
+  console.error('Pass --log <serial capture> or --listen <seconds>');
+  process.exit(1);
+}
+
+// TracePhase in esp32/src/trace.h, by value
+const PHASES = [
+  null,
+  'setup',
+  'setup_storage',
+  'setup_sensors',
+  'wifi_connect',
+  'sensor_cycle',
+  'read_sensors',
+  'dht_read',
+  'adc_average',
+  'publish_sample',
+  'payload_build',
+  'json_serialize',
+  'mqtt_publish',
+  'mqtt_connect',
+  'deep_sleep',
+  'espnow_send'
+];
+
+// Spanning other work on their core; drawn on their own lane
+const ASYNC_PHASES = new Set(['dht_read', 'mqtt_connect']);
+
+const EVENT_BEGIN = 0;
+const EVENT_END = 1;
+const EVENT_MARK = 2;
+
+const FRAME_MAGIC = 0xAB;
+const FRAME_VERSION = 1;
+const HEADER_SIZE = 12;
+const RECORD_SIZE = 12;
+
+// mA; phases not listed draw the awake current
+const CURRENTS = {
+  awake: 45,            // 240 MHz, WiFi in modem sleep
+  sleep: 0.15,          // Deep sleep, dev board regulator included
+  wifi_connect: 120,
+  mqtt_connect: 110,
+  mqtt_publish: 140,
+  espnow_send: 120,
+  ...(options.currents ? JSON.parse(readFileSync(options.currents, 'utf8')) : {})
+};
+
+const decodeFrame = (frame) => {
+  if (frame.length < HEADER_SIZE || frame[0] !== FRAME_MAGIC || frame[1] !== FRAME_VERSION) {
+    return null;
+  }
+  const count = frame.readUInt16LE(2);
+  if (frame.length < HEADER_SIZE + count * RECORD_SIZE) {
+    return null;
+  }
+
+  const mhz = frame.readUInt16LE(4);
+  const records = [];
+  for (let i = 0, offset = HEADER_SIZE; i < count; i++, offset += RECORD_SIZE) {
+    const flags = frame[offset + 9];
+    records.push({
+      timeUs: frame.readUInt32LE(offset),
+      cycles: frame.readUInt32LE(offset + 4),
+      phase: PHASES[frame[offset + 8]] || `phase_${frame[offset + 8]}`,
+      event: flags & 0x03,
+      core: flags >> 7,
+      arg: frame.readUInt16LE(offset + 10),
+      mhz
+    });
+  }
+  return { dropped: frame.readUInt16LE(6), records };
+};
+
+const readLog = (file) => {
+  const frames = [];
+  for (const [, hex] of readFileSync(file, 'utf8').matchAll(/TRACE:([0-9a-f]+)/g)) {
+    frames.push(Buffer.from(hex, 'hex'));
+  }
+  return frames;
+};
+
+// mqtt is only loaded here, so reading a capture needs no npm install
+const listen = async () => {
+  const { default: mqtt } = await import('mqtt');
+  return collect(mqtt);
+};
+
+const collect = (mqtt) => new Promise((resolve, reject) => {
+  const frames = [];
+  const client = mqtt.connect(options.url);
+  const topic = `${TOPIC_ROOT}/${TOPIC_VERSION}/+/+/${options.device}/${EVENTS}/${CHANNELS.trace}`;
+  client.on('connect', () => {
+    client.subscribe(topic, { qos: 0 });
+    console.log(`Listening on ${topic} for ${options.listen}s`);
+    setTimeout(() => client.end(false, () => resolve(frames)), options.listen * 1000);
+  });
+  client.on('message', (_topic, message) => frames.push(message));
+  client.on('error', reject);
+});
+
+// Records on one timeline: esp_timer restarts with every boot, so boots
+// follow each other, a deep sleep apart
+const placeRecords = (frames) => {
+  const placed = [];
+  let dropped = 0;
+  let bootStart = 0;
+  let bootEnd = 0;
+  let wrap = 0;
+  let last = null;
+
+  for (const frame of frames.map(decodeFrame).filter(Boolean)) {
+    dropped += frame.dropped;
+    for (const record of frame.records) {
+      const newBoot = record.phase === 'setup' && record.event === EVENT_BEGIN;
+      if (newBoot && placed.length > 0) {
+        bootStart = bootEnd;
+        wrap = 0;
+        last = null;
+      }
+      if (last !== null && record.timeUs + wrap < last - 2 ** 31) {
+        wrap += 2 ** 32;
+      }
+      last = record.timeUs + wrap;
+
+      const at = bootStart + last;
+      placed.push({ ...record, at });
+      bootEnd = at;
+      if (record.phase === 'deep_sleep') {
+        bootEnd += record.arg * 1e6;
+      }
+    }
+  }
+  return { records: placed, dropped };
+};
+
+// Begin/end pairs per core and phase. Short spans are timed by the cycle
+// counter, which the profile build never reclocks
+const buildSpans = (records) => {
+  const open = new Map();
+  const spans = [];
+  const marks = [];
+
+  for (const record of records) {
+    const key = `${record.core}:${record.phase}`;
+    if (record.event === EVENT_BEGIN) {
+      open.set(key, [...(open.get(key) || []), record]);
+    } else if (record.event === EVENT_END) {
+      const stack = open.get(key) || [];
+      const begin = stack.pop();
+      if (!begin) {
+        continue;
+      }
+      const wallUs = record.at - begin.at;
+      const cycleUs = ((record.cycles - begin.cycles) >>> 0) / record.mhz;
+      const dur = wallUs < 2 ** 32 / record.mhz / 2 ? cycleUs : wallUs;
+      spans.push({ phase: record.phase, core: record.core, start: begin.at, dur, arg: record.arg });
+    } else if (record.event === EVENT_MARK) {
+      marks.push(record);
+    }
+  }
+  return { spans: spans.sort((a, b) => a.start - b.start), marks };
+};
+
+const writeChromeTrace = (spans, marks) => {
+  const lane = (span) => (ASYNC_PHASES.has(span.phase) ? 2 : span.core);
+  const events = [
+    { name: 'thread_name', ph: 'M', pid: 1, tid: 0, args: { name: 'core 0 (network)' } },
+    { name: 'thread_name', ph: 'M', pid: 1, tid: 1, args: { name: 'core 1 (sensing)' } },
+    { name: 'thread_name', ph: 'M', pid: 1, tid: 2, args: { name: 'async' } },
+    ...spans.map((span) => ({
+      name: span.phase,
+      ph: 'X',
+      pid: 1,
+      tid: lane(span),
+      ts: span.start,
+      dur: span.dur,
+      args: { arg: span.arg }
+    })),
+    ...marks.map((mark) => ({
+      name: mark.phase,
+      ph: mark.phase === 'deep_sleep' ? 'X' : 'i',
+      pid: 1,
+      tid: mark.core,
+      ts: mark.at,
+      dur: mark.phase === 'deep_sleep' ? mark.arg * 1e6 : undefined,
+      args: { arg: mark.arg }
+    }))
+  ];
+  writeFileSync(options.out, JSON.stringify({ traceEvents: events, displayTimeUnit: 'ms' }));
+};
+
+const percentile = (sorted, p) => sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+const ms = (us) => (us / 1000).toFixed(2);
+
+const printPhases = (spans) => {
+  const byPhase = new Map();
+  for (const span of spans) {
+    byPhase.set(span.phase, [...(byPhase.get(span.phase) || []), span.dur]);
+  }
+
+  console.log('\nphase              count   total ms    mean ms     p50 ms     max ms');
+  for (const phase of PHASES.filter((name) => byPhase.has(name))) {
+    const durations = byPhase.get(phase).sort((a, b) => a - b);
+    const total = durations.reduce((sum, dur) => sum + dur, 0);
+    console.log(`${phase.padEnd(18)} ${String(durations.length).padStart(5)} ${ms(total).padStart(10)} ` +
+      `${ms(total / durations.length).padStart(10)} ${ms(percentile(durations, 0.5)).padStart(10)} ` +
+      `${ms(durations[durations.length - 1]).padStart(10)}`);
+  }
+};
+
+// Charge of [from, to): the sleep current while asleep, otherwise the
+// highest current of the spans active at each moment, the awake current
+// when none is
+const chargeUc = (spans, marks, from, to) => {
+  const edges = [];
+  const clip = (start, end, current) => {
+    if (Math.max(start, from) < Math.min(end, to)) {
+      edges.push([Math.max(start, from), current, 1], [Math.min(end, to), current, -1]);
+    }
+  };
+  for (const span of spans) {
+    if (CURRENTS[span.phase] !== undefined) {
+      clip(span.start, span.start + span.dur, CURRENTS[span.phase]);
+    }
+  }
+  for (const mark of marks.filter((mark) => mark.phase === 'deep_sleep')) {
+    clip(mark.at, mark.at + mark.arg * 1e6, 'sleep');
+  }
+  edges.sort((a, b) => a[0] - b[0]);
+
+  let charge = 0;
+  let sleepUs = 0;
+  let at = from;
+  const active = [];
+  const asleep = () => active.includes('sleep');
+  const level = () => (asleep() ? CURRENTS.sleep : Math.max(CURRENTS.awake, ...active));
+  for (const [time, current, delta] of [...edges, [to, null, 0]]) {
+    charge += (time - at) * level() / 1000;
+    sleepUs += asleep() ? time - at : 0;
+    at = time;
+    if (delta > 0) {
+      active.push(current);
+    } else if (delta < 0) {
+      active.splice(active.indexOf(current), 1);
+    }
+  }
+  return { charge, sleepUs };
+};
+
+// A cycle runs from one sample to the next; the first takes in the boot
+const printCycles = (spans, marks, records) => {
+  const starts = spans.filter((span) => span.phase === 'sensor_cycle').map((span) => span.start);
+  if (starts.length === 0) {
+    console.log('\nNo sensor_cycle in the trace, no per-cycle estimate');
+    return;
+  }
+  starts[0] = Math.min(starts[0], records[0].at);
+  const lastMark = marks.filter((mark) => mark.phase === 'deep_sleep').pop();
+  const end = lastMark && lastMark.at >= starts[starts.length - 1]
+    ? lastMark.at + lastMark.arg * 1e6
+    : records[records.length - 1].at;
+
+  console.log('\ncycle   length s   awake ms      µAh       mJ   mean mA');
+  let totalCharge = 0;
+  let totalUs = 0;
+  starts.forEach((start, index) => {
+    const stop = index + 1 < starts.length ? starts[index + 1] : end;
+    const { charge, sleepUs } = chargeUc(spans, marks, start, stop);
+    const lengthUs = stop - start;
+    totalCharge += charge;
+    totalUs += lengthUs;
+    const energyMj = charge * options.voltage / 1000;
+    console.log(`${String(index + 1).padStart(5)} ${(lengthUs / 1e6).toFixed(2).padStart(10)} ` +
+      `${ms(lengthUs - sleepUs).padStart(10)} ${(charge / 3600).toFixed(2).padStart(8)} ` +
+      `${energyMj.toFixed(2).padStart(8)} ${(charge / lengthUs * 1000).toFixed(2).padStart(9)}`);
+  });
+
+  const meanMa = totalCharge / totalUs * 1000;
+  console.log(`\nMean ${meanMa.toFixed(3)} mA over ${(totalUs / 1e6).toFixed(1)} s, ` +
+    `${(meanMa * 24).toFixed(1)} mAh per day`);
+};
+
+const frames = options.log ? readLog(options.log) : await listen();
+const { records, dropped } = placeRecords(frames);
+if (records.length === 0) {
+  console.error('No trace records found');
+  process.exit(1);
+}
+
+const { spans, marks } = buildSpans(records);
+writeChromeTrace(spans, marks);
+
+console.log(`${records.length} records from ${frames.length} frames, ${spans.length} spans -> ${options.out}`);
+if (dropped > 0) {
+  console.log(`⚠️  ${dropped} records were dropped on the device (trace buffer full)`);
+}
+printPhases(spans);
+printCycles(spans, marks, records);
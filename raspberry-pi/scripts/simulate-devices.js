@@ -0,0 +1,358 @@
+#!/usr/bin/env node
+// Fleet simulator for load-testing the ingestion path: N virtual ESP32s,
+// each with its own MQTT connection, publishing the firmware's topics and
+// payload shapes (esp32/src/network.cpp, payloads.cpp) and answering
+// water/config commands the way the firmware does.
+//
+//   npm run simulate -- --devices 200 --speed 60 --duration 600
+//
+// --speed compresses device time: at 60 a minute of sampling passes every
+// second, so 200 devices produce roughly the sample rate of 12000 real ones.
+
+import mqtt from 'mqtt';
+import { CHANNELS, COMMANDS, COMMAND_NAMES, EVENTS, deviceTopic, topicShard } from '../src/config/topics.js';
+
+const options = {
+  devices: 200,
+  url: process.env.MQTT_URL || `mqtt://${process.env.MQTT_HOST || 'localhost'}:${process.env.MQTT_PORT || 1883}`,
+  interval: 60000,      // Sample period (device ms)
+  heartbeat: 120000,    // Heartbeat period (device ms)
+  duration: 0,          // Wall-clock seconds, 0 = until Ctrl-C
+  ramp: 10,             // Seconds over which devices connect
+  speed: 1,             // Device time per wall-clock time
+  prefix: 'esp32_sim',
+  site: 'default'       // MQTT_SITE of the simulated devices
+};
+
+for (let i = 2; i < process.argv.length; i += 2) {
+  const key = process.argv[i].replace(/^--/, '');
+  const value = process.argv[i + 1];
+  if (!(key in options) || value === undefined) {
+    console.error(`Unknown or incomplete option: ${process.argv[i]}`);
+    console.error(`Options: ${Object.keys(options).map((name) => `--${name}`).join(' ')}`);
+    process.exit(1);
+  }
+  options[key] = typeof options[key] === 'number' ? Number(value) : value;
+}
+
+// Firmware defaults (esp32/src/config.h)
+const METRICS_INTERVAL = 300000;
+const AGGREGATE_WINDOW = 900000;
+const REPORT_MAX_SILENCE = 900000;
+const DEADBANDS = { temperature: 0.5, humidity: 2, moisture: 2, light: 5 };
+const BUCKET_COUNT = 12;
+
+const STATS_INTERVAL = 10;    // Seconds between progress lines
+
+const stats = {
+  connected: 0,
+  published: 0,
+  failed: 0,
+  bytes: 0,
+  commands: 0,
+  latencies: [],
+  byTopic: {}
+};
+
+const clamp = (value, min, max) => Math.min(max, Math.max(min, value));
+const round = (value, digits) => Number(value.toFixed(digits));
+
+const histogram = (typicalUs) => {
+  const buckets = new Array(BUCKET_COUNT).fill(0);
+  const count = 100 + Math.floor(Math.random() * 900);
+  buckets[typicalUs < 1000 ? 3 : 5] = count;
+  return { count, sum: count * typicalUs, max: typicalUs * 4, buckets };
+};
+
+class VirtualDevice {
+  constructor(index) {
+    this.id = `${options.prefix}${String(index).padStart(4, '0')}`;
+    this.route = { site: options.site, shard: topicShard(this.id), deviceId: this.id };
+    this.startedAt = Date.now();
+    this.revision = 0;
+    this.settings = { sensor_interval: options.interval, heartbeat_interval: options.heartbeat };
+    this.pumpActive = false;
+    this.online = false;
+    this.publishOk = 0;
+    this.publishFailed = 0;
+    this.timers = [];
+    this.values = {
+      temperature: 19 + Math.random() * 6,
+      humidity: 45 + Math.random() * 20,
+      moisture: 30 + Math.random() * 40,
+      light: Math.random() * 100
+    };
+    this.reported = null;
+    this.lastReportAt = 0;
+    this.window = [];
+  }
+
+  // Device clock in ms, as millis() would read it
+  now() {
+    return Math.floor((Date.now() - this.startedAt) * options.speed);
+  }
+
+  every(deviceMs, task) {
+    this.timers.push(setInterval(task, Math.max(1, deviceMs / options.speed)));
+  }
+
+  start() {
+    this.client = mqtt.connect(options.url, {
+      clientId: `plantplant_${this.id}`,
+      username: process.env.MQTT_USERNAME,
+      password: process.env.MQTT_PASSWORD,
+      keepalive: 60,
+      reconnectPeriod: 5000,
+      clean: false
+    });
+
+    this.client.on('connect', () => {
+      if (!this.online) {
+        this.online = true;
+        stats.connected++;
+      }
+      const commands = [this.commandTopic(COMMAND_NAMES.water), this.commandTopic(COMMAND_NAMES.config)];
+      this.client.subscribe(commands, { qos: 1 });
+      this.publish(this.eventTopic(CHANNELS.status), {
+        device_id: this.id,
+        timestamp: this.now(),
+        status: 'online',
+        ip_address: '127.0.0.1',
+        wifi_rssi: -60,
+        local_watering: false,
+        config_revision: this.revision
+      });
+    });
+    this.client.on('close', () => {
+      if (this.online) {
+        this.online = false;
+        stats.connected--;
+      }
+    });
+    this.client.on('message', (topic, message) => this.handleCommand(topic, message));
+    this.client.on('error', () => {});
+
+    this.every(this.settings.sensor_interval, () => this.sample());
+    this.every(this.settings.heartbeat_interval, () => this.heartbeat());
+    this.every(AGGREGATE_WINDOW, () => this.aggregate());
+    this.every(METRICS_INTERVAL, () => this.metrics());
+  }
+
+  stop() {
+    this.timers.forEach(clearInterval);
+    return this.client.endAsync();
+  }
+
+  eventTopic(channel) {
+    return deviceTopic(this.route, EVENTS, channel);
+  }
+
+  commandTopic(command) {
+    return deviceTopic(this.route, COMMANDS, command);
+  }
+
+  publish(topic, payload) {
+    if (!this.client.connected) {
+      return;
+    }
+    const body = JSON.stringify(payload);
+    const kind = topic.split('/').pop();
+    const started = process.hrtime.bigint();
+    this.client.publishAsync(topic, body, { qos: 1 })
+      .then(() => {
+        this.publishOk++;
+        stats.published++;
+        stats.bytes += body.length;
+        stats.byTopic[kind] = (stats.byTopic[kind] || 0) + 1;
+        stats.latencies.push(Number(process.hrtime.bigint() - started) / 1e6);
+      })
+      .catch(() => {
+        this.publishFailed++;
+        stats.failed++;
+      });
+  }
+
+  sample() {
+    const v = this.values;
+    v.temperature = clamp(v.temperature + (Math.random() - 0.5) * 0.4, 5, 40);
+    v.humidity = clamp(v.humidity + (Math.random() - 0.5) * 1.5, 10, 95);
+    v.moisture = clamp(v.moisture + (this.pumpActive ? 3 : -0.05) + (Math.random() - 0.5), 0, 100);
+    v.light = clamp(v.light + (Math.random() - 0.5) * 6, 0, 100);
+    this.window.push({ ...v });
+
+    // Report-by-exception, as report_filter.cpp does with the default dead-bands
+    const now = this.now();
+    const moved = !this.reported ||
+      Object.keys(DEADBANDS).some((channel) => Math.abs(v[channel] - this.reported[channel]) >= DEADBANDS[channel]);
+    if (!moved && now - this.lastReportAt < REPORT_MAX_SILENCE) {
+      return;
+    }
+    this.reported = { ...v };
+    this.lastReportAt = now;
+
+    this.publish(this.eventTopic(CHANNELS.data), {
+      device_id: this.id,
+      timestamp: now,
+      sensors: {
+        temperature: round(v.temperature, 2),
+        humidity: round(v.humidity, 2),
+        moisture: Math.round(v.moisture),
+        light: Math.round(v.light),
+        pump_active: this.pumpActive
+      },
+      status: { wifi_rssi: -60, free_heap: 180000, uptime: now }
+    });
+  }
+
+  aggregate() {
+    if (this.window.length === 0) {
+      return;
+    }
+    const payload = {
+      device_id: this.id,
+      timestamp: this.now(),
+      window_ms: AGGREGATE_WINDOW,
+      count: this.window.length
+    };
+    for (const channel of Object.keys(DEADBANDS)) {
+      const values = this.window.map((sample) => sample[channel]);
+      const mean = values.reduce((sum, value) => sum + value, 0) / values.length;
+      const hours = AGGREGATE_WINDOW / 3600000;
+      payload[channel] = {
+        min: round(Math.min(...values), 2),
+        max: round(Math.max(...values), 2),
+        mean: round(mean, 2),
+        slope: round((values[values.length - 1] - values[0]) / hours, 3)
+      };
+    }
+    this.window = [];
+    this.publish(this.eventTopic(CHANNELS.aggregate), payload);
+  }
+
+  heartbeat() {
+    const now = this.now();
+    this.publish(this.eventTopic(CHANNELS.heartbeat), {
+      device_id: this.id,
+      timestamp: now,
+      status: 'online',
+      wifi_rssi: -60,
+      free_heap: 180000,
+      min_free_heap: 172000,
+      uptime: now
+    });
+  }
+
+  metrics() {
+    this.publish(this.eventTopic(CHANNELS.metrics), {
+      device_id: this.id,
+      timestamp: this.now(),
+      uptime: this.now(),
+      heap: { free: 180000, min_free: 172000, largest_block: 110000, fragmentation: 0.39 },
+      stack_free: { network: 3100, sensing: 2400 },
+      jitter_ms: { network: 3, sensing: 2 },
+      loop_us: { network: histogram(400), sensing: histogram(150) },
+      publish: { ok: this.publishOk, failed: this.publishFailed, latency_us: histogram(1800) },
+      sensor_us: { dht: histogram(4800), adc: histogram(90) },
+      dht_checksum_errors: 0,
+      dht_timeouts: 0,
+      mqtt: { attempts: 1, failures: 0, connects: 1, connect_ms: 120, downtime_ms: 0 }
+    });
+  }
+
+  handleCommand(topic, message) {
+    stats.commands++;
+    let command;
+    try {
+      command = JSON.parse(message.toString());
+    } catch {
+      return;
+    }
+
+    if (topic.endsWith('/water') && command.id) {
+      this.publish(this.eventTopic(CHANNELS.commandAck), {
+        device_id: this.id, timestamp: this.now(), request_id: command.id, command: 'water', result: 'accepted'
+      });
+    }
+
+    if (topic.endsWith('/water') && command.action === 'start') {
+      const duration = command.duration || 5000;
+      const zone = command.zone || 0;
+      this.pumpActive = true;
+      this.publish(this.eventTopic(CHANNELS.pump), {
+        device_id: this.id, timestamp: this.now(), action: 'started', duration, zone, pump_active: true
+      });
+      setTimeout(() => {
+        this.pumpActive = false;
+        this.publish(this.eventTopic(CHANNELS.pump), {
+          device_id: this.id, timestamp: this.now(), action: 'stopped', duration, zone, pump_active: false
+        });
+      }, duration / options.speed);
+    } else if (topic.endsWith('/config')) {
+      // Accepts every key; the firmware validates against its descriptor table
+      const changes = command.reset ? {} : command.settings || {};
+      const changed = command.reset || Object.keys(changes).length > 0;
+      if (changed) {
+        this.revision++;
+        Object.assign(this.settings, changes);
+      }
+      this.publish(this.eventTopic(CHANNELS.configAck), {
+        device_id: this.id,
+        timestamp: this.now(),
+        request_id: command.id,
+        result: changed ? 'applied' : 'unchanged',
+        revision: this.revision,
+        settings: this.settings
+      });
+    }
+  }
+}
+
+const percentile = (sorted, p) => {
+  if (sorted.length === 0) {
+    return 0;
+  }
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+};
+
+const reportStats = (elapsedSeconds) => {
+  const latencies = stats.latencies.sort((a, b) => a - b);
+  const rate = (stats.published / STATS_INTERVAL).toFixed(1);
+  const throughput = (stats.bytes / 1024 / STATS_INTERVAL).toFixed(1);
+  const topics = Object.entries(stats.byTopic).map(([kind, count]) => `${kind}=${count}`).join(' ');
+  console.log(
+    `[${elapsedSeconds}s] connected=${stats.connected}/${options.devices} ` +
+    `published=${stats.published} (${rate}/s, ${throughput} KiB/s) ` +
+    `failed=${stats.failed} commands=${stats.commands} ` +
+    `puback ms p50=${percentile(latencies, 0.5).toFixed(1)} p95=${percentile(latencies, 0.95).toFixed(1)} ` +
+    `p99=${percentile(latencies, 0.99).toFixed(1)} max=${(latencies[latencies.length - 1] || 0).toFixed(1)} ` +
+    `${topics}`
+  );
+  stats.published = 0;
+  stats.failed = 0;
+  stats.bytes = 0;
+  stats.commands = 0;
+  stats.latencies = [];
+  stats.byTopic = {};
+};
+
+const devices = Array.from({ length: options.devices }, (_, i) => new VirtualDevice(i));
+console.log(`🌱 Simulating ${options.devices} devices against ${options.url} at ${options.speed}x`);
+
+devices.forEach((device, i) => {
+  setTimeout(() => device.start(), (options.ramp * 1000 * i) / options.devices);
+});
+
+const startedAt = Date.now();
+const statsTimer = setInterval(() => reportStats(Math.round((Date.now() - startedAt) / 1000)),
+  STATS_INTERVAL * 1000);
+
+const shutdown = async () => {
+  clearInterval(statsTimer);
+  await Promise.allSettled(devices.filter((device) => device.client).map((device) => device.stop()));
+  process.exit(0);
+};
+
+process.on('SIGINT', shutdown);
+if (options.duration > 0) {
+  setTimeout(shutdown, options.duration * 1000);
+}
@@ -1,3 +1,5 @@
+import * as topics from './topics.js';
+
 export const mqttConfig = {
   broker: {
     host: process.env.MQTT_HOST || 'localhost',
@@ -14,31 +16,8 @@ export const mqttConfig = {
     clean: true
   },
   
-  topics: {
-    // Incoming topics (subscribe)
-    sensors: {
-      data: 'sensors/+/data',
-      status: 'sensors/+/status'
-    },
-    
-    devices: {
-      heartbeat: 'devices/+/heartbeat',
-      status: 'devices/+/status'
-    },
-    
-    // Outgoing topics (publish)
-    commands: {
-      water: 'commands/{plant_id}/water',
-      config: 'commands/{plant_id}/config',
-      calibrate: 'commands/{plant_id}/calibrate',
-      system: 'commands/system'
-    },
-    
-    server: {
-      status: 'server/status',
-      heartbeat: 'server/heartbeat'
-    }
-  },
+  // Layout, parsing and subscription filters, shared with the firmware
+  topics,
   
   qos: {
     sensor_data: 1,
@@ -47,7 +26,3 @@ export const mqttConfig = {
     heartbeat: 0
   }
 };
-
-export const getTopicForPlant = (template, plantId) => {
-  return template.replace('{plant_id}', plantId);
-};
\ No newline at end of file
@@ -0,0 +1,132 @@
+// MQTT topic scheme shared with the ESP32 firmware. Names mirror
+// esp32/src/topics.h; `npm run check:topics` compares the two.
+//
+//   planetplant/v1/<site>/<shard>/<device_id>/evt/<channel>   device to server
+//   planetplant/v1/<site>/<shard>/<device_id>/cmd/<command>   server to device
+//
+// Firmware from before the scheme publishes on sensors/<id>/... and
+// devices/<id>/... and listens on commands/<id>/...; both are accepted.
+
+export const TOPIC_ROOT = 'planetplant';
+export const TOPIC_VERSION = 'v1';
+export const TOPIC_SHARD_COUNT = 16;
+export const EVENTS = 'evt';
+export const COMMANDS = 'cmd';
+export const DEFAULT_SITE = 'default';
+
+export const CHANNELS = {
+  data: 'data',
+  batch: 'batch',
+  aggregate: 'aggregate',
+  status: 'status',
+  pump: 'pump',
+  watering: 'watering',
+  heartbeat: 'heartbeat',
+  configAck: 'config',
+  commandAck: 'ack',
+  metrics: 'metrics',
+  otaStatus: 'ota',
+  sampleRate: 'rate',
+  calibration: 'calibration',
+  mesh: 'mesh',
+  trace: 'trace'
+};
+
+export const COMMAND_NAMES = {
+  water: 'water',
+  config: 'config',
+  ota: 'ota',
+  calibrate: 'calibrate'
+};
+
+// Tree each channel used before the versioned scheme; newer channels
+// only exist on it
+const LEGACY_TREES = {
+  data: 'sensors',
+  batch: 'sensors',
+  aggregate: 'sensors',
+  status: 'sensors',
+  pump: 'sensors',
+  watering: 'sensors',
+  heartbeat: 'devices',
+  config: 'devices',
+  ack: 'devices',
+  metrics: 'devices',
+  ota: 'devices'
+};
+
+// FNV-1a of the device id, as fnv1a32() in esp32/src/fnv1a.h
+export const topicShard = (deviceId) => {
+  let hash = 2166136261;
+  for (const byte of Buffer.from(deviceId, 'utf8')) {
+    hash = Math.imul(hash ^ byte, 16777619) >>> 0;
+  }
+  return hash % TOPIC_SHARD_COUNT;
+};
+
+const shardSegment = (shard) => String(shard).padStart(2, '0');
+
+export const deviceTopic = ({ site, shard, deviceId }, direction, name) =>
+  `${TOPIC_ROOT}/${TOPIC_VERSION}/${site}/${shardSegment(shard)}/${deviceId}/${direction}/${name}`;
+
+// Where commands for a device go: the route its own messages arrived on,
+// or the default site and its computed shard before it has been heard
+export const commandTopic = (route, deviceId, command, site = DEFAULT_SITE) => {
+  if (route?.legacy) {
+    return `commands/${deviceId}/${command}`;
+  }
+  return deviceTopic(route || { site, shard: topicShard(deviceId), deviceId }, COMMANDS, command);
+};
+
+// { deviceId, site, shard, direction, channel, legacy } or null
+export const parseDeviceTopic = (topic) => {
+  const parts = topic.split('/');
+  if (parts.length === 7 && parts[0] === TOPIC_ROOT && parts[1] === TOPIC_VERSION) {
+    const [, , site, shard, deviceId, direction, channel] = parts;
+    return { deviceId, site, shard: parseInt(shard, 10), direction, channel, legacy: false };
+  }
+  if (parts.length === 3 && LEGACY_TREES[parts[2]] === parts[0]) {
+    return { deviceId: parts[1], site: null, shard: null, direction: EVENTS, channel: parts[2], legacy: true };
+  }
+  return null;
+};
+
+// Event filters for the given channels. With a group they become shared
+// subscriptions the broker balances across every worker in it; site and
+// shards narrow a worker down to part of the fleet. Legacy topics carry
+// neither, so only a worker taking the whole fleet gets them.
+export const eventSubscriptions = (channels, { group = null, site = '+', shards = ['+'] } = {}) => {
+  const legacy = site === '+' && shards.includes('+');
+  const share = (filter) => (group ? `$share/${group}/${filter}` : filter);
+  const filters = [];
+  for (const channel of channels) {
+    for (const shard of shards) {
+      const segment = shard === '+' ? shard : shardSegment(shard);
+      filters.push(share(`${TOPIC_ROOT}/${TOPIC_VERSION}/${site}/${segment}/+/${EVENTS}/${channel}`));
+    }
+    if (legacy && LEGACY_TREES[channel]) {
+      filters.push(share(`${LEGACY_TREES[channel]}/+/${channel}`));
+    }
+  }
+  return filters;
+};
+
+// "0-3,8" -> [0, 1, 2, 3, 8]; empty means every shard
+export const parseShardList = (list) => {
+  if (!list) {
+    return ['+'];
+  }
+  const shards = new Set();
+  for (const part of list.split(',')) {
+    const [from, to = from] = part.split('-').map((value) => parseInt(value, 10));
+    for (let shard = from; shard <= to && shard < TOPIC_SHARD_COUNT; shard++) {
+      shards.add(shard);
+    }
+  }
+  return shards.size > 0 ? [...shards] : ['+'];
+};
+
+// Backend-owned topics, per client so several workers don't overwrite
+// each other's retained status
+export const serverTopic = (clientId, name) => `${TOPIC_ROOT}/${TOPIC_VERSION}/server/${clientId}/${name}`;
+export const SYSTEM_COMMAND_TOPIC = `${TOPIC_ROOT}/${TOPIC_VERSION}/server/${COMMANDS}/system`;
@@ -212,11 +212,11 @@ router.put('/:id', asyncHandler(async (req, res) => {
 // POST /api/plants/:id/calibrate - Calibrate sensors
 router.post('/:id/calibrate', asyncHandler(async (req, res) => {
   const { id } = req.params;
-  const { sensor, calibrationType } = req.body;
+  const { sensor, calibrationType, value } = req.body;
   
-  // Validate input
-  const validSensors = ['moisture', 'temperature', 'humidity'];
-  const validCalibrationTypes = ['dry', 'wet', 'zero', 'span'];
+  // Validate input; temperature and humidity come calibrated from the DHT22
+  const validSensors = ['moisture', 'light'];
+  const validCalibrationTypes = ['dry', 'wet', 'zero', 'span', 'point', 'reset'];
   
   if (!validSensors.includes(sensor)) {
     return res.status(400).json({
@@ -238,20 +238,24 @@ router.post('/:id/calibrate', asyncHandler(async (req, res) => {
     });
   }
   
+  // A point is captured for a value measured some other way
+  if (calibrationType === 'point' && (!Number.isInteger(value) || value < 0 || value > 100)) {
+    return res.status(400).json({
+      success: false,
+      error: {
+        message: 'Point calibration requires an integer value between 0 and 100'
+      }
+    });
+  }
+  
   // Ensure plant exists
   await plantService.getPlantById(id);
   
-  // Send calibration command via MQTT
-  const calibrationCommand = {
-    command: 'calibrate',
-    sensor,
-    type: calibrationType,
-    timestamp: new Date().toISOString()
-  };
+  // Send calibration command via MQTT; the device reports the new curve
+  // on its calibration channel
+  const commandId = mqttClient.publishCalibrationCommand(id, sensor, calibrationType, value);
   
-  const success = mqttClient.publish(`commands/${id}/calibrate`, calibrationCommand, 1);
-  
-  if (!success) {
+  if (!commandId) {
     return res.status(503).json({
       success: false,
       error: {
@@ -267,6 +271,7 @@ router.post('/:id/calibrate', asyncHandler(async (req, res) => {
     success: true,
     data: {
       plantId: id,
+      commandId,
       sensor,
       calibrationType,
       timestamp: new Date().toISOString()
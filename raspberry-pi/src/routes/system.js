@@ -4,6 +4,7 @@ import { healthService } from '../services/healthService.js';
 import { mqttClient } from '../services/mqttClient.js';
 import { influxService } from '../services/influxService.js';
 import { plantService } from '../services/plantService.js';
+import { metricsService } from '../services/metricsService.js';
 import { logger } from '../utils/logger.js';
 import os from 'os';
 import process from 'process';
@@ -260,6 +261,56 @@ router.get('/metrics', asyncHandler(async (req, res) => {
   });
 }));
 
+// GET /api/system/metrics/devices - Firmware performance metrics per device
+router.get('/metrics/devices', asyncHandler(async (req, res) => {
+  if (req.query.format === 'prometheus') {
+    res.type('text/plain; version=0.0.4').send(metricsService.renderPrometheus());
+    return;
+  }
+
+  res.json({
+    success: true,
+    data: metricsService.getDeviceMetrics(),
+    timestamp: new Date().toISOString()
+  });
+}));
+
+// POST /api/system/ota - Roll a firmware image out to devices
+router.post('/ota', asyncHandler(async (req, res) => {
+  const { version, url, size, sha256, encoding = 'none', windowMs, devices } = req.body;
+
+  const invalid = [
+    typeof version !== 'string' || version.length === 0 || version.length > 23 ? 'version' : null,
+    typeof url !== 'string' || !/^https?:\/\//.test(url) || url.length > 159 ? 'url' : null,
+    !Number.isInteger(size) || size <= 0 ? 'size' : null,
+    typeof sha256 !== 'string' || !/^[0-9a-fA-F]{64}$/.test(sha256) ? 'sha256' : null,
+    !['none', 'zlib'].includes(encoding) ? 'encoding' : null,
+    windowMs !== undefined && (!Number.isInteger(windowMs) || windowMs < 0 || windowMs > 86400000)
+      ? 'windowMs' : null
+  ].filter(Boolean);
+  if (invalid.length > 0) {
+    return res.status(400).json({
+      success: false,
+      error: { message: 'Invalid firmware manifest', fields: invalid }
+    });
+  }
+
+  // Default to every known device; zone plants share their device's firmware
+  const targets = Array.isArray(devices) ? devices : [...new Set(
+    [...plantService.plants.keys()].map((plantId) => mqttClient.parseZonePlantId(plantId).deviceId)
+  )];
+  mqttClient.publishOtaManifest(targets, { version, url, size, sha256, encoding, windowMs });
+
+  res.json({
+    success: true,
+    data: {
+      version,
+      devices: targets,
+      timestamp: new Date().toISOString()
+    }
+  });
+}));
+
 // GET /api/system/logs - Get recent logs
 router.get('/logs', asyncHandler(async (req, res) => {
   const { 
@@ -118,6 +118,12 @@ class AutomationService {
           continue;
         }
 
+        // Devices with the local controller close the loop themselves
+        if (plant.status.local_watering) {
+          logger.debug(`🌱 Skipping locally watered plant: ${plant.name} (${plant.id})`);
+          continue;
+        }
+
         if (!plantService.needsWatering(plant)) {
           logger.debug(`🌱 Plant ${plant.name} doesn't need watering (moisture: ${plant.currentData.moisture}%)`);
           continue;
@@ -139,7 +139,7 @@ class InfluxService {
     }
   }
 
-  writeSensorData(deviceId, plantId, location, sensorType, value, unit, quality = 'good') {
+  writeSensorData(deviceId, plantId, location, sensorType, value, unit, quality = 'good', timestamp = new Date()) {
     if (!this.isConnected) {
       logger.debug('📊 InfluxDB not connected - discarding sensor data');
       return;
@@ -153,7 +153,7 @@ class InfluxService {
       .floatField('value', parseFloat(value))
       .stringField('unit', unit)
       .stringField('quality', quality)
-      .timestamp(new Date());
+      .timestamp(timestamp);
 
     this.writeBuffer.push(point);
     
@@ -164,6 +164,31 @@ class InfluxService {
     logger.debug(`📊 Queued sensor data: ${sensorType}=${value}${unit} for ${plantId}`);
   }
 
+  writeSensorAggregate(deviceId, plantId, location, sensorType, aggregate, unit, count, windowMs,
+    timestamp = new Date()) {
+    if (!this.isConnected) {
+      logger.debug('📊 InfluxDB not connected - discarding sensor aggregate');
+      return;
+    }
+
+    const point = new Point('sensor_aggregates')
+      .tag('device_id', deviceId)
+      .tag('plant_id', plantId)
+      .tag('location', location || 'unknown')
+      .tag('sensor_type', sensorType)
+      .floatField('min', parseFloat(aggregate.min))
+      .floatField('max', parseFloat(aggregate.max))
+      .floatField('mean', parseFloat(aggregate.mean))
+      .floatField('slope_per_hour', parseFloat(aggregate.slope))
+      .intField('count', count)
+      .intField('window_ms', windowMs)
+      .stringField('unit', unit)
+      .timestamp(timestamp);
+
+    this.writeBuffer.push(point);
+    logger.debug(`📊 Queued ${sensorType} aggregate over ${count} samples for ${plantId}`);
+  }
+
   writeWateringEvent(plantId, deviceId, triggerType, durationMs, volumeMl, success, reason) {
     if (!this.isConnected) {
       logger.debug('📊 InfluxDB not connected - discarding watering event');
@@ -184,6 +209,29 @@ class InfluxService {
     logger.info(`💧 Queued watering event for ${plantId}: ${durationMs}ms, success=${success}`);
   }
 
+  writeSampleRate(deviceId, mode, intervalMs, previousMs, moistureRate, batteryMv, timestamp = new Date()) {
+    if (!this.isConnected) {
+      logger.debug('📊 InfluxDB not connected - discarding sample rate change');
+      return;
+    }
+
+    const point = new Point('sample_rate')
+      .tag('device_id', deviceId)
+      .tag('mode', mode)
+      .intField('interval_ms', intervalMs)
+      .floatField('moisture_rate_per_hour', parseFloat(moistureRate) || 0)
+      .timestamp(timestamp);
+    if (typeof previousMs === 'number') {
+      point.intField('previous_interval_ms', previousMs);
+    }
+    if (typeof batteryMv === 'number') {
+      point.intField('battery_mv', batteryMv);
+    }
+
+    this.writeBuffer.push(point);
+    logger.debug(`📊 Queued sample rate change for ${deviceId}: ${mode}, ${intervalMs}ms`);
+  }
+
   writeSystemStats(cpuUsage, memoryUsage, diskUsage, temperature) {
     const point = new Point('system_stats')
       .tag('host', process.env.DEVICE_ID || 'unknown')
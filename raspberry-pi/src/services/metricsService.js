@@ -0,0 +1,149 @@
+import { logger } from '../utils/logger.js';
+
+// Upper bucket bounds (microseconds) of the firmware histograms; must match
+// metricsBucketBounds in esp32/src/metrics.cpp. The last device bucket is +Inf.
+const BUCKET_BOUNDS_US = [50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 1000000];
+
+// Devices that stopped reporting drop out of the exposition after this long
+const STALE_AFTER_MS = 30 * 60 * 1000;
+
+class MetricsService {
+  constructor() {
+    this.devices = new Map();
+  }
+
+  recordDeviceMetrics(deviceId, payload) {
+    this.devices.set(deviceId, { payload, receivedAt: Date.now() });
+    logger.debug(`📊 Metrics from device ${deviceId} (uptime ${payload.uptime}ms)`);
+  }
+
+  getDeviceMetrics() {
+    const devices = {};
+    for (const [deviceId, { payload, receivedAt }] of this.devices) {
+      devices[deviceId] = { ...payload, receivedAt: new Date(receivedAt).toISOString() };
+    }
+    return devices;
+  }
+
+  // Prometheus text exposition (version 0.0.4) of the latest report per device
+  renderPrometheus() {
+    const families = new Map();
+    const add = (name, type, help, labels, value) => {
+      if (typeof value !== 'number' || !Number.isFinite(value)) {
+        return;
+      }
+      if (!families.has(name)) {
+        families.set(name, { type, help, samples: [] });
+      }
+      families.get(name).samples.push({ labels, value });
+    };
+
+    const addHistogram = (name, help, labels, histogram) => {
+      if (!histogram || !Array.isArray(histogram.buckets)) {
+        return;
+      }
+      // Device buckets are per-bucket counts; Prometheus wants cumulative ones
+      let cumulative = 0;
+      BUCKET_BOUNDS_US.forEach((bound, i) => {
+        cumulative += histogram.buckets[i] || 0;
+        add(`${name}_bucket`, 'histogram', help, { ...labels, le: `${bound / 1e6}` }, cumulative);
+      });
+      add(`${name}_bucket`, 'histogram', help, { ...labels, le: '+Inf' }, histogram.count);
+      add(`${name}_sum`, 'histogram', help, labels, histogram.sum / 1e6);
+      add(`${name}_count`, 'histogram', help, labels, histogram.count);
+    };
+
+    const now = Date.now();
+    for (const [deviceId, { payload, receivedAt }] of this.devices) {
+      if (now - receivedAt > STALE_AFTER_MS) {
+        continue;
+      }
+
+      const device = { device: deviceId };
+      add('planetplant_device_metrics_age_seconds', 'gauge', 'Seconds since the last metrics report',
+        device, (now - receivedAt) / 1000);
+      add('planetplant_device_uptime_seconds', 'gauge', 'Device uptime', device, payload.uptime / 1000);
+
+      const heap = payload.heap || {};
+      add('planetplant_device_heap_free_bytes', 'gauge', 'Free heap', device, heap.free);
+      add('planetplant_device_heap_min_free_bytes', 'gauge', 'Lowest free heap since boot', device, heap.min_free);
+      add('planetplant_device_heap_largest_block_bytes', 'gauge', 'Largest allocatable heap block',
+        device, heap.largest_block);
+      add('planetplant_device_heap_fragmentation_ratio', 'gauge', '1 - largest block / free heap',
+        device, heap.fragmentation);
+
+      for (const [task, value] of Object.entries(payload.stack_free || {})) {
+        add('planetplant_device_stack_free_bytes', 'gauge', 'Task stack high-water mark (unused bytes)',
+          { ...device, task }, value);
+      }
+      for (const [task, value] of Object.entries(payload.jitter_ms || {})) {
+        add('planetplant_device_scheduler_jitter_max_seconds', 'gauge', 'Worst scheduler lateness since boot',
+          { ...device, task }, value / 1000);
+      }
+      for (const [task, histogram] of Object.entries(payload.loop_us || {})) {
+        addHistogram('planetplant_device_loop_duration_seconds', 'Work per task loop iteration',
+          { ...device, task }, histogram);
+      }
+
+      const publish = payload.publish || {};
+      add('planetplant_device_mqtt_publish_total', 'counter', 'MQTT publishes by result',
+        { ...device, result: 'ok' }, publish.ok);
+      add('planetplant_device_mqtt_publish_total', 'counter', 'MQTT publishes by result',
+        { ...device, result: 'failed' }, publish.failed);
+      addHistogram('planetplant_device_mqtt_publish_duration_seconds', 'QoS 1 publish to PUBACK',
+        device, publish.latency_us);
+      add('planetplant_device_mqtt_inflight', 'gauge', 'QoS 1 publishes awaiting PUBACK', device, publish.in_flight);
+      add('planetplant_device_mqtt_outbox_bytes', 'gauge', 'Bytes queued in the MQTT outbox',
+        device, publish.queued_bytes);
+      add('planetplant_device_mqtt_outbox_refused_total', 'counter', 'Publishes refused with a full outbox',
+        device, publish.refused);
+
+      for (const [sensor, histogram] of Object.entries(payload.sensor_us || {})) {
+        addHistogram('planetplant_device_sensor_read_duration_seconds', 'Sensor read duration',
+          { ...device, sensor }, histogram);
+      }
+      add('planetplant_device_dht_errors_total', 'counter', 'DHT22 failed reads by cause',
+        { ...device, cause: 'checksum' }, payload.dht_checksum_errors);
+      add('planetplant_device_dht_errors_total', 'counter', 'DHT22 failed reads by cause',
+        { ...device, cause: 'timeout' }, payload.dht_timeouts);
+
+      const mqtt = payload.mqtt || {};
+      add('planetplant_device_mqtt_connect_attempts_total', 'counter', 'MQTT connect attempts', device, mqtt.attempts);
+      add('planetplant_device_mqtt_connect_failures_total', 'counter', 'Failed MQTT connect attempts',
+        device, mqtt.failures);
+      add('planetplant_device_mqtt_connects_total', 'counter', 'Successful MQTT connects', device, mqtt.connects);
+      add('planetplant_device_mqtt_connect_duration_seconds', 'gauge', 'Duration of the last MQTT connect',
+        device, mqtt.connect_ms / 1000);
+      add('planetplant_device_mqtt_downtime_seconds', 'gauge', 'Length of the last MQTT outage',
+        device, mqtt.downtime_ms / 1000);
+
+      // Only sent by devices with MQTT over TLS; mode is full or resumed
+      for (const [mode, histogram] of Object.entries(payload.tls_us || {})) {
+        addHistogram('planetplant_device_tls_handshake_duration_seconds', 'MQTT TLS handshake duration',
+          { ...device, mode }, histogram);
+      }
+      add('planetplant_device_tls_session_save_failures_total', 'counter', 'TLS sessions too large for RTC memory',
+        device, payload.tls_session_save_failures);
+    }
+
+    const escape = (value) => String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+    const lines = [];
+    for (const [name, { type, help, samples }] of families) {
+      const family = name.replace(/_(bucket|sum|count)$/, '');
+      if (type !== 'histogram' || name.endsWith('_bucket')) {
+        lines.push(`# HELP ${family} ${help}`);
+        lines.push(`# TYPE ${family} ${type}`);
+      }
+      for (const { labels, value } of samples) {
+        const labelText = Object.entries(labels).map(([key, v]) => `${key}="${escape(v)}"`).join(',');
+        lines.push(`${name}{${labelText}} ${value}`);
+      }
+    }
+    return `${lines.join('\n')}\n`;
+  }
+}
+
+// Export singleton instance
+export const metricsService = new MetricsService();
+
+export { MetricsService };
@@ -1,6 +1,52 @@
 import mqtt from 'mqtt';
+import { randomUUID } from 'node:crypto';
 import { logger } from '../utils/logger.js';
 import { plantService } from './plantService.js';
+import { metricsService } from './metricsService.js';
+import {
+  isBinaryFrame, decodeTelemetryFrame, expandBatch, expandMeshBatch, isEpochTimestamp
+} from '../utils/telemetryCodec.js';
+import {
+  CHANNELS, COMMAND_NAMES, DEFAULT_SITE, EVENTS, SYSTEM_COMMAND_TOPIC,
+  commandTopic, eventSubscriptions, parseDeviceTopic, parseShardList, serverTopic
+} from '../config/topics.js';
+
+// Device clocks further ahead than this are ignored in favour of arrival time
+const MAX_CLOCK_SKEW_MS = 5 * 60 * 1000;
+
+// Firmware reset reasons that mean the previous run ended in a crash
+const CRASH_RESET_REASONS = ['panic', 'interrupt_watchdog', 'task_watchdog', 'watchdog', 'brownout'];
+
+// The broker queues commands for offline devices (persistent sessions); a
+// watering command that is delivered later than this is dropped by the device
+const WATER_COMMAND_TTL_MS = 10 * 60 * 1000;
+
+// Commands without a device ack by then are reported as unacknowledged
+const COMMAND_ACK_TIMEOUT_MS = WATER_COMMAND_TTL_MS;
+
+// Channels each message of which needs handling once, and the QoS they
+// are taken at; with MQTT_SHARED_GROUP the broker spreads them over every
+// backend worker in the group
+const INGEST_CHANNELS = [
+  [CHANNELS.data, 1],
+  [CHANNELS.batch, 1],
+  [CHANNELS.aggregate, 1],
+  [CHANNELS.watering, 1],
+  [CHANNELS.status, 1],
+  [CHANNELS.heartbeat, 0],
+  [CHANNELS.configAck, 1],
+  [CHANNELS.otaStatus, 1],
+  [CHANNELS.sampleRate, 1],
+  [CHANNELS.calibration, 1],
+  [CHANNELS.mesh, 1]
+];
+
+// Channels every worker needs: metrics are served from memory and acks
+// are matched to the commands this worker sent
+const WORKER_CHANNELS = [
+  [CHANNELS.metrics, 0],
+  [CHANNELS.commandAck, 1]
+];
 
 class MQTTClient {
   constructor() {
@@ -9,25 +55,19 @@ class MQTTClient {
     this.reconnectAttempts = 0;
     this.maxReconnectAttempts = parseInt(process.env.MQTT_MAX_RETRY_COUNT) || 10;
     this.reconnectInterval = parseInt(process.env.MQTT_RECONNECT_INTERVAL) || 5000;
+    this.pendingCommands = new Map();
     
-    this.topics = {
-      // Incoming sensor data
-      sensorData: 'sensors/+/data',
-      sensorStatus: 'sensors/+/status',
-      deviceHeartbeat: 'devices/+/heartbeat',
-      
-      // Outgoing commands
-      waterCommand: 'commands/{plant_id}/water',
-      configCommand: 'commands/{plant_id}/config',
-      systemCommand: 'commands/system'
-    };
+    this.clientId = process.env.MQTT_CLIENT_ID || `plantplant-server-${Date.now()}`;
+    
+    // Last topic tree each device was heard on; its commands follow it
+    this.deviceRoutes = new Map();
   }
 
   async initialize() {
     const brokerUrl = `mqtt://${process.env.MQTT_HOST || 'localhost'}:${process.env.MQTT_PORT || 1883}`;
     
     const options = {
-      clientId: process.env.MQTT_CLIENT_ID || `plantplant-server-${Date.now()}`,
+      clientId: this.clientId,
       username: process.env.MQTT_USERNAME,
       password: process.env.MQTT_PASSWORD,
       keepalive: parseInt(process.env.MQTT_KEEPALIVE) || 60,
@@ -35,7 +75,7 @@ class MQTTClient {
       reconnectPeriod: this.reconnectInterval,
       clean: true,
       will: {
-        topic: 'server/status',
+        topic: serverTopic(this.clientId, 'status'),
         payload: JSON.stringify({
           status: 'offline',
           timestamp: new Date().toISOString()
@@ -87,12 +127,19 @@ class MQTTClient {
   }
 
   subscribeToTopics() {
+    const group = process.env.MQTT_SHARED_GROUP ?? 'planetplant-ingest';
+    const filter = {
+      group: group || null,
+      site: process.env.MQTT_SITE_FILTER || '+',
+      shards: parseShardList(process.env.MQTT_SHARDS)
+    };
+    const expand = (channels, options) => channels.flatMap(([channel, qos]) =>
+      eventSubscriptions([channel], options).map((topic) => ({ topic, qos })));
     const subscriptions = [
-      { topic: this.topics.sensorData, qos: 1 },
-      { topic: this.topics.sensorStatus, qos: 1 },
-      { topic: this.topics.deviceHeartbeat, qos: 0 }
+      ...expand(INGEST_CHANNELS, filter),
+      ...expand(WORKER_CHANNELS, { ...filter, group: null })
     ];
-
+    
     subscriptions.forEach(({ topic, qos }) => {
       this.client.subscribe(topic, { qos }, (error) => {
         if (error) {
@@ -106,22 +153,72 @@ class MQTTClient {
 
   async onMessage(topic, message) {
     try {
-      const payload = JSON.parse(message.toString());
-      const topicParts = topic.split('/');
+      // Packed firmware frames start with a magic byte JSON can never start with
+      const payload = isBinaryFrame(message)
+        ? decodeTelemetryFrame(message)
+        : JSON.parse(message.toString());
+      const route = parseDeviceTopic(topic);
       
       logger.debug(`📡 MQTT Message received on ${topic}:`, payload);
       
-      switch (true) {
-        case topic.startsWith('sensors/') && topic.endsWith('/data'):
-          await this.handleSensorData(topicParts[1], payload);
+      if (!route || route.direction !== EVENTS) {
+        logger.warn(`📡 Unhandled MQTT topic: ${topic}`);
+        return;
+      }
+      const { deviceId } = route;
+      this.deviceRoutes.set(deviceId, route);
+      
+      switch (route.channel) {
+        case CHANNELS.data:
+          await this.handleSensorData(deviceId, payload);
+          break;
+          
+        case CHANNELS.batch:
+          await this.handleSensorBatch(deviceId, payload);
+          break;
+          
+        case CHANNELS.aggregate:
+          await this.handleSensorAggregate(deviceId, payload);
+          break;
+          
+        case CHANNELS.watering:
+          await this.handleWateringResult(deviceId, payload);
+          break;
+          
+        case CHANNELS.status:
+          await this.handleSensorStatus(deviceId, payload);
+          break;
+          
+        case CHANNELS.heartbeat:
+          await this.handleDeviceHeartbeat(deviceId, payload);
+          break;
+          
+        case CHANNELS.configAck:
+          await this.handleConfigAck(deviceId, payload);
           break;
           
-        case topic.startsWith('sensors/') && topic.endsWith('/status'):
-          await this.handleSensorStatus(topicParts[1], payload);
+        case CHANNELS.metrics:
+          metricsService.recordDeviceMetrics(deviceId, payload);
           break;
           
-        case topic.startsWith('devices/') && topic.endsWith('/heartbeat'):
-          await this.handleDeviceHeartbeat(topicParts[1], payload);
+        case CHANNELS.otaStatus:
+          await this.handleOtaStatus(deviceId, payload);
+          break;
+          
+        case CHANNELS.commandAck:
+          this.handleCommandAck(deviceId, payload);
+          break;
+          
+        case CHANNELS.sampleRate:
+          await this.handleSampleRate(deviceId, payload);
+          break;
+          
+        case CHANNELS.calibration:
+          await this.handleCalibrationResult(deviceId, payload);
+          break;
+          
+        case CHANNELS.mesh:
+          await this.handleMeshBatch(route, payload);
           break;
           
         default:
@@ -133,19 +230,31 @@ class MQTTClient {
     }
   }
 
-  async handleSensorData(plantId, data) {
+  async handleSensorData(plantId, payload) {
     try {
+      const data = this.normalizeSensorData(payload);
+
       // Validate sensor data
       if (!this.validateSensorData(data)) {
-        logger.warn(`📡 Invalid sensor data for plant ${plantId}:`, data);
+        logger.warn(`📡 Invalid sensor data for plant ${plantId}:`, payload);
         return;
       }
 
+      // Place samples where they were taken instead of at arrival time:
+      // synced devices send epoch timestamps, replayed ones at least their age
+      const sampledAt = this.getSampleTime(payload);
+      const live = !payload.replayed;
+
       // Store in InfluxDB
       // Data is now written to InfluxDB via plantService.updateSensorData
       
       // Update plant service
-      await plantService.updateSensorData(plantId, data);
+      await plantService.updateSensorData(plantId, data, sampledAt, live);
+      
+      if (!live) {
+        logger.debug(`📊 Stored replayed sample for plant ${plantId} from ${sampledAt?.toISOString() ?? 'an unknown time'}`);
+        return;
+      }
       
       // Broadcast to WebSocket clients
       if (global.io) {
@@ -158,11 +267,207 @@ class MQTTClient {
       
       logger.debug(`📊 Processed sensor data for plant ${plantId}`);
       
+      // Multi-zone devices: zone 0 is the device plant itself, the other
+      // probes report as their own plants sharing the ambient readings
+      if (Array.isArray(payload.zones)) {
+        for (let zone = 1; zone < payload.zones.length; zone++) {
+          const { moisture, pump_active: pumpActive } = payload.zones[zone];
+          await this.handleSensorData(this.zonePlantId(plantId, zone), {
+            ...payload,
+            zones: undefined,
+            sensors: { ...payload.sensors, moisture, pump_active: pumpActive }
+          });
+        }
+      }
+      
     } catch (error) {
       logger.error(`📡 Error handling sensor data for plant ${plantId}:`, error);
     }
   }
 
+  // Plant id of a zone on a multi-zone device; zone 0 keeps the device id
+  zonePlantId(deviceId, zone) {
+    return zone > 0 ? `${deviceId}-zone${zone}` : deviceId;
+  }
+
+  // Inverse of zonePlantId(): device topic id and zone index for a plant
+  parseZonePlantId(plantId) {
+    const match = /^(.+)-zone(\d+)$/.exec(plantId);
+    return match ? { deviceId: match[1], zone: Number(match[2]) } : { deviceId: plantId, zone: 0 };
+  }
+
+  // Samples an ESP-NOW gateway relays for its leaves. Each leaf becomes
+  // reachable through the gateway's topics: its commands go to the
+  // gateway, which holds them until the leaf's next sample.
+  async handleMeshBatch(route, payload) {
+    try {
+      const byPlant = new Map();
+      for (const sample of expandMeshBatch(payload)) {
+        const { deviceId, zones, ...reading } = sample;
+        this.deviceRoutes.set(deviceId, route);
+
+        // Zone 0 is the leaf itself, as for evt/data
+        const plants = zones.length > 1
+          ? zones.map(({ moisture, pump_active: pumpActive }, zone) =>
+            [this.zonePlantId(deviceId, zone), { ...reading, moisture, pump_active: pumpActive }])
+          : [[deviceId, reading]];
+        for (const [plantId, data] of plants) {
+          if (this.validateSensorData(data)) {
+            byPlant.set(plantId, [...(byPlant.get(plantId) || []), data]);
+          }
+        }
+      }
+
+      for (const [plantId, samples] of byPlant) {
+        await plantService.updateSensorBatch(plantId, samples);
+        if (global.io) {
+          global.io.emit('sensorData', {
+            plantId,
+            data: samples[samples.length - 1],
+            timestamp: new Date().toISOString()
+          });
+        }
+      }
+
+      logger.debug(`📊 Processed mesh batch from gateway ${route.deviceId} for ${byPlant.size} plants`);
+
+    } catch (error) {
+      logger.error(`📡 Error handling mesh batch from gateway ${route.deviceId}:`, error);
+    }
+  }
+
+  async handleSensorBatch(plantId, payload) {
+    try {
+      const samples = expandBatch(payload).filter(sample => this.validateSensorData(sample));
+      if (samples.length === 0) {
+        logger.warn(`📡 Empty or invalid sensor batch for plant ${plantId}`);
+        return;
+      }
+
+      await plantService.updateSensorBatch(plantId, samples);
+      
+      // Batches may carry the heartbeat instead of a separate message
+      if (payload.heartbeat) {
+        await plantService.updateDeviceHeartbeat(plantId, payload.heartbeat);
+      }
+      
+      // Only the newest reading is interesting for live dashboards
+      if (global.io) {
+        global.io.emit('sensorData', {
+          plantId,
+          data: samples[samples.length - 1],
+          timestamp: new Date().toISOString()
+        });
+      }
+      
+      logger.debug(`📊 Processed batch of ${samples.length} samples for plant ${plantId}`);
+      
+    } catch (error) {
+      logger.error(`📡 Error handling sensor batch for plant ${plantId}:`, error);
+    }
+  }
+
+  async handleSensorAggregate(plantId, payload) {
+    try {
+      // Report-by-exception devices send window summaries (min/max/mean/slope)
+      if (!payload.window_ms || !payload.count) {
+        logger.warn(`📡 Invalid sensor aggregate for plant ${plantId}:`, payload);
+        return;
+      }
+
+      await plantService.updateSensorAggregates(plantId, payload);
+      
+      logger.debug(`📈 Processed ${payload.count}-sample aggregate for plant ${plantId}`);
+      
+    } catch (error) {
+      logger.error(`📡 Error handling sensor aggregate for plant ${plantId}:`, error);
+    }
+  }
+
+  async handleWateringResult(deviceId, result) {
+    const plantId = this.zonePlantId(deviceId, result.zone || 0);
+    try {
+      // Devices water locally on moisture feedback and only report the outcome
+      if (typeof result.pump_ms !== 'number' || !result.outcome) {
+        logger.warn(`📡 Invalid watering result for plant ${plantId}:`, result);
+        return;
+      }
+
+      await plantService.recordWateringEvent(plantId, {
+        duration: result.pump_ms,
+        triggerType: 'device',
+        reason: `${result.outcome}: ${result.moisture_start}% -> ${result.moisture_end}% in ${result.pulses} pulses`,
+        success: result.outcome === 'target_reached'
+      });
+
+      if (global.io) {
+        global.io.emit('wateringCompleted', {
+          plantId,
+          result,
+          timestamp: new Date().toISOString()
+        });
+      }
+
+      logger.info(`💧 Plant ${plantId} watered locally (${result.outcome}, ${result.pump_ms}ms)`);
+
+    } catch (error) {
+      logger.error(`📡 Error handling watering result for plant ${plantId}:`, error);
+    }
+  }
+
+  async handleSampleRate(deviceId, change) {
+    try {
+      // Adaptive sampling (esp32/src/sample_rate.h): samples that follow are
+      // interval_ms apart, so gaps up to that long are not missing data
+      if (typeof change.interval_ms !== 'number' || !change.mode) {
+        logger.warn(`📡 Invalid sample rate change from device ${deviceId}:`, change);
+        return;
+      }
+
+      await plantService.updateSampleRate(deviceId, change, this.getSampleTime(change));
+
+      logger.debug(`⏱️ Device ${deviceId} now samples every ${change.interval_ms}ms (${change.mode})`);
+
+    } catch (error) {
+      logger.error(`📡 Error handling sample rate change for ${deviceId}:`, error);
+    }
+  }
+
+  async handleCalibrationResult(deviceId, report) {
+    try {
+      // Calibration step (esp32/src/calibration.h); curve is the sensor's
+      // [[mV, %], ...] after it, applied on the device
+      if (!report.result || !Array.isArray(report.curve)) {
+        logger.warn(`📡 Invalid calibration result from device ${deviceId}:`, report);
+        return;
+      }
+
+      const sensor = report.sensor || 'moisture';
+      const plantId = sensor === 'moisture' ? this.zonePlantId(deviceId, report.zone || 0) : deviceId;
+      if (report.result === 'captured' || report.result === 'reset' || report.result === 'capturing') {
+        logger.info(`🔧 Plant ${plantId} ${sensor} calibration ${report.result}` +
+          `${report.millivolts ? ` at ${report.millivolts}mV` : ''}`);
+      } else {
+        logger.warn(`🔧 Plant ${plantId} ${sensor} calibration ${report.result}`);
+      }
+
+      await plantService.updatePlantStatus(plantId, {
+        [`${sensor}Calibration`]: { result: report.result, curve: report.curve, updated: new Date().toISOString() }
+      });
+
+      if (global.io) {
+        global.io.emit('calibrationResult', {
+          plantId,
+          report,
+          timestamp: new Date().toISOString()
+        });
+      }
+
+    } catch (error) {
+      logger.error(`📡 Error handling calibration result for ${deviceId}:`, error);
+    }
+  }
+
   async handleSensorStatus(plantId, status) {
     try {
       // Update plant status
@@ -178,6 +483,19 @@ class MQTTClient {
       }
       
       logger.info(`📡 Plant ${plantId} status updated:`, status);
+
+      // Firmware fault report (esp32/src/watchdog.h), once per device
+      const faults = status.faults;
+      if (faults && CRASH_RESET_REASONS.includes(faults.reset_reason) && this.parseZonePlantId(plantId).zone === 0) {
+        logger.warn(`🔁 Device ${plantId} restarted after ${faults.reset_reason}` +
+          `${faults.stalled_task ? ` (${faults.stalled_task} task stalled)` : ''}, ` +
+          `${faults.crashes} crash(es) since power-on, ${faults.consecutive_crashes} in a row`);
+      }
+      
+      // Zone plants share their device's connectivity
+      for (let zone = 1; zone < (status.zones || 1); zone++) {
+        await this.handleSensorStatus(this.zonePlantId(plantId, zone), { ...status, zones: undefined });
+      }
       
     } catch (error) {
       logger.error(`📡 Error handling sensor status for plant ${plantId}:`, error);
@@ -197,6 +515,125 @@ class MQTTClient {
     }
   }
 
+  async handleConfigAck(deviceId, ack) {
+    try {
+      if (ack.result === 'rejected') {
+        logger.warn(`⚙️ Device ${deviceId} rejected config update ${ack.request_id || ''}: ${ack.error}`);
+      } else {
+        logger.info(`⚙️ Device ${deviceId} config ${ack.result} (revision ${ack.revision})`);
+      }
+
+      await plantService.updatePlantStatus(deviceId, {
+        configRevision: ack.revision,
+        deviceSettings: ack.settings
+      });
+
+      if (global.io) {
+        global.io.emit('configAck', {
+          plantId: deviceId,
+          ack,
+          timestamp: new Date().toISOString()
+        });
+      }
+
+    } catch (error) {
+      logger.error(`📡 Error handling config ack for ${deviceId}:`, error);
+    }
+  }
+
+  handleCommandAck(deviceId, ack) {
+    const pending = this.pendingCommands.get(ack.request_id);
+    if (!pending) {
+      // Sent before a backend restart, or a duplicate after a redelivery
+      logger.debug(`📨 Device ${deviceId} acked unknown command ${ack.request_id}: ${ack.result}`);
+      return;
+    }
+
+    const latencyMs = Date.now() - pending.sentAt;
+    if (ack.result === 'accepted' || ack.result === 'duplicate') {
+      logger.info(`📨 Device ${deviceId} ${ack.result} ${ack.command} command ${ack.request_id} ` +
+        `after ${latencyMs}ms`);
+    } else {
+      logger.warn(`📨 Device ${deviceId} ${ack.result} ${ack.command} command ${ack.request_id}: ${ack.error || ''}`);
+    }
+
+    // The first ack settles it; later ones are redeliveries
+    clearTimeout(pending.timer);
+    this.pendingCommands.delete(ack.request_id);
+
+    if (global.io) {
+      global.io.emit('commandAck', {
+        plantId: pending.plantId,
+        ack,
+        latencyMs,
+        timestamp: new Date().toISOString()
+      });
+    }
+  }
+
+  trackCommand(id, plantId, command) {
+    const timer = setTimeout(() => {
+      this.pendingCommands.delete(id);
+      logger.warn(`📨 No ack for ${command} command ${id} to plant ${plantId} after ${COMMAND_ACK_TIMEOUT_MS}ms`);
+      if (global.io) {
+        global.io.emit('commandTimeout', { plantId, id, command, timestamp: new Date().toISOString() });
+      }
+    }, COMMAND_ACK_TIMEOUT_MS);
+    timer.unref();
+    this.pendingCommands.set(id, { plantId, command, sentAt: Date.now(), timer });
+  }
+
+  async handleOtaStatus(deviceId, status) {
+    try {
+      if (status.rejected) {
+        logger.warn(`🆕 Device ${deviceId} rejected firmware ${status.version || ''}: ${status.rejected}`);
+      } else if (status.state === 'failed' || status.state === 'rolled_back') {
+        logger.warn(`🆕 Device ${deviceId} firmware ${status.version} ${status.state}: ${status.error}`);
+      } else {
+        logger.info(`🆕 Device ${deviceId} firmware ${status.version || status.running} ${status.state}`);
+      }
+
+      await plantService.updatePlantStatus(deviceId, {
+        firmwareVersion: status.running,
+        ota: { state: status.state, version: status.version, error: status.error, checks: status.checks }
+      });
+
+      if (global.io) {
+        global.io.emit('otaStatus', {
+          plantId: deviceId,
+          status,
+          timestamp: new Date().toISOString()
+        });
+      }
+
+    } catch (error) {
+      logger.error(`📡 Error handling OTA status for ${deviceId}:`, error);
+    }
+  }
+
+  normalizeSensorData(payload) {
+    // ESP32 firmware nests readings under "sensors" and health under "status"
+    if (payload && typeof payload.sensors === 'object') {
+      return {
+        ...payload.sensors,
+        ...(typeof payload.status === 'object' ? payload.status : {}),
+        device_id: payload.device_id,
+        timestamp: payload.timestamp
+      };
+    }
+    return payload;
+  }
+
+  getSampleTime(payload) {
+    if (isEpochTimestamp(payload?.timestamp) && payload.timestamp <= Date.now() + MAX_CLOCK_SKEW_MS) {
+      return new Date(payload.timestamp);
+    }
+    if (payload?.replayed && typeof payload.age_ms === 'number' && payload.age_ms >= 0) {
+      return new Date(Date.now() - payload.age_ms);
+    }
+    return null;
+  }
+
   validateSensorData(data) {
     const requiredFields = ['temperature', 'humidity', 'moisture'];
     const numericFields = ['temperature', 'humidity', 'moisture'];
@@ -223,23 +660,84 @@ class MQTTClient {
     return true;
   }
 
+  // Topic tree the device was last heard on, versioned or legacy
+  deviceCommandTopic(deviceId, command) {
+    return commandTopic(this.deviceRoutes.get(deviceId), deviceId, command, process.env.MQTT_SITE || DEFAULT_SITE);
+  }
+
+  // Heard through an ESP-NOW gateway, which only relays water commands
+  isMeshLeaf(deviceId) {
+    const route = this.deviceRoutes.get(deviceId);
+    return Boolean(route) && route.deviceId !== deviceId;
+  }
+
+  // Returns the command id the device acks on its ack channel, or false
   publishWateringCommand(plantId, duration = 5000) {
-    const topic = this.topics.waterCommand.replace('{plant_id}', plantId);
+    const { deviceId, zone } = this.parseZonePlantId(plantId);
+    const topic = this.deviceCommandTopic(deviceId, COMMAND_NAMES.water);
+    const id = randomUUID();
     const payload = {
       command: 'water',
+      id,
+      device_id: deviceId,
+      action: 'start',
+      zone,
       duration,
+      expires_at: Date.now() + WATER_COMMAND_TTL_MS,
       timestamp: new Date().toISOString()
     };
     
-    this.publish(topic, payload, 1);
-    logger.info(`💧 Sent watering command to plant ${plantId} for ${duration}ms`);
+    if (!this.publish(topic, payload, 1)) {
+      return false;
+    }
+    this.trackCommand(id, plantId, 'water');
+    logger.info(`💧 Sent watering command ${id} to plant ${plantId} for ${duration}ms`);
+    return id;
+  }
+
+  // Light is per device; moisture goes to the plant's zone. Returns the
+  // command id, or false
+  publishCalibrationCommand(plantId, sensor, type, value) {
+    const { deviceId, zone } = this.parseZonePlantId(plantId);
+    const topic = this.deviceCommandTopic(deviceId, COMMAND_NAMES.calibrate);
+    const id = randomUUID();
+    const payload = {
+      command: 'calibrate',
+      id,
+      device_id: deviceId,
+      sensor,
+      type,
+      timestamp: new Date().toISOString()
+    };
+    if (sensor === 'moisture') {
+      payload.zone = zone;
+    }
+    if (type === 'point') {
+      payload.value = value;
+    }
+
+    if (!this.publish(topic, payload, 1)) {
+      return false;
+    }
+    this.trackCommand(id, plantId, 'calibrate');
+    logger.info(`🔧 Sent ${sensor} ${type} calibration command ${id} to plant ${plantId}`);
+    return id;
   }
 
   publishConfigUpdate(plantId, config) {
-    const topic = this.topics.configCommand.replace('{plant_id}', plantId);
+    // Runtime settings are per device, so a zone plant's config applies to
+    // every zone on it
+    const { deviceId } = this.parseZonePlantId(plantId);
+    if (this.isMeshLeaf(deviceId)) {
+      logger.warn(`⚙️ Plant ${plantId} reports through an ESP-NOW gateway, config not sent`);
+      return;
+    }
+    const topic = this.deviceCommandTopic(deviceId, COMMAND_NAMES.config);
     const payload = {
       command: 'config',
+      id: `${Date.now()}`,
       config,
+      settings: this.toDeviceSettings(config),
       timestamp: new Date().toISOString()
     };
     
@@ -247,6 +745,38 @@ class MQTTClient {
     logger.info(`⚙️ Sent config update to plant ${plantId}:`, config);
   }
 
+  toDeviceSettings(config) {
+    // Firmware runtime settings (esp32/src/runtime_settings.cpp) the plant config maps onto
+    const settings = {};
+    if (config.moistureThresholds?.min !== undefined) settings.moisture_min = config.moistureThresholds.min;
+    if (config.moistureThresholds?.max !== undefined) settings.moisture_max = config.moistureThresholds.max;
+    if (config.wateringConfig?.duration !== undefined) settings.watering_duration = config.wateringConfig.duration;
+    if (config.wateringConfig?.cooldownMs !== undefined) settings.pump_cooldown = config.wateringConfig.cooldownMs;
+    return { ...settings, ...config.deviceSettings };
+  }
+
+  publishOtaManifest(deviceIds, manifest) {
+    // Devices spread their downloads over window_ms themselves
+    const payload = {
+      version: manifest.version,
+      url: manifest.url,
+      size: manifest.size,
+      sha256: manifest.sha256,
+      encoding: manifest.encoding || 'none',
+      window_ms: manifest.windowMs,
+      timestamp: new Date().toISOString()
+    };
+
+    for (const deviceId of deviceIds) {
+      if (this.isMeshLeaf(deviceId)) {
+        logger.warn(`🆕 Device ${deviceId} reports through an ESP-NOW gateway, skipped`);
+        continue;
+      }
+      this.publish(this.deviceCommandTopic(deviceId, COMMAND_NAMES.ota), payload, 1);
+    }
+    logger.info(`🆕 Sent firmware ${manifest.version} to ${deviceIds.length} device(s)`);
+  }
+
   publishSystemCommand(command, data = {}) {
     const payload = {
       command,
@@ -254,7 +784,7 @@ class MQTTClient {
       timestamp: new Date().toISOString()
     };
     
-    this.publish(this.topics.systemCommand, payload, 1);
+    this.publish(SYSTEM_COMMAND_TOPIC, payload, 1);
     logger.info(`🔧 Sent system command: ${command}`, data);
   }
 
@@ -290,7 +820,7 @@ class MQTTClient {
       memory: process.memoryUsage()
     };
     
-    this.publish('server/status', payload, 1);
+    this.publish(serverTopic(this.clientId, 'status'), payload, 1);
   }
 
   onError(error) {
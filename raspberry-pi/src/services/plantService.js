@@ -197,34 +197,45 @@ class PlantService {
     }
   }
 
-  async updateSensorData(plantId, sensorData) {
+  async updateSensorData(plantId, sensorData, sampledAt = null, live = !sampledAt) {
     const timer = createTimer('plantService.updateSensorData');
     
     try {
       const plant = this.plants.get(plantId);
-      if (!plant) {
+      if (!plant && live) {
         // Create new plant if it doesn't exist
         await this.createPlantFromSensorData(plantId, sensorData);
         timer.end({ plantId, created: true });
         return;
       }
+      if (!plant) {
+        timer.end({ plantId, skipped: true });
+        return;
+      }
 
       // Write sensor data to InfluxDB
+      const timestamp = sampledAt || new Date();
       if (sensorData.temperature !== undefined) {
         influxService.writeSensorData(plant.deviceId, plantId, plant.location, 
-          'temperature', sensorData.temperature, '°C');
+          'temperature', sensorData.temperature, '°C', 'good', timestamp);
       }
       if (sensorData.humidity !== undefined) {
         influxService.writeSensorData(plant.deviceId, plantId, plant.location, 
-          'humidity', sensorData.humidity, '%');
+          'humidity', sensorData.humidity, '%', 'good', timestamp);
       }
       if (sensorData.moisture !== undefined) {
         influxService.writeSensorData(plant.deviceId, plantId, plant.location, 
-          'moisture', sensorData.moisture, '%');
+          'moisture', sensorData.moisture, '%', 'good', timestamp);
       }
       if (sensorData.light !== undefined) {
         influxService.writeSensorData(plant.deviceId, plantId, plant.location, 
-          'light', sensorData.light, 'lux');
+          'light', sensorData.light, 'lux', 'good', timestamp);
+      }
+
+      // Historical samples only backfill the time series
+      if (!live) {
+        timer.end({ plantId, replayed: true });
+        return;
       }
 
       // Update current data in memory
@@ -253,6 +264,63 @@ class PlantService {
     }
   }
 
+  async updateSensorBatch(plantId, samples) {
+    const timer = createTimer('plantService.updateSensorBatch');
+    
+    try {
+      // Backfill every sample at its own time, then let the newest one
+      // update current data and online status like a live reading
+      const latest = samples[samples.length - 1];
+      for (const sample of samples.slice(0, -1)) {
+        await this.updateSensorData(plantId, sample, sample.sampledAt);
+      }
+      await this.updateSensorData(plantId, latest, latest.sampledAt, true);
+      
+      timer.end({ plantId, samples: samples.length });
+      
+    } catch (error) {
+      timer.end({ plantId, error: error.message });
+      throw error;
+    }
+  }
+
+  async updateSensorAggregates(plantId, aggregates) {
+    const plant = this.plants.get(plantId);
+    if (!plant) {
+      return;
+    }
+
+    const units = { temperature: '°C', humidity: '%', moisture: '%', light: 'lux' };
+    const windowEnd = new Date();
+    for (const [sensorType, unit] of Object.entries(units)) {
+      if (aggregates[sensorType]) {
+        influxService.writeSensorAggregate(plant.deviceId, plantId, plant.location, sensorType,
+          aggregates[sensorType], unit, aggregates.count, aggregates.window_ms, windowEnd);
+      }
+    }
+
+    // Sparse reporting: the summary is also a sign of life
+    plant.status.lastSeen = windowEnd.toISOString();
+    plant.status.isOnline = true;
+  }
+
+  async updateSampleRate(deviceId, change, changedAt = null) {
+    const plant = this.plants.get(deviceId);
+    if (!plant) {
+      return;
+    }
+
+    const timestamp = changedAt || new Date();
+    influxService.writeSampleRate(deviceId, change.mode, change.interval_ms, change.previous_interval_ms,
+      change.moisture_rate, change.battery_mv, timestamp);
+
+    plant.status.sampling = {
+      mode: change.mode,
+      intervalMs: change.interval_ms,
+      since: timestamp.toISOString()
+    };
+  }
+
   async createPlantFromSensorData(plantId, sensorData) {
     const newPlant = {
       id: plantId,
@@ -0,0 +1,206 @@
+// Binary telemetry frames sent by ESP32 firmware built with
+// TELEMETRY_FORMAT_PACKED. Layout is documented in esp32/src/telemetry_codec.h.
+
+export const FRAME_MAGIC = 0xA7;
+export const FRAME_VERSION = 1;
+export const FRAME_TYPES = {
+  SAMPLE: 1,
+  BATCH: 2
+};
+
+const FLAG_PUMP_ACTIVE = 0x01;
+const FLAG_REPLAYED = 0x02;
+const FLAG_HAS_AGE = 0x04;
+const FLAG_HAS_HEARTBEAT = 0x08;
+const FLAG_EPOCH = 0x10;
+
+const SAMPLE_FRAME_SIZE = 30;
+const BATCH_HEADER_SIZE = 16;
+const BATCH_FIELDS = 5;
+
+// Device timestamps are uptime ms (always below 2^32) until the device has
+// synced its clock, epoch ms after
+export const EPOCH_MIN_MS = 2 ** 32;
+
+export const isEpochTimestamp = (timestamp) => typeof timestamp === 'number' && timestamp >= EPOCH_MIN_MS;
+
+// With FLAG_EPOCH the boot_id field carries the high 16 bits of the timestamp
+const readTimestamp = (frame, lowOffset, highOffset, flags) => {
+  const low = frame.readUInt32LE(lowOffset);
+  return flags & FLAG_EPOCH ? frame.readUInt16LE(highOffset) * 2 ** 32 + low : low;
+};
+
+export const isBinaryFrame = (message) => {
+  return Buffer.isBuffer(message) && message.length >= 4 && message[0] === FRAME_MAGIC;
+};
+
+// Returns the same shape as the firmware's JSON payload so both formats
+// share one ingestion path
+const decodeSampleFrame = (frame, flags) => {
+  if (frame.length < SAMPLE_FRAME_SIZE) {
+    throw new Error(`Sample frame too short: ${frame.length} bytes`);
+  }
+
+  const replayed = (flags & FLAG_REPLAYED) !== 0;
+  const payload = {
+    timestamp: readTimestamp(frame, 4, 24, flags),
+    sensors: {
+      temperature: frame.readInt16LE(8) / 100,
+      humidity: frame.readUInt16LE(10) / 100,
+      moisture: frame.readUInt8(12),
+      light: frame.readUInt8(13),
+      pump_active: (flags & FLAG_PUMP_ACTIVE) !== 0
+    }
+  };
+
+  if (!(flags & FLAG_EPOCH)) {
+    payload.boot_id = frame.readUInt16LE(24);
+  }
+
+  if (replayed) {
+    payload.replayed = true;
+    if (flags & FLAG_HAS_AGE) {
+      payload.age_ms = frame.readUInt32LE(26);
+    }
+  } else {
+    payload.status = {
+      wifi_rssi: frame.readInt8(14),
+      free_heap: frame.readUInt32LE(16),
+      uptime: frame.readUInt32LE(20)
+    };
+  }
+
+  return payload;
+};
+
+const readVarint = (frame, state) => {
+  let value = 0;
+  let shift = 0;
+  let byte;
+  do {
+    if (state.offset >= frame.length) {
+      throw new Error('Truncated batch frame');
+    }
+    byte = frame[state.offset++];
+    value += (byte & 0x7F) * 2 ** shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  // Undo zigzag
+  return value % 2 === 0 ? value / 2 : -(value + 1) / 2;
+};
+
+// Returns the same shape as the firmware's JSON batch payload
+const decodeBatchFrame = (frame, flags) => {
+  if (frame.length < BATCH_HEADER_SIZE) {
+    throw new Error(`Batch frame too short: ${frame.length} bytes`);
+  }
+
+  const count = frame.readUInt8(14);
+  const timestamp = readTimestamp(frame, 4, 12, flags);
+  const payload = {
+    timestamp,
+    // Only the low 32 bits are sent; the send time is never before the base
+    sent_at: timestamp + ((frame.readUInt32LE(8) - frame.readUInt32LE(4)) >>> 0),
+    samples: []
+  };
+  if (!(flags & FLAG_EPOCH)) {
+    payload.boot_id = frame.readUInt16LE(12);
+  }
+
+  const state = { offset: BATCH_HEADER_SIZE };
+  if (flags & FLAG_HAS_HEARTBEAT) {
+    payload.heartbeat = {
+      wifi_rssi: frame.readInt8(16),
+      free_heap: frame.readUInt32LE(18),
+      uptime: frame.readUInt32LE(22)
+    };
+    state.offset += 10;
+  }
+
+  for (let i = 0; i < count; i++) {
+    const row = [];
+    for (let field = 0; field < BATCH_FIELDS; field++) {
+      row.push(readVarint(frame, state));
+    }
+    row.push(frame.readUInt8(state.offset++));
+    payload.samples.push(row);
+  }
+
+  return payload;
+};
+
+// Turn the delta rows of a batch (JSON or decoded binary) into absolute samples.
+// Epoch timestamps place samples directly; uptime-relative ones are placed
+// on the server clock by their age at send time.
+export const expandBatch = (payload, receivedAt = Date.now()) => {
+  if (!Array.isArray(payload?.samples)) {
+    throw new Error('Batch payload has no samples');
+  }
+
+  const values = [0, 0, 0, 0, 0];
+  const baseTimestamp = payload.timestamp ?? 0;
+  const sentAt = payload.sent_at ?? baseTimestamp;
+  const epoch = isEpochTimestamp(baseTimestamp);
+
+  return payload.samples.map((row) => {
+    for (let field = 0; field < BATCH_FIELDS; field++) {
+      values[field] += row[field];
+    }
+    const deviceTime = baseTimestamp + values[0];
+
+    return {
+      timestamp: deviceTime,
+      sampledAt: new Date(epoch ? deviceTime : receivedAt - (sentAt - deviceTime)),
+      temperature: values[1] / 100,
+      humidity: values[2] / 100,
+      moisture: values[3],
+      light: values[4],
+      pump_active: (row[BATCH_FIELDS] & FLAG_PUMP_ACTIVE) !== 0
+    };
+  });
+};
+
+// Rows of a gateway's evt/mesh batch (esp32/src/payloads.h) as samples
+// of the leaves that took them: [leaf, age_ms, temperature, humidity,
+// moisture, light, flags, zone_pumps, [zone moisture...]]
+export const expandMeshBatch = (payload, receivedAt = Date.now()) => {
+  if (!Array.isArray(payload?.samples)) {
+    throw new Error('Mesh payload has no samples');
+  }
+
+  const sentAt = isEpochTimestamp(payload.timestamp) ? payload.timestamp : receivedAt;
+
+  return payload.samples.map(([leaf, ageMs, temperature, humidity, moisture, light, flags, zonePumps, zones]) => ({
+    deviceId: `esp32_${leaf.toString(16)}`,
+    sampledAt: new Date(sentAt - ageMs),
+    temperature: temperature / 100,
+    humidity: humidity / 100,
+    moisture,
+    light,
+    pump_active: (flags & FLAG_PUMP_ACTIVE) !== 0,
+    zones: (zones || []).map((zoneMoisture, zone) => ({
+      moisture: zoneMoisture,
+      pump_active: (zonePumps & (1 << zone)) !== 0
+    }))
+  }));
+};
+
+export const decodeTelemetryFrame = (frame) => {
+  const version = frame[1];
+  const type = frame[2];
+  const flags = frame[3];
+
+  if (version !== FRAME_VERSION) {
+    throw new Error(`Unsupported telemetry frame version ${version}`);
+  }
+
+  switch (type) {
+    case FRAME_TYPES.SAMPLE:
+      return decodeSampleFrame(frame, flags);
+    case FRAME_TYPES.BATCH:
+      return decodeBatchFrame(frame, flags);
+    default:
+      throw new Error(`Unknown telemetry frame type ${type}`);
+  }
+};